@@ -0,0 +1,506 @@
+// Times the platform-neutral core (layout, drawing, labels, target search, schedules, keystroke
+// planning, pane output scanning, metrics, status files) against the headless backends, so its hot paths can be measured on any
+// platform. Built by the CMakeLists.txt at the top of the tree:
+//
+//   cmake -S . -B build && cmake --build build && ./build/CoreBench
+//
+// Each line is the average over the iterations, plus a checksum that keeps the optimizer honest.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Headless.h"
+#include "Keystrokes.h"
+#include "Metrics.h"
+#include "PatternScanner.h"
+#include "ProfileStore.h"
+#include "Schedule.h"
+#include "StatusJson.h"
+#include "TargetSearch.h"
+#include "Ui.h"
+
+namespace {
+	constexpr int ITERATIONS = 200000;
+
+	template<class Fn>
+	void Run(const char* name, int iterations, Fn fn) {
+		uint64_t checksum = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			checksum += fn(i);
+		}
+		double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count());
+		printf("%-28s %10.1f ns/op  (checksum %llu)\n", name, nanos / iterations, static_cast<unsigned long long>(checksum));
+	}
+
+	constexpr int SEARCH_ITEMS = 5000;
+	constexpr double FRAME_MICROS = 1000000.0 / 60;
+
+	// Queries typed a key at a time then erased, as in the TAB target list
+	const wchar_t* const TYPED_QUERIES[] = { L"code", L"chrome github", L"term claude", L"slack general", L"wt pwsh", L"qqzz" };
+
+	// What a busy desktop lists: a few dozen processes, many windows each, titles sharing words
+	void FillSearch(TargetSearch& search) {
+		static const wchar_t* const PROCESSES[] = { L"chrome.exe", L"Code.exe", L"WindowsTerminal.exe", L"slack.exe",
+			L"explorer.exe", L"OUTLOOK.EXE", L"Teams.exe", L"firefox.exe", L"devenv.exe", L"notepad.exe" };
+		static const wchar_t* const WORDS[] = { L"github", L"pull request", L"claude", L"general", L"inbox", L"build",
+			L"pwsh", L"release notes", L"design review", L"main.cpp", L"dashboard", L"meeting" };
+		wchar_t title[128];
+		for (int i = 0; i < SEARCH_ITEMS; i++) {
+			swprintf(title, 128, L"%ls - %ls #%d", WORDS[i % 12], WORDS[(i / 12) % 12], i);
+			search.Update(reinterpret_cast<TargetSearch::WindowHandle>(static_cast<uintptr_t>(i + 1)), PROCESSES[i % 10], title);
+		}
+	}
+
+	// What the query is after each key: every prefix of every query, then again while erasing
+	std::vector<std::wstring> TypedSequence() {
+		std::vector<std::wstring> sequence;
+		for (const wchar_t* typed : TYPED_QUERIES) {
+			std::wstring query;
+			for (const wchar_t* c = typed; *c; c++) {
+				query += *c;
+				sequence.push_back(query);
+			}
+			while (!query.empty()) {
+				query.pop_back();
+				sequence.push_back(query);
+			}
+		}
+		return sequence;
+	}
+
+	void PrintWorstKey(const TargetSearch& search) {
+		TargetSearch::Stats stats = search.GetStats();
+		double worst = static_cast<double>(stats.maxQueryTicks) * 1000000.0 / static_cast<double>(stats.ticksPerSecond);
+		printf("%-28s %10.1f us worst key  (%s a %.1f us frame)\n", "", worst, worst < FRAME_MICROS ? "within" : "OVER", FRAME_MICROS);
+	}
+
+	// Starting with a store of count profiles, written here and removed after: Open maps it and
+	// checks the header, Find binary searches the mapping. The page cache is warm, so this is the
+	// store's own cost rather than the disk's.
+	void BenchProfiles(int count) {
+		static const wchar_t PATH[] = L"CoreBench-profiles.bin";
+		Platform::RemoveFile(PATH);
+		std::vector<std::wstring> names;
+		uint64_t saveTicks = 0;
+		{
+			ProfileStore store;
+			store.Open(PATH);
+			wchar_t name[32];
+			for (int i = 0; i < count; i++) {
+				swprintf(name, 32, L"process%04d.exe", i);
+				names.push_back(name);
+				ProfileStore::Profile profile;
+				profile.processName = name;
+				profile.title = L"claude - ~/src/project";
+				profile.payload = L"Continue with the next step of the plan, then run the tests and fix anything that fails.";
+				profile.hourOffset = i % Ui::HOUR_COUNT;
+				profile.lastUsed = 1790000000 + i;
+				if (!store.Save(profile)) {
+					printf("could not save profiles\n");
+					return;
+				}
+			}
+			saveTicks = store.GetStats().saveTicks;
+		}
+
+		char label[48];
+		snprintf(label, sizeof(label), "ProfileStore Open+Find (%d)", count);
+		Run(label, ITERATIONS / 100, [&](int i) {
+			ProfileStore store;
+			store.Open(PATH);
+			ProfileStore::ProfileView view;
+			return static_cast<uint64_t>(store.Find(names[i % names.size()], view) ? view.hourOffset + 1 : 0);
+		});
+		printf("%-28s %10.1f us to save the %dth\n", "", static_cast<double>(saveTicks) * 1000000.0 / static_cast<double>(Platform::TicksPerSecond()), count);
+		Platform::RemoveFile(PATH);
+	}
+
+	constexpr size_t SCAN_BYTES = 32 * 1024 * 1024;
+	constexpr size_t SCAN_MAX_CHUNK = 64 * 1024;
+	constexpr int SCAN_PASSES = 4;
+
+	// What the app watches panes for
+	const char* const SCAN_PATTERNS[] = { "limit reached", "reset at ", "resets ", "esc to interrupt" };
+
+	struct ScanMatch {
+		uint32_t pattern;
+		uint64_t offset;
+
+		bool operator<(const ScanMatch& other) const {
+			return offset != other.offset ? offset < other.offset : pattern < other.pattern;
+		}
+		bool operator!=(const ScanMatch& other) const {
+			return pattern != other.pattern || offset != other.offset;
+		}
+	};
+
+	// Deterministic, so runs can be compared
+	uint32_t Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	// Terminal output: words, line breaks, colour escapes, near misses that pass the two-byte
+	// filter, and now and then one of the patterns in any case
+	std::string PaneOutput() {
+		static const char* const WORDS[] = { "the", "build", "passed", "\x1b[32m", "\x1b[0m", "li", "limit", "reach",
+			"res", "reset", "es", "esc to", "warning:", "src/main.cpp", "12", "tests", "\r\n" };
+		std::string text;
+		text.reserve(SCAN_BYTES + 64);
+		uint32_t state = 0xC0FFEE;
+		while (text.size() < SCAN_BYTES) {
+			uint32_t pick = Random(state);
+			if (pick % 97 == 0) {
+				const char* pattern = SCAN_PATTERNS[pick / 97 % 4];
+				for (const char* c = pattern; *c; c++) {
+					text += Random(state) % 3 == 0 && *c >= 'a' && *c <= 'z' ? static_cast<char>(*c - 32) : *c;
+				}
+			}
+			else {
+				text += WORDS[pick % (sizeof(WORDS) / sizeof(WORDS[0]))];
+			}
+			text += pick % 11 == 0 ? '\n' : ' ';
+		}
+		text.resize(SCAN_BYTES);
+		return text;
+	}
+
+	// Feeds text through the scanner in chunks of random size, from one byte (so every seam
+	// shape comes up) to SCAN_MAX_CHUNK. Returns the ticks spent in Scan.
+	uint64_t ScanChunked(PatternScanner& scanner, const std::string& text, uint32_t seed, std::vector<ScanMatch>* matches) {
+		PatternScanner::Stream stream;
+		uint64_t before = scanner.GetStats().scanTicks;
+		uint32_t state = seed;
+		for (size_t at = 0; at < text.size();) {
+			uint32_t pick = Random(state);
+			size_t length = pick % 4 == 0 ? 1 + pick / 4 % 128 : 1 + pick / 4 % SCAN_MAX_CHUNK;
+			if (length > text.size() - at) length = text.size() - at;
+			scanner.Scan(stream, text.data() + at, length, [&](uint32_t pattern, uint64_t offset) {
+				if (matches) matches->push_back(ScanMatch{ pattern, offset });
+			});
+			at += length;
+		}
+		return scanner.GetStats().scanTicks - before;
+	}
+
+	// Matches from random chunks, vector and scalar, must equal the scalar scan of the whole
+	// buffer, seams included. Then the throughput of both over the same chunking.
+	bool BenchPatternScanner() {
+		std::string text = PaneOutput();
+		PatternScanner simd;
+		PatternScanner scalar(false);
+		for (const char* pattern : SCAN_PATTERNS) {
+			simd.Add(pattern);
+			scalar.Add(pattern);
+		}
+
+		std::vector<ScanMatch> expected;
+		{
+			PatternScanner whole(false);
+			for (const char* pattern : SCAN_PATTERNS) {
+				whole.Add(pattern);
+			}
+			PatternScanner::Stream stream;
+			whole.Scan(stream, text.data(), text.size(), [&](uint32_t pattern, uint64_t offset) {
+				expected.push_back(ScanMatch{ pattern, offset });
+			});
+		}
+		std::sort(expected.begin(), expected.end());
+
+		bool ok = true;
+		for (int pass = 0; pass < SCAN_PASSES; pass++) {
+			uint32_t seed = 0x5EED + static_cast<uint32_t>(pass);
+			for (PatternScanner* scanner : { &simd, &scalar }) {
+				std::vector<ScanMatch> matches;
+				matches.reserve(expected.size());
+				ScanChunked(*scanner, text, seed, &matches);
+				std::sort(matches.begin(), matches.end());
+				if (matches.size() != expected.size() || !std::equal(matches.begin(), matches.end(), expected.begin(),
+					[](const ScanMatch& a, const ScanMatch& b) { return !(a != b); })) {
+					printf("PatternScanner (%s) found %zu matches in random chunks, %zu expected\n",
+						scanner == &simd ? "simd" : "scalar", matches.size(), expected.size());
+					ok = false;
+				}
+			}
+		}
+
+		double ticksPerSecond = static_cast<double>(Platform::TicksPerSecond());
+		for (PatternScanner* scanner : { &simd, &scalar }) {
+			uint64_t ticks = 0;
+			for (int pass = 0; pass < SCAN_PASSES; pass++) {
+				ticks += ScanChunked(*scanner, text, 0xBEEF + static_cast<uint32_t>(pass), nullptr);
+			}
+			double seconds = static_cast<double>(ticks) / ticksPerSecond;
+			double gigabytes = static_cast<double>(text.size()) * SCAN_PASSES / 1e9;
+			PatternScanner::Stats stats = scanner->GetStats();
+			printf("%-28s %10.2f GB/s  (%zu matches, %.1f candidates/KB)\n", scanner == &simd ? "PatternScanner (chunks)" : "PatternScanner (scalar)",
+				seconds > 0.0 ? gigabytes / seconds : 0.0, expected.size(),
+				static_cast<double>(stats.candidates) * 1024.0 / static_cast<double>(stats.bytesScanned));
+		}
+		return ok;
+	}
+
+	constexpr int MIXED_RULES = 100000;
+
+	// Every shape of rule, with times and cadences spread so no two in a row are alike
+	bool CompileMixedRules(const Clock& clock, std::vector<Recurrence>& rules) {
+		static const char* const DAYS[] = { "daily", "weekdays", "weekends", "mon,wed,fri", "sat", "tue,thu" };
+		uint32_t state = 0xDA75;
+		char text[64];
+		rules.resize(MIXED_RULES);
+		for (int i = 0; i < MIXED_RULES; i++) {
+			uint32_t pick = Random(state);
+			if (i % 2) {
+				snprintf(text, sizeof(text), "%s at %02u:%02u:%02u", DAYS[pick % 6], pick / 6 % 24, pick / 144 % 60, pick / 8640 % 60);
+			}
+			else {
+				snprintf(text, sizeof(text), "every %uh%um from %02u:%02u", pick % 12, 1 + pick / 12 % 59, pick / 708 % 24, pick / 16992 % 60);
+			}
+			if (!Recurrence::Compile(text, clock, rules[i])) {
+				printf("rule did not compile: %s\n", text);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	constexpr int METRIC_OPS_PER_THREAD = 2000000;
+	constexpr unsigned MAX_METRIC_THREADS = 8;
+
+	// Latencies spread over the histogram's exact and log-linear range, as the app records them
+	uint64_t LatencyMicros(int i) {
+		return static_cast<uint64_t>((i * 2654435761u) >> (i % 24 + 8));
+	}
+
+	// Every thread records into the same counter and histogram, the way the render and loop
+	// threads share them in the app. The totals must come out exact.
+	bool BenchMetricsThreads(unsigned threadCount) {
+		Metrics::Counter counter;
+		Metrics::Histogram histogram;
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < threadCount; t++) {
+			threads.emplace_back([&]() {
+				for (int i = 0; i < METRIC_OPS_PER_THREAD; i++) {
+					counter.Add();
+					histogram.Record(LatencyMicros(i));
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count());
+
+		uint64_t expected = static_cast<uint64_t>(threadCount) * METRIC_OPS_PER_THREAD;
+		char label[48];
+		snprintf(label, sizeof(label), "Add+Record (%u thread%s)", threadCount, threadCount == 1 ? "" : "s");
+		printf("%-28s %10.1f ns/op per thread  (%.1f M/s in all)\n", label, nanos / METRIC_OPS_PER_THREAD,
+			static_cast<double>(expected) * 1000.0 / nanos);
+		if (counter.Value() != expected || histogram.Count() != expected) {
+			printf("lost updates: counter %llu, histogram %llu, expected %llu\n", static_cast<unsigned long long>(counter.Value()),
+				static_cast<unsigned long long>(histogram.Count()), static_cast<unsigned long long>(expected));
+			return false;
+		}
+		return true;
+	}
+
+	bool BenchMetrics() {
+		Metrics::Counter counter;
+		Metrics::Histogram histogram;
+		Run("Counter::Add", ITERATIONS * 10, [&](int) {
+			counter.Add();
+			return uint64_t(1);
+		});
+		Run("Histogram::Record", ITERATIONS * 10, [&](int i) {
+			histogram.Record(LatencyMicros(i));
+			return uint64_t(1);
+		});
+
+		unsigned cores = std::thread::hardware_concurrency();
+		unsigned most = cores < 2 ? 2 : cores > MAX_METRIC_THREADS ? MAX_METRIC_THREADS : cores;
+		bool ok = true;
+		for (unsigned threadCount = 1; threadCount <= most; threadCount *= 2) {
+			ok = BenchMetricsThreads(threadCount) && ok;
+		}
+		return ok;
+	}
+
+	// US layout for printable ASCII, VkKeyScanW-style
+	int16_t AsciiKeyScan(wchar_t c) {
+		if (c >= L'a' && c <= L'z') return static_cast<int16_t>('A' + (c - L'a'));
+		if (c >= L'A' && c <= L'Z') return static_cast<int16_t>(0x100 | c);
+		if (c >= L'0' && c <= L'9') return static_cast<int16_t>(c);
+		if (c == L' ') return 0x20;
+		if (c == L'\n') return 0x0D;
+		if (c >= 0x21 && c < 0x7F) return 0xBA;
+		return -1;
+	}
+}
+
+int main() {
+	SystemClock clock;
+	Headless::TextMeasurer measurer;
+	Headless::Canvas canvas;
+	Ui::Layout layout;
+
+	// Every iteration a new width, like a live resize
+	Run("ComputeLayout (reflow)", ITERATIONS, [&](int i) {
+		Ui::ComputeLayout(400.0f + static_cast<float>(i % 600), measurer, layout);
+		return static_cast<uint64_t>(layout.totalContentHeight);
+	});
+
+	Run("ComputeLayout (same width)", ITERATIONS, [&](int) {
+		Ui::ComputeLayout(500.0f, measurer, layout);
+		return static_cast<uint64_t>(layout.totalContentHeight);
+	});
+
+	Ui::Frame frame;
+	frame.appState = Ui::AppState::Waiting;
+	frame.hasTarget = true;
+	frame.timerActive = true;
+	frame.mouseX = 100.0f;
+	frame.mouseY = 300.0f;
+	frame.layout = layout;
+	wcscpy(frame.targetLabelName, L"WindowsTerminal.exe");
+	wcscpy(frame.targetLabelDetail, L"\"claude\" (0x1A2B3C)");
+
+	Run("FormatCountdown", ITERATIONS, [&](int i) {
+		Ui::FormatCountdown(clock, clock.Now() + std::chrono::seconds(i), frame.countdownText);
+		return static_cast<uint64_t>(frame.countdownText[12]);
+	});
+
+	Run("FormatHourLabels", ITERATIONS / 10, [&](int) {
+		Ui::FormatHourLabels(clock, frame.hourLabels);
+		return static_cast<uint64_t>(frame.hourLabels[0][0]);
+	});
+
+	Run("DrawContent", ITERATIONS, [&](int) {
+		canvas.Clear();
+		Ui::DrawContent(frame, canvas);
+		return static_cast<uint64_t>(canvas.Ops().size());
+	});
+
+	int hour = 0;
+	Run("HitTest", ITERATIONS, [&](int i) {
+		return static_cast<uint64_t>(Ui::HitTest(layout, static_cast<float>(i % 500), static_cast<float>(i % 450), hour));
+	});
+
+	// Per keystroke over 5k windows, incremental, then with the list changing under every key
+	std::vector<std::wstring> typed = TypedSequence();
+	{
+		TargetSearch search;
+		FillSearch(search);
+		Run("TargetSearch (5k, per key)", ITERATIONS / 100, [&](int i) {
+			search.SetQuery(typed[i % typed.size()]);
+			return static_cast<uint64_t>(search.ResultCount());
+		});
+		PrintWorstKey(search);
+	}
+	{
+		TargetSearch search;
+		FillSearch(search);
+		Run("TargetSearch (5k, rescan)", ITERATIONS / 100, [&](int i) {
+			search.Update(reinterpret_cast<TargetSearch::WindowHandle>(static_cast<uintptr_t>(i % SEARCH_ITEMS + 1)), L"Code.exe", L"main.cpp - arcc");
+			search.SetQuery(typed[i % typed.size()]);
+			return static_cast<uint64_t>(search.ResultCount());
+		});
+		PrintWorstKey(search);
+	}
+
+	Recurrence weekdays;
+	Recurrence interval;
+	if (!Recurrence::Compile("weekdays at 08:30", clock, weekdays) || !Recurrence::Compile("every 5h from 09:00", clock, interval)) {
+		printf("rule did not compile\n");
+		return 1;
+	}
+	Clock::time_point now = clock.Now();
+	Run("Recurrence::Next (days)", ITERATIONS / 10, [&](int i) {
+		return static_cast<uint64_t>(weekdays.Next(now + std::chrono::hours(i), clock).time_since_epoch().count());
+	});
+	Run("Recurrence::Next (interval)", ITERATIONS, [&](int i) {
+		return static_cast<uint64_t>(interval.Next(now + std::chrono::hours(i), clock).time_since_epoch().count());
+	});
+
+	// A large table of mixed rules, each asked for its next occurrence at a different time. Day
+	// rules go through the calendar twice, cadences are arithmetic, so they are also timed apart.
+	std::vector<Recurrence> mixed;
+	if (!CompileMixedRules(clock, mixed)) return 1;
+	std::vector<Recurrence> mixedDays;
+	std::vector<Recurrence> mixedIntervals;
+	for (const Recurrence& rule : mixed) {
+		(rule.kind == Recurrence::Kind::Days ? mixedDays : mixedIntervals).push_back(rule);
+	}
+	Run("Recurrence::Next (100k mixed)", MIXED_RULES, [&](int i) {
+		return static_cast<uint64_t>(mixed[i].Next(now + std::chrono::minutes(i), clock).time_since_epoch().count());
+	});
+	Run("  days", static_cast<int>(mixedDays.size()), [&](int i) {
+		return static_cast<uint64_t>(mixedDays[i].Next(now + std::chrono::minutes(i), clock).time_since_epoch().count());
+	});
+	Run("  interval", static_cast<int>(mixedIntervals.size()), [&](int i) {
+		return static_cast<uint64_t>(mixedIntervals[i].Next(now + std::chrono::minutes(i), clock).time_since_epoch().count());
+	});
+
+	// A week of a job every 5 hours plus one-shots, stepped on virtual time
+	Run("Scheduler::Simulate (week)", 100, [&](int) {
+		VirtualClock virtualClock(now);
+		Scheduler scheduler;
+		scheduler.ArmRecurring(interval, virtualClock, 1);
+		for (int h = 1; h <= 24; h++) {
+			scheduler.Arm(now + std::chrono::hours(h), 2);
+		}
+		Scheduler::RunStats stats = scheduler.Simulate(virtualClock, now + std::chrono::hours(24 * 7), [](const Scheduler::Job&) {});
+		return stats.fired;
+	});
+
+	Headless::InputSink sink;
+	static const wchar_t PROMPT[] = L"Continue with the next step of the plan, then run the tests and fix anything that fails.";
+	Run("Keystrokes::Plan", ITERATIONS / 10, [&](int) {
+		sink.Clear();
+		Keystrokes::Plan(PROMPT, wcslen(PROMPT), AsciiKeyScan, true, sink);
+		return static_cast<uint64_t>(sink.Keys().size());
+	});
+
+	// A multi-kilobyte continuation prompt with line breaks, as bulk delivery plans it
+	std::wstring bulkPrompt;
+	while (bulkPrompt.size() < 4096) {
+		bulkPrompt += PROMPT;
+		bulkPrompt += L'\n';
+	}
+	Run("Keystrokes::PlanUnicode (4 KB)", ITERATIONS / 100, [&](int) {
+		sink.Clear();
+		Keystrokes::PlanUnicode(bulkPrompt.c_str(), bulkPrompt.size(), true, sink);
+		return static_cast<uint64_t>(sink.Keys().size());
+	});
+
+	// A usage status file, whole, and an appended log line on its own
+	static const char STATUS[] = "{\"session\":{\"id\":\"4f1c2a\",\"model\":\"default\"},\"usage\":{\"input_tokens\":182233,"
+		"\"output_tokens\":40122,\"percent\":97.5,\"windows\":[{\"kind\":\"5h\",\"resets_at\":\"2026-10-18T15:00:00Z\"}]}}";
+	static const char LOG_LINE[] = "{\"type\":\"rate_limit\",\"resetsAt\":1792335600}\n";
+	StatusJsonScanner scanner;
+	Run("StatusJsonScanner (document)", ITERATIONS / 10, [&](int) {
+		scanner.Reset();
+		scanner.Feed(STATUS, sizeof(STATUS) - 1, clock);
+		return static_cast<uint64_t>(scanner.ResetTime().time_since_epoch().count());
+	});
+	Run("StatusJsonScanner (log line)", ITERATIONS, [&](int) {
+		scanner.Feed(LOG_LINE, sizeof(LOG_LINE) - 1, clock);
+		return scanner.ValueCount();
+	});
+
+	if (!BenchPatternScanner()) return 1;
+	if (!BenchMetrics()) return 1;
+
+	BenchProfiles(100);
+	BenchProfiles(1000);
+
+	printf("measured %llu texts\n", static_cast<unsigned long long>(measurer.MeasureCount()));
+	return 0;
+}
@@ -0,0 +1,562 @@
+// Times resume delivery end to end on Linux, against local stand-ins for the targets the app
+// types into. Every run arms a job with the core Scheduler a few milliseconds ahead, sleeps to the
+// deadline, fires it and delivers the payload; a receiver thread timestamps what the target sees.
+// Each run gives four stages, all measured from the deadline:
+//   fired    the job ran (wake lateness)
+//   first    the target saw the first character
+//   payload  it saw the whole payload
+//   enter    it saw Enter after it
+//
+//   ./build/DeliveryBench [--runs N] [--payload CHARS] [--backend pty|tmux|x11-sim] [--csv FILE] [--json FILE]
+//
+// Backends:
+//   pty      written to a pty master the way a terminal forwards typed keys: a write per
+//            character, then CR in a write of its own; the target reads the raw slave
+//   tmux     "send-keys -l" and "send-keys Enter" through one persistent "tmux -C" client, like
+//            TmuxControl; the pane runs "stty raw -echo; cat" into a FIFO the target reads. tmux
+//            writes the text to the pane in one go, so first to payload there is only the copy
+//            through the pane. Skipped if tmux isn't installed
+//   x11-sim  a stand-in for an X display, not one: Keystrokes::Plan's key events each go as one
+//            packet over a socket (as XTest requests would) to a display thread that turns key
+//            downs back into characters. No X server is involved, so this is the planning and
+//            per-event cost only
+//
+// The target reads bytes one at a time, so each character gets its own stamp even when several
+// arrive together. Prints p50/p90/p99 per backend and stage, and writes them as CSV or JSON if
+// asked.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include "Keystrokes.h"
+#include "Platform.h"
+#include "Schedule.h"
+
+extern char** environ;
+
+namespace {
+	constexpr int DEFAULT_RUNS = 200;
+	constexpr int WARMUP_RUNS = 3;
+	constexpr size_t DEFAULT_PAYLOAD = 90;
+	constexpr int ARM_LEAD_MS = 2;
+	constexpr int RUN_TIMEOUT_MS = 2000;
+	constexpr int POLL_MS = 50;
+	const char* const PAYLOAD_TEXT = "Continue with the next step of the plan, then run the tests and fix anything that fails. ";
+
+	enum Stage { STAGE_FIRED, STAGE_FIRST, STAGE_PAYLOAD, STAGE_ENTER, STAGE_COUNT };
+	const char* const STAGE_NAMES[STAGE_COUNT] = { "fired", "first", "payload", "enter" };
+
+	// One key event as the x11-sim stand-in sends it
+	struct KeyPacket {
+		uint8_t virtualKey;
+		uint8_t up;
+	};
+
+	struct Stamps {
+		uint64_t first = 0;
+		uint64_t payload = 0;
+		uint64_t enter = 0;
+	};
+
+	// Reads what the target gets on its own thread and stamps the first character, the last one
+	// of the payload and the Enter after it. Bytes for pty and tmux, read one per call so a read
+	// never stamps several stages at once; KeyPackets for x11-sim, one per packet.
+	class Receiver {
+	public:
+		Receiver(int fd, bool keyEvents, size_t units) : m_fd(fd), m_bKeyEvents(keyEvents), m_units(units) {
+			m_thread = std::thread([this]() { Loop(); });
+		}
+
+		~Receiver() {
+			m_bStop = true;
+			m_thread.join();
+		}
+
+		Receiver(const Receiver&) = delete;
+		Receiver& operator=(const Receiver&) = delete;
+
+		// Waits for the current run's Enter. False on timeout, which also starts the count over.
+		bool Wait(Stamps& stamps) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			bool done = m_done.wait_for(lock, std::chrono::milliseconds(RUN_TIMEOUT_MS), [this]() { return m_bComplete; });
+			stamps = m_stamps;
+			m_bComplete = false;
+			m_count = 0;
+			m_stamps = Stamps();
+			return done;
+		}
+
+	private:
+		int m_fd;
+		bool m_bKeyEvents;
+		size_t m_units;
+		std::atomic<bool> m_bStop{ false };
+		std::thread m_thread;
+
+		std::mutex m_mutex;
+		std::condition_variable m_done;
+		size_t m_count = 0;
+		Stamps m_stamps;
+		bool m_bComplete = false;
+
+		void Loop() {
+			char buffer[4096];
+			size_t readSize = m_bKeyEvents ? sizeof(buffer) : 1;
+			while (!m_bStop) {
+				pollfd wait = { m_fd, POLLIN, 0 };
+				if (poll(&wait, 1, POLL_MS) <= 0) continue;
+				ssize_t read = ::read(m_fd, buffer, readSize);
+				uint64_t now = Platform::Ticks();
+				if (read <= 0) continue;
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_bKeyEvents) {
+					for (ssize_t i = 0; i + static_cast<ssize_t>(sizeof(KeyPacket)) <= read; i += sizeof(KeyPacket)) {
+						KeyPacket packet;
+						memcpy(&packet, buffer + i, sizeof(packet));
+						if (packet.up || packet.virtualKey == Keystrokes::KEY_SHIFT) continue;
+						Unit(packet.virtualKey == Keystrokes::KEY_RETURN, now);
+					}
+				}
+				else {
+					for (ssize_t i = 0; i < read; i++) {
+						Unit(buffer[i] == '\r' || buffer[i] == '\n', now);
+					}
+				}
+			}
+		}
+
+		void Unit(bool enter, uint64_t now) {
+			if (m_bComplete) return;
+			if (enter) {
+				if (m_count < m_units) return;
+				m_stamps.enter = now;
+				m_bComplete = true;
+				m_done.notify_one();
+				return;
+			}
+			if (m_count == 0) m_stamps.first = now;
+			if (++m_count == m_units) m_stamps.payload = now;
+		}
+	};
+
+	// Delivers one payload to its target, from the thread that fired the job
+	class Backend {
+	public:
+		virtual ~Backend() = default;
+		virtual const char* Name() const = 0;
+		virtual bool Deliver() = 0;
+		virtual Receiver& Target() = 0;
+	};
+
+	bool WriteAll(int fd, const char* data, size_t length) {
+		while (length > 0) {
+			ssize_t written = write(fd, data, length);
+			if (written <= 0) return false;
+			data += written;
+			length -= static_cast<size_t>(written);
+		}
+		return true;
+	}
+
+	class PtyBackend : public Backend {
+	public:
+		explicit PtyBackend(const std::string& payload) : m_payload(payload) {}
+
+		~PtyBackend() override {
+			m_pReceiver.reset();
+			if (m_slave >= 0) close(m_slave);
+			if (m_master >= 0) close(m_master);
+		}
+
+		bool Open() {
+			m_master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+			if (m_master < 0 || grantpt(m_master) != 0 || unlockpt(m_master) != 0) return false;
+			const char* name = ptsname(m_master);
+			m_slave = name ? open(name, O_RDWR | O_NOCTTY | O_CLOEXEC) : -1;
+			if (m_slave < 0) return false;
+
+			// Raw, like a full-screen CLI: no line buffering, no echo, CR stays CR
+			termios mode;
+			if (tcgetattr(m_slave, &mode) != 0) return false;
+			cfmakeraw(&mode);
+			if (tcsetattr(m_slave, TCSANOW, &mode) != 0) return false;
+
+			m_pReceiver.reset(new Receiver(m_slave, false, m_payload.size()));
+			return true;
+		}
+
+		const char* Name() const override { return "pty"; }
+
+		// A key at a time, then Enter on its own, as typed input reaches a terminal's program
+		bool Deliver() override {
+			for (char c : m_payload) {
+				if (!WriteAll(m_master, &c, 1)) return false;
+			}
+			return WriteAll(m_master, "\r", 1);
+		}
+
+		Receiver& Target() override { return *m_pReceiver; }
+
+	private:
+		std::string m_payload;
+		int m_master = -1;
+		int m_slave = -1;
+		std::unique_ptr<Receiver> m_pReceiver;
+	};
+
+	class TmuxBackend : public Backend {
+	public:
+		explicit TmuxBackend(const std::string& payload) {
+			char name[64];
+			snprintf(name, sizeof(name), "arcc-bench-%ld", static_cast<long>(getpid()));
+			m_socket = name;
+			m_fifo = std::string("/tmp/") + name + ".fifo";
+			m_units = payload.size();
+
+			// As TmuxControl::SendKeys: the literal text, then Enter, in one write
+			m_command = "send-keys -t bench -l '";
+			for (char c : payload) {
+				if (c == '\'') m_command += "'\\''";
+				else m_command += c;
+			}
+			m_command += "'\nsend-keys -t bench Enter\n";
+		}
+
+		~TmuxBackend() override {
+			m_pReceiver.reset();
+			if (m_input >= 0) close(m_input);     // The client detaches and exits
+			if (m_client > 0) waitpid(m_client, nullptr, 0);
+			if (m_drain.joinable()) m_drain.join();
+			if (m_output >= 0) close(m_output);
+			if (m_bServer) Tmux("kill-server");
+			if (m_fifoFd >= 0) close(m_fifoFd);
+			unlink(m_fifo.c_str());
+		}
+
+		static bool Available() {
+			return system("tmux -V >/dev/null 2>&1") == 0;
+		}
+
+		bool Open() {
+			unlink(m_fifo.c_str());
+			if (mkfifo(m_fifo.c_str(), 0600) != 0) return false;
+			// Read-write, so neither side's open blocks and the reader never sees EOF
+			m_fifoFd = open(m_fifo.c_str(), O_RDWR | O_CLOEXEC);
+			if (m_fifoFd < 0) return false;
+
+			std::string session = "new-session -d -s bench -x 200 -y 50 \"stty raw -echo; exec cat > " + m_fifo + "\"";
+			if (!Tmux(session.c_str())) return false;
+			m_bServer = true;
+
+			// The control-mode client, its stdin for commands and stdout drained
+			int input[2];
+			int output[2];
+			if (pipe2(input, O_CLOEXEC) != 0) return false;
+			if (pipe2(output, O_CLOEXEC) != 0) {
+				close(input[0]);
+				close(input[1]);
+				return false;
+			}
+			posix_spawn_file_actions_t actions;
+			posix_spawn_file_actions_init(&actions);
+			posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+			posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+			posix_spawn_file_actions_adddup2(&actions, output[1], STDERR_FILENO);
+			const char* argv[] = { "tmux", "-L", m_socket.c_str(), "-C", "attach-session", "-t", "bench", nullptr };
+			int spawned = posix_spawnp(&m_client, "tmux", &actions, nullptr, const_cast<char* const*>(argv), environ);
+			posix_spawn_file_actions_destroy(&actions);
+			close(input[0]);
+			close(output[1]);
+			m_input = input[1];
+			m_output = output[0];
+			if (spawned != 0) {
+				m_client = 0;
+				return false;
+			}
+			m_drain = std::thread([this]() {
+				char buffer[4096];
+				while (read(m_output, buffer, sizeof(buffer)) > 0) {}
+			});
+
+			m_pReceiver.reset(new Receiver(m_fifoFd, false, m_units));
+			return true;
+		}
+
+		const char* Name() const override { return "tmux"; }
+
+		bool Deliver() override {
+			return WriteAll(m_input, m_command.data(), m_command.size());
+		}
+
+		Receiver& Target() override { return *m_pReceiver; }
+
+	private:
+		std::string m_socket;
+		std::string m_fifo;
+		std::string m_command;
+		size_t m_units = 0;
+		bool m_bServer = false;
+		int m_fifoFd = -1;
+		int m_input = -1;
+		int m_output = -1;
+		pid_t m_client = 0;
+		std::thread m_drain;
+		std::unique_ptr<Receiver> m_pReceiver;
+
+		bool Tmux(const char* command) {
+			std::string line = "tmux -L " + m_socket + " -f /dev/null " + command + " >/dev/null 2>&1";
+			return system(line.c_str()) == 0;
+		}
+	};
+
+	// US layout for printable ASCII, VkKeyScanW-style
+	int16_t AsciiKeyScan(wchar_t c) {
+		if (c >= L'a' && c <= L'z') return static_cast<int16_t>('A' + (c - L'a'));
+		if (c >= L'A' && c <= L'Z') return static_cast<int16_t>(0x100 | c);
+		if (c >= L'0' && c <= L'9') return static_cast<int16_t>(c);
+		if (c == L' ') return 0x20;
+		if (c >= 0x21 && c < 0x7F) return 0xBA;
+		return -1;
+	}
+
+	class X11Backend : public Backend, private InputSink {
+	public:
+		explicit X11Backend(const std::string& payload) : m_payload(payload.begin(), payload.end()) {}
+
+		~X11Backend() override {
+			m_pReceiver.reset();
+			if (m_display >= 0) close(m_display);
+			if (m_client >= 0) close(m_client);
+		}
+
+		bool Open() {
+			int pair[2];
+			if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0) return false;
+			m_client = pair[0];
+			m_display = pair[1];
+			m_pReceiver.reset(new Receiver(m_display, true, m_payload.size()));
+			return true;
+		}
+
+		const char* Name() const override { return "x11-sim"; }
+
+		bool Deliver() override {
+			m_bFailed = false;
+			Keystrokes::Plan(m_payload.c_str(), m_payload.size(), AsciiKeyScan, true, *this);
+			return !m_bFailed;
+		}
+
+		Receiver& Target() override { return *m_pReceiver; }
+
+	private:
+		std::wstring m_payload;
+		int m_client = -1;
+		int m_display = -1;
+		bool m_bFailed = false;
+		std::unique_ptr<Receiver> m_pReceiver;
+
+		// Sent as planned, one request per event
+		void Key(uint8_t virtualKey, bool up) override {
+			KeyPacket packet = { virtualKey, static_cast<uint8_t>(up ? 1 : 0) };
+			if (send(m_client, &packet, sizeof(packet), MSG_NOSIGNAL) != sizeof(packet)) m_bFailed = true;
+		}
+
+		void Unicode(wchar_t, bool) override {
+			m_bFailed = true;
+		}
+	};
+
+	struct Result {
+		const char* backend = nullptr;
+		int runs = 0;
+		int timeouts = 0;
+		std::vector<uint64_t> stages[STAGE_COUNT];     // Platform::Ticks after the deadline
+	};
+
+	uint64_t TicksFrom(std::chrono::system_clock::duration duration) {
+		uint64_t nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+		return nanos * Platform::TicksPerSecond() / 1000000000;
+	}
+
+	double Micros(uint64_t ticks) {
+		return static_cast<double>(ticks) * 1e6 / static_cast<double>(Platform::TicksPerSecond());
+	}
+
+	double Percentile(const std::vector<uint64_t>& sorted, double fraction) {
+		if (sorted.empty()) return 0.0;
+		return Micros(sorted[static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5)]);
+	}
+
+	// Arms a job per run and delivers when the scheduler fires it
+	void Measure(Backend& backend, int runs, Result& result) {
+		SystemClock clock;
+		Scheduler scheduler;
+		result.backend = backend.Name();
+		for (int run = -WARMUP_RUNS; run < runs; run++) {
+			Clock::time_point armed = clock.Now();
+			uint64_t armedTicks = Platform::Ticks();
+			Clock::time_point deadline = armed + std::chrono::milliseconds(ARM_LEAD_MS);
+			uint64_t deadlineTicks = armedTicks + TicksFrom(deadline - armed);
+			scheduler.Arm(deadline, 0);
+
+			uint64_t firedTicks = 0;
+			bool delivered = false;
+			while (!scheduler.Empty()) {
+				std::this_thread::sleep_until(scheduler.NextDeadline());
+				scheduler.RunDue(clock, [&](const Scheduler::Job&) {
+					firedTicks = Platform::Ticks();
+					delivered = backend.Deliver();
+				});
+			}
+
+			Stamps stamps;
+			bool received = backend.Target().Wait(stamps);
+			if (run < 0) continue;
+			result.runs++;
+			if (!delivered || !received) {
+				result.timeouts++;
+				continue;
+			}
+			auto since = [&](uint64_t ticks) { return ticks > deadlineTicks ? ticks - deadlineTicks : 0; };
+			result.stages[STAGE_FIRED].push_back(since(firedTicks));
+			result.stages[STAGE_FIRST].push_back(since(stamps.first));
+			result.stages[STAGE_PAYLOAD].push_back(since(stamps.payload));
+			result.stages[STAGE_ENTER].push_back(since(stamps.enter));
+		}
+		for (std::vector<uint64_t>& stage : result.stages) {
+			std::sort(stage.begin(), stage.end());
+		}
+	}
+
+	void WriteCsv(FILE* file, const std::vector<Result>& results) {
+		fprintf(file, "backend,stage,runs,timeouts,p50_us,p90_us,p99_us\n");
+		for (const Result& result : results) {
+			for (int stage = 0; stage < STAGE_COUNT; stage++) {
+				fprintf(file, "%s,%s,%d,%d,%.1f,%.1f,%.1f\n", result.backend, STAGE_NAMES[stage], result.runs, result.timeouts,
+					Percentile(result.stages[stage], 0.50), Percentile(result.stages[stage], 0.90), Percentile(result.stages[stage], 0.99));
+			}
+		}
+	}
+
+	void WriteJson(FILE* file, const std::vector<Result>& results, size_t payloadChars) {
+		fprintf(file, "{\"payloadChars\":%zu,\"backends\":[", payloadChars);
+		for (size_t i = 0; i < results.size(); i++) {
+			const Result& result = results[i];
+			fprintf(file, "%s{\"name\":\"%s\",\"runs\":%d,\"timeouts\":%d,\"stages\":{", i ? "," : "", result.backend,
+				result.runs, result.timeouts);
+			for (int stage = 0; stage < STAGE_COUNT; stage++) {
+				fprintf(file, "%s\"%s\":{\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f}", stage ? "," : "", STAGE_NAMES[stage],
+					Percentile(result.stages[stage], 0.50), Percentile(result.stages[stage], 0.90), Percentile(result.stages[stage], 0.99));
+			}
+			fprintf(file, "}}");
+		}
+		fprintf(file, "]}\n");
+	}
+
+	bool WriteReport(const char* path, bool json, const std::vector<Result>& results, size_t payloadChars) {
+		FILE* file = Platform::OpenFile(path, "w");
+		if (!file) return false;
+		if (json) WriteJson(file, results, payloadChars);
+		else WriteCsv(file, results);
+		return fclose(file) == 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	int runs = DEFAULT_RUNS;
+	size_t payloadChars = DEFAULT_PAYLOAD;
+	const char* only = nullptr;
+	const char* csvPath = nullptr;
+	const char* jsonPath = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--runs") && i + 1 < argc) runs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--payload") && i + 1 < argc) payloadChars = static_cast<size_t>(atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--backend") && i + 1 < argc) only = argv[++i];
+		else if (!strcmp(argv[i], "--csv") && i + 1 < argc) csvPath = argv[++i];
+		else if (!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+		else {
+			printf("usage: DeliveryBench [--runs N] [--payload CHARS] [--backend pty|tmux|x11-sim] [--csv FILE] [--json FILE]\n");
+			return 2;
+		}
+	}
+	if (runs < 1) runs = 1;
+	if (payloadChars < 1) payloadChars = 1;
+
+	// A write to a tmux client that went away must fail, not kill the bench
+	signal(SIGPIPE, SIG_IGN);
+
+	std::string payload;
+	while (payload.size() < payloadChars) {
+		payload += PAYLOAD_TEXT;
+	}
+	payload.resize(payloadChars);
+
+	std::vector<Result> results;
+	bool failed = false;
+	auto measure = [&](Backend& backend, bool opened) {
+		if (!opened) {
+			printf("%s: could not set up the stand-in\n", backend.Name());
+			failed = true;
+			return;
+		}
+		results.emplace_back();
+		Measure(backend, runs, results.back());
+	};
+
+	if (!only || !strcmp(only, "pty")) {
+		PtyBackend pty(payload);
+		measure(pty, pty.Open());
+	}
+	if (!only || !strcmp(only, "tmux")) {
+		if (TmuxBackend::Available()) {
+			TmuxBackend tmux(payload);
+			measure(tmux, tmux.Open());
+		}
+		else {
+			printf("tmux: not installed, skipped\n");
+		}
+	}
+	if (!only || !strcmp(only, "x11-sim")) {
+		X11Backend x11(payload);
+		measure(x11, x11.Open());
+	}
+
+	printf("%zu-character payload, %d runs, microseconds after the deadline\n", payloadChars, runs);
+	printf("%-8s %-8s %10s %10s %10s %9s\n", "backend", "stage", "p50", "p90", "p99", "timeouts");
+	for (const Result& result : results) {
+		for (int stage = 0; stage < STAGE_COUNT; stage++) {
+			printf("%-8s %-8s %10.1f %10.1f %10.1f %9d\n", result.backend, STAGE_NAMES[stage], Percentile(result.stages[stage], 0.50),
+				Percentile(result.stages[stage], 0.90), Percentile(result.stages[stage], 0.99), result.timeouts);
+		}
+		if (result.timeouts > 0) failed = true;
+	}
+
+	if (csvPath && !WriteReport(csvPath, false, results, payloadChars)) {
+		printf("could not write %s\n", csvPath);
+		failed = true;
+	}
+	if (jsonPath && !WriteReport(jsonPath, true, results, payloadChars)) {
+		printf("could not write %s\n", jsonPath);
+		failed = true;
+	}
+	return failed ? 1 : 0;
+}
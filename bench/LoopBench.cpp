@@ -0,0 +1,250 @@
+// Registers thousands of waitable handles with EventLoop and measures what they cost: wakeups and
+// CPU while none of them signals, then the latency from signalling one at random to its handler
+// running on the loop thread. On Windows the handles are auto-reset events, most of them past the
+// direct slots and waited on by the thread pool; elsewhere they are eventfds on epoll.
+//
+//   ./build/LoopBench [--handles N[,N...]] [--signals N] [--idle-ms MS]
+//
+// The loop runs on the main thread, a second thread signals. CPU is the whole process's, so the
+// thread pool's share counts too.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "EventLoop.h"
+#include "Platform.h"
+#ifndef _WIN32
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#endif
+
+namespace {
+	const int DEFAULT_HANDLES[] = { 1000, 5000, 10000 };
+	constexpr int DEFAULT_SIGNALS = 2000;
+	constexpr int DEFAULT_IDLE_MS = 1000;
+
+	struct Result {
+		int handles = 0;
+		uint64_t idleWakes = 0;
+		uint64_t idleCpuNanos = 0;
+		uint64_t signalCpuNanos = 0;   // Per signal, process wide
+		std::vector<uint64_t> latencies;   // Platform::Ticks, signal to handler
+		uint64_t pooled = 0;
+	};
+
+	uint64_t ProcessCpuNanos() {
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0;
+		uint64_t units = ((static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) +
+			((static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime);
+		return units * 100;
+#else
+		timespec now;
+		if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) != 0) return 0;
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+#endif
+	}
+
+	EventLoop::Handle CreateSignal() {
+#ifdef _WIN32
+		return CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#else
+		return eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+	}
+
+	bool IsValid(EventLoop::Handle handle) {
+#ifdef _WIN32
+		return handle != nullptr;
+#else
+		return handle >= 0;
+#endif
+	}
+
+	void Signal(EventLoop::Handle handle) {
+#ifdef _WIN32
+		SetEvent(handle);
+#else
+		uint64_t one = 1;
+		if (write(handle, &one, sizeof(one)) != sizeof(one)) perror("eventfd write");
+#endif
+	}
+
+	// An auto-reset event resets when the wait sees it, an eventfd when it is read
+	void Reset(EventLoop::Handle handle) {
+#ifdef _WIN32
+		(void)handle;
+#else
+		uint64_t count;
+		if (read(handle, &count, sizeof(count)) < 0 && errno != EAGAIN) perror("eventfd read");
+#endif
+	}
+
+	void CloseSignal(EventLoop::Handle handle) {
+#ifdef _WIN32
+		CloseHandle(handle);
+#else
+		close(handle);
+#endif
+	}
+
+	// Deterministic, so runs can be compared
+	uint32_t Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	double Micros(uint64_t ticks) {
+		return static_cast<double>(ticks) * 1e6 / static_cast<double>(Platform::TicksPerSecond());
+	}
+
+	double Percentile(const std::vector<uint64_t>& sorted, double fraction) {
+		if (sorted.empty()) return 0.0;
+		return Micros(sorted[static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5)]);
+	}
+
+	bool Measure(int handleCount, int signalCount, int idleMs, Result& result) {
+		result.handles = handleCount;
+		EventLoop loop;
+
+		// Both threads touch these: the signaller stores the time, the handler answers
+		std::atomic<uint64_t> signalTicks(0);
+		std::atomic<bool> handled(false);
+		result.latencies.reserve(static_cast<size_t>(signalCount));
+
+		// The mark ends the idle phase, the quit handle the run
+		EventLoop::Handle mark = CreateSignal();
+		EventLoop::Handle quit = CreateSignal();
+		if (!IsValid(mark) || !IsValid(quit)) return false;
+		uint64_t idleEndWakes = 0;
+		loop.Add(mark, [&]() {
+			Reset(mark);
+			idleEndWakes = loop.GetStats().wakeCount;
+			handled.store(true);
+		});
+		loop.Add(quit, [&]() {
+			Reset(quit);
+			loop.Quit(0);
+		});
+
+		std::vector<EventLoop::Handle> handles;
+		handles.reserve(static_cast<size_t>(handleCount));
+		for (int i = 0; i < handleCount; i++) {
+			EventLoop::Handle handle = CreateSignal();
+			if (!IsValid(handle)) break;
+			if (!loop.Add(handle, [&, handle]() {
+				Reset(handle);
+				result.latencies.push_back(Platform::Ticks() - signalTicks.load());
+				handled.store(true);
+			})) {
+				CloseSignal(handle);
+				break;
+			}
+			handles.push_back(handle);
+		}
+		if (static_cast<int>(handles.size()) < handleCount) {
+			printf("only %zu of %d handles could be registered\n", handles.size(), handleCount);
+			result.handles = static_cast<int>(handles.size());
+		}
+
+		uint64_t idleStartCpu = 0;
+		uint64_t idleEndCpu = 0;
+		uint64_t signalEndCpu = 0;
+		std::thread signaller([&]() {
+			auto waitHandled = [&]() {
+				while (!handled.load()) std::this_thread::yield();
+				handled.store(false);
+			};
+
+			idleStartCpu = ProcessCpuNanos();
+			std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+			idleEndCpu = ProcessCpuNanos();
+			Signal(mark);
+			waitHandled();
+
+			uint32_t state = 0x10AD;
+			for (int i = 0; i < signalCount && !handles.empty(); i++) {
+				EventLoop::Handle handle = handles[Random(state) % handles.size()];
+				signalTicks.store(Platform::Ticks());
+				Signal(handle);
+				waitHandled();
+			}
+			signalEndCpu = ProcessCpuNanos();
+			Signal(quit);
+		});
+		loop.Run();
+		signaller.join();
+
+		// The mark's own wake isn't idle
+		result.idleWakes = idleEndWakes > 0 ? idleEndWakes - 1 : 0;
+		result.idleCpuNanos = idleEndCpu - idleStartCpu;
+		// The signaller spins while it waits, so this is an upper bound
+		result.signalCpuNanos = signalCount > 0 ? (signalEndCpu - idleEndCpu) / static_cast<uint64_t>(signalCount) : 0;
+		result.pooled = loop.GetStats().pooledCount;
+
+		for (EventLoop::Handle handle : handles) {
+			loop.Remove(handle);
+			CloseSignal(handle);
+		}
+		loop.Remove(mark);
+		loop.Remove(quit);
+		CloseSignal(mark);
+		CloseSignal(quit);
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<int> handleCounts(std::begin(DEFAULT_HANDLES), std::end(DEFAULT_HANDLES));
+	int signalCount = DEFAULT_SIGNALS;
+	int idleMs = DEFAULT_IDLE_MS;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--handles") && i + 1 < argc) {
+			handleCounts.clear();
+			for (const char* p = argv[++i]; *p; ) {
+				handleCounts.push_back(atoi(p));
+				p = strchr(p, ',');
+				if (!p) break;
+				p++;
+			}
+		}
+		else if (!strcmp(argv[i], "--signals") && i + 1 < argc) signalCount = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--idle-ms") && i + 1 < argc) idleMs = atoi(argv[++i]);
+		else {
+			printf("usage: LoopBench [--handles N[,N...]] [--signals N] [--idle-ms MS]\n");
+			return 2;
+		}
+	}
+
+#ifndef _WIN32
+	// A descriptor per handle, the default soft limit is often 1024
+	rlimit files;
+	if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+		files.rlim_cur = files.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &files);
+	}
+#endif
+
+	printf("%-8s %10s %12s %10s %10s %10s %12s %10s\n", "handles", "idle wakes", "idle cpu ms", "p50 us", "p99 us",
+		"max us", "cpu/signal us", "pooled");
+	for (int handleCount : handleCounts) {
+		Result result;
+		if (!Measure(handleCount, signalCount, idleMs, result)) {
+			printf("could not create handles\n");
+			return 1;
+		}
+		std::sort(result.latencies.begin(), result.latencies.end());
+		printf("%-8d %10llu %12.2f %10.1f %10.1f %10.1f %12.1f %10llu\n", result.handles,
+			static_cast<unsigned long long>(result.idleWakes), static_cast<double>(result.idleCpuNanos) / 1e6,
+			Percentile(result.latencies, 0.50), Percentile(result.latencies, 0.99),
+			result.latencies.empty() ? 0.0 : Micros(result.latencies.back()),
+			static_cast<double>(result.signalCpuNanos) / 1e3, static_cast<unsigned long long>(result.pooled));
+	}
+	return 0;
+}
@@ -0,0 +1,276 @@
+// Drives ARCC's control endpoint the way a script would, keeping up to --depth commands in flight,
+// and reports the round trip of each (write queued to reply read) and the sustained rate.
+//
+//   PipeBench [--pipe NAME] [--count N] [--depth D] [--command TEXT]      (Windows)
+//   PipeBench [--socket PATH] [--count N] [--depth D] [--command TEXT]    (Linux)
+//
+// On Windows it talks to a running app through its named pipe, which defaults to the session's
+// coordinator, \\.\pipe\arcc; pass \\.\pipe\arcc-<pid> for one instance. On Linux there is no app
+// to talk to, so unless --socket names a server it serves ControlSocket itself, on an EventLoop
+// thread, with a stand-in handler that answers every command "ok" and changes nothing. That
+// measures the socket, the edge-triggered loop and ControlProtocol's parsing and batching, not
+// the app's commands. The command defaults to "list". Exits non-zero if the endpoint can't be
+// opened, it closes early or a reply starts with "err".
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include "ControlSocket.h"
+#endif
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Platform.h"
+
+namespace {
+	constexpr int DEFAULT_COUNT = 10000;
+	constexpr int DEFAULT_DEPTH = 16;
+	constexpr int MAX_DEPTH = 256;          // Keeps a window of commands well inside the pipe's buffer
+	constexpr size_t READ_CHUNK = 4096;
+	const char* const DEFAULT_COMMAND = "list";
+
+#ifdef _WIN32
+	using Connection = HANDLE;
+	const Connection NO_CONNECTION = INVALID_HANDLE_VALUE;
+	constexpr DWORD CONNECT_TIMEOUT_MS = 2000;
+	const char* const DEFAULT_ENDPOINT = "\\\\.\\pipe\\arcc";
+	const char* const ENDPOINT_OPTION = "--pipe";
+	const char* const ENDPOINT_USAGE = "--pipe NAME";
+
+	Connection Open(const std::string& endpoint) {
+		std::wstring name(endpoint.begin(), endpoint.end());
+		for (;;) {
+			HANDLE hPipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+			if (hPipe != INVALID_HANDLE_VALUE) return hPipe;
+			// The single instance is serving someone else
+			if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeW(name.c_str(), CONNECT_TIMEOUT_MS)) return INVALID_HANDLE_VALUE;
+		}
+	}
+
+	unsigned long LastError() { return GetLastError(); }
+
+	bool WriteAll(Connection connection, const std::string& data) {
+		DWORD written = 0;
+		return WriteFile(connection, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) && written == data.size();
+	}
+
+	// 0 once the other end has closed
+	size_t ReadSome(Connection connection, char* buffer, size_t size) {
+		DWORD read = 0;
+		if (!ReadFile(connection, buffer, static_cast<DWORD>(size), &read, nullptr)) return 0;
+		return read;
+	}
+
+	void Close(Connection connection) { CloseHandle(connection); }
+#else
+	using Connection = int;
+	const Connection NO_CONNECTION = -1;
+	const char* const ENDPOINT_OPTION = "--socket";
+	const char* const ENDPOINT_USAGE = "--socket PATH";
+
+	Connection Open(const std::string& endpoint) {
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (endpoint.size() >= sizeof(address.sun_path)) {
+			errno = ENAMETOOLONG;
+			return -1;
+		}
+		strcpy(address.sun_path, endpoint.c_str());
+		int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0) return -1;
+		if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+			int error = errno;
+			close(fd);
+			errno = error;
+			return -1;
+		}
+		return fd;
+	}
+
+	unsigned long LastError() { return static_cast<unsigned long>(errno); }
+
+	bool WriteAll(Connection connection, const std::string& data) {
+		size_t sent = 0;
+		while (sent < data.size()) {
+			ssize_t written = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if (written < 0 && errno == EINTR) continue;
+			if (written <= 0) return false;
+			sent += static_cast<size_t>(written);
+		}
+		return true;
+	}
+
+	size_t ReadSome(Connection connection, char* buffer, size_t size) {
+		for (;;) {
+			ssize_t read = recv(connection, buffer, size, 0);
+			if (read < 0 && errno == EINTR) continue;
+			return read > 0 ? static_cast<size_t>(read) : 0;
+		}
+	}
+
+	void Close(Connection connection) { close(connection); }
+
+	// ControlSocket on its own loop thread, until destroyed
+	class Server {
+	public:
+		bool Start(const std::string& path) {
+			m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (m_wake < 0 || !m_loop.Add(m_wake, [this]() { m_loop.Quit(0); })) return false;
+			auto handler = [](const ControlProtocol::Command& command, std::string& reply) {
+				reply = command.type == ControlProtocol::Command::Type::Unknown ? "err unknown command" : "ok";
+			};
+			if (!m_socket.Start(path.c_str(), m_loop, handler)) return false;
+			m_thread = std::thread([this]() { m_loop.Run(); });
+			return true;
+		}
+
+		~Server() {
+			Stop();
+		}
+
+		void Stop() {
+			if (m_thread.joinable()) {
+				uint64_t one = 1;
+				ssize_t ignored = write(m_wake, &one, sizeof(one));
+				(void)ignored;
+				m_thread.join();
+			}
+			m_socket.Stop();
+			if (m_wake >= 0) {
+				m_loop.Remove(m_wake);
+				close(m_wake);
+				m_wake = -1;
+			}
+		}
+
+		// Once stopped
+		ControlSocket::Stats GetStats() const { return m_socket.GetStats(); }
+
+	private:
+		EventLoop m_loop;
+		ControlSocket m_socket;
+		int m_wake = -1;
+		std::thread m_thread;
+	};
+#endif
+
+	double Percentile(const std::vector<uint64_t>& sorted, double fraction) {
+		if (sorted.empty()) return 0.0;
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+		return static_cast<double>(sorted[index]);
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string endpoint;
+	int count = DEFAULT_COUNT;
+	int depth = DEFAULT_DEPTH;
+	std::string command = DEFAULT_COMMAND;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], ENDPOINT_OPTION) && i + 1 < argc) endpoint = argv[++i];
+		else if (!strcmp(argv[i], "--count") && i + 1 < argc) count = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--depth") && i + 1 < argc) depth = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--command") && i + 1 < argc) command = argv[++i];
+		else {
+			printf("usage: PipeBench [%s] [--count N] [--depth D] [--command TEXT]\n", ENDPOINT_USAGE);
+			return 2;
+		}
+	}
+	if (count < 1) count = 1;
+	depth = std::max(1, std::min(depth, std::min(count, MAX_DEPTH)));
+	std::string line = command + "\n";
+
+#ifdef _WIN32
+	if (endpoint.empty()) endpoint = DEFAULT_ENDPOINT;
+#else
+	Server server;
+	bool serving = endpoint.empty();
+	if (serving) {
+		endpoint = "/tmp/PipeBench-" + std::to_string(getpid()) + ".sock";
+		if (!server.Start(endpoint)) {
+			printf("could not serve %s (error %lu)\n", endpoint.c_str(), LastError());
+			return 1;
+		}
+	}
+#endif
+
+	Connection connection = Open(endpoint);
+	if (connection == NO_CONNECTION) {
+		printf("could not open %s (error %lu)\n", endpoint.c_str(), LastError());
+		return 1;
+	}
+
+	// Send time of each command, replies come back in order
+	std::vector<uint64_t> sentTicks(static_cast<size_t>(count));
+	std::vector<uint64_t> roundTrips;
+	roundTrips.reserve(static_cast<size_t>(count));
+	int sent = 0;
+	int errors = 0;
+	bool closed = false;
+
+	uint64_t start = Platform::Ticks();
+	std::string batch;
+	for (; sent < depth; sent++) {
+		batch += line;
+		sentTicks[sent] = start;
+	}
+	closed = !WriteAll(connection, batch);
+
+	char buffer[READ_CHUNK];
+	std::string pending;
+	while (!closed && static_cast<int>(roundTrips.size()) < count) {
+		size_t read = ReadSome(connection, buffer, READ_CHUNK);
+		if (read == 0) {
+			closed = true;
+			break;
+		}
+		uint64_t now = Platform::Ticks();
+		pending.append(buffer, read);
+
+		// Every reply frees a slot in the window for the next command
+		batch.clear();
+		size_t lineStart = 0;
+		for (size_t newline; (newline = pending.find('\n', lineStart)) != std::string::npos; lineStart = newline + 1) {
+			if (pending.compare(lineStart, 3, "err") == 0) errors++;
+			roundTrips.push_back(now - sentTicks[roundTrips.size()]);
+			if (sent < count) {
+				batch += line;
+				sentTicks[sent++] = now;
+			}
+		}
+		pending.erase(0, lineStart);
+		if (!batch.empty() && !WriteAll(connection, batch)) closed = true;
+	}
+	uint64_t elapsed = Platform::Ticks() - start;
+	Close(connection);
+
+	double ticksPerMicro = static_cast<double>(Platform::TicksPerSecond()) / 1e6;
+	std::sort(roundTrips.begin(), roundTrips.end());
+	double seconds = static_cast<double>(elapsed) / static_cast<double>(Platform::TicksPerSecond());
+	printf("%zu of %d \"%s\" at depth %d: p50 %.1f us  p99 %.1f us  max %.1f us  %.0f commands/s  %d errors\n",
+		roundTrips.size(), count, command.c_str(), depth,
+		Percentile(roundTrips, 0.50) / ticksPerMicro, Percentile(roundTrips, 0.99) / ticksPerMicro,
+		roundTrips.empty() ? 0.0 : static_cast<double>(roundTrips.back()) / ticksPerMicro,
+		seconds > 0.0 ? static_cast<double>(roundTrips.size()) / seconds : 0.0, errors);
+#ifndef _WIN32
+	if (serving) {
+		server.Stop();
+		ControlSocket::Stats stats = server.GetStats();
+		printf("server: %llu batches, %.1f commands per batch, %.2f us per batch\n",
+			static_cast<unsigned long long>(stats.batchCount),
+			stats.batchCount ? static_cast<double>(stats.commandCount) / static_cast<double>(stats.batchCount) : 0.0,
+			stats.batchCount ? static_cast<double>(stats.batchTicks) / static_cast<double>(stats.batchCount) / ticksPerMicro : 0.0);
+	}
+#endif
+	if (closed) printf("the endpoint closed early\n");
+	return closed || errors ? 1 : 0;
+}
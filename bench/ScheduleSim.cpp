@@ -0,0 +1,260 @@
+// Arms thousands of one-shot and recurring jobs around the two daylight saving changes of a year
+// and midnights either side, then runs the scheduler through them on virtual time. Every decision
+// is printed with the local time it fired at and, for recurring jobs, the occurrence it was
+// re-armed for. Each simulated hour is one step of the harness, printed with the RunStats the
+// scheduler reported for it:
+//
+//   ./build/ScheduleSim [--jobs N] [--tz TZ] [--quiet]
+//
+// TZ defaults to US Eastern so the run doesn't depend on the machine's zone. The harness checks
+// what should hold whatever the zone does: nothing fires off its deadline, a recurring job is
+// re-armed strictly later, a cadence keeps its period and a day rule fires at most once a day on
+// one of its days. It exits non-zero if any of that fails. --quiet prints only steps and totals.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "Schedule.h"
+
+namespace {
+	constexpr int DEFAULT_JOBS = 2000;
+	const char* const DEFAULT_TZ = "EST5EDT,M3.2.0,M11.1.0";
+
+	// Rules that land in, next to or across a DST change or midnight
+	const char* const RULES[] = {
+		"daily at 02:30",           // Skipped in spring
+		"daily at 01:30",           // Twice in autumn
+		"daily at 00:00",
+		"daily at 23:59:50",
+		"weekdays at 00:00:10",
+		"weekends at 02:00",
+		"sun,sat at 01:59:59",
+		"every 90m from 01:15",
+		"every 1h from 00:00:10",
+		"every 5h30m from 23:00",
+		"every 25m from 02:10",
+	};
+	constexpr size_t RULE_COUNT = sizeof(RULES) / sizeof(RULES[0]);
+
+	// Local times one-shots are pinned to on each day of a window
+	const int PINNED[][3] = { { 23, 59, 50 }, { 0, 0, 0 }, { 0, 0, 10 }, { 1, 30, 0 }, { 2, 30, 0 }, { 3, 0, 10 } };
+	constexpr size_t PINNED_COUNT = sizeof(PINNED) / sizeof(PINNED[0]);
+
+	struct Window {
+		const char* name;
+		int month;                  // tm_mon
+		int day;                    // Noon the day before the change
+	};
+
+	// 2026: clocks go forward on March 8 and back on November 1
+	const Window WINDOWS[] = {
+		{ "spring forward", 2, 7 },
+		{ "fall back", 9, 31 },
+	};
+
+	constexpr int WINDOW_HOURS = 72;
+
+	struct Decision {
+		Scheduler::Job job;
+		Clock::time_point at;
+	};
+
+	struct Totals {
+		uint64_t jobs = 0;
+		uint64_t steps = 0;         // Simulated hours
+		uint64_t wakes = 0;
+		uint64_t fired = 0;
+		uint64_t cpuNanos = 0;
+		uint64_t maxStepNanos = 0;
+		uint64_t shifted = 0;       // Day rule occurrences moved by a DST gap
+		uint64_t errors = 0;
+	};
+
+	// Deterministic spread, so runs can be compared
+	uint32_t Random(uint32_t& state) {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	void SetZone(const char* tz) {
+#ifdef _WIN32
+		_putenv_s("TZ", tz);
+		_tzset();
+#else
+		setenv("TZ", tz, 1);
+		tzset();
+#endif
+	}
+
+	void FormatLocal(const Clock& clock, Clock::time_point time, char (&text)[32]) {
+		tm local{};
+		clock.ToLocal(time, local);
+		if (!strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S %Z", &local)) text[0] = '\0';
+	}
+
+	bool SameLocalDay(const tm& a, const tm& b) {
+		return a.tm_year == b.tm_year && a.tm_yday == b.tm_yday;
+	}
+
+	// Prints one decision and counts whatever is wrong with it
+	void Check(const Decision& decision, const Clock& clock, bool quiet, Totals& totals) {
+		const Scheduler::Job& job = decision.job;
+		char at[32];
+		FormatLocal(clock, decision.at, at);
+
+		const char* problem = nullptr;
+		if (decision.at != job.deadline) problem = "off deadline";
+
+		if (!job.recurring) {
+			if (!quiet) printf("  fire #%u once  %s%s%s\n", job.id, at, problem ? "  ERROR " : "", problem ? problem : "");
+			if (problem) totals.errors++;
+			return;
+		}
+
+		const Recurrence& rule = job.recurrence;
+		Clock::time_point next = rule.Next(decision.at, clock);
+		tm firedLocal{};
+		tm nextLocal{};
+		clock.ToLocal(decision.at, firedLocal);
+		clock.ToLocal(next, nextLocal);
+		bool shifted = false;
+
+		if (next <= decision.at) {
+			problem = "next not later";
+		}
+		else if (rule.kind == Recurrence::Kind::Interval) {
+			if (next - decision.at != rule.period) problem = "cadence drifted";
+		}
+		else {
+			if (!(rule.dayMask & (1 << nextLocal.tm_wday))) problem = "next on a day off";
+			else if (SameLocalDay(firedLocal, nextLocal)) problem = "twice in a day";
+			shifted = firedLocal.tm_hour != rule.hour || firedLocal.tm_min != rule.minute || firedLocal.tm_sec != rule.second;
+		}
+		if (shifted) totals.shifted++;
+		if (problem) totals.errors++;
+
+		if (!quiet) {
+			char nextText[32];
+			FormatLocal(clock, next, nextText);
+			printf("  fire #%u %-5s %s%s  next %s%s%s\n", job.id, rule.kind == Recurrence::Kind::Interval ? "every" : "days",
+				at, shifted ? " (shifted)" : "", nextText, problem ? "  ERROR " : "", problem ? problem : "");
+		}
+	}
+
+	void RunWindow(const Window& window, int jobCount, bool quiet, Totals& totals) {
+		tm local{};
+		local.tm_year = 2026 - 1900;
+		local.tm_mon = window.month;
+		local.tm_mday = window.day;
+		local.tm_hour = 12;
+		VirtualClock clock{ Clock::time_point() };
+		clock.Set(clock.FromLocal(local));
+		Clock::time_point start = clock.Now();
+		Clock::time_point end = start + std::chrono::hours(WINDOW_HOURS);
+
+		Scheduler scheduler;
+		uint32_t state = 0x5EED;
+		int recurring = 0;
+		for (int i = 0; i < jobCount; i++) {
+			if (i % 2) {
+				Recurrence rule;
+				if (!Recurrence::Compile(RULES[i / 2 % RULE_COUNT], clock, rule)) {
+					printf("rule did not compile: %s\n", RULES[i / 2 % RULE_COUNT]);
+					totals.errors++;
+					continue;
+				}
+				scheduler.ArmRecurring(rule, clock, static_cast<uintptr_t>(i));
+				recurring++;
+			}
+			else if (i % 6 == 0) {
+				// Pinned to a local time on one of the window's days
+				tm pinned = local;
+				const int* time = PINNED[Random(state) % PINNED_COUNT];
+				pinned.tm_mday += 1 + static_cast<int>(Random(state) % 2);
+				pinned.tm_hour = time[0];
+				pinned.tm_min = time[1];
+				pinned.tm_sec = time[2];
+				scheduler.Arm(clock.FromLocal(pinned), static_cast<uintptr_t>(i));
+			}
+			else {
+				scheduler.Arm(start + std::chrono::seconds(Random(state) % (WINDOW_HOURS * 3600)), static_cast<uintptr_t>(i));
+			}
+		}
+		totals.jobs += scheduler.Size();
+
+		char from[32];
+		char to[32];
+		FormatLocal(clock, start, from);
+		FormatLocal(clock, end, to);
+		printf("%s: %s to %s, %zu jobs (%d recurring)\n", window.name, from, to, scheduler.Size(), recurring);
+
+		// Filled inside the timed region, so it must not allocate there
+		std::vector<Decision> decisions;
+		decisions.reserve(scheduler.Size() * 2 + 1024);
+
+		for (Clock::time_point stepStart = start; stepStart < end; stepStart += std::chrono::hours(1)) {
+			decisions.clear();
+			Scheduler::RunStats stats = scheduler.Simulate(clock, stepStart + std::chrono::hours(1), [&](const Scheduler::Job& job) {
+				if (decisions.size() < decisions.capacity()) decisions.push_back(Decision{ job, clock.Now() });
+			});
+
+			char stepText[32];
+			FormatLocal(clock, stepStart, stepText);
+			printf("step %s  wakes %llu  fired %llu  cpuNanos %llu  maxStepNanos %llu\n", stepText,
+				static_cast<unsigned long long>(stats.steps), static_cast<unsigned long long>(stats.fired),
+				static_cast<unsigned long long>(stats.cpuNanos), static_cast<unsigned long long>(stats.maxStepNanos));
+			if (decisions.size() < stats.fired) {
+				printf("  %llu decisions not recorded\n", static_cast<unsigned long long>(stats.fired - decisions.size()));
+			}
+			for (const Decision& decision : decisions) {
+				Check(decision, clock, quiet, totals);
+			}
+
+			totals.steps++;
+			totals.wakes += stats.steps;
+			totals.fired += stats.fired;
+			totals.cpuNanos += stats.cpuNanos;
+			if (stats.maxStepNanos > totals.maxStepNanos) totals.maxStepNanos = stats.maxStepNanos;
+		}
+
+		// Every one-shot inside the window has fired
+		scheduler.ForEach([&](const Scheduler::Job& job) {
+			if (!job.recurring && job.deadline <= end) {
+				printf("  ERROR #%u never fired\n", job.id);
+				totals.errors++;
+			}
+		});
+	}
+}
+
+int main(int argc, char** argv) {
+	int jobCount = DEFAULT_JOBS;
+	const char* tz = DEFAULT_TZ;
+	bool quiet = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--jobs") && i + 1 < argc) jobCount = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--tz") && i + 1 < argc) tz = argv[++i];
+		else if (!strcmp(argv[i], "--quiet")) quiet = true;
+		else {
+			printf("usage: ScheduleSim [--jobs N] [--tz TZ] [--quiet]\n");
+			return 2;
+		}
+	}
+	if (jobCount < 1) jobCount = 1;
+	SetZone(tz);
+
+	Totals totals;
+	for (const Window& window : WINDOWS) {
+		RunWindow(window, jobCount, quiet, totals);
+	}
+
+	printf("total: %llu jobs, %llu steps, %llu wakes, %llu fired, cpuNanos %llu, maxStepNanos %llu, %llu shifted, %llu errors\n",
+		static_cast<unsigned long long>(totals.jobs), static_cast<unsigned long long>(totals.steps),
+		static_cast<unsigned long long>(totals.wakes), static_cast<unsigned long long>(totals.fired),
+		static_cast<unsigned long long>(totals.cpuNanos), static_cast<unsigned long long>(totals.maxStepNanos),
+		static_cast<unsigned long long>(totals.shifted), static_cast<unsigned long long>(totals.errors));
+	return totals.errors ? 1 : 0;
+}
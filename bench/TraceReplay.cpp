@@ -0,0 +1,364 @@
+// Replays a message trace (ARCC.exe --record <file>) against the portable core on any platform.
+// Sizes, DPI changes, mouse moves, clicks, keys and timer ticks drive a headless model of the
+// window through Ui::ComputeLayout and Ui::HitTest, and every paint draws a frame with
+// Ui::DrawContent on the headless canvas. Recorded time moves a VirtualClock, so countdowns and
+// hour labels match the session.
+//
+//   ./build/TraceReplay <trace>                  replay a recorded session
+//   ./build/TraceReplay --synthetic <trace>      write a generated session to <trace>, then replay it
+//
+// Prints wall time, thread CPU time and heap allocations per message, then the frame cost, and
+// writes the table next to the trace like the app's --replay. Exits with 3 if a steady-state
+// frame allocated.
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include "AllocationCounter.h"
+#include "AllocationHooks.h"
+#include "Headless.h"
+#include "MessageTrace.h"
+#include "Platform.h"
+#include "Schedule.h"
+#include "Ui.h"
+
+namespace {
+	using MessageTrace::Record;
+
+	// From the Windows headers, which this doesn't include
+	constexpr uint64_t SIZE_MINIMIZED = 1;
+	constexpr uint64_t VK_ESCAPE = 0x1B;
+	constexpr uint64_t TIMER_STATUS_UPDATE = 2;
+
+	constexpr int EXIT_PAINT_ALLOCATED = 3;
+	constexpr const char* REPORT_EXT = ".report.txt";
+
+	constexpr float DEFAULT_DPI = 96.0f;
+
+	int16_t LowWord(int64_t value) { return static_cast<int16_t>(value & 0xFFFF); }
+	int16_t HighWord(int64_t value) { return static_cast<int16_t>((value >> 16) & 0xFFFF); }
+	int64_t MakeLParam(int x, int y) { return static_cast<int64_t>((static_cast<uint32_t>(y & 0xFFFF) << 16) | (x & 0xFFFF)); }
+
+	// What the window does with each traced message, minus the platform: the same state the app
+	// keeps, turned into a Ui::Frame and drawn on paint
+	class Session {
+	public:
+		struct FrameStats {
+			uint64_t frames = 0;
+			uint64_t ticks = 0;
+			uint64_t maxTicks = 0;
+			uint64_t ops = 0;
+			uint64_t steadyFrames = 0;
+			uint64_t allocatingFrames = 0;  // Of the steady ones
+		};
+
+		explicit Session(const Clock& clock) : m_clock(clock) {
+			wcscpy(m_frame.targetLabelName, L"WindowsTerminal.exe");
+			wcscpy(m_frame.targetLabelDetail, L"\"claude\" (replay)");
+		}
+
+		void Handle(const Record& record) {
+			switch (record.message) {
+			case MessageTrace::MSG_SIZE:
+				if (record.wParam == SIZE_MINIMIZED) return;
+				m_clientWidth = static_cast<uint16_t>(LowWord(record.lParam));
+				Layout();
+				break;
+			case MessageTrace::MSG_DPICHANGED:
+			{
+				// The window keeps the width it had in DIPs
+				float widthDip = ToDip(m_clientWidth, m_dpiX);
+				m_dpiX = static_cast<float>(record.wParam & 0xFFFF);
+				m_dpiY = static_cast<float>((record.wParam >> 16) & 0xFFFF);
+				m_clientWidth = static_cast<int>(std::lround(widthDip * m_dpiX / DEFAULT_DPI));
+				Layout();
+				break;
+			}
+			case MessageTrace::MSG_MOUSEMOVE:
+				m_mouseX = LowWord(record.lParam);
+				m_mouseY = HighWord(record.lParam);
+				if (m_layout.isValid) {
+					int hour;
+					m_overButton = Ui::HitTest(m_layout, ToDip(m_mouseX, m_dpiX), ToDip(m_mouseY, m_dpiY), hour) != Ui::Hit::None;
+				}
+				break;
+			case MessageTrace::MSG_MOUSELEAVE:
+				m_mouseX = m_mouseY = -1;
+				m_overButton = false;
+				break;
+			case MessageTrace::MSG_LBUTTONDOWN:
+				Click(LowWord(record.lParam), HighWord(record.lParam));
+				break;
+			case MessageTrace::MSG_KEYDOWN:
+				if (record.wParam == VK_ESCAPE) m_capturing = false;
+				break;
+			case MessageTrace::MSG_KILLFOCUS:
+				m_capturing = false;
+				break;
+			case MessageTrace::MSG_TIMER:
+				if (record.wParam == TIMER_STATUS_UPDATE && m_timerActive && m_clock.Now() >= m_deadline) {
+					m_timerActive = false;
+					m_delivered++;
+				}
+				break;
+			case MessageTrace::MSG_PAINT:
+				Paint();
+				break;
+			}
+		}
+
+		const FrameStats& Frames() const { return m_frameStats; }
+		uint64_t Delivered() const { return m_delivered; }
+		uint64_t MeasureCount() const { return m_measurer.MeasureCount(); }
+
+	private:
+		const Clock& m_clock;
+		Headless::TextMeasurer m_measurer;
+		Headless::Canvas m_canvas;
+		Ui::Layout m_layout;
+		Ui::Frame m_frame;
+
+		int m_clientWidth = 500;
+		float m_dpiX = DEFAULT_DPI;
+		float m_dpiY = DEFAULT_DPI;
+		int m_mouseX = -1;
+		int m_mouseY = -1;
+		bool m_overButton = false;
+		bool m_capturing = false;
+		bool m_timerActive = false;
+		int m_selectedHour = 0;
+		Clock::time_point m_deadline;
+		uint64_t m_delivered = 0;
+		FrameStats m_frameStats;
+
+		static float ToDip(int pixels, float dpi) {
+			return static_cast<float>(pixels) * DEFAULT_DPI / dpi;
+		}
+
+		void Layout() {
+			Ui::ComputeLayout(ToDip(m_clientWidth, m_dpiX), m_measurer, m_layout);
+		}
+
+		void Click(int x, int y) {
+			if (!m_layout.isValid) Layout();
+
+			// Picking a target ends capture, the replay has no other windows so it keeps its own
+			if (m_capturing) {
+				m_capturing = false;
+				return;
+			}
+
+			int hour = 0;
+			switch (Ui::HitTest(m_layout, ToDip(x, m_dpiX), ToDip(y, m_dpiY), hour)) {
+			case Ui::Hit::TargetButton:
+				m_capturing = true;
+				break;
+			case Ui::Hit::StartButton:
+				m_timerActive = !m_timerActive;
+				if (m_timerActive) {
+					m_deadline = Schedule::HourTarget(m_clock, m_selectedHour);
+				}
+				break;
+			case Ui::Hit::HourButton:
+				m_selectedHour = hour;
+				break;
+			case Ui::Hit::None:
+				break;
+			}
+		}
+
+		// PublishFrame and the render thread's draw in one
+		void Paint() {
+			bool steadyState = m_layout.isValid && m_frameStats.frames > 0;
+			AllocationCounter::Scope allocations;
+			uint64_t start = Platform::Ticks();
+
+			if (!m_layout.isValid) Layout();
+			m_frame.appState = Ui::GetAppState(true, m_timerActive);
+			m_frame.hasTarget = true;
+			m_frame.capturing = m_capturing;
+			m_frame.timerActive = m_timerActive;
+			m_frame.selectedHourOffset = m_selectedHour;
+			m_frame.mouseX = m_mouseX < 0 ? -1.0f : ToDip(m_mouseX, m_dpiX);
+			m_frame.mouseY = m_mouseY < 0 ? -1.0f : ToDip(m_mouseY, m_dpiY);
+			m_frame.layout = m_layout;
+			m_frame.countdownText[0] = L'\0';
+			if (m_timerActive) {
+				Ui::FormatCountdown(m_clock, m_deadline, m_frame.countdownText);
+			}
+			Ui::FormatHourLabels(m_clock, m_frame.hourLabels);
+			m_canvas.Clear();
+			Ui::DrawContent(m_frame, m_canvas);
+
+			uint64_t ticks = Platform::Ticks() - start;
+			m_frameStats.frames++;
+			m_frameStats.ticks += ticks;
+			if (ticks > m_frameStats.maxTicks) m_frameStats.maxTicks = ticks;
+			m_frameStats.ops += m_canvas.Ops().size();
+			if (steadyState) {
+				m_frameStats.steadyFrames++;
+				if (allocations.Allocations() > 0) m_frameStats.allocatingFrames++;
+			}
+		}
+	};
+
+	// A few minutes of use: hover over everything, pick an hour, start the timer and watch it
+	// count down, resize, move to a 150% monitor and back, re-select the target and cancel
+	bool WriteSynthetic(const char* path) {
+		MessageTrace::Writer writer;
+		if (!writer.Open(path)) return false;
+
+		uint64_t time = 0;
+		auto add = [&](uint32_t message, uint64_t wParam, int64_t lParam, uint64_t afterMicros) {
+			time += afterMicros;
+			writer.Append(Record{ time, message, wParam, lParam, {} });
+		};
+		auto paint = [&]() { add(MessageTrace::MSG_PAINT, 0, 0, 200); };
+
+		const int width = 500;
+		Headless::TextMeasurer measurer;
+		Ui::Layout layout;
+		Ui::ComputeLayout(static_cast<float>(width), measurer, layout);
+		auto center = [](const Ui::Rect& rect, float scale) {
+			return MakeLParam(static_cast<int>((rect.left + rect.right) / 2 * scale), static_cast<int>((rect.top + rect.bottom) / 2 * scale));
+		};
+
+		add(MessageTrace::MSG_SIZE, 0, MakeLParam(width, static_cast<int>(layout.totalContentHeight)), 0);
+		paint();
+
+		// Hover down the window, the app repaints on every move
+		for (int i = 0; i < 400; i++) {
+			add(MessageTrace::MSG_MOUSEMOVE, 0, MakeLParam(20 + i, 50 + i), 8000);
+			paint();
+		}
+
+		// Third hour, then start
+		add(MessageTrace::MSG_LBUTTONDOWN, 1, center(layout.hourButtonRects[2], 1.0f), 300000);
+		add(MessageTrace::MSG_LBUTTONUP, 0, center(layout.hourButtonRects[2], 1.0f), 90000);
+		paint();
+		add(MessageTrace::MSG_LBUTTONDOWN, 1, center(layout.startButtonRect, 1.0f), 600000);
+		add(MessageTrace::MSG_LBUTTONUP, 0, center(layout.startButtonRect, 1.0f), 90000);
+		paint();
+		add(MessageTrace::MSG_MOUSELEAVE, 0, 0, 400000);
+		paint();
+
+		// Ten minutes of countdown
+		for (int i = 0; i < 600; i++) {
+			add(MessageTrace::MSG_TIMER, TIMER_STATUS_UPDATE, 0, 1000000);
+			paint();
+		}
+
+		// Drag the width out and back
+		for (int w = 400; w <= 800; w += 8) {
+			add(MessageTrace::MSG_SIZE, 0, MakeLParam(w, static_cast<int>(layout.totalContentHeight)), 16000);
+			paint();
+		}
+		add(MessageTrace::MSG_SIZE, 0, MakeLParam(width, static_cast<int>(layout.totalContentHeight)), 16000);
+		paint();
+
+		// Onto a 150% monitor, hover and re-select the target there, then ESC
+		Record dpi = { 0, MessageTrace::MSG_DPICHANGED, 144 | (144 << 16), 0, { 1920, 100, 1920 + width * 3 / 2, 1000 } };
+		time += 2000000;
+		dpi.timeMicros = time;
+		writer.Append(dpi);
+		paint();
+		for (int i = 0; i < 200; i++) {
+			add(MessageTrace::MSG_MOUSEMOVE, 0, MakeLParam(30 + i * 2, 60 + i * 3), 8000);
+			paint();
+		}
+		add(MessageTrace::MSG_LBUTTONDOWN, 1, center(layout.targetButtonRect, 1.5f), 300000);
+		add(MessageTrace::MSG_LBUTTONUP, 0, center(layout.targetButtonRect, 1.5f), 90000);
+		paint();
+		add(MessageTrace::MSG_KEYDOWN, VK_ESCAPE, 0, 1500000);
+		paint();
+
+		// Back again and let the timer run a little longer
+		dpi.wParam = 96 | (96 << 16);
+		dpi.rect = { 0, 100, width, 1000 };
+		time += 2000000;
+		dpi.timeMicros = time;
+		writer.Append(dpi);
+		paint();
+		add(MessageTrace::MSG_MOUSELEAVE, 0, 0, 400000);
+		paint();
+		for (int i = 0; i < 60; i++) {
+			add(MessageTrace::MSG_TIMER, TIMER_STATUS_UPDATE, 0, 1000000);
+			paint();
+		}
+		writer.Close();
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* path = nullptr;
+	bool synthetic = false;
+	if (argc == 2) {
+		path = argv[1];
+	}
+	else if (argc == 3 && !strcmp(argv[1], "--synthetic")) {
+		path = argv[2];
+		synthetic = true;
+	}
+	else {
+		printf("usage: TraceReplay <trace> | TraceReplay --synthetic <trace>\n");
+		return 2;
+	}
+
+	if (synthetic && !WriteSynthetic(path)) {
+		printf("could not write %s\n", path);
+		return 1;
+	}
+
+	MessageTrace::Reader reader;
+	if (!reader.Open(path)) {
+		printf("could not read %s\n", path);
+		return 1;
+	}
+
+	// Recorded time drives the clock, from the wall clock time the trace started
+	using Ticks100ns = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
+	Clock::time_point startTime(std::chrono::duration_cast<Clock::time_point::duration>(Ticks100ns(reader.StartTime())));
+	VirtualClock clock(startTime);
+	Session session(clock);
+
+	MessageTrace::ReplayReport report("mean_cpu_ns");
+	Record record;
+	uint64_t messages = 0;
+	while (reader.Next(record)) {
+		clock.Set(startTime + std::chrono::microseconds(record.timeMicros));
+
+		AllocationCounter::Scope allocations;
+		uint64_t startCpu = Platform::ThreadCpuNanos();
+		uint64_t start = Platform::Ticks();
+
+		session.Handle(record);
+
+		uint64_t end = Platform::Ticks();
+		uint64_t endCpu = Platform::ThreadCpuNanos();
+		report.Add(record.message, end - start, endCpu - startCpu, allocations.Allocations());
+		messages++;
+	}
+
+	report.Print(stdout);
+	std::string reportPath = std::string(path) + REPORT_EXT;
+	report.Write(reportPath.c_str());
+
+	const Session::FrameStats& frames = session.Frames();
+	double microsPerTick = 1000000.0 / static_cast<double>(Platform::TicksPerSecond());
+	printf("%llu messages, %llu frames: mean %.2f us, max %.1f us, %.1f draw ops\n",
+		static_cast<unsigned long long>(messages), static_cast<unsigned long long>(frames.frames),
+		frames.frames ? static_cast<double>(frames.ticks) * microsPerTick / static_cast<double>(frames.frames) : 0.0,
+		static_cast<double>(frames.maxTicks) * microsPerTick,
+		frames.frames ? static_cast<double>(frames.ops) / static_cast<double>(frames.frames) : 0.0);
+	if (AllocationCounter::ENABLED) {
+		printf("%llu of %llu steady-state frames allocated\n", static_cast<unsigned long long>(frames.allocatingFrames),
+			static_cast<unsigned long long>(frames.steadyFrames));
+	}
+	printf("%llu resumes due, %llu texts measured, report in %s\n", static_cast<unsigned long long>(session.Delivered()),
+		static_cast<unsigned long long>(session.MeasureCount()), reportPath.c_str());
+	return frames.allocatingFrames > 0 ? EXIT_PAINT_ALLOCATED : 0;
+}
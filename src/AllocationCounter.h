@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocation counting for checking that hot paths (painting in particular) stay
+// allocation-free. Only active when built with ARCC_COUNT_ALLOCATIONS
+// (msbuild ... /p:CountAllocations=true), which replaces the global operator new with the one in
+// AllocationHooks.h. Otherwise everything here compiles to nothing.
+namespace AllocationCounter {
+#ifdef ARCC_COUNT_ALLOCATIONS
+	constexpr bool ENABLED = true;
+#else
+	constexpr bool ENABLED = false;
+#endif
+
+	// Per thread, so a scope on one thread isn't charged for allocations on another
+	inline uint64_t& Count() {
+		static thread_local uint64_t count = 0;
+		return count;
+	}
+
+	// Allocations made between construction and Allocations()
+	class Scope {
+	public:
+		Scope() : m_start(Count()) {}
+
+		uint64_t Allocations() const { return Count() - m_start; }
+
+	private:
+		uint64_t m_start;
+	};
+}
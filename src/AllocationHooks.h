@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include "AllocationCounter.h"
+
+// The counting global operator new of an ARCC_COUNT_ALLOCATIONS build. A program may only
+// replace it once, so this goes in the translation unit with main and nowhere else.
+#ifdef ARCC_COUNT_ALLOCATIONS
+// Inlined into a caller, GCC sees free() on what new returned, which here is the point
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+	AllocationCounter::Count()++;
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+// Over-aligned types (alignas wider than the default) come through here, C++17 and later
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment) {
+	AllocationCounter::Count()++;
+	size_t align = static_cast<size_t>(alignment);
+	if (align < sizeof(void*)) align = sizeof(void*);
+#ifdef _WIN32
+	if (void* p = _aligned_malloc(size ? size : 1, align)) return p;
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, align, size ? size : 1) == 0) return p;
+#endif
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept {
+	operator delete(p, alignment);
+}
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#endif
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Keystrokes.h"
+
+// Delivery of a planned payload into the foreground window. Input is collected as SendInput
+// events and sent in as few batches as the target keeps up with: SendInput never interleaves
+// other input within a batch, so a large one can't be garbled by a key pressed meanwhile. Batches
+// only split between characters, never between a Shift and the key it shifts.
+//
+// After each batch the target's thread is pinged with WM_NULL. A thread that is still working
+// through earlier input answers late, which is the nearest Win32 gets to backpressure from
+// another process, and the next batch shrinks (Keystrokes::ChunkSizer).
+class InputBatch : public InputSink {
+public:
+	struct Stats {
+		ULONGLONG events = 0;           // Events SendInput took
+		ULONGLONG batches = 0;
+		ULONGLONG backoffs = 0;         // Batches refused in part or answered late
+		ULONGLONG maxBatch = 0;
+	};
+
+	InputBatch() {
+		m_inputs.reserve(INITIAL_CAPACITY);
+		m_groupEnds.reserve(INITIAL_CAPACITY / 2);
+	}
+
+	void Key(uint8_t virtualKey, bool up) override {
+		INPUT input = {};
+		input.type = INPUT_KEYBOARD;
+		input.ki.wVk = virtualKey;
+		input.ki.dwFlags = up ? KEYEVENTF_KEYUP : 0;
+		Push(input, up);
+	}
+
+	void Unicode(wchar_t unit, bool up) override {
+		INPUT input = {};
+		input.type = INPUT_KEYBOARD;
+		input.ki.wScan = unit;
+		input.ki.dwFlags = KEYEVENTF_UNICODE | (up ? KEYEVENTF_KEYUP : 0);
+		Push(input, up);
+	}
+
+	void Clear() {
+		m_inputs.clear();
+		m_groupEnds.clear();
+		m_held = 0;
+	}
+
+	size_t Size() const { return m_inputs.size(); }
+
+	// Sends everything collected to whichever window has the keyboard, pacing by hTarget. False
+	// if input stays blocked (a higher integrity target, or the secure desktop).
+	bool Send(HWND hTarget) {
+		Keystrokes::ChunkSizer sizer(INITIAL_BATCH, MIN_BATCH, MAX_BATCH);
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+
+		size_t sent = 0;
+		size_t group = 0;
+		int stalls = 0;
+		while (sent < m_inputs.size()) {
+			size_t count = BatchSize(sent, sizer.Size(), group);
+
+			LARGE_INTEGER start, end;
+			QueryPerformanceCounter(&start);
+			UINT accepted = SendInput(static_cast<UINT>(count), &m_inputs[sent], sizeof(INPUT));
+			SendMessageTimeoutW(hTarget, WM_NULL, 0, 0, SMTO_ABORTIFHUNG, PACE_TIMEOUT_MS, nullptr);
+			QueryPerformanceCounter(&end);
+
+			uint64_t micros = static_cast<uint64_t>(end.QuadPart - start.QuadPart) * 1000000 / static_cast<uint64_t>(freq.QuadPart);
+			sizer.Completed(count, accepted, micros, BATCH_BUDGET_MICROS);
+			m_stats.batches++;
+			m_stats.events += accepted;
+			if (accepted > m_stats.maxBatch) m_stats.maxBatch = accepted;
+			sent += accepted;
+
+			if (accepted < count) {
+				if (accepted == 0 && ++stalls > MAX_STALLS) return false;
+				Sleep(BACKOFF_MS);
+			}
+			else {
+				stalls = 0;
+			}
+		}
+		m_stats.backoffs += sizer.Backoffs();
+		return true;
+	}
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	static constexpr size_t INITIAL_CAPACITY = 1024;
+	static constexpr size_t INITIAL_BATCH = 512;        // Events, two to four per character
+	static constexpr size_t MIN_BATCH = 32;
+	static constexpr size_t MAX_BATCH = 16384;
+	static constexpr uint64_t BATCH_BUDGET_MICROS = 20000;
+	static constexpr UINT PACE_TIMEOUT_MS = 1000;
+	static constexpr DWORD BACKOFF_MS = 20;
+	static constexpr int MAX_STALLS = 25;
+
+	std::vector<INPUT> m_inputs;
+	std::vector<size_t> m_groupEnds;    // Where each character's events end, e.g. 4 for a shifted one
+	size_t m_held = 0;                  // Keys down and not yet up
+	Stats m_stats;
+
+	// A group ends when the last key held is released, so Shift+key or Ctrl+V stays together
+	void Push(const INPUT& input, bool up) {
+		m_inputs.push_back(input);
+		if (!up) {
+			m_held++;
+		}
+		else if (m_held > 0 && --m_held == 0) {
+			m_groupEnds.push_back(m_inputs.size());
+		}
+	}
+
+	// The most whole groups from sent that fit in limit events, at least one. group is the first
+	// group ending past sent, carried between calls.
+	size_t BatchSize(size_t sent, size_t limit, size_t& group) const {
+		while (group < m_groupEnds.size() && m_groupEnds[group] <= sent) group++;
+		if (group == m_groupEnds.size()) {
+			// Events after the last group (unbalanced input) go as they are
+			return m_inputs.size() - sent < limit ? m_inputs.size() - sent : limit;
+		}
+		size_t end = m_groupEnds[group];
+		for (size_t next = group + 1; next < m_groupEnds.size() && m_groupEnds[next] - sent <= limit; next++) {
+			end = m_groupEnds[next];
+		}
+		return end - sent;
+	}
+};
+
+// What was on the clipboard before a paste, so it can be put back once the target has read it.
+// Only text is kept; anything else on the clipboard is lost to the paste.
+struct SavedClipboard {
+	bool hadText = false;
+	std::wstring text;
+	DWORD sequence = 0;     // GetClipboardSequenceNumber once the payload went on
+};
+
+// Another process may have the clipboard open for a moment
+inline bool OpenClipboardRetrying(HWND hOwner) {
+	static constexpr int OPEN_ATTEMPTS = 10;
+	static constexpr DWORD OPEN_RETRY_MS = 10;
+	for (int attempt = 0; attempt < OPEN_ATTEMPTS; attempt++) {
+		if (OpenClipboard(hOwner)) return true;
+		Sleep(OPEN_RETRY_MS);
+	}
+	return false;
+}
+
+// Replaces the clipboard's contents with text, as is. The clipboard owns the memory once it takes it.
+inline bool PutClipboardText(HWND hOwner, const wchar_t* text, size_t length) {
+	HGLOBAL hMemory = GlobalAlloc(GMEM_MOVEABLE, (length + 1) * sizeof(wchar_t));
+	if (!hMemory) return false;
+	wchar_t* pText = static_cast<wchar_t*>(GlobalLock(hMemory));
+	if (!pText) {
+		GlobalFree(hMemory);
+		return false;
+	}
+	memcpy(pText, text, length * sizeof(wchar_t));
+	pText[length] = L'\0';
+	GlobalUnlock(hMemory);
+
+	if (!OpenClipboardRetrying(hOwner)) {
+		GlobalFree(hMemory);
+		return false;
+	}
+	bool set = EmptyClipboard() && SetClipboardData(CF_UNICODETEXT, hMemory) != nullptr;
+	CloseClipboard();
+	if (!set) GlobalFree(hMemory);
+	return set;
+}
+
+// Copies the clipboard's text, if it has any, before a paste replaces it
+inline void SaveClipboardText(HWND hOwner, SavedClipboard& saved) {
+	saved.hadText = false;
+	saved.text.clear();
+	if (!IsClipboardFormatAvailable(CF_UNICODETEXT) || !OpenClipboardRetrying(hOwner)) return;
+
+	HANDLE hData = GetClipboardData(CF_UNICODETEXT);
+	const wchar_t* pText = hData ? static_cast<const wchar_t*>(GlobalLock(hData)) : nullptr;
+	if (pText) {
+		// Bounded by the allocation, in case the text isn't terminated
+		size_t capacity = GlobalSize(hData) / sizeof(wchar_t);
+		size_t length = 0;
+		while (length < capacity && pText[length] != L'\0') length++;
+		saved.text.assign(pText, length);
+		saved.hadText = true;
+		GlobalUnlock(hData);
+	}
+	CloseClipboard();
+}
+
+// Puts text on the clipboard as CF_UNICODETEXT, line breaks as CRLF, and notes the clipboard's
+// sequence number so RestoreClipboardText can tell whether anyone copied something since
+inline bool SetClipboardText(HWND hOwner, const wchar_t* text, size_t length, SavedClipboard& saved) {
+	std::wstring converted;
+	converted.reserve(length + length / 16);
+	for (size_t i = 0; i < length; i++) {
+		if (text[i] == L'\n' && (i == 0 || text[i - 1] != L'\r')) converted += L'\r';
+		converted += text[i];
+	}
+	if (!PutClipboardText(hOwner, converted.data(), converted.size())) return false;
+	saved.sequence = GetClipboardSequenceNumber();
+	return true;
+}
+
+// Puts back what SaveClipboardText found, or empties the clipboard if it held no text. Call it
+// once the target has read the paste; putting the old text back before then would paste that
+// instead. Left alone if something else was copied since the payload went on.
+inline void RestoreClipboardText(HWND hOwner, const SavedClipboard& saved) {
+	if (GetClipboardSequenceNumber() != saved.sequence) return;
+	if (saved.hadText) {
+		PutClipboardText(hOwner, saved.text.data(), saved.text.size());
+	}
+	else if (OpenClipboardRetrying(hOwner)) {
+		EmptyClipboard();
+		CloseClipboard();
+	}
+}
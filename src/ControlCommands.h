@@ -0,0 +1,227 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "ControlProtocol.h"
+#include "Schedule.h"
+#include "Ui.h"
+
+// What the control commands act on. The app implements it with the same calls its buttons and
+// the countdown use, so a command has the same effect as the matching click; tests implement it
+// with a fake.
+class ControlTarget {
+public:
+	// One armed job in the session's shared schedule
+	struct SharedJob {
+		uint32_t ownerPid;
+		uint64_t job;
+		int64_t deadline;       // Unix seconds
+	};
+
+	virtual ~ControlTarget() = default;
+
+	virtual const Clock& GetClock() const = 0;
+
+	// The window resumes are delivered to, and its process name in UTF-8
+	virtual bool HasTarget() const = 0;
+	virtual std::string TargetName() const = 0;
+
+	virtual bool TimerActive() const = 0;
+	virtual uint64_t ArmedJob() const = 0;
+	virtual Clock::time_point Deadline() const = 0;
+
+	// Each replaces whatever timer was running
+	virtual void ArmHour(int hourOffset, Clock::time_point deadline) = 0;
+	virtual void Arm(Clock::time_point deadline) = 0;
+	virtual void ArmRecurring(const Recurrence& recurrence) = 0;
+	virtual void Cancel() = 0;
+	virtual void Fire() = 0;
+
+	// Up to capacity of the shared schedule's jobs, returns how many
+	virtual size_t SharedJobs(SharedJob* jobs, size_t capacity) = 0;
+
+	// From a UTF-8 file, or back to the default with reset. False if the file couldn't be read.
+	virtual bool SetPayload(bool reset, const std::string& path, size_t& length) = 0;
+
+	// Returns the lead as clamped
+	virtual int64_t SetWakeLead(int64_t seconds) = 0;
+
+	virtual bool Watch(const std::string& path) = 0;
+	virtual void StopWatching() = 0;
+	virtual size_t WatchCount() const = 0;
+
+	// -1 unbinds. False if tmux can't be reached. PaneId is empty with no pane bound.
+	virtual bool BindPane(int64_t pane) = 0;
+	virtual std::string PaneId() const = 0;
+
+	virtual void EnableTrace(bool enable) = 0;
+	virtual bool DumpTrace(std::string& path) = 0;
+};
+
+// Control protocol commands onto a ControlTarget: checks the arguments and the target's state,
+// calls the one method that does the work and formats the reply.
+namespace ControlCommands {
+	constexpr const char* ERR_NO_TARGET = "err no target";
+	constexpr const char* ERR_BAD_HOUR = "err hour out of range";
+	constexpr const char* ERR_PAST = "err deadline has passed";
+	constexpr const char* ERR_BAD_RULE = "err bad rule";
+	constexpr const char* ERR_UNKNOWN = "err unknown command";
+	constexpr const char* ERR_TMUX = "err tmux unavailable";
+	constexpr const char* ERR_TRACE = "err trace not written";
+	constexpr const char* ERR_PAYLOAD = "err payload not read";
+	constexpr const char* ERR_WATCH = "err directory not watched";
+
+	constexpr size_t MAX_SHARED_JOBS = 64;
+
+	inline int64_t ToUnixSeconds(Clock::time_point time) {
+		return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+	}
+
+	// ok <job> <deadline>
+	inline std::string ArmedReply(const ControlTarget& target) {
+		return "ok " + std::to_string(target.ArmedJob()) + " " + std::to_string(ToUnixSeconds(target.Deadline()));
+	}
+
+	// Sets reply (without the newline)
+	inline void Handle(const ControlProtocol::Command& command, ControlTarget& target, std::string& reply) {
+		using Type = ControlProtocol::Command::Type;
+		const Clock& clock = target.GetClock();
+
+		switch (command.type) {
+		case Type::Arm: {
+			if (!target.HasTarget()) {
+				reply = ERR_NO_TARGET;
+				return;
+			}
+
+			Clock::time_point deadline;
+			if (command.absolute) {
+				deadline = Clock::time_point(std::chrono::seconds(command.value));
+			}
+			else {
+				if (command.value < 0 || command.value >= Ui::HOUR_COUNT) {
+					reply = ERR_BAD_HOUR;
+					return;
+				}
+				deadline = Schedule::HourTarget(clock, static_cast<int>(command.value));
+			}
+			if (deadline <= clock.Now()) {
+				reply = ERR_PAST;
+				return;
+			}
+
+			if (command.absolute) {
+				target.Arm(deadline);
+			}
+			else {
+				target.ArmHour(static_cast<int>(command.value), deadline);
+			}
+			reply = ArmedReply(target);
+			break;
+		}
+		case Type::Repeat: {
+			if (!target.HasTarget()) {
+				reply = ERR_NO_TARGET;
+				return;
+			}
+
+			Recurrence recurrence;
+			if (!Recurrence::Compile(command.text.c_str(), clock, recurrence)) {
+				reply = ERR_BAD_RULE;
+				return;
+			}
+			target.ArmRecurring(recurrence);
+			reply = ArmedReply(target);
+			break;
+		}
+		case Type::Cancel:
+			target.Cancel();
+			reply = "ok";
+			break;
+		case Type::List:
+			// ok armed <job> <deadline> <process> | ok idle [<process>]
+			reply = target.TimerActive() ? "ok armed " + std::to_string(target.ArmedJob()) + " " +
+				std::to_string(ToUnixSeconds(target.Deadline())) : "ok idle";
+			if (target.HasTarget()) {
+				reply += ' ';
+				reply += target.TargetName();
+			}
+			break;
+		case Type::Jobs: {
+			// ok <count> [<pid>:<job>@<deadline>]...
+			ControlTarget::SharedJob jobs[MAX_SHARED_JOBS];
+			size_t count = target.SharedJobs(jobs, MAX_SHARED_JOBS);
+			reply = "ok " + std::to_string(count);
+			for (size_t i = 0; i < count; i++) {
+				reply += ' ' + std::to_string(jobs[i].ownerPid) + ':' + std::to_string(jobs[i].job) + '@' +
+					std::to_string(jobs[i].deadline);
+			}
+			break;
+		}
+		case Type::Payload: {
+			// Kept with the target's profile, so it comes back with the application
+			if (!target.HasTarget()) {
+				reply = ERR_NO_TARGET;
+				return;
+			}
+			size_t length = 0;
+			if (!target.SetPayload(command.value == ControlProtocol::PAYLOAD_RESET, command.text, length)) {
+				reply = ERR_PAYLOAD;
+				return;
+			}
+			reply = "ok " + std::to_string(length);
+			break;
+		}
+		case Type::Lead:
+			// Applies to the deadline already armed too
+			reply = "ok " + std::to_string(target.SetWakeLead(command.value));
+			break;
+		case Type::Watch:
+			if (command.value == ControlProtocol::WATCH_STOP) {
+				target.StopWatching();
+			}
+			else if (!target.Watch(command.text)) {
+				reply = ERR_WATCH;
+				return;
+			}
+			reply = "ok " + std::to_string(target.WatchCount());
+			break;
+		case Type::Fire:
+			if (!target.HasTarget()) {
+				reply = ERR_NO_TARGET;
+				return;
+			}
+			target.Fire();
+			reply = "ok";
+			break;
+		case Type::Pane: {
+			// The pane belongs to the target (the terminal running tmux), a new target unbinds it
+			if (!target.HasTarget()) {
+				reply = ERR_NO_TARGET;
+				return;
+			}
+			if (!target.BindPane(command.value)) {
+				reply = ERR_TMUX;
+				return;
+			}
+			std::string pane = target.PaneId();
+			reply = pane.empty() ? "ok" : "ok " + pane;
+			break;
+		}
+		case Type::Trace:
+			if (command.value == ControlProtocol::TRACE_DUMP) {
+				std::string path;
+				reply = target.DumpTrace(path) ? "ok " + path : ERR_TRACE;
+			}
+			else {
+				target.EnableTrace(command.value == ControlProtocol::TRACE_ON);
+				reply = "ok";
+			}
+			break;
+		default:
+			reply = ERR_UNKNOWN;
+			break;
+		}
+	}
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <windows.h>
+#include <cstring>
+#include <string>
+#include "ControlProtocol.h"
+#include "EventLoop.h"
+
+// Local control endpoint so other tools can drive the timer: ControlProtocol over one overlapped
+// named pipe instance serviced from the event loop, no extra thread. The app serves \\.\pipe\arcc from the session's coordinating instance, and \\.\pipe\arcc-<pid>
+// from every instance for commands meant for that one's target. bench/PipeBench.cpp measures it.
+class ControlPipe {
+public:
+	using Stats = ControlProtocol::Stats;
+
+	ControlPipe() = default;
+
+	~ControlPipe() {
+		Stop();
+	}
+
+	ControlPipe(const ControlPipe&) = delete;
+	ControlPipe& operator=(const ControlPipe&) = delete;
+
+	// Fails if another process already serves the name
+	bool Start(const wchar_t* name, EventLoop& loop, ControlProtocol::Handler handler) {
+		if (m_hPipe != INVALID_HANDLE_VALUE) return true;
+
+		m_hPipe = CreateNamedPipeW(name,
+			PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+			PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+			1, BUFFER_SIZE, BUFFER_SIZE, 0, nullptr);
+		if (m_hPipe == INVALID_HANDLE_VALUE) return false;
+
+		m_hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (!m_hEvent || !loop.Add(m_hEvent, [this]() { OnSignalled(); })) {
+			Stop();
+			return false;
+		}
+
+		m_pLoop = &loop;
+		m_protocol.SetHandler(std::move(handler));
+		Connect();
+		return true;
+	}
+
+	void Stop() {
+		if (m_hPipe != INVALID_HANDLE_VALUE) {
+			// The pending operation still owns m_overlapped until it completes
+			if (CancelIoEx(m_hPipe, &m_overlapped)) {
+				DWORD bytes;
+				GetOverlappedResult(m_hPipe, &m_overlapped, &bytes, TRUE);
+			}
+			CloseHandle(m_hPipe);
+			m_hPipe = INVALID_HANDLE_VALUE;
+		}
+		if (m_hEvent) {
+			if (m_pLoop) {
+				m_pLoop->Remove(m_hEvent);
+			}
+			CloseHandle(m_hEvent);
+			m_hEvent = nullptr;
+		}
+		m_pLoop = nullptr;
+		m_input.clear();
+		m_output.clear();
+	}
+
+	Stats GetStats() const { return m_protocol.GetStats(); }
+
+private:
+	static constexpr DWORD BUFFER_SIZE = 4096;
+
+	enum class State {
+		Connecting,
+		Reading,
+		Writing
+	};
+
+	HANDLE m_hPipe = INVALID_HANDLE_VALUE;
+	HANDLE m_hEvent = nullptr;
+	OVERLAPPED m_overlapped = {};
+	State m_state = State::Connecting;
+	EventLoop* m_pLoop = nullptr;
+	ControlProtocol m_protocol;
+
+	char m_readBuffer[BUFFER_SIZE];
+	std::string m_input;    // Received, not yet a complete line
+	std::string m_output;   // Replies not yet written
+
+	// Every operation completes through m_hEvent, even ones that finish immediately
+	void ResetOverlapped() {
+		memset(&m_overlapped, 0, sizeof(m_overlapped));
+		m_overlapped.hEvent = m_hEvent;
+	}
+
+	void Connect() {
+		m_state = State::Connecting;
+		ResetOverlapped();
+		if (ConnectNamedPipe(m_hPipe, &m_overlapped)) return;
+
+		switch (GetLastError()) {
+		case ERROR_IO_PENDING:
+			break;
+		case ERROR_PIPE_CONNECTED:
+			// Client got in between instances, nothing will signal for it
+			m_protocol.Connected();
+			Read();
+			break;
+		default:
+			// Pipe unusable, the endpoint stays silent from here on
+			break;
+		}
+	}
+
+	// Drop the client and wait for the next one
+	void Reconnect() {
+		DisconnectNamedPipe(m_hPipe);
+		m_input.clear();
+		m_output.clear();
+		Connect();
+	}
+
+	void Read() {
+		m_state = State::Reading;
+		ResetOverlapped();
+		if (!ReadFile(m_hPipe, m_readBuffer, BUFFER_SIZE, nullptr, &m_overlapped) && GetLastError() != ERROR_IO_PENDING) {
+			Reconnect();
+		}
+	}
+
+	void Write() {
+		m_state = State::Writing;
+		ResetOverlapped();
+		if (!WriteFile(m_hPipe, m_output.data(), static_cast<DWORD>(m_output.size()), nullptr, &m_overlapped) &&
+			GetLastError() != ERROR_IO_PENDING) {
+			Reconnect();
+		}
+	}
+
+	void OnSignalled() {
+		DWORD bytes = 0;
+		BOOL ok = GetOverlappedResult(m_hPipe, &m_overlapped, &bytes, FALSE);
+		ResetEvent(m_hEvent);
+
+		switch (m_state) {
+		case State::Connecting:
+			if (!ok) {
+				Reconnect();
+				return;
+			}
+			m_protocol.Connected();
+			Read();
+			break;
+		case State::Reading:
+			if (!ok || bytes == 0) {
+				Reconnect();
+				return;
+			}
+			m_input.append(m_readBuffer, bytes);
+			HandleInput();
+			break;
+		case State::Writing:
+			if (!ok) {
+				Reconnect();
+				return;
+			}
+			m_output.erase(0, bytes);
+			if (!m_output.empty()) {
+				Write();
+			}
+			else {
+				Read();
+			}
+			break;
+		}
+	}
+
+	// Handle every complete line received so far, then send all their replies at once
+	void HandleInput() {
+		m_protocol.HandleInput(m_input, m_output);
+		if (!m_output.empty()) {
+			Write();
+		}
+		else {
+			Read();
+		}
+	}
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include "Platform.h"
+
+// The control endpoints' protocol, apart from how the bytes arrive: ControlPipe serves it over a
+// named pipe on Windows, ControlSocket over a Unix domain socket elsewhere.
+//
+// Newline-terminated ASCII commands, one reply line per command, in order.
+//   arm <hour>      arm for the hour button <hour> (0 = this hour)
+//   arm @<seconds>  arm for a Unix time
+//   repeat <rule>   arm on a recurrence rule, e.g. "every 5h from 03:00:10" or "weekdays at 09:00:10"
+//   cancel          stop the timer
+//   list            timer state
+//   jobs            every instance's armed jobs, from the session's shared schedule
+//   fire            send the resume message now
+//   payload <path>  resume with the text of a UTF-8 file instead (several KB and line breaks are fine)
+//   payload -       back to the default resume message
+//   lead <seconds>  how long before the deadline power saving mode wakes the machine
+//   watch <path>    arm from the reset time in a CLI's JSON status file whenever it changes
+//   watch -         stop watching status files
+//   pane %<id>      deliver to this tmux pane of the target instead of typing into its window
+//   pane -          back to typing into the window
+//   trace on|off    start or stop recording trace spans
+//   trace dump      write the recorded spans as Chrome trace JSON, the reply carries the path
+// Replies start with "ok" or "err". Clients may write any number of commands before reading,
+// every complete command in a read is handled and the replies go back in a single write.
+class ControlProtocol {
+public:
+	struct Command {
+		enum class Type {
+			Arm,
+			Repeat,
+			Cancel,
+			List,
+			Jobs,
+			Payload,
+			Lead,
+			Watch,
+			Fire,
+			Pane,
+			Trace,
+			Unknown
+		};
+		Type type = Type::Unknown;
+		bool absolute = false;  // Arm: value is a Unix time rather than an hour button
+		int64_t value = 0;      // Lead: seconds. Pane: pane number, or -1 to unbind. Trace: TRACE_OFF/ON/DUMP. Payload: PAYLOAD_FILE/RESET. Watch: WATCH_FILE/STOP
+		std::string text;       // Repeat: the rule. Payload, Watch: the file path
+	};
+
+	static constexpr int64_t TRACE_OFF = 0;
+	static constexpr int64_t TRACE_ON = 1;
+	static constexpr int64_t TRACE_DUMP = 2;
+	static constexpr int64_t PAYLOAD_FILE = 0;
+	static constexpr int64_t PAYLOAD_RESET = 1;
+	static constexpr int64_t WATCH_FILE = 0;
+	static constexpr int64_t WATCH_STOP = 1;
+
+	// Sets reply (without the newline)
+	using Handler = std::function<void(const Command&, std::string& reply)>;
+
+	// Across every client of an endpoint
+	struct Stats {
+		uint64_t connectionCount = 0;
+		uint64_t commandCount = 0;
+		uint64_t batchCount = 0;        // Reads that carried at least one command
+		uint64_t maxBatchSize = 0;      // Most commands in one read
+		uint64_t batchTicks = 0;        // Platform::Ticks from a read completing to its replies being queued
+		uint64_t maxBatchTicks = 0;
+		uint64_t ticksPerSecond = 1;
+	};
+
+	ControlProtocol() {
+		m_stats.ticksPerSecond = Platform::TicksPerSecond();
+	}
+
+	void SetHandler(Handler handler) { m_handler = std::move(handler); }
+
+	void Connected() { m_stats.connectionCount++; }
+
+	// Handles every complete line in input, which one client's reads are appended to, and appends
+	// their replies to output. A partial line stays in input for the next read. Returns the
+	// number of commands handled.
+	size_t HandleInput(std::string& input, std::string& output) {
+		uint64_t start = Platform::Ticks();
+
+		size_t commands = 0;
+		size_t lineStart = 0;
+		for (;;) {
+			size_t lineEnd = input.find('\n', lineStart);
+			if (lineEnd == std::string::npos) break;
+
+			size_t length = lineEnd - lineStart;
+			if (length > 0 && input[lineEnd - 1] == '\r') length--;
+			if (length > 0) {
+				m_reply.clear();
+				m_handler(Parse(input.data() + lineStart, length), m_reply);
+				output += m_reply;
+				output += '\n';
+				commands++;
+			}
+			lineStart = lineEnd + 1;
+		}
+		input.erase(0, lineStart);
+
+		// A client that never sends a newline can't grow the buffer without bound
+		if (input.size() > MAX_LINE) {
+			input.clear();
+			output += ERR_LINE_TOO_LONG;
+			output += '\n';
+		}
+
+		if (commands > 0) {
+			uint64_t ticks = Platform::Ticks() - start;
+			m_stats.commandCount += commands;
+			m_stats.batchCount++;
+			m_stats.batchTicks += ticks;
+			if (ticks > m_stats.maxBatchTicks) m_stats.maxBatchTicks = ticks;
+			if (commands > m_stats.maxBatchSize) m_stats.maxBatchSize = commands;
+		}
+		return commands;
+	}
+
+	Stats GetStats() const { return m_stats; }
+
+	static Command Parse(const char* line, size_t length) {
+		Command command;
+		std::string text(line, length);
+		const char* p = text.c_str();
+		const char* end = p + text.size();
+
+		const char* verb = p;
+		while (p < end && *p != ' ') p++;
+		size_t verbLength = static_cast<size_t>(p - verb);
+		while (p < end && *p == ' ') p++;
+
+		if (IsVerb(verb, verbLength, "arm")) {
+			command.absolute = p < end && *p == '@';
+			if (command.absolute) p++;
+
+			char* parsedEnd = nullptr;
+			long long value = strtoll(p, &parsedEnd, 10);
+			if (parsedEnd != p && parsedEnd == end) {
+				command.type = Command::Type::Arm;
+				command.value = value;
+			}
+		}
+		else if (IsVerb(verb, verbLength, "repeat")) {
+			if (p < end) {
+				command.type = Command::Type::Repeat;
+				command.text.assign(p, end);
+			}
+		}
+		else if (IsVerb(verb, verbLength, "payload")) {
+			if (p < end) {
+				command.type = Command::Type::Payload;
+				command.value = end - p == 1 && *p == '-' ? PAYLOAD_RESET : PAYLOAD_FILE;
+				command.text.assign(p, end);
+			}
+		}
+		else if (IsVerb(verb, verbLength, "lead")) {
+			char* parsedEnd = nullptr;
+			long long value = strtoll(p, &parsedEnd, 10);
+			if (parsedEnd != p && parsedEnd == end && value >= 0) {
+				command.type = Command::Type::Lead;
+				command.value = value;
+			}
+		}
+		else if (IsVerb(verb, verbLength, "watch")) {
+			if (p < end) {
+				command.type = Command::Type::Watch;
+				command.value = end - p == 1 && *p == '-' ? WATCH_STOP : WATCH_FILE;
+				command.text.assign(p, end);
+			}
+		}
+		else if (IsVerb(verb, verbLength, "pane")) {
+			if (end - p == 1 && *p == '-') {
+				command.type = Command::Type::Pane;
+				command.value = -1;
+			}
+			else if (p < end && *p == '%' && p + 1 < end && p[1] >= '0' && p[1] <= '9') {
+				char* parsedEnd = nullptr;
+				long long value = strtoll(p + 1, &parsedEnd, 10);
+				if (parsedEnd == end) {
+					command.type = Command::Type::Pane;
+					command.value = value;
+				}
+			}
+		}
+		else if (IsVerb(verb, verbLength, "trace")) {
+			size_t argLength = static_cast<size_t>(end - p);
+			command.type = Command::Type::Trace;
+			if (IsVerb(p, argLength, "on")) command.value = TRACE_ON;
+			else if (IsVerb(p, argLength, "off")) command.value = TRACE_OFF;
+			else if (IsVerb(p, argLength, "dump")) command.value = TRACE_DUMP;
+			else command.type = Command::Type::Unknown;
+		}
+		else if (p == end) {
+			if (IsVerb(verb, verbLength, "cancel")) command.type = Command::Type::Cancel;
+			else if (IsVerb(verb, verbLength, "list")) command.type = Command::Type::List;
+			else if (IsVerb(verb, verbLength, "jobs")) command.type = Command::Type::Jobs;
+			else if (IsVerb(verb, verbLength, "fire")) command.type = Command::Type::Fire;
+		}
+		return command;
+	}
+
+private:
+	static constexpr size_t MAX_LINE = 1024;
+	static constexpr const char* ERR_LINE_TOO_LONG = "err line too long";
+
+	Handler m_handler;
+	std::string m_reply;
+	Stats m_stats;
+
+	static bool IsVerb(const char* verb, size_t length, const char* name) {
+		return length == strlen(name) && memcmp(verb, name, length) == 0;
+	}
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ControlProtocol.h"
+#include "EventLoop.h"
+
+// The control endpoint off Windows: ControlProtocol over a Unix domain stream socket listening on
+// the epoll loop, no extra thread. Unlike the single pipe instance any number of clients may be
+// connected, each with its own partial line and unsent replies. The loop is edge-triggered, so
+// accepts, reads and writes each go until EAGAIN. A client that stops reading its replies is
+// only read from again once they have gone out. bench/PipeBench.cpp measures it on Linux.
+class ControlSocket {
+public:
+	using Stats = ControlProtocol::Stats;
+
+	ControlSocket() = default;
+
+	~ControlSocket() {
+		Stop();
+	}
+
+	ControlSocket(const ControlSocket&) = delete;
+	ControlSocket& operator=(const ControlSocket&) = delete;
+
+	// Fails if another process already serves the path. A socket file left by one that died is
+	// replaced.
+	bool Start(const char* path, EventLoop& loop, ControlProtocol::Handler handler) {
+		if (m_listener >= 0) return true;
+
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (strlen(path) >= sizeof(address.sun_path)) return false;
+		strcpy(address.sun_path, path);
+
+		if (IsServed(address)) return false;
+		unlink(path);
+
+		m_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (m_listener < 0) return false;
+		if (bind(m_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+			listen(m_listener, BACKLOG) != 0 || !loop.Add(m_listener, [this]() { OnListener(); })) {
+			close(m_listener);
+			m_listener = -1;
+			return false;
+		}
+
+		m_path = path;
+		m_pLoop = &loop;
+		m_protocol.SetHandler(std::move(handler));
+		return true;
+	}
+
+	void Stop() {
+		for (auto& entry : m_clients) {
+			m_pLoop->Remove(entry.first);
+			close(entry.first);
+		}
+		m_clients.clear();
+		if (m_listener >= 0) {
+			m_pLoop->Remove(m_listener);
+			close(m_listener);
+			m_listener = -1;
+			unlink(m_path.c_str());
+		}
+		m_pLoop = nullptr;
+	}
+
+	size_t ClientCount() const { return m_clients.size(); }
+
+	Stats GetStats() const { return m_protocol.GetStats(); }
+
+private:
+	static constexpr int BACKLOG = 16;
+	static constexpr size_t MAX_UNSENT = 64 * 1024;   // Replies queued before the client's input waits
+
+	struct Client {
+		std::string input;      // Received, not yet a complete line
+		std::string output;     // Replies not yet written
+		bool waitingToWrite = false;
+	};
+
+	int m_listener = -1;
+	std::string m_path;
+	EventLoop* m_pLoop = nullptr;
+	ControlProtocol m_protocol;
+	std::unordered_map<int, std::unique_ptr<Client>> m_clients;
+
+	static bool IsServed(const sockaddr_un& address) {
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (probe < 0) return false;
+		bool served = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+		close(probe);
+		return served;
+	}
+
+	void OnListener() {
+		for (;;) {
+			int fd = accept4(m_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0) {
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				// EAGAIN: all taken. Anything else (out of descriptors) leaves the rest queued
+				// until the next connection arrives.
+				return;
+			}
+			if (!m_pLoop->Add(fd, [this, fd]() { OnClient(fd); })) {
+				close(fd);
+				continue;
+			}
+			m_clients[fd].reset(new Client());
+			m_protocol.Connected();
+		}
+	}
+
+	// Readable, writable or hung up: send what is queued, then read and handle what came in
+	void OnClient(int fd) {
+		auto it = m_clients.find(fd);
+		if (it == m_clients.end()) return;
+		Client& client = *it->second;
+
+		if (!Flush(fd, client)) {
+			Close(fd);
+			return;
+		}
+
+		char* buffer = m_pLoop->ReadBuffer();
+		bool hungUp = false;
+		while (client.output.size() < MAX_UNSENT) {
+			ssize_t read = recv(fd, buffer, EventLoop::READ_BUFFER_SIZE, 0);
+			if (read > 0) {
+				client.input.append(buffer, static_cast<size_t>(read));
+				m_protocol.HandleInput(client.input, client.output);
+				continue;
+			}
+			if (read < 0 && errno == EINTR) continue;
+			hungUp = read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+			break;
+		}
+
+		// Replies to a client that has finished writing still go out if the socket takes them
+		if (!Flush(fd, client) || (hungUp && client.output.empty())) {
+			Close(fd);
+		}
+	}
+
+	// Writes until the replies are gone or the socket is full, then waits for it to be writable
+	// only as long as something is left. False if the client is gone.
+	bool Flush(int fd, Client& client) {
+		size_t sent = 0;
+		while (sent < client.output.size()) {
+			ssize_t written = send(fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+			if (written > 0) {
+				sent += static_cast<size_t>(written);
+				continue;
+			}
+			if (written < 0 && errno == EINTR) continue;
+			if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			return false;
+		}
+		client.output.erase(0, sent);
+
+		bool waiting = !client.output.empty();
+		if (waiting != client.waitingToWrite) {
+			m_pLoop->SetWritable(fd, waiting);
+			client.waitingToWrite = waiting;
+		}
+		return true;
+	}
+
+	void Close(int fd) {
+		m_pLoop->Remove(fd);
+		close(fd);
+		m_clients.erase(fd);
+	}
+};
+#endif
@@ -0,0 +1,454 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include "Platform.h"
+#ifndef _WIN32
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+// Message loop that also waits on kernel handles (processes, timers, events) so the app can
+// react to them the moment they signal instead of polling from WM_TIMER.
+//
+// The first handles are waited on directly by MsgWaitForMultipleObjectsEx, which takes at most
+// MAXIMUM_WAIT_OBJECTS - 1 of them. Any more go to thread pool waits (the pool waits on up to 63
+// handles per thread, not one thread each) that queue the signalled handle back to this loop, so
+// handlers always run on the loop thread and an idle loop costs nothing however many it watches.
+//
+// Elsewhere it is one edge-triggered epoll instance with no message queue, the loop a Linux
+// port's scheduler and delivery path would run on: deadlines (timerfd), target exits (pidfd),
+// signals (signalfd), and any non-blocking descriptor such as a pty master or the control socket.
+// Edge-triggered so an idle descriptor costs nothing and a busy one wakes once per change rather
+// than once per wait; in return every handler reads (or writes) until EAGAIN, or it hears nothing
+// more. The loop drains its own timer and signal descriptors before their handlers run. Handlers
+// run one at a time on the loop thread, so they share one read buffer (ReadBuffer) rather than
+// each keeping their own. LoopBench compares the two backends at thousands of handles.
+class EventLoop {
+public:
+	using Handler = std::function<void()>;
+#ifdef _WIN32
+	using Handle = HANDLE;
+#else
+	using Handle = int;
+#endif
+
+	struct Stats {
+		uint64_t wakeCount = 0;         // Returns from the wait
+		uint64_t handlerCount = 0;      // Handlers run, direct and pooled
+		uint64_t pooledCount = 0;       // Of those, handles waited on by the thread pool
+		uint64_t handlerTicks = 0;      // Platform::Ticks spent in handlers
+		uint64_t maxHandlerTicks = 0;
+		uint64_t ticksPerSecond = 1;
+	};
+
+	EventLoop() {
+		m_stats.ticksPerSecond = Platform::TicksPerSecond();
+#ifdef _WIN32
+		InitializeSRWLock(&m_readyLock);
+#else
+		m_epoll = epoll_create1(EPOLL_CLOEXEC);
+#endif
+	}
+
+	~EventLoop() {
+#ifdef _WIN32
+		for (auto& entry : m_pooled) {
+			CloseWait(*entry.second);
+		}
+		if (m_hReadyEvent) {
+			CloseHandle(m_hReadyEvent);
+		}
+#else
+		for (auto& entry : m_watched) {
+			if (entry.second.kind != Kind::Descriptor) {
+				close(entry.second.handle);
+			}
+		}
+		if (m_epoll >= 0) {
+			close(m_epoll);
+		}
+#endif
+	}
+
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	// Handler runs on the loop thread each time the handle is signalled. On Windows level-triggered
+	// handles (e.g. an exited process) must be removed or reset by their handler; elsewhere the
+	// descriptor must be non-blocking and its handler must drain it until EAGAIN.
+	bool Add(Handle handle, Handler handler) {
+#ifdef _WIN32
+		if (!handle) return false;
+
+		// The last direct slot is kept for the pool's ready event
+		if (m_handles.size() < MAX_HANDLES - 1) {
+			m_handles.push_back(handle);
+			m_handlers.push_back(std::move(handler));
+			return true;
+		}
+		return AddPooled(handle, std::move(handler));
+#else
+		return Watch(handle, Kind::Descriptor, std::move(handler));
+#endif
+	}
+
+	// Must be called before the handle is closed
+	void Remove(Handle handle) {
+#ifdef _WIN32
+		for (size_t i = 0; i < m_handles.size(); i++) {
+			if (m_handles[i] == handle) {
+				m_handles.erase(m_handles.begin() + i);
+				m_handlers.erase(m_handlers.begin() + i);
+				return;
+			}
+		}
+
+		auto it = m_pooledByHandle.find(handle);
+		if (it == m_pooledByHandle.end()) return;
+		auto pooled = m_pooled.find(it->second);
+		CloseWait(*pooled->second);
+		m_pooled.erase(pooled);
+		m_pooledByHandle.erase(it);
+#else
+		auto it = m_byHandle.find(handle);
+		if (it == m_byHandle.end()) return;
+		epoll_ctl(m_epoll, EPOLL_CTL_DEL, handle, nullptr);
+		auto watched = m_watched.find(it->second);
+		if (watched->second.kind != Kind::Descriptor) {
+			close(handle);
+		}
+		m_watched.erase(watched);
+		m_byHandle.erase(it);
+#endif
+	}
+
+#ifndef _WIN32
+	// Also wait for the descriptor to take writes (a pty or socket with output queued), or stop
+	// once it has. The handler tells which from trying.
+	bool SetWritable(Handle handle, bool writable) {
+		auto it = m_byHandle.find(handle);
+		if (it == m_byHandle.end()) return false;
+		epoll_event event = {};
+		event.events = EVENTS | (writable ? EPOLLOUT : 0u);
+		event.data.u64 = it->second;
+		return epoll_ctl(m_epoll, EPOLL_CTL_MOD, handle, &event) == 0;
+	}
+
+	// A deadline timer owned by the loop, armed with SetTimer. -1 on failure; Remove closes it.
+	Handle AddTimer(Handler handler) {
+		int timer = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (timer < 0) return -1;
+		if (!Watch(timer, Kind::Timer, std::move(handler))) {
+			close(timer);
+			return -1;
+		}
+		return timer;
+	}
+
+	// Fires once at an absolute wall-clock time, like the app's waitable timers: a clock change
+	// doesn't move the deadline, and also runs the handler so it can check again. A time already
+	// past fires at once.
+	bool SetTimer(Handle timer, std::chrono::system_clock::time_point deadline) {
+		auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+		if (nanos <= 0) nanos = 1;    // Zero would disarm it
+		itimerspec spec = {};
+		spec.it_value.tv_sec = static_cast<time_t>(nanos / 1000000000);
+		spec.it_value.tv_nsec = static_cast<long>(nanos % 1000000000);
+		return timerfd_settime(timer, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) == 0;
+	}
+
+	bool CancelTimer(Handle timer) {
+		itimerspec spec = {};
+		return timerfd_settime(timer, 0, &spec, nullptr) == 0;
+	}
+
+	// Runs the handler once when the process exits, through a pidfd (Linux 5.3 and later). The
+	// process need not be a child. -1 if it can't be watched, e.g. it has gone already; Remove
+	// closes it.
+	Handle AddProcess(pid_t pid, Handler handler) {
+		int process = static_cast<int>(syscall(SYS_PIDFD_OPEN, pid, 0));
+		if (process < 0) return -1;
+		if (!Watch(process, Kind::Process, std::move(handler))) {
+			close(process);
+			return -1;
+		}
+		return process;
+	}
+
+	// Runs the handler when the signal arrives, instead of its disposition. The signal is blocked
+	// in the calling thread; other threads must block it too (block it before starting them). -1
+	// on failure; Remove closes it.
+	Handle AddSignal(int signal, Handler handler) {
+		sigset_t mask;
+		sigemptyset(&mask);
+		sigaddset(&mask, signal);
+		if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) return -1;
+		int signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+		if (signals < 0) return -1;
+		if (!Watch(signals, Kind::Signal, std::move(handler))) {
+			close(signals);
+			return -1;
+		}
+		return signals;
+	}
+
+	// Scratch space for handlers draining a descriptor, reused by all of them. Valid until the
+	// handler returns.
+	char* ReadBuffer() { return m_readBuffer; }
+	static constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+#endif
+
+#ifdef _WIN32
+	size_t Size() const { return m_handles.size() + m_pooled.size(); }
+#else
+	size_t Size() const { return m_watched.size(); }
+#endif
+
+	Stats GetStats() const { return m_stats; }
+
+	// Makes Run return exitCode once the current handler is done. Loop thread only.
+	void Quit(int exitCode) {
+#ifdef _WIN32
+		PostQuitMessage(exitCode);
+#else
+		m_bQuit = true;
+		m_exitCode = exitCode;
+#endif
+	}
+
+	// Returns the WM_QUIT exit code
+	int Run() {
+#ifdef _WIN32
+		for (;;) {
+			DWORD count = static_cast<DWORD>(m_handles.size());
+			DWORD result = MsgWaitForMultipleObjectsEx(count, m_handles.empty() ? nullptr : m_handles.data(),
+				INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			m_stats.wakeCount++;
+
+			// An abandoned mutex is still acquired, its handler runs like any other
+			DWORD index = result < WAIT_OBJECT_0 + count ? result - WAIT_OBJECT_0 :
+				result >= WAIT_ABANDONED_0 && result < WAIT_ABANDONED_0 + count ? result - WAIT_ABANDONED_0 : count;
+			if (index < count) {
+				// Copy so the handler can remove itself
+				Handler handler = m_handlers[index];
+				RunHandler(handler);
+			}
+
+			// Drain messages after every wake so a busy handle can't starve the UI
+			MSG msg;
+			while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+				if (msg.message == WM_QUIT) {
+					return static_cast<int>(msg.wParam);
+				}
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		}
+#else
+		m_bQuit = false;
+		while (!m_bQuit) {
+			int count = epoll_wait(m_epoll, m_events, MAX_EVENTS, -1);
+			if (count < 0) {
+				if (errno == EINTR) continue;
+				return -1;
+			}
+			m_stats.wakeCount++;
+
+			for (int i = 0; i < count && !m_bQuit; i++) {
+				// An earlier handler in this batch may have removed it
+				auto it = m_watched.find(m_events[i].data.u64);
+				if (it == m_watched.end()) continue;
+				if (!Drain(it->second)) continue;
+				Handler handler = it->second.handler;
+				RunHandler(handler);
+			}
+		}
+		return m_exitCode;
+#endif
+	}
+
+private:
+#ifdef _WIN32
+	// MsgWaitForMultipleObjectsEx reserves one slot for the message queue
+	static constexpr size_t MAX_HANDLES = MAXIMUM_WAIT_OBJECTS - 1;
+
+	// A handle past the direct slots. The pool wait is one-shot and re-armed after the handler.
+	struct Pooled {
+		EventLoop* pLoop;
+		UINT64 id;
+		HANDLE handle;
+		Handler handler;
+		PTP_WAIT wait;
+	};
+
+	std::vector<HANDLE> m_handles;
+	std::vector<Handler> m_handlers;
+
+	// Ids rather than pointers cross threads, so a handle removed while queued is just skipped
+	std::unordered_map<UINT64, std::unique_ptr<Pooled>> m_pooled;
+	std::unordered_map<HANDLE, UINT64> m_pooledByHandle;
+	UINT64 m_lastPooledId = 0;
+	HANDLE m_hReadyEvent = nullptr;     // Auto-reset, waited on directly
+	SRWLOCK m_readyLock;
+	std::vector<UINT64> m_ready;        // Filled by pool threads under m_readyLock
+	std::vector<UINT64> m_dispatching;  // Swapped with m_ready, both keep their capacity
+#else
+	static constexpr int MAX_EVENTS = 64;
+	static constexpr uint32_t EVENTS = EPOLLIN | EPOLLRDHUP | EPOLLET;
+#ifndef SYS_pidfd_open
+	static constexpr long SYS_PIDFD_OPEN = 434;     // The same on every architecture
+#else
+	static constexpr long SYS_PIDFD_OPEN = SYS_pidfd_open;
+#endif
+
+	// Descriptors are the caller's; timers, processes and signals the loop's own
+	enum class Kind : uint8_t {
+		Descriptor,
+		Timer,
+		Process,
+		Signal
+	};
+
+	struct Watched {
+		int handle;
+		Kind kind;
+		Handler handler;
+	};
+
+	// Ids rather than descriptors in the events, so a descriptor removed and reused within one
+	// batch isn't run for the old handler
+	int m_epoll = -1;
+	std::unordered_map<uint64_t, Watched> m_watched;
+	std::unordered_map<int, uint64_t> m_byHandle;
+	uint64_t m_lastId = 0;
+	bool m_bQuit = false;
+	int m_exitCode = 0;
+	epoll_event m_events[MAX_EVENTS];
+	char m_readBuffer[READ_BUFFER_SIZE];
+#endif
+	Stats m_stats;
+
+#ifdef _WIN32
+	bool AddPooled(HANDLE handle, Handler handler) {
+		if (!m_hReadyEvent) {
+			m_hReadyEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+			if (!m_hReadyEvent) return false;
+			m_handles.push_back(m_hReadyEvent);
+			m_handlers.push_back([this]() { DispatchReady(); });
+		}
+
+		std::unique_ptr<Pooled> pooled(new Pooled{ this, ++m_lastPooledId, handle, std::move(handler), nullptr });
+		pooled->wait = CreateThreadpoolWait(OnPoolWait, pooled.get(), nullptr);
+		if (!pooled->wait) return false;
+		SetThreadpoolWait(pooled->wait, handle, nullptr);
+
+		m_pooledByHandle[handle] = pooled->id;
+		m_pooled[pooled->id] = std::move(pooled);
+		return true;
+	}
+
+	// Stops the wait and waits out a callback that may already be running
+	static void CloseWait(Pooled& pooled) {
+		SetThreadpoolWait(pooled.wait, nullptr, nullptr);
+		WaitForThreadpoolWaitCallbacks(pooled.wait, TRUE);
+		CloseThreadpoolWait(pooled.wait);
+	}
+
+	// Pool thread
+	static void CALLBACK OnPoolWait(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WAIT, TP_WAIT_RESULT) {
+		Pooled* pooled = static_cast<Pooled*>(context);
+		EventLoop* pLoop = pooled->pLoop;
+		AcquireSRWLockExclusive(&pLoop->m_readyLock);
+		pLoop->m_ready.push_back(pooled->id);
+		ReleaseSRWLockExclusive(&pLoop->m_readyLock);
+		SetEvent(pLoop->m_hReadyEvent);
+	}
+
+	void DispatchReady() {
+		AcquireSRWLockExclusive(&m_readyLock);
+		m_dispatching.swap(m_ready);
+		ReleaseSRWLockExclusive(&m_readyLock);
+
+		for (UINT64 id : m_dispatching) {
+			auto it = m_pooled.find(id);
+			if (it == m_pooled.end()) continue;
+
+			Handler handler = it->second->handler;
+			m_stats.pooledCount++;
+			RunHandler(handler);
+
+			// Still registered after its handler ran, wait again
+			it = m_pooled.find(id);
+			if (it != m_pooled.end()) {
+				SetThreadpoolWait(it->second->wait, it->second->handle, nullptr);
+			}
+		}
+		m_dispatching.clear();
+	}
+#endif
+
+#ifndef _WIN32
+	bool Watch(int handle, Kind kind, Handler handler) {
+		if (handle < 0 || m_epoll < 0 || m_byHandle.count(handle)) return false;
+
+		epoll_event event = {};
+		event.events = EVENTS;
+		event.data.u64 = ++m_lastId;
+		if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, handle, &event) != 0) return false;
+		m_byHandle[handle] = m_lastId;
+		m_watched[m_lastId] = Watched{ handle, kind, std::move(handler) };
+		return true;
+	}
+
+	// Empties the loop's own descriptors so the next edge comes. False if there was nothing in
+	// them after all, so the handler doesn't run.
+	bool Drain(const Watched& watched) {
+		switch (watched.kind) {
+		case Kind::Timer: {
+			// ECANCELED is a clock change, which the handler should see too
+			bool fired = false;
+			uint64_t expirations;
+			for (;;) {
+				if (read(watched.handle, &expirations, sizeof(expirations)) > 0) fired = true;
+				else if (errno == ECANCELED) fired = true;
+				else break;
+			}
+			return fired;
+		}
+		case Kind::Signal: {
+			bool arrived = false;
+			while (read(watched.handle, m_readBuffer, READ_BUFFER_SIZE - READ_BUFFER_SIZE % sizeof(signalfd_siginfo)) > 0) {
+				arrived = true;
+			}
+			return arrived;
+		}
+		case Kind::Process:
+			// Readable from exit on; edge-triggered, so that is the one time it wakes the loop
+		case Kind::Descriptor:
+		default:
+			return true;
+		}
+	}
+#endif
+
+	void RunHandler(const Handler& handler) {
+		uint64_t start = Platform::Ticks();
+		handler();
+		uint64_t ticks = Platform::Ticks() - start;
+
+		m_stats.handlerCount++;
+		m_stats.handlerTicks += ticks;
+		if (ticks > m_stats.maxHandlerTicks) m_stats.maxHandlerTicks = ticks;
+	}
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <vector>
+#include "Ui.h"
+#include "Keystrokes.h"
+
+// Backends that need no window, GPU or keyboard: they record what would have been drawn or
+// typed, so the core can be driven and profiled on any platform and the output compared.
+namespace Headless {
+	// Fixed-advance text metrics: every character is AVERAGE_ADVANCE of the font size wide,
+	// paragraphs wrap at word boundaries. Not what DirectWrite measures, but deterministic and
+	// roughly the same shape, which is what layout profiling needs.
+	class TextMeasurer : public Ui::TextMeasurer {
+	public:
+		static constexpr float AVERAGE_ADVANCE = 0.5f;
+
+		bool Measure(const wchar_t* text, Ui::TextStyle style, float maxWidth, float& width, float& height) override {
+			m_measureCount++;
+			float size = Ui::MAIN_FONT_SIZE;
+			float advance = size * AVERAGE_ADVANCE;
+			float lineHeight = size * Ui::LINE_SPACING;
+			size_t length = wcslen(text);
+
+			if (style != Ui::TextStyle::Paragraph) {
+				width = static_cast<float>(length) * advance;
+				height = lineHeight;
+				return true;
+			}
+
+			// Greedy word wrap
+			size_t perLine = maxWidth > advance ? static_cast<size_t>(maxWidth / advance) : 1;
+			size_t lines = 1;
+			size_t lineLength = 0;
+			size_t widest = 0;
+			size_t pos = 0;
+			while (pos < length) {
+				size_t word = pos;
+				while (word < length && text[word] != L' ') word++;
+				size_t wordLength = word - pos;
+
+				if (lineLength > 0 && lineLength + 1 + wordLength > perLine) {
+					if (lineLength > widest) widest = lineLength;
+					lines++;
+					lineLength = wordLength;
+				}
+				else {
+					lineLength += (lineLength > 0 ? 1 : 0) + wordLength;
+				}
+				pos = word < length ? word + 1 : word;
+			}
+			if (lineLength > widest) widest = lineLength;
+
+			width = static_cast<float>(widest) * advance;
+			height = static_cast<float>(lines) * lineHeight;
+			return true;
+		}
+
+		uint64_t MeasureCount() const { return m_measureCount; }
+
+	private:
+		uint64_t m_measureCount = 0;
+	};
+
+	// Keeps every draw call of the current frame. Text is kept by pointer, the frame it came from
+	// must outlive the recording.
+	class Canvas : public Ui::Canvas {
+	public:
+		enum class OpType {
+			FillRect,
+			DrawRect,
+			DrawText
+		};
+
+		struct Op {
+			OpType type;
+			Ui::Rect rect;
+			Ui::Color color;
+			float value;                // Opacity or stroke width
+			Ui::TextStyle style;
+			const wchar_t* text;
+		};
+
+		Canvas() {
+			m_ops.reserve(INITIAL_CAPACITY);
+		}
+
+		// Start a new frame, capacity is kept
+		void Clear() { m_ops.clear(); }
+
+		void FillRect(const Ui::Rect& rect, Ui::Color color, float opacity) override {
+			m_ops.push_back(Op{ OpType::FillRect, rect, color, opacity, Ui::TextStyle::Paragraph, nullptr });
+		}
+
+		void DrawRect(const Ui::Rect& rect, Ui::Color color, float strokeWidth) override {
+			m_ops.push_back(Op{ OpType::DrawRect, rect, color, strokeWidth, Ui::TextStyle::Paragraph, nullptr });
+		}
+
+		void DrawText(const wchar_t* text, Ui::TextStyle style, const Ui::Rect& rect, Ui::Color color) override {
+			m_ops.push_back(Op{ OpType::DrawText, rect, color, 1.0f, style, text });
+		}
+
+		const std::vector<Op>& Ops() const { return m_ops; }
+
+	private:
+		static constexpr size_t INITIAL_CAPACITY = 64;
+
+		std::vector<Op> m_ops;
+	};
+
+	class InputSink : public ::InputSink {
+	public:
+		// A virtual key, or a Unicode unit when unit isn't 0
+		struct KeyEvent {
+			uint8_t virtualKey;
+			wchar_t unit;
+			bool up;
+		};
+
+		void Key(uint8_t virtualKey, bool up) override {
+			m_keys.push_back(KeyEvent{ virtualKey, 0, up });
+		}
+
+		void Unicode(wchar_t unit, bool up) override {
+			m_keys.push_back(KeyEvent{ 0, unit, up });
+		}
+
+		void Clear() { m_keys.clear(); }
+
+		const std::vector<KeyEvent>& Keys() const { return m_keys; }
+
+	private:
+		std::vector<KeyEvent> m_keys;
+	};
+}
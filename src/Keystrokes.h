@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+
+// Receives planned key presses. The window sends them with SendInput, Headless.h records them.
+class InputSink {
+public:
+	virtual ~InputSink() = default;
+
+	virtual void Key(uint8_t virtualKey, bool up) = 0;
+
+	// A UTF-16 unit typed as itself, whatever the keyboard layout (KEYEVENTF_UNICODE)
+	virtual void Unicode(wchar_t unit, bool up) = 0;
+};
+
+// Plans the key presses that type a payload into a focused window, with no Win32 dependency:
+// characters are mapped by a VkKeyScanW-compatible function (low byte virtual key, bit 0 of
+// the high byte shift), so the planning can run against any keyboard layout table.
+namespace Keystrokes {
+	constexpr uint8_t KEY_SHIFT = 0x10;     // VK_SHIFT
+	constexpr uint8_t KEY_RETURN = 0x0D;    // VK_RETURN
+	constexpr uint8_t KEY_CONTROL = 0x11;   // VK_CONTROL
+	constexpr uint8_t KEY_V = 0x56;
+
+	// Payloads this long, or with a line break, are pasted rather than typed: a line break typed
+	// into a terminal would submit the prompt there and then
+	constexpr size_t BULK_THRESHOLD = 256;
+
+	inline bool IsBulk(const wchar_t* text, size_t length) {
+		return length >= BULK_THRESHOLD || wmemchr(text, L'\n', length) != nullptr;
+	}
+
+	// Returns the number of characters typed, those the layout has no key for are skipped
+	template<class KeyScan>
+	size_t Plan(const wchar_t* text, size_t length, KeyScan keyScan, bool pressEnter, InputSink& sink) {
+		size_t typed = 0;
+		for (size_t i = 0; i < length; i++) {
+			int16_t vk = static_cast<int16_t>(keyScan(text[i]));
+			if (vk == -1) continue;
+
+			uint8_t key = static_cast<uint8_t>(vk & 0xFF);
+			bool shift = ((vk >> 8) & 1) != 0;
+
+			if (shift) sink.Key(KEY_SHIFT, false);
+			sink.Key(key, false);
+			sink.Key(key, true);
+			if (shift) sink.Key(KEY_SHIFT, true);
+			typed++;
+		}
+
+		if (pressEnter) {
+			sink.Key(KEY_RETURN, false);
+			sink.Key(KEY_RETURN, true);
+		}
+		return typed;
+	}
+
+	// How a typed line break goes: Return submits in most terminal CLIs, Shift+Return starts a
+	// new line in the prompt instead
+	enum class LineBreak {
+		Return,
+		ShiftReturn
+	};
+
+	// Layout-independent typing: every UTF-16 unit goes as itself, a surrogate pair as its two
+	// halves, which the receiving window joins again. Line breaks go as lineBreak says, CRs are
+	// dropped. Returns the number of units typed.
+	inline size_t PlanUnicode(const wchar_t* text, size_t length, bool pressEnter, InputSink& sink,
+		LineBreak lineBreak = LineBreak::Return) {
+		size_t typed = 0;
+		for (size_t i = 0; i < length; i++) {
+			wchar_t unit = text[i];
+			if (unit == L'\r') continue;
+			if (unit == L'\n') {
+				bool shift = lineBreak == LineBreak::ShiftReturn;
+				if (shift) sink.Key(KEY_SHIFT, false);
+				sink.Key(KEY_RETURN, false);
+				sink.Key(KEY_RETURN, true);
+				if (shift) sink.Key(KEY_SHIFT, true);
+				continue;
+			}
+			sink.Unicode(unit, false);
+			sink.Unicode(unit, true);
+			typed++;
+		}
+
+		if (pressEnter) {
+			sink.Key(KEY_RETURN, false);
+			sink.Key(KEY_RETURN, true);
+		}
+		return typed;
+	}
+
+	// Ctrl+V, for a payload already on the clipboard
+	inline void PlanPaste(InputSink& sink) {
+		sink.Key(KEY_CONTROL, false);
+		sink.Key(KEY_V, false);
+		sink.Key(KEY_V, true);
+		sink.Key(KEY_CONTROL, true);
+	}
+
+	// Batch size for bulk delivery. Doubles while the target takes each batch within the latency
+	// budget, halves when it refuses part of one or falls behind, so a slow target is fed at the
+	// rate it keeps up with and a fast one in a few large writes.
+	class ChunkSizer {
+	public:
+		ChunkSizer(size_t initial, size_t minimum, size_t maximum)
+			: m_size(initial), m_minimum(minimum), m_maximum(maximum) {}
+
+		size_t Size() const { return m_size; }
+
+		void Completed(size_t offered, size_t accepted, uint64_t micros, uint64_t budgetMicros) {
+			if (accepted < offered || micros > budgetMicros) {
+				m_size = m_size / 2 > m_minimum ? m_size / 2 : m_minimum;
+				m_backoffs++;
+			}
+			else if (accepted == offered && offered > m_size / 2) {
+				// Full, or cut a little short to end between characters
+				m_size = m_size * 2 < m_maximum ? m_size * 2 : m_maximum;
+			}
+		}
+
+		uint64_t Backoffs() const { return m_backoffs; }
+
+	private:
+		size_t m_size;
+		size_t m_minimum;
+		size_t m_maximum;
+		uint64_t m_backoffs = 0;
+	};
+}
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <map>
+#include "AllocationCounter.h"
+#include "Platform.h"
+
+// Compact binary trace of the messages reaching the main window, so a user's session can be
+// replayed against the same handlers and profiled.
+//
+// File layout: Header, then one record per message. Record fields are LEB128 varints:
+//   time delta (microseconds since previous record), message, wParam, lParam (zigzag)
+// WM_DPICHANGED carries a pointer to the suggested rect, so its record is followed by the
+// rect's four edges (zigzag) instead of the pointer value.
+//
+// Messages are stored as their Win32 numbers but nothing here needs Windows, so a trace recorded
+// by the app can be read and replayed headless anywhere.
+namespace MessageTrace {
+	constexpr uint32_t MAGIC = 0x54435241;  // "ARCT"
+	constexpr uint32_t VERSION = 1;
+
+	// The traced window messages
+	constexpr uint32_t MSG_SIZE = 0x0005;
+	constexpr uint32_t MSG_ACTIVATE = 0x0006;
+	constexpr uint32_t MSG_KILLFOCUS = 0x0008;
+	constexpr uint32_t MSG_PAINT = 0x000F;
+	constexpr uint32_t MSG_NCACTIVATE = 0x0086;
+	constexpr uint32_t MSG_KEYDOWN = 0x0100;
+	constexpr uint32_t MSG_TIMER = 0x0113;
+	constexpr uint32_t MSG_MOUSEMOVE = 0x0200;
+	constexpr uint32_t MSG_LBUTTONDOWN = 0x0201;
+	constexpr uint32_t MSG_LBUTTONUP = 0x0202;
+	constexpr uint32_t MSG_MOUSELEAVE = 0x02A3;
+	constexpr uint32_t MSG_DPICHANGED = 0x02E0;
+
+#ifdef _WIN32
+	static_assert(MSG_SIZE == WM_SIZE && MSG_ACTIVATE == WM_ACTIVATE && MSG_KILLFOCUS == WM_KILLFOCUS &&
+		MSG_PAINT == WM_PAINT && MSG_NCACTIVATE == WM_NCACTIVATE && MSG_KEYDOWN == WM_KEYDOWN &&
+		MSG_TIMER == WM_TIMER && MSG_MOUSEMOVE == WM_MOUSEMOVE && MSG_LBUTTONDOWN == WM_LBUTTONDOWN &&
+		MSG_LBUTTONUP == WM_LBUTTONUP && MSG_MOUSELEAVE == WM_MOUSELEAVE && MSG_DPICHANGED == WM_DPICHANGED,
+		"trace message numbers are the Win32 ones");
+#endif
+
+#pragma pack(push, 1)
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		int64_t startTime;  // Wall clock at first record, 100ns units since the Unix epoch
+	};
+#pragma pack(pop)
+
+	struct Rect {
+		int32_t left;
+		int32_t top;
+		int32_t right;
+		int32_t bottom;
+	};
+
+	struct Record {
+		uint64_t timeMicros;    // Since the start of the trace
+		uint32_t message;
+		uint64_t wParam;
+		int64_t lParam;
+		Rect rect;              // WM_DPICHANGED only
+	};
+
+	// Messages whose handlers matter for responsiveness. Everything else is left to DefWindowProc
+	// and not worth the trace space.
+	inline bool IsTraced(uint32_t message) {
+		switch (message) {
+		case MSG_PAINT:
+		case MSG_TIMER:
+		case MSG_SIZE:
+		case MSG_DPICHANGED:
+		case MSG_MOUSEMOVE:
+		case MSG_MOUSELEAVE:
+		case MSG_LBUTTONDOWN:
+		case MSG_LBUTTONUP:
+		case MSG_KEYDOWN:
+		case MSG_ACTIVATE:
+		case MSG_NCACTIVATE:
+		case MSG_KILLFOCUS:
+			return true;
+		}
+		return false;
+	}
+
+	inline const char* MessageName(uint32_t message) {
+		switch (message) {
+		case MSG_PAINT: return "WM_PAINT";
+		case MSG_TIMER: return "WM_TIMER";
+		case MSG_SIZE: return "WM_SIZE";
+		case MSG_DPICHANGED: return "WM_DPICHANGED";
+		case MSG_MOUSEMOVE: return "WM_MOUSEMOVE";
+		case MSG_MOUSELEAVE: return "WM_MOUSELEAVE";
+		case MSG_LBUTTONDOWN: return "WM_LBUTTONDOWN";
+		case MSG_LBUTTONUP: return "WM_LBUTTONUP";
+		case MSG_KEYDOWN: return "WM_KEYDOWN";
+		case MSG_ACTIVATE: return "WM_ACTIVATE";
+		case MSG_NCACTIVATE: return "WM_NCACTIVATE";
+		case MSG_KILLFOCUS: return "WM_KILLFOCUS";
+		}
+		return "WM_?";
+	}
+
+	inline uint64_t ZigZag(int64_t value) {
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+
+	inline int64_t UnZigZag(uint64_t value) {
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	class Writer {
+	public:
+		~Writer() {
+			Close();
+		}
+
+		bool Open(const char* path) {
+			m_pFile = Platform::OpenFile(path, "wb");
+			if (!m_pFile) return false;
+
+			m_ticksPerSecond = Platform::TicksPerSecond();
+			m_buffer.reserve(FLUSH_SIZE + MAX_RECORD_SIZE);
+			return true;
+		}
+
+		void Close() {
+			if (m_pFile) {
+				Flush();
+				fclose(m_pFile);
+				m_pFile = nullptr;
+			}
+		}
+
+		bool IsOpen() const { return m_pFile != nullptr; }
+
+		// A message as it arrives, timed now. pRect is WM_DPICHANGED's suggested rect.
+		void Record(uint32_t message, uint64_t wParam, int64_t lParam, const Rect* pRect = nullptr) {
+			if (!m_pFile || !IsTraced(message)) return;
+
+			uint64_t now = Platform::Ticks();
+			if (!m_bStarted) {
+				m_lastTicks = now;
+			}
+			uint64_t deltaMicros = (now - m_lastTicks) * 1000000 / m_ticksPerSecond;
+			// Keep the remainder so rounding doesn't drift over a long session
+			m_lastTicks += deltaMicros * m_ticksPerSecond / 1000000;
+
+			MessageTrace::Record record = { m_timeMicros + deltaMicros, message, wParam, lParam, {} };
+			if (pRect) {
+				record.rect = *pRect;
+			}
+			Append(record);
+		}
+
+#ifdef _WIN32
+		// From the window procedure, where WM_DPICHANGED's lParam points at the rect
+		void RecordWindowMessage(UINT message, WPARAM wParam, LPARAM lParam) {
+			if (message == WM_DPICHANGED) {
+				const RECT* pRect = reinterpret_cast<const RECT*>(lParam);
+				Rect rect = { static_cast<int32_t>(pRect->left), static_cast<int32_t>(pRect->top),
+					static_cast<int32_t>(pRect->right), static_cast<int32_t>(pRect->bottom) };
+				Record(message, static_cast<uint64_t>(wParam), 0, &rect);
+			}
+			else {
+				Record(message, static_cast<uint64_t>(wParam), static_cast<int64_t>(lParam));
+			}
+		}
+#endif
+
+		// A record with its own time, for writing traces that weren't recorded live
+		void Append(const MessageTrace::Record& record) {
+			if (!m_pFile || !IsTraced(record.message)) return;
+
+			if (!m_bStarted) {
+				constexpr int64_t TICKS_100NS = 10000000;
+				auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+				Header header = { MAGIC, VERSION,
+					std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, TICKS_100NS>>>(sinceEpoch).count() };
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+				m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(header));
+				m_bStarted = true;
+			}
+
+			uint64_t timeMicros = record.timeMicros > m_timeMicros ? record.timeMicros : m_timeMicros;
+			PutVarint(timeMicros - m_timeMicros);
+			m_timeMicros = timeMicros;
+			PutVarint(record.message);
+			PutVarint(record.wParam);
+			if (record.message == MSG_DPICHANGED) {
+				PutVarint(0);
+				PutVarint(ZigZag(record.rect.left));
+				PutVarint(ZigZag(record.rect.top));
+				PutVarint(ZigZag(record.rect.right));
+				PutVarint(ZigZag(record.rect.bottom));
+			}
+			else {
+				PutVarint(ZigZag(record.lParam));
+			}
+
+			if (m_buffer.size() >= FLUSH_SIZE) {
+				Flush();
+			}
+		}
+
+	private:
+		static constexpr size_t FLUSH_SIZE = 64 * 1024;
+		static constexpr size_t MAX_RECORD_SIZE = 9 * 10;
+
+		FILE* m_pFile = nullptr;
+		std::vector<uint8_t> m_buffer;
+		uint64_t m_ticksPerSecond = 1;
+		uint64_t m_lastTicks = 0;
+		uint64_t m_timeMicros = 0;
+		bool m_bStarted = false;
+
+		void PutVarint(uint64_t value) {
+			while (value >= 0x80) {
+				m_buffer.push_back(static_cast<uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			m_buffer.push_back(static_cast<uint8_t>(value));
+		}
+
+		void Flush() {
+			if (m_buffer.empty()) return;
+			fwrite(m_buffer.data(), 1, m_buffer.size(), m_pFile);
+			m_buffer.clear();
+		}
+	};
+
+	class Reader {
+	public:
+		bool Open(const char* path) {
+			FILE* pFile = Platform::OpenFile(path, "rb");
+			if (!pFile) return false;
+
+			m_data.clear();
+			uint8_t chunk[64 * 1024];
+			size_t read;
+			while ((read = fread(chunk, 1, sizeof(chunk), pFile)) > 0) {
+				m_data.insert(m_data.end(), chunk, chunk + read);
+			}
+			bool ok = !ferror(pFile) && m_data.size() >= sizeof(Header);
+			fclose(pFile);
+			if (!ok) return false;
+
+			memcpy(&m_header, m_data.data(), sizeof(Header));
+			m_pos = sizeof(Header);
+			return m_header.magic == MAGIC && m_header.version == VERSION;
+		}
+
+		int64_t StartTime() const { return m_header.startTime; }
+
+		bool Next(Record& record) {
+			uint64_t delta, message, wParam, lParam;
+			if (!GetVarint(delta) || !GetVarint(message) || !GetVarint(wParam) || !GetVarint(lParam)) return false;
+
+			m_timeMicros += delta;
+			record.timeMicros = m_timeMicros;
+			record.message = static_cast<uint32_t>(message);
+			record.wParam = wParam;
+			record.lParam = UnZigZag(lParam);
+			record.rect = {};
+
+			if (record.message == MSG_DPICHANGED) {
+				uint64_t edges[4];
+				for (uint64_t& edge : edges) {
+					if (!GetVarint(edge)) return false;
+				}
+				record.rect = { static_cast<int32_t>(UnZigZag(edges[0])), static_cast<int32_t>(UnZigZag(edges[1])),
+					static_cast<int32_t>(UnZigZag(edges[2])), static_cast<int32_t>(UnZigZag(edges[3])) };
+			}
+			return true;
+		}
+
+	private:
+		std::vector<uint8_t> m_data;
+		size_t m_pos = 0;
+		Header m_header = {};
+		uint64_t m_timeMicros = 0;
+
+		bool GetVarint(uint64_t& value) {
+			value = 0;
+			for (int shift = 0; shift < 64 && m_pos < m_data.size(); shift += 7) {
+				uint8_t byte = m_data[m_pos++];
+				value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if (!(byte & 0x80)) return true;
+			}
+			return false;
+		}
+	};
+
+	// Per-message cost collected during replay. ticks are Platform::Ticks; cpu is whatever CPU
+	// measure the replayer has, named by cpuColumn (thread cycles in the app, CPU ns headless).
+	class ReplayReport {
+	public:
+		explicit ReplayReport(const char* cpuColumn = "mean_cycles") : m_cpuColumn(cpuColumn) {
+			m_ticksPerSecond = Platform::TicksPerSecond();
+		}
+
+		void Add(uint32_t message, uint64_t ticks, uint64_t cpu, uint64_t allocations) {
+			Row& row = m_rows[message];
+			row.count++;
+			row.ticks += ticks;
+			row.cpu += cpu;
+			row.allocations += allocations;
+			if (ticks > row.maxTicks) row.maxTicks = ticks;
+		}
+
+		bool Write(const char* path) const {
+			FILE* pFile = Platform::OpenFile(path, "w");
+			if (!pFile) return false;
+			Print(pFile);
+			fclose(pFile);
+			return true;
+		}
+
+		void Print(FILE* pFile) const {
+			fprintf(pFile, "%-16s %10s %12s %10s %10s %14s", "message", "count", "total_us", "mean_us", "max_us", m_cpuColumn);
+			if (AllocationCounter::ENABLED) {
+				fprintf(pFile, " %10s", "allocs");
+			}
+			fputc('\n', pFile);
+			for (const auto& item : m_rows) {
+				const Row& row = item.second;
+				fprintf(pFile, "%-16s %10llu %12.1f %10.2f %10.1f %14llu",
+					MessageName(item.first),
+					static_cast<unsigned long long>(row.count),
+					ToMicros(row.ticks),
+					ToMicros(row.ticks) / row.count,
+					ToMicros(row.maxTicks),
+					static_cast<unsigned long long>(row.cpu / row.count));
+				if (AllocationCounter::ENABLED) {
+					fprintf(pFile, " %10llu", static_cast<unsigned long long>(row.allocations));
+				}
+				fputc('\n', pFile);
+			}
+		}
+
+	private:
+		struct Row {
+			uint64_t count = 0;
+			uint64_t ticks = 0;
+			uint64_t maxTicks = 0;
+			uint64_t cpu = 0;
+			uint64_t allocations = 0;
+		};
+
+		std::map<uint32_t, Row> m_rows;
+		const char* m_cpuColumn;
+		uint64_t m_ticksPerSecond = 1;
+
+		double ToMicros(uint64_t ticks) const {
+			return static_cast<double>(ticks) * 1000000.0 / static_cast<double>(m_ticksPerSecond);
+		}
+	};
+}
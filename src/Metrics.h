@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Counters, gauges and latency histograms, exported in Prometheus text format. Metrics are
+// registered once at startup; recording is a relaxed atomic add on any thread, no locks. No
+// platform dependency, MetricsFile.h writes the export out on Windows.
+//
+// Histograms are log-linear like HdrHistogram: exact below 16us, then 16 buckets per power of two
+// (about 6% resolution) up to MAX_MICROS. The export collapses them to power-of-two buckets.
+class Metrics {
+public:
+	class Counter {
+	public:
+		void Add(uint64_t value = 1) { m_value.fetch_add(value, std::memory_order_relaxed); }
+
+		// For totals kept elsewhere (e.g. EventLoop::Stats), copied in before an export
+		void Set(uint64_t value) { m_value.store(value, std::memory_order_relaxed); }
+
+		uint64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<uint64_t> m_value{ 0 };
+	};
+
+	class Gauge {
+	public:
+		void Set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+		int64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<int64_t> m_value{ 0 };
+	};
+
+	class Histogram {
+	public:
+		static constexpr uint64_t MAX_MICROS = uint64_t(1) << 40;   // About 12 days
+		static constexpr unsigned SUB_BITS = 4;
+		static constexpr unsigned SUB_COUNT = 1u << SUB_BITS;
+		static constexpr unsigned LEVELS = 40 - SUB_BITS + 2;
+		static constexpr unsigned BUCKETS = LEVELS * SUB_COUNT;
+
+		Histogram() {
+			for (auto& bucket : m_buckets) {
+				bucket.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		void Record(uint64_t micros) {
+			if (micros >= MAX_MICROS) micros = MAX_MICROS - 1;
+			m_buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+			m_sum.fetch_add(micros, std::memory_order_relaxed);
+		}
+
+		// Convenience for QPC intervals
+		void RecordTicks(uint64_t ticks, uint64_t ticksPerSecond) {
+			Record(ticks * 1000000 / ticksPerSecond);
+		}
+
+		// Summed from the buckets, which saves recording a third atomic
+		uint64_t Count() const {
+			uint64_t count = 0;
+			for (unsigned i = 0; i < BUCKETS; i++) {
+				count += BucketCount(i);
+			}
+			return count;
+		}
+
+		uint64_t SumMicros() const { return m_sum.load(std::memory_order_relaxed); }
+		uint64_t BucketCount(unsigned index) const { return m_buckets[index].load(std::memory_order_relaxed); }
+
+		// Level 0 holds 0-15 exactly, level n >= 1 holds [16 << (n - 1), 32 << (n - 1))
+		static unsigned BucketIndex(uint64_t micros) {
+			if (micros < SUB_COUNT) return static_cast<unsigned>(micros);
+			unsigned msb = 63;
+			while (!(micros >> msb)) msb--;
+			unsigned shift = msb - SUB_BITS;
+			return (shift + 1) * SUB_COUNT + static_cast<unsigned>((micros >> shift) - SUB_COUNT);
+		}
+
+		// Exclusive upper bound of a level, in microseconds
+		static uint64_t LevelLimit(unsigned level) {
+			return level == 0 ? SUB_COUNT : uint64_t(2 * SUB_COUNT) << (level - 1);
+		}
+
+	private:
+		std::atomic<uint64_t> m_buckets[BUCKETS];
+		std::atomic<uint64_t> m_sum{ 0 };
+	};
+
+	Metrics() = default;
+	Metrics(const Metrics&) = delete;
+	Metrics& operator=(const Metrics&) = delete;
+
+	// Registration is not thread safe and must happen before recording starts. Names and help text
+	// must outlive the registry (string literals).
+	Counter& AddCounter(const char* name, const char* help) {
+		m_counters.push_back(Named<Counter>{ name, help, std::unique_ptr<Counter>(new Counter()) });
+		return *m_counters.back().metric;
+	}
+
+	Gauge& AddGauge(const char* name, const char* help) {
+		m_gauges.push_back(Named<Gauge>{ name, help, std::unique_ptr<Gauge>(new Gauge()) });
+		return *m_gauges.back().metric;
+	}
+
+	// Exported in seconds, name should end in _seconds
+	Histogram& AddHistogram(const char* name, const char* help) {
+		m_histograms.push_back(Named<Histogram>{ name, help, std::unique_ptr<Histogram>(new Histogram()) });
+		return *m_histograms.back().metric;
+	}
+
+	// Prometheus text exposition format
+	void Format(std::string& out) const {
+		out.clear();
+		for (const auto& counter : m_counters) {
+			AppendHeader(out, counter.name, counter.help, "counter");
+			AppendLine(out, "%s %llu\n", counter.name, static_cast<unsigned long long>(counter.metric->Value()));
+		}
+		for (const auto& gauge : m_gauges) {
+			AppendHeader(out, gauge.name, gauge.help, "gauge");
+			AppendLine(out, "%s %lld\n", gauge.name, static_cast<long long>(gauge.metric->Value()));
+		}
+		for (const auto& histogram : m_histograms) {
+			AppendHeader(out, histogram.name, histogram.help, "histogram");
+			const Histogram& h = *histogram.metric;
+
+			// Buckets are read one at a time while others may still record, so the count is the
+			// running total of what was read to keep the output consistent
+			uint64_t cumulative = 0;
+			for (unsigned level = 0; level < Histogram::LEVELS; level++) {
+				for (unsigned sub = 0; sub < Histogram::SUB_COUNT; sub++) {
+					cumulative += h.BucketCount(level * Histogram::SUB_COUNT + sub);
+				}
+				AppendLine(out, "%s_bucket{le=\"%.6g\"} %llu\n", histogram.name,
+					static_cast<double>(Histogram::LevelLimit(level)) / 1e6, static_cast<unsigned long long>(cumulative));
+			}
+			AppendLine(out, "%s_bucket{le=\"+Inf\"} %llu\n", histogram.name, static_cast<unsigned long long>(cumulative));
+			AppendLine(out, "%s_sum %.6f\n", histogram.name, static_cast<double>(h.SumMicros()) / 1e6);
+			AppendLine(out, "%s_count %llu\n", histogram.name, static_cast<unsigned long long>(cumulative));
+		}
+	}
+
+private:
+	template<class T>
+	struct Named {
+		const char* name;
+		const char* help;
+		std::unique_ptr<T> metric;
+	};
+
+	std::vector<Named<Counter>> m_counters;
+	std::vector<Named<Gauge>> m_gauges;
+	std::vector<Named<Histogram>> m_histograms;
+
+	static void AppendHeader(std::string& out, const char* name, const char* help, const char* type) {
+		AppendLine(out, "# HELP %s %s\n", name, help);
+		AppendLine(out, "# TYPE %s %s\n", name, type);
+	}
+
+	template<class... Args>
+	static void AppendLine(std::string& out, const char* format, Args... args) {
+		char line[256];
+		int length = snprintf(line, sizeof(line), format, args...);
+		if (length > 0) {
+			out.append(line, static_cast<size_t>(length) < sizeof(line) ? static_cast<size_t>(length) : sizeof(line) - 1);
+		}
+	}
+};
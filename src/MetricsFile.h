@@ -0,0 +1,35 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include "Metrics.h"
+
+// Metrics export for node_exporter's textfile collector: Prometheus text in a file that is
+// replaced in one step.
+class MetricsFile {
+public:
+	MetricsFile() = default;
+	MetricsFile(const MetricsFile&) = delete;
+	MetricsFile& operator=(const MetricsFile&) = delete;
+
+	// Write next to the file and rename over it, so a collector never reads a partial export
+	bool Write(const Metrics& metrics, const std::wstring& path) {
+		metrics.Format(m_text);
+
+		std::wstring tempPath = path + L".tmp";
+		HANDLE hFile = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) return false;
+
+		DWORD written = 0;
+		BOOL ok = WriteFile(hFile, m_text.data(), static_cast<DWORD>(m_text.size()), &written, nullptr) && written == m_text.size();
+		CloseHandle(hFile);
+		if (!ok || !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+			DeleteFileW(tempPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	std::string m_text;     // Reused between exports
+};
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "Platform.h"
+#ifdef ARCC_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// Finds a small set of phrases (ASCII, case-insensitive) in streams of terminal output, e.g.
+// "usage limit reached" in a pane that may be logging tens of MB/s.
+//
+// Candidates come from the first two bytes of every pattern: each distinct pair is compared
+// against 32 (AVX2) or 16 (SSE2) positions at a time, and only the positions where a pair hits
+// are verified byte by byte. Without SIMD, or for the last few bytes of a chunk, the same
+// filter runs one position at a time.
+//
+// Output arrives in arbitrary chunks, so every stream keeps the last bytes it saw and matches
+// that straddle two chunks are still found. Scanning never allocates.
+class PatternScanner {
+public:
+	static constexpr size_t MAX_PATTERNS = 32;
+	static constexpr size_t MAX_PATTERN_LENGTH = 64;
+
+	// Where one stream is up to, one per watched pane
+	struct Stream {
+		uint64_t offset = 0;            // Bytes scanned so far
+		uint32_t tailLength = 0;
+		char tail[MAX_PATTERN_LENGTH - 1];
+	};
+
+	struct Stats {
+		uint64_t bytesScanned = 0;
+		uint64_t scanTicks = 0;         // Platform::Ticks spent in Scan, bytes / seconds is the throughput
+		uint64_t candidates = 0;        // Positions where a pattern's first two bytes hit
+		uint64_t matches = 0;
+		uint64_t ticksPerSecond = 1;
+	};
+
+	// useSimd false keeps to the scalar filter, for checking the vector paths against it
+	explicit PatternScanner(bool useSimd = true) {
+		m_stats.ticksPerSecond = Platform::TicksPerSecond();
+#ifdef ARCC_X86
+		m_bSimd = useSimd;
+		m_bAvx2 = useSimd && Platform::HasAvx2();
+#else
+		(void)useSimd;
+#endif
+	}
+
+	PatternScanner(const PatternScanner&) = delete;
+	PatternScanner& operator=(const PatternScanner&) = delete;
+
+	// Add every pattern before scanning. Returns the pattern's index, or -1 if it is shorter than
+	// two bytes, too long, or the set is full.
+	int Add(const char* text) {
+		size_t length = strlen(text);
+		if (length < 2 || length > MAX_PATTERN_LENGTH || m_patternCount == MAX_PATTERNS) return -1;
+
+		Pattern& pattern = m_patterns[m_patternCount];
+		for (size_t i = 0; i < length; i++) {
+			pattern.text[i] = Fold(text[i]);
+		}
+		pattern.length = static_cast<uint32_t>(length);
+		if (length > m_maxLength) m_maxLength = length;
+
+		// Patterns sharing their first two bytes share a filter pair
+		uint8_t first = static_cast<uint8_t>(pattern.text[0]) | FILTER_FOLD;
+		uint8_t second = static_cast<uint8_t>(pattern.text[1]) | FILTER_FOLD;
+		size_t pair = 0;
+		while (pair < m_pairCount && !(m_pairs[pair].first == first && m_pairs[pair].second == second)) pair++;
+		if (pair == m_pairCount) {
+			m_pairs[pair].first = first;
+			m_pairs[pair].second = second;
+			m_pairs[pair].patterns = 0;
+			m_pairCount++;
+		}
+		m_pairs[pair].patterns |= 1u << m_patternCount;
+		m_firstBytes[first] = true;
+
+		return static_cast<int>(m_patternCount++);
+	}
+
+	// Calls found(pattern, offset) for every match in this chunk, offset being where the match
+	// starts in the stream. Matches come in stream order within the seam and within the chunk.
+	template<class Fn>
+	void Scan(Stream& stream, const char* data, size_t length, Fn found) {
+		if (length == 0 || m_patternCount == 0) return;
+
+		uint64_t start = Platform::Ticks();
+
+		// Matches starting in the previous chunk's tail and ending in this one
+		if (stream.tailLength > 0) {
+			char seam[2 * MAX_PATTERN_LENGTH];
+			size_t tailLength = stream.tailLength;
+			size_t head = length < m_maxLength - 1 ? length : m_maxLength - 1;
+			memcpy(seam, stream.tail, tailLength);
+			memcpy(seam + tailLength, data, head);
+			uint64_t seamOffset = stream.offset - tailLength;
+			ScanScalar(seam, tailLength + head, 0, tailLength, [&](uint32_t pattern, size_t pos) {
+				if (pos + m_patterns[pattern].length > tailLength) {
+					found(pattern, seamOffset + pos);
+				}
+			});
+		}
+
+		uint64_t chunkOffset = stream.offset;
+		auto report = [&](uint32_t pattern, size_t pos) {
+			found(pattern, chunkOffset + pos);
+		};
+		size_t scanned = 0;
+#ifdef ARCC_X86
+		if (m_bSimd) {
+			scanned = m_bAvx2 ? ScanAvx2(data, length, report) : ScanSse2(data, length, 0, report);
+		}
+#endif
+		ScanScalar(data, length, scanned, length, report);
+
+		KeepTail(stream, data, length);
+		stream.offset += length;
+
+		m_stats.bytesScanned += length;
+		m_stats.scanTicks += Platform::Ticks() - start;
+	}
+
+	size_t PatternCount() const { return m_patternCount; }
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	// OR-ing 0x20 lowercases ASCII letters; other bytes may collide, verification sorts that out
+	static constexpr uint8_t FILTER_FOLD = 0x20;
+
+	struct Pattern {
+		char text[MAX_PATTERN_LENGTH];  // Lowercased
+		uint32_t length = 0;
+	};
+
+	// Folded first two bytes and the patterns that start with them
+	struct Pair {
+		uint8_t first = 0;
+		uint8_t second = 0;
+		uint32_t patterns = 0;
+	};
+
+	Pattern m_patterns[MAX_PATTERNS];
+	size_t m_patternCount = 0;
+	size_t m_maxLength = 0;
+	Pair m_pairs[MAX_PATTERNS];
+	size_t m_pairCount = 0;
+	bool m_firstBytes[256] = {};
+	bool m_bSimd = false;
+	bool m_bAvx2 = false;
+	Stats m_stats;
+
+	static char Fold(char c) {
+		return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+	}
+
+	// Check the pair's patterns at pos, whole match must be inside text
+	template<class Fn>
+	void Verify(const Pair& pair, const char* text, size_t length, size_t pos, Fn& found) {
+		m_stats.candidates++;
+		uint32_t patterns = pair.patterns;
+		while (patterns) {
+			uint32_t index = LowestBit(patterns);
+			patterns &= patterns - 1;
+
+			const Pattern& pattern = m_patterns[index];
+			if (pos + pattern.length > length) continue;
+			size_t i = 0;
+			while (i < pattern.length && Fold(text[pos + i]) == pattern.text[i]) i++;
+			if (i == pattern.length) {
+				m_stats.matches++;
+				found(index, pos);
+			}
+		}
+	}
+
+	static uint32_t LowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#elif defined(__GNUC__) || defined(__clang__)
+		return static_cast<uint32_t>(__builtin_ctz(mask));
+#else
+		uint32_t index = 0;
+		while (!(mask & 1)) {
+			mask >>= 1;
+			index++;
+		}
+		return index;
+#endif
+	}
+
+	// Candidate starts in [first, last)
+	template<class Fn>
+	void ScanScalar(const char* text, size_t length, size_t first, size_t last, Fn found) {
+		for (size_t pos = first; pos < last && pos + 1 < length; pos++) {
+			uint8_t a = static_cast<uint8_t>(text[pos]) | FILTER_FOLD;
+			if (!m_firstBytes[a]) continue;
+			uint8_t b = static_cast<uint8_t>(text[pos + 1]) | FILTER_FOLD;
+			for (size_t k = 0; k < m_pairCount; k++) {
+				if (m_pairs[k].first == a && m_pairs[k].second == b) {
+					Verify(m_pairs[k], text, length, pos, found);
+				}
+			}
+		}
+	}
+
+#ifdef ARCC_X86
+	// Candidate starts from pos on, returns the first position left for the scalar pass
+	template<class Fn>
+	size_t ScanSse2(const char* text, size_t length, size_t pos, Fn& found) {
+		__m128i first[MAX_PATTERNS];
+		__m128i second[MAX_PATTERNS];
+		for (size_t k = 0; k < m_pairCount; k++) {
+			first[k] = _mm_set1_epi8(static_cast<char>(m_pairs[k].first));
+			second[k] = _mm_set1_epi8(static_cast<char>(m_pairs[k].second));
+		}
+		const __m128i fold = _mm_set1_epi8(static_cast<char>(FILTER_FOLD));
+
+		for (; pos + 17 <= length; pos += 16) {
+			__m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos)), fold);
+			__m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos + 1)), fold);
+			for (size_t k = 0; k < m_pairCount; k++) {
+				uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+					_mm_and_si128(_mm_cmpeq_epi8(a, first[k]), _mm_cmpeq_epi8(b, second[k]))));
+				while (mask) {
+					Verify(m_pairs[k], text, length, pos + LowestBit(mask), found);
+					mask &= mask - 1;
+				}
+			}
+		}
+		return pos;
+	}
+
+	template<class Fn>
+	ARCC_TARGET_AVX2 size_t ScanAvx2(const char* text, size_t length, Fn& found) {
+		__m256i first[MAX_PATTERNS];
+		__m256i second[MAX_PATTERNS];
+		for (size_t k = 0; k < m_pairCount; k++) {
+			first[k] = _mm256_set1_epi8(static_cast<char>(m_pairs[k].first));
+			second[k] = _mm256_set1_epi8(static_cast<char>(m_pairs[k].second));
+		}
+		const __m256i fold = _mm256_set1_epi8(static_cast<char>(FILTER_FOLD));
+
+		size_t pos = 0;
+		for (; pos + 33 <= length; pos += 32) {
+			__m256i a = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos)), fold);
+			__m256i b = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos + 1)), fold);
+			for (size_t k = 0; k < m_pairCount; k++) {
+				uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+					_mm256_and_si256(_mm256_cmpeq_epi8(a, first[k]), _mm256_cmpeq_epi8(b, second[k]))));
+				while (mask) {
+					Verify(m_pairs[k], text, length, pos + LowestBit(mask), found);
+					mask &= mask - 1;
+				}
+			}
+		}
+		// Leftover full 16-byte block
+		return ScanSse2(text, length, pos, found);
+	}
+#endif
+
+	// Keep the last bytes seen, one short of the longest pattern, for the next chunk's seam
+	void KeepTail(Stream& stream, const char* data, size_t length) {
+		size_t keep = m_maxLength - 1;
+		if (length >= keep) {
+			memcpy(stream.tail, data + length - keep, keep);
+			stream.tailLength = static_cast<uint32_t>(keep);
+			return;
+		}
+		size_t total = stream.tailLength + length;
+		size_t drop = total > keep ? total - keep : 0;
+		memmove(stream.tail, stream.tail + drop, stream.tailLength - drop);
+		memcpy(stream.tail + stream.tailLength - drop, data, length);
+		stream.tailLength = static_cast<uint32_t>(total - drop);
+	}
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <windows.h>
+#include <dwmapi.h>
+#include <string>
+
+// Click-through topmost outline around the window the target picker would select, labelled with
+// its process name and title. Plain GDI on a colour-keyed layered window: everything painted in
+// KEY_COLOR is see-through, so only the frame and the label show.
+//
+// Show/Track are cheap when nothing changed, the window is only moved or repainted when the
+// outlined window or its bounds differ from last time.
+class PickerOverlay {
+public:
+	PickerOverlay() = default;
+	PickerOverlay(const PickerOverlay&) = delete;
+	PickerOverlay& operator=(const PickerOverlay&) = delete;
+
+	~PickerOverlay() {
+		Destroy();
+	}
+
+	// Owned by hOwner so it is destroyed along with it
+	bool Create(HINSTANCE hInstance, HWND hOwner) {
+		WNDCLASSEXW wc = {};
+		wc.cbSize = sizeof(wc);
+		wc.lpfnWndProc = WndProc;
+		wc.hInstance = hInstance;
+		wc.lpszClassName = CLASS_NAME;
+		RegisterClassExW(&wc);
+
+		m_hKeyBrush = CreateSolidBrush(KEY_COLOR);
+		m_hFrameBrush = CreateSolidBrush(FRAME_COLOR);
+		m_hLabelBrush = CreateSolidBrush(LABEL_BG_COLOR);
+
+		m_hWnd = CreateWindowExW(
+			WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+			CLASS_NAME, L"", WS_POPUP,
+			0, 0, 0, 0,
+			hOwner, nullptr, hInstance, this);
+		if (!m_hWnd) return false;
+
+		SetLayeredWindowAttributes(m_hWnd, KEY_COLOR, 0, LWA_COLORKEY);
+		return true;
+	}
+
+	void Destroy() {
+		if (m_hWnd) {
+			DestroyWindow(m_hWnd);
+			m_hWnd = nullptr;
+		}
+		DeleteGdiObject(m_hFont);
+		DeleteGdiObject(m_hKeyBrush);
+		DeleteGdiObject(m_hFrameBrush);
+		DeleteGdiObject(m_hLabelBrush);
+	}
+
+	// Outline hTarget, or just follow it if it is already the outlined window
+	void Show(HWND hTarget, const std::wstring& processName, const std::wstring& title) {
+		if (!m_hWnd) return;
+		if (hTarget == m_hTarget) {
+			Track();
+			return;
+		}
+
+		RECT bounds;
+		if (!GetTargetBounds(hTarget, bounds)) {
+			Hide();
+			return;
+		}
+
+		m_hTarget = hTarget;
+		m_label = processName;
+		if (!title.empty()) {
+			m_label += L"  \"";
+			m_label += title;
+			m_label += L"\"";
+		}
+		Place(bounds);
+	}
+
+	// Follow the outlined window if it moved or resized since the last call
+	void Track() {
+		if (!m_hTarget) return;
+
+		RECT bounds;
+		if (!GetTargetBounds(m_hTarget, bounds)) {
+			Hide();
+			return;
+		}
+		if (!EqualRect(&bounds, &m_bounds)) {
+			Place(bounds);
+		}
+	}
+
+	void Hide() {
+		if (m_hWnd && m_hTarget) {
+			ShowWindow(m_hWnd, SW_HIDE);
+		}
+		m_hTarget = nullptr;
+	}
+
+	HWND GetTarget() const { return m_hTarget; }
+
+private:
+	static constexpr const wchar_t* CLASS_NAME = L"ARCCPickerOverlay";
+	static constexpr const wchar_t* FONT_NAME = L"Segoe UI";
+	static constexpr COLORREF KEY_COLOR = RGB(0xFF, 0x00, 0xFF);
+	static constexpr COLORREF FRAME_COLOR = RGB(0xE5, 0xBB, 0x6E);     // Target button amber
+	static constexpr COLORREF LABEL_BG_COLOR = RGB(0x19, 0x19, 0x22);  // App background
+	static constexpr COLORREF LABEL_TEXT_COLOR = RGB(0xDD, 0xDD, 0xDD);
+
+	// In DIPs
+	static constexpr int FRAME_WIDTH = 3;
+	static constexpr int LABEL_FONT_SIZE = 14;
+	static constexpr int LABEL_PADDING = 6;
+
+	static constexpr UINT LABEL_FORMAT = DT_SINGLELINE | DT_NOPREFIX | DT_END_ELLIPSIS;
+
+	HWND m_hWnd = nullptr;
+	HWND m_hTarget = nullptr;
+	RECT m_bounds = {};
+	std::wstring m_label;
+
+	HFONT m_hFont = nullptr;
+	UINT m_fontDpi = 0;
+	HBRUSH m_hKeyBrush = nullptr;
+	HBRUSH m_hFrameBrush = nullptr;
+	HBRUSH m_hLabelBrush = nullptr;
+
+	template<class T>
+	static void DeleteGdiObject(T& object) {
+		if (object) {
+			DeleteObject(object);
+			object = nullptr;
+		}
+	}
+
+	// Visible bounds, GetWindowRect would include the invisible resize borders
+	static bool GetTargetBounds(HWND hTarget, RECT& bounds) {
+		if (!IsWindow(hTarget)) return false;
+		if (FAILED(DwmGetWindowAttribute(hTarget, DWMWA_EXTENDED_FRAME_BOUNDS, &bounds, sizeof(bounds)))) {
+			if (!GetWindowRect(hTarget, &bounds)) return false;
+		}
+		return bounds.right > bounds.left && bounds.bottom > bounds.top;
+	}
+
+	void Place(const RECT& bounds) {
+		m_bounds = bounds;
+		SetWindowPos(m_hWnd, HWND_TOPMOST, bounds.left, bounds.top,
+			bounds.right - bounds.left, bounds.bottom - bounds.top,
+			SWP_NOACTIVATE | SWP_SHOWWINDOW);
+		InvalidateRect(m_hWnd, nullptr, FALSE);
+	}
+
+	static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+		if (message == WM_NCCREATE) {
+			const CREATESTRUCTW* pCreate = reinterpret_cast<const CREATESTRUCTW*>(lParam);
+			SetWindowLongPtrW(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pCreate->lpCreateParams));
+		}
+
+		PickerOverlay* pOverlay = reinterpret_cast<PickerOverlay*>(GetWindowLongPtrW(hWnd, GWLP_USERDATA));
+		switch (message) {
+		case WM_NCHITTEST:
+			return HTTRANSPARENT;
+		case WM_ERASEBKGND:
+			return 1;
+		case WM_PAINT:
+			if (pOverlay) {
+				pOverlay->OnPaint();
+				return 0;
+			}
+			break;
+		case WM_NCDESTROY:
+			// Destroyed with the owner window
+			if (pOverlay) {
+				pOverlay->m_hWnd = nullptr;
+				pOverlay->m_hTarget = nullptr;
+			}
+			break;
+		}
+		return DefWindowProcW(hWnd, message, wParam, lParam);
+	}
+
+	void OnPaint() {
+		PAINTSTRUCT ps;
+		HDC hdc = BeginPaint(m_hWnd, &ps);
+
+		// The overlay takes on the DPI of whichever monitor the target is on
+		UINT dpi = GetDpiForWindow(m_hWnd);
+		int frame = MulDiv(FRAME_WIDTH, dpi, 96);
+		int padding = MulDiv(LABEL_PADDING, dpi, 96);
+
+		RECT client;
+		GetClientRect(m_hWnd, &client);
+		FillRect(hdc, &client, m_hKeyBrush);
+
+		// Frame just inside the target's visible edge
+		RECT edge = { client.left, client.top, client.right, client.top + frame };
+		FillRect(hdc, &edge, m_hFrameBrush);
+		edge = { client.left, client.bottom - frame, client.right, client.bottom };
+		FillRect(hdc, &edge, m_hFrameBrush);
+		edge = { client.left, client.top, client.left + frame, client.bottom };
+		FillRect(hdc, &edge, m_hFrameBrush);
+		edge = { client.right - frame, client.top, client.right, client.bottom };
+		FillRect(hdc, &edge, m_hFrameBrush);
+
+		// Label in the top-left corner, clipped to the target's width
+		if (m_fontDpi != dpi) {
+			DeleteGdiObject(m_hFont);
+			m_hFont = CreateFontW(-MulDiv(LABEL_FONT_SIZE, dpi, 96), 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+				DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, DEFAULT_PITCH, FONT_NAME);
+			m_fontDpi = dpi;
+		}
+		HGDIOBJ hOldFont = SelectObject(hdc, m_hFont);
+
+		RECT text = { 0, 0, 0, 0 };
+		DrawTextW(hdc, m_label.c_str(), static_cast<int>(m_label.size()), &text, LABEL_FORMAT | DT_CALCRECT);
+
+		RECT label = { client.left + frame, client.top + frame, 0, 0 };
+		label.right = label.left + (text.right - text.left) + 2 * padding;
+		label.bottom = label.top + (text.bottom - text.top) + 2 * padding;
+		if (label.right > client.right - frame) label.right = client.right - frame;
+		if (label.bottom > client.bottom - frame) label.bottom = client.bottom - frame;
+		if (label.right > label.left && label.bottom > label.top) {
+			FillRect(hdc, &label, m_hLabelBrush);
+
+			text = { label.left + padding, label.top + padding, label.right - padding, label.bottom - padding };
+			SetBkMode(hdc, TRANSPARENT);
+			SetTextColor(hdc, LABEL_TEXT_COLOR);
+			DrawTextW(hdc, m_label.c_str(), static_cast<int>(m_label.size()), &text, LABEL_FORMAT);
+		}
+
+		SelectObject(hdc, hOldFont);
+		EndPaint(m_hWnd, &ps);
+	}
+};
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <chrono>
+#include <ctime>
+#include <cwctype>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// SSE2 is part of x64, and of 32-bit x86 builds that say so
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define ARCC_X86 1
+#endif
+
+// Functions using AVX2 intrinsics in a build that doesn't target AVX2 as a whole. MSVC allows the
+// intrinsics anywhere, GCC and Clang need them enabled per function.
+#if defined(ARCC_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ARCC_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ARCC_TARGET_AVX2
+#endif
+
+// The few operating system services the portable core needs (timing, CPU features, case folding,
+// files), so those headers build and can be measured anywhere. On Windows they are the calls the
+// app always used.
+namespace Platform {
+#ifdef _WIN32
+	using WindowHandle = HWND;
+#else
+	// Only ever compared and hashed off Windows
+	using WindowHandle = const void*;
+#endif
+
+	// Monotonic high resolution counter, QPC on Windows
+	inline uint64_t Ticks() {
+#ifdef _WIN32
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return static_cast<uint64_t>(now.QuadPart);
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	inline uint64_t TicksPerSecond() {
+#ifdef _WIN32
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		return static_cast<uint64_t>(freq.QuadPart);
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num);
+#endif
+	}
+
+	// CPU time the calling thread has used, user and kernel
+	inline uint64_t ThreadCpuNanos() {
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+		uint64_t units = ((static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) +
+			((static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime);
+		return units * 100;
+#else
+		timespec now;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+		return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+#endif
+	}
+
+	// fopen without the CRT's deprecation warning on Windows. Null on failure.
+	inline FILE* OpenFile(const char* path, const char* mode) {
+#ifdef _WIN32
+		FILE* pFile = nullptr;
+		return fopen_s(&pFile, path, mode) == 0 ? pFile : nullptr;
+#else
+		return fopen(path, mode);
+#endif
+	}
+
+	inline bool HasAvx2() {
+#if defined(_WIN32) && defined(ARCC_X86)
+		return IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE) != FALSE;
+#elif defined(ARCC_X86) && (defined(__GNUC__) || defined(__clang__))
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	}
+
+	// In place. Off Windows this follows the C locale, which lowercases ASCII and little else.
+	inline void ToLower(wchar_t* text, size_t length) {
+#ifdef _WIN32
+		if (length > 0) CharLowerBuffW(text, static_cast<DWORD>(length));
+#else
+		for (size_t i = 0; i < length; i++) {
+			text[i] = static_cast<wchar_t>(towlower(static_cast<wint_t>(text[i])));
+		}
+#endif
+	}
+
+#ifndef _WIN32
+	// Paths are wide like on Windows, the file system takes UTF-8
+	inline std::string NarrowPath(const std::wstring& path) {
+		std::string narrow;
+		narrow.reserve(path.size());
+		for (wchar_t c : path) {
+			uint32_t code = static_cast<uint32_t>(c);
+			if (code < 0x80) {
+				narrow += static_cast<char>(code);
+			}
+			else if (code < 0x800) {
+				narrow += static_cast<char>(0xC0 | (code >> 6));
+				narrow += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else if (code < 0x10000) {
+				narrow += static_cast<char>(0xE0 | (code >> 12));
+				narrow += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				narrow += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else {
+				narrow += static_cast<char>(0xF0 | (code >> 18));
+				narrow += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+				narrow += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				narrow += static_cast<char>(0x80 | (code & 0x3F));
+			}
+		}
+		return narrow;
+	}
+#endif
+
+	// A whole file mapped read-only, until Close or destruction. The file stays readable and
+	// replaceable by others meanwhile.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+
+		~MappedFile() {
+			Close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// False if the file is missing, empty or over 4 GB
+		bool Open(const std::wstring& path) {
+			Close();
+#ifdef _WIN32
+			HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (hFile == INVALID_HANDLE_VALUE) return false;
+
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(hFile, &size) || size.QuadPart <= 0 || size.QuadPart > MAXDWORD) {
+				CloseHandle(hFile);
+				return false;
+			}
+
+			// The mapping keeps the file open
+			m_hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle(hFile);
+			if (!m_hMapping) return false;
+
+			m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+			if (!m_pData) {
+				Close();
+				return false;
+			}
+			m_size = static_cast<size_t>(size.QuadPart);
+#else
+			int fd = open(NarrowPath(path).c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return false;
+
+			struct stat info;
+			if (fstat(fd, &info) != 0 || info.st_size <= 0 || static_cast<uint64_t>(info.st_size) > 0xFFFFFFFFu) {
+				close(fd);
+				return false;
+			}
+
+			// The mapping keeps the file open
+			void* pData = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (pData == MAP_FAILED) return false;
+
+			m_pData = static_cast<const uint8_t*>(pData);
+			m_size = static_cast<size_t>(info.st_size);
+#endif
+			return true;
+		}
+
+		void Close() {
+#ifdef _WIN32
+			if (m_pData) {
+				UnmapViewOfFile(m_pData);
+			}
+			if (m_hMapping) {
+				CloseHandle(m_hMapping);
+				m_hMapping = nullptr;
+			}
+#else
+			if (m_pData) {
+				munmap(const_cast<uint8_t*>(m_pData), m_size);
+			}
+#endif
+			m_pData = nullptr;
+			m_size = 0;
+		}
+
+		const uint8_t* Data() const { return m_pData; }
+		size_t Size() const { return m_size; }
+
+	private:
+#ifdef _WIN32
+		HANDLE m_hMapping = nullptr;
+#endif
+		const uint8_t* m_pData = nullptr;
+		size_t m_size = 0;
+	};
+
+	// Creates or truncates the file and returns once the data is on disk
+	inline bool WriteFileThrough(const std::wstring& path, const void* data, size_t size) {
+#ifdef _WIN32
+		HANDLE hFile = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) return false;
+
+		DWORD written = 0;
+		bool ok = size <= MAXDWORD && WriteFile(hFile, data, static_cast<DWORD>(size), &written, nullptr) &&
+			written == size &&
+			FlushFileBuffers(hFile);
+		CloseHandle(hFile);
+		return ok;
+#else
+		int fd = open(NarrowPath(path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) return false;
+
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		size_t left = size;
+		while (left > 0) {
+			ssize_t written = write(fd, p, left);
+			if (written <= 0) break;
+			p += written;
+			left -= static_cast<size_t>(written);
+		}
+		bool ok = left == 0 && fsync(fd) == 0;
+		close(fd);
+		return ok;
+#endif
+	}
+
+	// Atomically puts from in place of to, replacing it
+	inline bool RenameOver(const std::wstring& from, const std::wstring& to) {
+#ifdef _WIN32
+		return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+		return rename(NarrowPath(from).c_str(), NarrowPath(to).c_str()) == 0;
+#endif
+	}
+
+	inline void RemoveFile(const std::wstring& path) {
+#ifdef _WIN32
+		DeleteFileW(path.c_str());
+#else
+		unlink(NarrowPath(path).c_str());
+#endif
+	}
+}
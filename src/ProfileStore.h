@@ -0,0 +1,315 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Platform.h"
+
+// Remembered per-application settings (last title, resume payload, preferred hour offset), one
+// profile per target process name.
+//
+// The file is memory-mapped and read in place: opening only checks the header, and records are
+// bounds-checked as they are read, so startup cost doesn't grow with the number of profiles.
+// Saving writes a complete new file next to the old one and renames it over, so a crash mid-write
+// leaves the previous file intact.
+//
+// File layout: Header, RecordCount fixed-size Records sorted by process name, then a pool of
+// wchar_t strings the records point into (offsets and lengths in characters, not terminated).
+// That is UTF-16 on Windows; elsewhere wchar_t is wider, and a store is only read where it was
+// written (the benchmarks).
+// Readers step by Header::recordSize, so fields can be appended to Record without a VERSION bump;
+// VERSION only changes for incompatible layouts.
+class ProfileStore {
+public:
+	static constexpr uint32_t MAGIC = 0x50435241;  // "ARCP"
+	static constexpr uint16_t VERSION = 1;
+	static constexpr size_t MAX_PROFILES = 1024;
+
+	// A profile as stored, pointing into the mapped file
+	struct ProfileView {
+		const wchar_t* processName = nullptr;
+		size_t processNameLength = 0;
+		const wchar_t* title = nullptr;
+		size_t titleLength = 0;
+		const wchar_t* payload = nullptr;
+		size_t payloadLength = 0;
+		int hourOffset = 0;
+		int64_t lastUsed = 0;   // Seconds since the Unix epoch
+	};
+
+	// A profile to save
+	struct Profile {
+		std::wstring processName;
+		std::wstring title;
+		std::wstring payload;
+		int hourOffset = 0;
+		int64_t lastUsed = 0;
+	};
+
+	struct Stats {
+		uint64_t openTicks = 0;     // Platform::Ticks for the last Open
+		uint64_t saveTicks = 0;     // Platform::Ticks for the last Save, including the flush
+		uint64_t ticksPerSecond = 1;
+		size_t fileBytes = 0;
+	};
+
+	ProfileStore() {
+		m_stats.ticksPerSecond = Platform::TicksPerSecond();
+	}
+
+	~ProfileStore() {
+		Unmap();
+	}
+
+	ProfileStore(const ProfileStore&) = delete;
+	ProfileStore& operator=(const ProfileStore&) = delete;
+
+	// A missing or unreadable file is an empty store, the next Save creates it
+	void Open(const std::wstring& path) {
+		uint64_t start = Platform::Ticks();
+
+		Unmap();
+		m_path = path;
+		Map();
+
+		m_stats.openTicks = Platform::Ticks() - start;
+	}
+
+	size_t Size() const { return m_recordCount; }
+
+	// False if the record is damaged
+	bool Get(size_t index, ProfileView& view) const {
+		if (index >= m_recordCount) return false;
+
+		Record record;
+		memcpy(&record, m_pRecords + index * m_recordSize, sizeof(record));
+		if (!InPool(record.nameOffset, record.nameLength) ||
+			!InPool(record.titleOffset, record.titleLength) ||
+			!InPool(record.payloadOffset, record.payloadLength)) {
+			return false;
+		}
+
+		view.processName = m_pStrings + record.nameOffset;
+		view.processNameLength = record.nameLength;
+		view.title = m_pStrings + record.titleOffset;
+		view.titleLength = record.titleLength;
+		view.payload = m_pStrings + record.payloadOffset;
+		view.payloadLength = record.payloadLength;
+		view.hourOffset = record.hourOffset;
+		view.lastUsed = record.lastUsed;
+		return true;
+	}
+
+	// Binary search, records are sorted by process name
+	bool Find(const std::wstring& processName, ProfileView& view) const {
+		size_t low = 0;
+		size_t high = m_recordCount;
+		while (low < high) {
+			size_t mid = (low + high) / 2;
+			if (!Get(mid, view)) return false;
+
+			int order = Compare(view.processName, view.processNameLength, processName.c_str(), processName.size());
+			if (order == 0) return true;
+			if (order < 0) {
+				low = mid + 1;
+			}
+			else {
+				high = mid;
+			}
+		}
+		return false;
+	}
+
+	// Add or replace the profile for profile.processName and write the store out. When full, the
+	// least recently used profile is dropped.
+	bool Save(const Profile& profile) {
+		if (m_path.empty()) return false;
+
+		uint64_t start = Platform::Ticks();
+
+		// Copy out of the mapping first, it is released before the rename
+		std::vector<Profile> profiles;
+		profiles.reserve(m_recordCount + 1);
+		for (size_t i = 0; i < m_recordCount; i++) {
+			ProfileView view;
+			if (!Get(i, view)) continue;
+			if (Compare(view.processName, view.processNameLength, profile.processName.c_str(), profile.processName.size()) == 0) continue;
+
+			Profile existing;
+			existing.processName.assign(view.processName, view.processNameLength);
+			existing.title.assign(view.title, view.titleLength);
+			existing.payload.assign(view.payload, view.payloadLength);
+			existing.hourOffset = view.hourOffset;
+			existing.lastUsed = view.lastUsed;
+			profiles.push_back(std::move(existing));
+		}
+		profiles.push_back(profile);
+
+		if (profiles.size() > MAX_PROFILES) {
+			auto oldest = std::min_element(profiles.begin(), profiles.end(), [](const Profile& a, const Profile& b) {
+				return a.lastUsed < b.lastUsed;
+			});
+			profiles.erase(oldest);
+		}
+
+		std::sort(profiles.begin(), profiles.end(), [](const Profile& a, const Profile& b) {
+			return Compare(a.processName.c_str(), a.processName.size(), b.processName.c_str(), b.processName.size()) < 0;
+		});
+
+		std::vector<uint8_t> image;
+		if (!Serialize(profiles, image)) return false;
+
+		// The data must be on disk before the rename makes it the store
+		std::wstring tempPath = m_path + TEMP_SUFFIX;
+		if (!Platform::WriteFileThrough(tempPath, image.data(), image.size())) {
+			Platform::RemoveFile(tempPath);
+			return false;
+		}
+
+		Unmap();
+		bool replaced = Platform::RenameOver(tempPath, m_path);
+		if (!replaced) {
+			Platform::RemoveFile(tempPath);
+		}
+		Map();
+
+		m_stats.saveTicks = Platform::Ticks() - start;
+		return replaced;
+	}
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	static constexpr const wchar_t* TEMP_SUFFIX = L".tmp";
+
+#pragma pack(push, 1)
+	struct Header {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t recordSize;
+		uint32_t recordCount;
+		uint32_t stringsOffset;     // Bytes from the start of the file
+		uint32_t stringsLength;     // Characters
+		uint32_t reserved;
+	};
+
+	struct Record {
+		uint32_t nameOffset;
+		uint32_t titleOffset;
+		uint32_t payloadOffset;
+		uint16_t nameLength;
+		uint16_t titleLength;
+		uint16_t payloadLength;
+		uint16_t reserved;
+		int32_t hourOffset;
+		int64_t lastUsed;
+	};
+#pragma pack(pop)
+
+	std::wstring m_path;
+	Platform::MappedFile m_file;
+	const uint8_t* m_pRecords = nullptr;
+	const wchar_t* m_pStrings = nullptr;
+	size_t m_recordCount = 0;
+	size_t m_recordSize = 0;
+	size_t m_stringsLength = 0;
+	Stats m_stats;
+
+	static int Compare(const wchar_t* a, size_t aLength, const wchar_t* b, size_t bLength) {
+		int order = wmemcmp(a, b, aLength < bLength ? aLength : bLength);
+		if (order != 0) return order;
+		return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+	}
+
+	bool InPool(uint32_t offset, uint16_t length) const {
+		return static_cast<size_t>(offset) + length <= m_stringsLength;
+	}
+
+	// Map the file and take the record and string regions from the header. Anything that doesn't
+	// add up leaves the store empty.
+	void Map() {
+		if (!m_file.Open(m_path)) return;
+		if (m_file.Size() < sizeof(Header)) {
+			Unmap();
+			return;
+		}
+
+		size_t fileBytes = m_file.Size();
+		const uint8_t* pView = m_file.Data();
+		Header header;
+		memcpy(&header, pView, sizeof(header));
+		size_t recordsEnd = sizeof(Header) + static_cast<size_t>(header.recordCount) * header.recordSize;
+		size_t stringsEnd = static_cast<size_t>(header.stringsOffset) + static_cast<size_t>(header.stringsLength) * sizeof(wchar_t);
+		if (header.magic != MAGIC || header.version != VERSION || header.recordSize < sizeof(Record) ||
+			header.recordCount > MAX_PROFILES || recordsEnd > header.stringsOffset ||
+			header.stringsOffset % sizeof(wchar_t) != 0 || stringsEnd > fileBytes) {
+			Unmap();
+			return;
+		}
+
+		m_pRecords = pView + sizeof(Header);
+		m_pStrings = reinterpret_cast<const wchar_t*>(pView + header.stringsOffset);
+		m_recordCount = header.recordCount;
+		m_recordSize = header.recordSize;
+		m_stringsLength = header.stringsLength;
+		m_stats.fileBytes = fileBytes;
+	}
+
+	void Unmap() {
+		m_file.Close();
+		m_pRecords = nullptr;
+		m_pStrings = nullptr;
+		m_recordCount = 0;
+		m_recordSize = 0;
+		m_stringsLength = 0;
+		m_stats.fileBytes = 0;
+	}
+
+	// Strings longer than a record can describe are cut
+	static uint16_t AppendString(std::vector<wchar_t>& pool, const std::wstring& text, uint32_t& offset) {
+		size_t length = text.size() < 0xFFFF ? text.size() : 0xFFFF;
+		offset = static_cast<uint32_t>(pool.size());
+		pool.insert(pool.end(), text.begin(), text.begin() + length);
+		return static_cast<uint16_t>(length);
+	}
+
+	static bool Serialize(const std::vector<Profile>& profiles, std::vector<uint8_t>& image) {
+		std::vector<Record> records(profiles.size());
+		std::vector<wchar_t> pool;
+		for (size_t i = 0; i < profiles.size(); i++) {
+			const Profile& profile = profiles[i];
+			Record& record = records[i];
+			record = {};
+			record.nameLength = AppendString(pool, profile.processName, record.nameOffset);
+			record.titleLength = AppendString(pool, profile.title, record.titleOffset);
+			record.payloadLength = AppendString(pool, profile.payload, record.payloadOffset);
+			record.hourOffset = profile.hourOffset;
+			record.lastUsed = profile.lastUsed;
+		}
+
+		Header header = {};
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.recordSize = sizeof(Record);
+		header.recordCount = static_cast<uint32_t>(records.size());
+		header.stringsOffset = static_cast<uint32_t>(sizeof(Header) + records.size() * sizeof(Record));
+		header.stringsLength = static_cast<uint32_t>(pool.size());
+
+		size_t recordBytes = records.size() * sizeof(Record);
+		size_t poolBytes = pool.size() * sizeof(wchar_t);
+		if (header.stringsOffset + poolBytes > 0xFFFFFFFFu) return false;
+
+		image.resize(sizeof(Header) + recordBytes + poolBytes);
+		memcpy(image.data(), &header, sizeof(header));
+		if (recordBytes > 0) {
+			memcpy(image.data() + sizeof(Header), records.data(), recordBytes);
+		}
+		if (poolBytes > 0) {
+			memcpy(image.data() + header.stringsOffset, pool.data(), poolBytes);
+		}
+		return true;
+	}
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// The thread frames are drawn on. The UI thread publishes a frame (SnapshotBuffer) and calls
+// Signal; the thread wakes, draws the newest frame and waits again. A frame held back because the
+// window was covered is tried again after the recheck interval, uncovering a window doesn't
+// repaint it.
+//
+// It stops and starts again any number of times, e.g. around a stay in the tray, and every Start
+// clears the quit flag the last Stop set, so a restarted thread keeps drawing. Win32 thread and
+// auto-reset event on Windows, std::thread and a condition variable elsewhere, so the lifecycle
+// is tested under ctest.
+class RenderThread {
+public:
+	// Draws the newest frame. False if the window is covered and nothing was drawn.
+	using Draw = std::function<bool()>;
+	// Runs on the thread before its first frame, or after its last
+	using Hook = std::function<void()>;
+
+	struct Stats {
+		uint64_t starts = 0;
+		uint64_t frames = 0;        // Draw calls, covered ones included
+		uint64_t rechecks = 0;      // Of those, retries of a covered frame
+	};
+
+	RenderThread() = default;
+
+	~RenderThread() {
+		Stop();
+	}
+
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+
+	// Once, before the first Start. enter and exit may be empty.
+	void SetCallbacks(Hook enter, Draw draw, Hook exit, uint32_t recheckMs) {
+		m_enter = std::move(enter);
+		m_draw = std::move(draw);
+		m_exit = std::move(exit);
+		m_recheckMs = recheckMs;
+	}
+
+	// True if it is running, already or now
+	bool Start() {
+		if (Running()) return true;
+		m_bQuit = false;
+#ifdef _WIN32
+		m_hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (!m_hEvent) return false;
+		m_hThread = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+		if (!m_hThread) {
+			CloseHandle(m_hEvent);
+			m_hEvent = nullptr;
+			return false;
+		}
+#else
+		m_bSignalled = false;
+		m_bRunning = true;
+		try {
+			m_thread = std::thread([this]() { Loop(); });
+		}
+		catch (const std::system_error&) {
+			m_bRunning = false;
+			return false;
+		}
+#endif
+		m_starts++;
+		return true;
+	}
+
+	// Waits for the frame being drawn, if any, and for the exit hook. Must run while the window
+	// still exists, the render target presents to it.
+	void Stop() {
+		if (!Running()) return;
+		m_bQuit = true;
+#ifdef _WIN32
+		SetEvent(m_hEvent);
+		WaitForSingleObject(m_hThread, INFINITE);
+		CloseHandle(m_hThread);
+		CloseHandle(m_hEvent);
+		m_hThread = nullptr;
+		m_hEvent = nullptr;
+#else
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bSignalled = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+		m_bRunning = false;
+#endif
+	}
+
+	bool Running() const {
+#ifdef _WIN32
+		return m_hEvent != nullptr;
+#else
+		return m_bRunning;
+#endif
+	}
+
+	// A frame is ready. False if the thread isn't running, the caller draws it then. Also from
+	// the thread itself, to draw the same frame again.
+	bool Signal() {
+		if (!Running()) return false;
+#ifdef _WIN32
+		SetEvent(m_hEvent);
+#else
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bSignalled = true;
+		}
+		m_wake.notify_one();
+#endif
+		return true;
+	}
+
+	Stats GetStats() const {
+		Stats stats;
+		stats.starts = m_starts;
+		stats.frames = m_frames.load(std::memory_order_relaxed);
+		stats.rechecks = m_rechecks.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	Hook m_enter;
+	Draw m_draw;
+	Hook m_exit;
+	uint32_t m_recheckMs = 1000;
+
+	std::atomic<bool> m_bQuit{ false };
+	uint64_t m_starts = 0;
+	std::atomic<uint64_t> m_frames{ 0 };
+	std::atomic<uint64_t> m_rechecks{ 0 };
+
+#ifdef _WIN32
+	HANDLE m_hThread = nullptr;
+	HANDLE m_hEvent = nullptr;
+
+	static DWORD WINAPI ThreadProc(LPVOID lpParam) {
+		static_cast<RenderThread*>(lpParam)->Loop();
+		return 0;
+	}
+
+	// True if signalled, false if the recheck interval passed first
+	bool Wait(bool covered) {
+		return WaitForSingleObject(m_hEvent, covered ? m_recheckMs : INFINITE) == WAIT_OBJECT_0;
+	}
+#else
+	std::thread m_thread;
+	bool m_bRunning = false;        // UI thread only
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_bSignalled = false;      // Auto-reset, under m_mutex
+
+	bool Wait(bool covered) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (covered) {
+			if (!m_wake.wait_for(lock, std::chrono::milliseconds(m_recheckMs), [this]() { return m_bSignalled; })) return false;
+		}
+		else {
+			m_wake.wait(lock, [this]() { return m_bSignalled; });
+		}
+		m_bSignalled = false;
+		return true;
+	}
+#endif
+
+	void Loop() {
+		if (m_enter) m_enter();
+		bool covered = false;
+		for (;;) {
+			bool signalled = Wait(covered);
+			if (m_bQuit) break;
+			if (!signalled) m_rechecks.fetch_add(1, std::memory_order_relaxed);
+			m_frames.fetch_add(1, std::memory_order_relaxed);
+			covered = !m_draw();
+		}
+		if (m_exit) m_exit();
+	}
+};
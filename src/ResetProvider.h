@@ -0,0 +1,377 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <functional>
+#include <string>
+#include "EventLoop.h"
+#include "Platform.h"
+#include "Schedule.h"
+#include "StatusJson.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A source of rate limit reset times other than the target's own output. Providers run on the
+// event loop and report a reset time only when it differs from the last one they reported.
+class ResetProvider {
+public:
+	// changeTicks is Platform::Ticks when the change was noticed, for measuring how long re-arming took
+	using Handler = std::function<void(Clock::time_point resetTime, uint64_t changeTicks)>;
+
+	virtual ~ResetProvider() = default;
+
+	virtual bool Start(EventLoop& loop, const Clock& clock, Handler handler) = 0;
+	virtual void Stop() = 0;
+
+	// What it watches, e.g. a file path
+	virtual const std::wstring& Source() const = 0;
+
+	virtual uint64_t BytesParsed() const = 0;
+};
+
+#ifdef _WIN32
+
+// Watches a JSON status file a CLI keeps up to date. The directory is watched with an overlapped
+// ReadDirectoryChangesW serviced from the event loop, so nothing polls and an unchanged file costs
+// nothing. A change re-reads the file through StatusFileReader, which decides how much of it to
+// read and whether the reset time changed. Writers that replace the file (write a temporary, then
+// rename) and ones that write in place both notify. A file that is missing or locked is read again
+// on the next change.
+class StatusFileProvider : public ResetProvider {
+public:
+	struct Stats {
+		uint64_t notifications = 0;     // Directory reads that completed
+		uint64_t overflows = 0;         // Of those, too many changes to list, read as a change
+		StatusFileReader::Stats reads;
+	};
+
+	explicit StatusFileProvider(std::wstring path) : m_path(std::move(path)), m_reader(StatusFileReader::IsLog(m_path)) {}
+
+	~StatusFileProvider() override {
+		Stop();
+	}
+
+	StatusFileProvider(const StatusFileProvider&) = delete;
+	StatusFileProvider& operator=(const StatusFileProvider&) = delete;
+
+	// Fails if the directory can't be watched. The file itself need not exist yet.
+	bool Start(EventLoop& loop, const Clock& clock, Handler handler) override {
+		if (m_hDirectory != INVALID_HANDLE_VALUE) return true;
+
+		// A root keeps its separator: C:\status.json is in "C:\", as "C:" alone is the drive's
+		// current directory
+		size_t slash = m_path.find_last_of(L"\\/");
+		bool root = slash == 0 || (slash == 2 && m_path[1] == L':');
+		std::wstring directory = slash == std::wstring::npos ? L"." : m_path.substr(0, root ? slash + 1 : slash);
+		m_name = slash == std::wstring::npos ? m_path : m_path.substr(slash + 1);
+		if (m_name.empty()) return false;
+
+		m_hDirectory = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+		if (m_hDirectory == INVALID_HANDLE_VALUE) return false;
+
+		m_hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (!m_hEvent || !loop.Add(m_hEvent, [this]() { OnSignalled(); })) {
+			Stop();
+			return false;
+		}
+
+		m_pLoop = &loop;
+		m_pClock = &clock;
+		m_handler = std::move(handler);
+		if (!Watch()) {
+			Stop();
+			return false;
+		}
+
+		// Whatever the file says already
+		Reload(Platform::Ticks());
+		return true;
+	}
+
+	void Stop() override {
+		if (m_hDirectory != INVALID_HANDLE_VALUE) {
+			// The pending read still owns m_overlapped and m_buffer until it completes
+			if (CancelIoEx(m_hDirectory, &m_overlapped)) {
+				DWORD bytes;
+				GetOverlappedResult(m_hDirectory, &m_overlapped, &bytes, TRUE);
+			}
+			CloseHandle(m_hDirectory);
+			m_hDirectory = INVALID_HANDLE_VALUE;
+		}
+		if (m_hEvent) {
+			if (m_pLoop) {
+				m_pLoop->Remove(m_hEvent);
+			}
+			CloseHandle(m_hEvent);
+			m_hEvent = nullptr;
+		}
+		m_pLoop = nullptr;
+	}
+
+	const std::wstring& Source() const override { return m_path; }
+
+	uint64_t BytesParsed() const override { return m_reader.GetStats().bytesParsed; }
+
+	Stats GetStats() const {
+		Stats stats = m_stats;
+		stats.reads = m_reader.GetStats();
+		return stats;
+	}
+
+private:
+	static constexpr DWORD BUFFER_SIZE = 4096;      // Directory changes, well under the 64 KB network limit
+	static constexpr DWORD READ_CHUNK = 4096;
+	static constexpr DWORD NOTIFY_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+	std::wstring m_path;
+	std::wstring m_name;            // File name within the watched directory
+
+	HANDLE m_hDirectory = INVALID_HANDLE_VALUE;
+	HANDLE m_hEvent = nullptr;
+	OVERLAPPED m_overlapped = {};
+	DWORD m_buffer[BUFFER_SIZE / sizeof(DWORD)];    // FILE_NOTIFY_INFORMATION needs DWORD alignment
+	EventLoop* m_pLoop = nullptr;
+	const Clock* m_pClock = nullptr;
+	Handler m_handler;
+
+	StatusFileReader m_reader;
+	char m_readBuffer[READ_CHUNK];
+	Stats m_stats;
+
+	bool Watch() {
+		memset(&m_overlapped, 0, sizeof(m_overlapped));
+		m_overlapped.hEvent = m_hEvent;
+		return ReadDirectoryChangesW(m_hDirectory, m_buffer, BUFFER_SIZE, FALSE, NOTIFY_FILTER, nullptr, &m_overlapped, nullptr) != FALSE;
+	}
+
+	void OnSignalled() {
+		uint64_t now = Platform::Ticks();
+
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(m_hDirectory, &m_overlapped, &bytes, FALSE)) {
+			// The directory went away, nothing more will arrive
+			ResetEvent(m_hEvent);
+			return;
+		}
+		m_stats.notifications++;
+
+		// An empty result means the changes didn't fit, the file may be among them
+		bool changed = bytes == 0;
+		if (changed) {
+			m_stats.overflows++;
+		}
+		else {
+			const BYTE* p = reinterpret_cast<const BYTE*>(m_buffer);
+			for (;;) {
+				const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+				bool written = info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED ||
+					info->Action == FILE_ACTION_RENAMED_NEW_NAME;
+				if (written && CompareStringOrdinal(info->FileName, static_cast<int>(info->FileNameLength / sizeof(WCHAR)),
+					m_name.c_str(), static_cast<int>(m_name.size()), TRUE) == CSTR_EQUAL) {
+					changed = true;
+					break;
+				}
+				if (info->NextEntryOffset == 0) break;
+				p += info->NextEntryOffset;
+			}
+		}
+
+		// Watch again before reading, so a write during the read isn't missed
+		ResetEvent(m_hEvent);
+		if (!Watch()) return;
+		if (changed) {
+			Reload(now);
+		}
+	}
+
+	void Reload(uint64_t changeTicks) {
+		HANDLE hFile = CreateFileW(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) {
+			m_reader.Failed();
+			return;
+		}
+
+		BY_HANDLE_FILE_INFORMATION info;
+		if (!GetFileInformationByHandle(hFile, &info)) {
+			CloseHandle(hFile);
+			m_reader.Failed();
+			return;
+		}
+		ULONGLONG index = (static_cast<ULONGLONG>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+		ULONGLONG size = (static_cast<ULONGLONG>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+
+		uint64_t start = m_reader.Begin(info.dwVolumeSerialNumber, index, size);
+		if (start > 0) {
+			LARGE_INTEGER offset;
+			offset.QuadPart = static_cast<LONGLONG>(start);
+			SetFilePointerEx(hFile, offset, nullptr, FILE_BEGIN);
+		}
+
+		DWORD read = 0;
+		while (ReadFile(hFile, m_readBuffer, READ_CHUNK, &read, nullptr) && read > 0 && m_reader.Feed(m_readBuffer, read, *m_pClock)) {
+		}
+		CloseHandle(hFile);
+
+		Clock::time_point resetTime;
+		if (m_reader.End(resetTime)) {
+			m_handler(resetTime, changeTicks);
+		}
+	}
+};
+#else
+// Watches a JSON status file a CLI keeps up to date, through an inotify watch on its directory
+// registered with the edge-triggered event loop, so nothing polls and an unchanged file costs
+// nothing. Creating, writing, closing after writing and renaming onto the name all count as a
+// change, so writers that replace the file and ones that write in place both notify; a queue
+// overflow counts as one too. The events are drained until EAGAIN before the file is read, so a
+// write during the read notifies again. The reading itself is StatusFileReader's, as on Windows.
+class StatusFileProvider : public ResetProvider {
+public:
+	struct Stats {
+		uint64_t notifications = 0;     // Reads of the inotify descriptor that returned events
+		uint64_t overflows = 0;         // Of those, events dropped by the kernel, read as a change
+		StatusFileReader::Stats reads;
+	};
+
+	explicit StatusFileProvider(std::wstring path) : m_path(std::move(path)), m_reader(StatusFileReader::IsLog(m_path)) {}
+
+	~StatusFileProvider() override {
+		Stop();
+	}
+
+	StatusFileProvider(const StatusFileProvider&) = delete;
+	StatusFileProvider& operator=(const StatusFileProvider&) = delete;
+
+	// Fails if the directory can't be watched. The file itself need not exist yet.
+	bool Start(EventLoop& loop, const Clock& clock, Handler handler) override {
+		if (m_inotify >= 0) return true;
+
+		m_narrowPath = Platform::NarrowPath(m_path);
+		size_t slash = m_narrowPath.find_last_of('/');
+		std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : m_narrowPath.substr(0, slash);
+		m_name = slash == std::string::npos ? m_narrowPath : m_narrowPath.substr(slash + 1);
+		if (m_name.empty()) return false;
+
+		m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_inotify < 0) return false;
+		if (inotify_add_watch(m_inotify, directory.c_str(), WATCH_MASK) < 0 || !loop.Add(m_inotify, [this]() { OnReadable(); })) {
+			close(m_inotify);
+			m_inotify = -1;
+			return false;
+		}
+
+		m_pLoop = &loop;
+		m_pClock = &clock;
+		m_handler = std::move(handler);
+
+		// Whatever the file says already
+		Reload(Platform::Ticks());
+		return true;
+	}
+
+	void Stop() override {
+		if (m_inotify >= 0) {
+			m_pLoop->Remove(m_inotify);
+			close(m_inotify);
+			m_inotify = -1;
+		}
+		m_pLoop = nullptr;
+	}
+
+	const std::wstring& Source() const override { return m_path; }
+
+	uint64_t BytesParsed() const override { return m_reader.GetStats().bytesParsed; }
+
+	Stats GetStats() const {
+		Stats stats = m_stats;
+		stats.reads = m_reader.GetStats();
+		return stats;
+	}
+
+private:
+	static constexpr size_t BUFFER_SIZE = 4096;     // Room for several events with names up to NAME_MAX
+	static constexpr size_t READ_CHUNK = 4096;
+	static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO;
+
+	std::wstring m_path;
+	std::string m_narrowPath;
+	std::string m_name;             // File name within the watched directory
+
+	int m_inotify = -1;
+	alignas(inotify_event) char m_buffer[BUFFER_SIZE];
+	EventLoop* m_pLoop = nullptr;
+	const Clock* m_pClock = nullptr;
+	Handler m_handler;
+
+	StatusFileReader m_reader;
+	Stats m_stats;
+
+	void OnReadable() {
+		uint64_t now = Platform::Ticks();
+
+		bool changed = false;
+		for (;;) {
+			ssize_t length = read(m_inotify, m_buffer, BUFFER_SIZE);
+			if (length < 0 && errno == EINTR) continue;
+			if (length <= 0) break;
+			m_stats.notifications++;
+
+			for (const char* p = m_buffer; p < m_buffer + length;) {
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+				if (event->mask & IN_Q_OVERFLOW) {
+					m_stats.overflows++;
+					changed = true;
+				}
+				else if (event->len > 0 && m_name == event->name) {
+					changed = true;
+				}
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		if (changed) {
+			Reload(now);
+		}
+	}
+
+	// Read through the loop's shared buffer, this only ever runs on the loop thread
+	void Reload(uint64_t changeTicks) {
+		int file = open(m_narrowPath.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat info;
+		if (file < 0 || fstat(file, &info) != 0) {
+			if (file >= 0) close(file);
+			m_reader.Failed();
+			return;
+		}
+
+		uint64_t start = m_reader.Begin(static_cast<uint64_t>(info.st_dev), static_cast<uint64_t>(info.st_ino),
+			static_cast<uint64_t>(info.st_size));
+		if (start > 0) {
+			lseek(file, static_cast<off_t>(start), SEEK_SET);
+		}
+
+		char* buffer = m_pLoop->ReadBuffer();
+		for (;;) {
+			ssize_t read = ::read(file, buffer, READ_CHUNK);
+			if (read < 0 && errno == EINTR) continue;
+			if (read <= 0 || !m_reader.Feed(buffer, static_cast<size_t>(read), *m_pClock)) break;
+		}
+		close(file);
+
+		Clock::time_point resetTime;
+		if (m_reader.End(resetTime)) {
+			m_handler(resetTime, changeTicks);
+		}
+	}
+};
+#endif
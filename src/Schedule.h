@@ -0,0 +1,385 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+// Wall-clock source and local calendar conversion. Everything that decides when a resume is
+// due goes through this so schedules can be driven by virtual time.
+class Clock {
+public:
+	using time_point = std::chrono::system_clock::time_point;
+
+	virtual ~Clock() = default;
+
+	virtual time_point Now() const = 0;
+
+	// Local calendar for a point in time
+	virtual void ToLocal(time_point time, tm& local) const {
+		time_t t = std::chrono::system_clock::to_time_t(time);
+#ifdef _WIN32
+		localtime_s(&local, &t);
+#else
+		localtime_r(&t, &local);
+#endif
+	}
+
+	// Normalizes out-of-range fields (hour 24+, day overflow). Daylight saving is always
+	// re-derived for the resulting date rather than carried over from the input.
+	virtual time_point FromLocal(tm local) const {
+		local.tm_isdst = -1;
+		return std::chrono::system_clock::from_time_t(mktime(&local));
+	}
+};
+
+class SystemClock : public Clock {
+public:
+	time_point Now() const override {
+		return std::chrono::system_clock::now();
+	}
+};
+
+// Time only moves when told to, so days of schedule run in no real time. Calendar conversion
+// uses the machine's time zone rules so DST transitions behave as they would live.
+class VirtualClock : public Clock {
+public:
+	explicit VirtualClock(time_point start) : m_now(start) {}
+
+	time_point Now() const override { return m_now; }
+
+	void Set(time_point now) { m_now = now; }
+
+	template<class Rep, class Period>
+	void Advance(std::chrono::duration<Rep, Period> delta) { m_now += std::chrono::duration_cast<std::chrono::system_clock::duration>(delta); }
+
+private:
+	time_point m_now;
+};
+
+namespace Schedule {
+	// Seconds past the hour to resume at, so we land just after a limit reset
+	constexpr int RESUME_SECOND = 10;
+
+	// Start of the next local hour. Later hours are whole elapsed hours from here so the
+	// hour buttons and the deadline agree even when a DST change falls in between.
+	inline Clock::time_point NextHourStart(const Clock& clock) {
+		tm local{};
+		clock.ToLocal(clock.Now(), local);
+		local.tm_min = 0;
+		local.tm_sec = 0;
+		local.tm_hour += 1;
+		return clock.FromLocal(local);
+	}
+
+	// Deadline for one of the hour buttons; offset 0 is the next hour
+	inline Clock::time_point HourTarget(const Clock& clock, int hourOffset) {
+		return NextHourStart(clock) + std::chrono::hours(hourOffset) + std::chrono::seconds(RESUME_SECOND);
+	}
+
+	// Next local hour:minute still ahead of now, e.g. a reset time announced in terminal output
+	inline Clock::time_point TimeOfDayTarget(const Clock& clock, int hour, int minute) {
+		Clock::time_point now = clock.Now();
+		tm local{};
+		clock.ToLocal(now, local);
+		local.tm_hour = hour;
+		local.tm_min = minute;
+		local.tm_sec = RESUME_SECOND;
+		Clock::time_point target = clock.FromLocal(local);
+		if (target <= now) {
+			local.tm_mday += 1;
+			target = clock.FromLocal(local);
+		}
+		return target;
+	}
+
+	// Deadline to re-arm for a reset time from a status file, or false to leave the timer alone:
+	// never over a timer set by hand, nor for a reset already past or the deadline already armed
+	inline bool RearmForReset(Clock::time_point resetTime, Clock::time_point now, bool timerActive, bool autoArmed,
+		Clock::time_point armed, Clock::time_point& deadline) {
+		if (timerActive && !autoArmed) return false;
+		deadline = resetTime + std::chrono::seconds(RESUME_SECOND);
+		if (deadline <= now) return false;
+		return !(timerActive && deadline == armed);
+	}
+}
+
+// Compiled repeat rule, next occurrence in constant time:
+//   every 5h from 03:00:10        elapsed-time cadence from an anchor (90m, 5h30m also work)
+//   weekdays at 09:00:10          local time of day on a set of days; daily, weekends, or
+//   mon,wed,fri at 21:30          three-letter day names also work
+// Cadences count real elapsed time, so a DST change doesn't shift them. Day rules go through
+// the clock's calendar conversion, so 09:00 stays 09:00 local across a change.
+struct Recurrence {
+	enum class Kind : uint8_t {
+		Interval,
+		Days
+	};
+
+	Kind kind = Kind::Interval;
+
+	// Interval
+	Clock::time_point anchor;
+	std::chrono::seconds period{ 0 };
+
+	// Days
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+	uint8_t dayMask = 0;        // Bit per tm_wday, Sunday = bit 0
+	uint8_t nextDay[7] = {};    // Days from each weekday to the next one in dayMask, 1-7
+
+	// First occurrence strictly after the given time
+	Clock::time_point Next(Clock::time_point after, const Clock& clock) const {
+		if (kind == Kind::Interval) {
+			if (after < anchor) return anchor;
+			auto periods = (after - anchor) / period + 1;
+			return anchor + periods * period;
+		}
+
+		tm local{};
+		clock.ToLocal(after, local);
+		int weekday = local.tm_wday;
+		bool reached = local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec >= hour * 3600 + minute * 60 + second;
+		local.tm_hour = hour;
+		local.tm_min = minute;
+		local.tm_sec = second;
+		if (dayMask & (1 << weekday)) {
+			Clock::time_point today = clock.FromLocal(local);
+			// Still ahead although the wall clock is past it only around a DST change. A time a gap
+			// moved later is still to come, a time the clocks went back over has been had already.
+			if (today > after && (!reached || !IsWallTime(today, clock))) return today;
+		}
+		local.tm_mday += nextDay[weekday];
+		return clock.FromLocal(local);
+	}
+
+	// False if the text isn't a rule. The clock anchors cadences to today's date.
+	static bool Compile(const char* text, const Clock& clock, Recurrence& rule) {
+		const char* p = text;
+		rule = Recurrence();
+
+		if (SkipWord(p, "every")) {
+			long long seconds = 0;
+			while (*p >= '0' && *p <= '9') {
+				long long value = 0;
+				while (*p >= '0' && *p <= '9' && value < 100000) value = value * 10 + (*p++ - '0');
+				if (*p == 'h') seconds += value * 3600;
+				else if (*p == 'm') seconds += value * 60;
+				else return false;
+				p++;
+			}
+			while (*p == ' ') p++;
+			if (seconds <= 0 || !SkipWord(p, "from") || !ParseTime(p, rule.hour, rule.minute, rule.second) || *p) return false;
+
+			tm local{};
+			clock.ToLocal(clock.Now(), local);
+			local.tm_hour = rule.hour;
+			local.tm_min = rule.minute;
+			local.tm_sec = rule.second;
+			rule.kind = Kind::Interval;
+			rule.anchor = clock.FromLocal(local);
+			rule.period = std::chrono::seconds(seconds);
+			return true;
+		}
+
+		rule.kind = Kind::Days;
+		if (SkipWord(p, "daily")) rule.dayMask = 0x7F;
+		else if (SkipWord(p, "weekdays")) rule.dayMask = 0x3E;
+		else if (SkipWord(p, "weekends")) rule.dayMask = 0x41;
+		else {
+			static const char* const DAY_NAMES[7] = { "sun", "mon", "tue", "wed", "thu", "fri", "sat" };
+			for (;;) {
+				int day = 0;
+				while (day < 7 && !MatchesNoCase(p, DAY_NAMES[day], 3)) day++;
+				if (day == 7) return false;
+				rule.dayMask |= static_cast<uint8_t>(1 << day);
+				p += 3;
+				if (*p != ',') break;
+				p++;
+			}
+			while (*p == ' ') p++;
+		}
+		if (!SkipWord(p, "at") || !ParseTime(p, rule.hour, rule.minute, rule.second) || *p) return false;
+
+		for (int day = 0; day < 7; day++) {
+			int ahead = 1;
+			while (!(rule.dayMask & (1 << ((day + ahead) % 7)))) ahead++;
+			rule.nextDay[day] = static_cast<uint8_t>(ahead);
+		}
+		return true;
+	}
+
+private:
+	bool IsWallTime(Clock::time_point time, const Clock& clock) const {
+		tm local{};
+		clock.ToLocal(time, local);
+		return local.tm_hour == hour && local.tm_min == minute && local.tm_sec == second;
+	}
+
+	// Case-insensitive word followed by spaces or the end
+	static bool SkipWord(const char*& p, const char* word) {
+		size_t length = strlen(word);
+		if (!MatchesNoCase(p, word, length) || (p[length] != ' ' && p[length] != '\0')) return false;
+		p += length;
+		while (*p == ' ') p++;
+		return true;
+	}
+
+	// ASCII only, word is lowercase. Stops at the end of p.
+	static bool MatchesNoCase(const char* p, const char* word, size_t length) {
+		for (size_t i = 0; i < length; i++) {
+			char c = p[i] >= 'A' && p[i] <= 'Z' ? static_cast<char>(p[i] + ('a' - 'A')) : p[i];
+			if (c != word[i]) return false;
+		}
+		return true;
+	}
+
+	// HH:MM or HH:MM:SS
+	static bool ParseTime(const char*& p, int& hour, int& minute, int& second) {
+		int fields[3] = { 0, 0, 0 };
+		int count = 0;
+		for (;;) {
+			if (p[0] < '0' || p[0] > '9') return false;
+			int value = *p++ - '0';
+			if (*p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+			fields[count++] = value;
+			if (*p != ':' || count == 3) break;
+			p++;
+		}
+		if (count < 2 || fields[0] > 23 || fields[1] > 59 || fields[2] > 59) return false;
+		hour = fields[0];
+		minute = fields[1];
+		second = fields[2];
+		return true;
+	}
+};
+
+// Pending resume jobs ordered by deadline. The app arms one job from the UI, but nothing here
+// assumes there is only one.
+class Scheduler {
+public:
+	using JobId = uint32_t;
+
+	struct Job {
+		JobId id;
+		Clock::time_point deadline;
+		uintptr_t target;   // Opaque to the scheduler, the app stores the target window
+		bool recurring;
+		Recurrence recurrence;
+	};
+
+	// Outcome of running the scheduler forward, for simulation and profiling
+	struct RunStats {
+		uint64_t steps = 0;             // Times the scheduler was woken
+		uint64_t fired = 0;             // Jobs that came due
+		uint64_t cpuNanos = 0;          // Time spent inside the scheduler (steady clock)
+		uint64_t maxStepNanos = 0;
+	};
+
+	static constexpr JobId INVALID_JOB = 0;
+
+	JobId Arm(Clock::time_point deadline, uintptr_t target) {
+		JobId id = ++m_lastId;
+		if (id == INVALID_JOB) id = ++m_lastId;
+		m_byDeadline.insert(std::make_pair(deadline, id));
+		m_jobs[id] = Job{ id, deadline, target, false, Recurrence() };
+		return id;
+	}
+
+	// Fires at every occurrence of the rule until cancelled, keeping its id
+	JobId ArmRecurring(const Recurrence& recurrence, const Clock& clock, uintptr_t target) {
+		JobId id = Arm(recurrence.Next(clock.Now(), clock), target);
+		Job& job = m_jobs[id];
+		job.recurring = true;
+		job.recurrence = recurrence;
+		return id;
+	}
+
+	bool Cancel(JobId id) {
+		auto it = m_jobs.find(id);
+		if (it == m_jobs.end()) return false;
+		m_byDeadline.erase(std::make_pair(it->second.deadline, id));
+		m_jobs.erase(it);
+		return true;
+	}
+
+	const Job* Find(JobId id) const {
+		auto it = m_jobs.find(id);
+		return it != m_jobs.end() ? &it->second : nullptr;
+	}
+
+	bool Empty() const { return m_jobs.empty(); }
+	size_t Size() const { return m_jobs.size(); }
+
+	// Earliest deadline, only valid when not empty
+	Clock::time_point NextDeadline() const {
+		return m_byDeadline.begin()->first;
+	}
+
+	template<class Fn>
+	void ForEach(Fn fn) const {
+		for (const auto& entry : m_byDeadline) {
+			fn(m_jobs.at(entry.second));
+		}
+	}
+
+	// Fires every job due at the clock's now, earliest first. One-shot jobs are removed first,
+	// recurring ones are re-armed for their next occurrence after now. The callback may cancel
+	// jobs or arm new ones, as long as they are due after now.
+	template<class Fn>
+	size_t RunDue(const Clock& clock, Fn fire) {
+		Clock::time_point now = clock.Now();
+		size_t count = 0;
+		while (!m_byDeadline.empty() && m_byDeadline.begin()->first <= now) {
+			JobId id = m_byDeadline.begin()->second;
+			m_byDeadline.erase(m_byDeadline.begin());
+			auto it = m_jobs.find(id);
+			Job job = it->second;
+			if (job.recurring) {
+				// Occurrences missed while asleep collapse into this one
+				it->second.deadline = job.recurrence.Next(now, clock);
+				m_byDeadline.insert(std::make_pair(it->second.deadline, id));
+			}
+			else {
+				m_jobs.erase(it);
+			}
+			fire(job);
+			count++;
+		}
+		return count;
+	}
+
+	// Deterministic simulation: jump a virtual clock from deadline to deadline until the given
+	// time, firing jobs as they come due. Only wakes when something is due, the way the live
+	// app should, so steps == distinct deadlines.
+	template<class Fn>
+	RunStats Simulate(VirtualClock& clock, Clock::time_point until, Fn fire) {
+		RunStats stats;
+		while (!m_byDeadline.empty() && NextDeadline() <= until) {
+			clock.Set(NextDeadline());
+
+			auto start = std::chrono::steady_clock::now();
+
+			stats.fired += RunDue(clock, fire);
+
+			uint64_t nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count());
+			stats.cpuNanos += nanos;
+			if (nanos > stats.maxStepNanos) stats.maxStepNanos = nanos;
+			stats.steps++;
+		}
+		if (clock.Now() < until) {
+			clock.Set(until);
+		}
+		return stats;
+	}
+
+private:
+	std::set<std::pair<Clock::time_point, JobId>> m_byDeadline;
+	std::unordered_map<JobId, Job> m_jobs;
+	JobId m_lastId = INVALID_JOB;
+};
@@ -0,0 +1,436 @@
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include "EventLoop.h"
+
+// One schedule for every ARCC running in the session, so several instances share one deadline
+// timer, one wake timer and one power request instead of each holding their own.
+//
+// The first instance becomes the coordinator: it owns a named mutex and is the only process that
+// writes the table in shared memory. Other instances (members) send their deadlines to the
+// coordinator's window with WM_COPYDATA and wait on an event of their own, which the coordinator
+// sets when one of their jobs comes due. A member delivering its own resume keeps the target, the
+// payload and the UI local to the instance that owns them.
+//
+// Readers never lock: the table is guarded by a sequence counter that the writer makes odd while
+// it writes, and a reader copies the table and retries if the counter moved. If the coordinator
+// exits, the member whose wait on the mutex completes takes over and adopts the table as it is.
+class SharedSchedule {
+public:
+	static constexpr size_t MAX_ENTRIES = 64;
+
+	enum class Mode {
+		Standalone,     // No shared table (replay, or the coordinator can't be reached)
+		Coordinator,
+		Member
+	};
+
+	struct Entry {
+		uint32_t ownerPid;          // 0 for a free slot
+		uint32_t due;               // Set by the coordinator once the owner has been signalled
+		uint64_t job;               // Owner's Scheduler::JobId
+		int64_t deadline;           // Unix milliseconds
+	};
+
+	struct Stats {
+		ULONGLONG writes = 0;           // Table updates, coordinator only
+		ULONGLONG requests = 0;         // WM_COPYDATA requests handled, coordinator only
+		ULONGLONG signals = 0;          // Owners woken for due jobs, coordinator only
+		ULONGLONG snapshots = 0;
+		ULONGLONG snapshotRetries = 0;  // Reads that overlapped a write and went again
+		ULONGLONG requestFailures = 0;  // Requests the coordinator didn't take, member only
+	};
+
+	// A job of this process came due
+	using FireHandler = std::function<void()>;
+
+	// Coordinator: the earliest deadline may have moved without a request (this process just took
+	// over, or an owner exited), re-arm from NextDeadline
+	using ChangeHandler = std::function<void()>;
+
+	SharedSchedule() = default;
+
+	~SharedSchedule() {
+		Close();
+	}
+
+	SharedSchedule(const SharedSchedule&) = delete;
+	SharedSchedule& operator=(const SharedSchedule&) = delete;
+
+	// Joins or starts the session's schedule. Stays standalone if the shared objects can't be made.
+	bool Open(EventLoop& loop, HWND hWindow, FireHandler onFire, ChangeHandler onChange) {
+		if (m_mode != Mode::Standalone) return true;
+
+		m_pLoop = &loop;
+		m_hWindow = hWindow;
+		m_onFire = std::move(onFire);
+		m_onChange = std::move(onChange);
+
+		m_hMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Table), MAPPING_NAME);
+		if (!m_hMapping) return false;
+		m_pTable = static_cast<Table*>(MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Table)));
+		if (!m_pTable) {
+			Close();
+			return false;
+		}
+
+		wchar_t eventName[64];
+		swprintf_s(eventName, L"%ls%lu", FIRE_EVENT_PREFIX, GetCurrentProcessId());
+		m_hFireEvent = CreateEventW(nullptr, FALSE, FALSE, eventName);
+		if (!m_hFireEvent || !loop.Add(m_hFireEvent, [this]() { m_onFire(); })) {
+			Close();
+			return false;
+		}
+
+		m_hMutex = CreateMutexW(nullptr, FALSE, MUTEX_NAME);
+		if (!m_hMutex) {
+			Close();
+			return false;
+		}
+
+		// Whoever holds the mutex coordinates, everyone else waits on it in the event loop. The
+		// loop thread then owns it, which is what releasing it on close requires.
+		DWORD wait = WaitForSingleObject(m_hMutex, 0);
+		if (wait == WAIT_OBJECT_0 || wait == WAIT_ABANDONED) {
+			BecomeCoordinator();
+		}
+		else if (wait == WAIT_TIMEOUT && loop.Add(m_hMutex, [this]() { OnCoordinatorGone(); })) {
+			m_mode = Mode::Member;
+		}
+		else {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close() {
+		if (m_mode == Mode::Coordinator) {
+			// Leave the table to the next coordinator, minus anything of ours
+			BeginWrite();
+			for (Entry& entry : m_pTable->entries) {
+				if (entry.ownerPid == GetCurrentProcessId()) entry = Entry();
+			}
+			m_pTable->coordinatorWindow = 0;
+			EndWrite();
+			ReleaseMutex(m_hMutex);
+		}
+		else if (m_mode == Mode::Member) {
+			WithdrawAll();
+		}
+
+		for (auto& owner : m_owners) {
+			if (m_pLoop) m_pLoop->Remove(owner.second);
+			CloseHandle(owner.second);
+		}
+		m_owners.clear();
+
+		if (m_pLoop) {
+			if (m_hFireEvent) m_pLoop->Remove(m_hFireEvent);
+			if (m_hMutex) m_pLoop->Remove(m_hMutex);
+		}
+		if (m_hFireEvent) CloseHandle(m_hFireEvent);
+		if (m_hMutex) CloseHandle(m_hMutex);
+		if (m_pTable) UnmapViewOfFile(m_pTable);
+		if (m_hMapping) CloseHandle(m_hMapping);
+		m_hFireEvent = nullptr;
+		m_hMutex = nullptr;
+		m_pTable = nullptr;
+		m_hMapping = nullptr;
+		m_pLoop = nullptr;
+		m_mode = Mode::Standalone;
+	}
+
+	Mode GetMode() const { return m_mode; }
+	bool IsCoordinator() const { return m_mode == Mode::Coordinator; }
+
+	// Adds or moves this process's job. False if the coordinator didn't take it (standalone, hung,
+	// or the table is full), the caller then keeps its own timers for it.
+	bool Publish(uint64_t job, int64_t deadline) {
+		switch (m_mode) {
+		case Mode::Coordinator:
+			Write(GetCurrentProcessId(), job, deadline);
+			return true;
+		case Mode::Member:
+			return Send(Request{ REQUEST_PUBLISH, job, deadline });
+		case Mode::Standalone:
+		default:
+			return false;
+		}
+	}
+
+	void Withdraw(uint64_t job) {
+		switch (m_mode) {
+		case Mode::Coordinator:
+			Remove(GetCurrentProcessId(), job);
+			break;
+		case Mode::Member:
+			Send(Request{ REQUEST_WITHDRAW, job, 0 });
+			break;
+		case Mode::Standalone:
+			break;
+		}
+	}
+
+	// Coordinator, from WM_COPYDATA. The sender is identified by its window, not by what it claims.
+	bool OnCopyData(HWND hSender, const COPYDATASTRUCT& data) {
+		if (m_mode != Mode::Coordinator || data.dwData != REQUEST_MAGIC || data.cbData != sizeof(Request)) return false;
+
+		DWORD pid = 0;
+		if (!hSender || !GetWindowThreadProcessId(hSender, &pid) || pid == 0) return false;
+
+		Request request;
+		memcpy(&request, data.lpData, sizeof(request));
+		m_stats.requests++;
+
+		switch (request.type) {
+		case REQUEST_PUBLISH:
+			if (!WatchOwner(pid)) return false;
+			return Write(pid, request.job, request.deadline);
+		case REQUEST_WITHDRAW:
+			Remove(pid, request.job);
+			return true;
+		case REQUEST_WITHDRAW_ALL:
+			RemoveOwner(pid);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Coordinator: wake the owners of every job due at now. Each job is signalled once.
+	void DispatchDue(int64_t now) {
+		if (m_mode != Mode::Coordinator) return;
+
+		bool changed = false;
+		for (size_t i = 0; i < MAX_ENTRIES; i++) {
+			const Entry& entry = m_pTable->entries[i];
+			if (!entry.ownerPid || entry.due || entry.deadline > now) continue;
+
+			if (!changed) BeginWrite();
+			changed = true;
+			m_pTable->entries[i].due = 1;
+			Signal(entry.ownerPid);
+		}
+		if (changed) EndWrite();
+	}
+
+	// Coordinator: earliest deadline not yet signalled
+	bool NextDeadline(int64_t& deadline) const {
+		if (m_mode != Mode::Coordinator) return false;
+
+		bool found = false;
+		for (const Entry& entry : m_pTable->entries) {
+			if (!entry.ownerPid || entry.due) continue;
+			if (!found || entry.deadline < deadline) deadline = entry.deadline;
+			found = true;
+		}
+		return found;
+	}
+
+	// Any process: consistent copy of the used slots, without locking. Returns the count.
+	size_t Snapshot(Entry (&out)[MAX_ENTRIES]) {
+		if (!m_pTable) return 0;
+
+		Entry copy[MAX_ENTRIES];
+		m_stats.snapshots++;
+		for (;;) {
+			uint32_t before = m_pTable->sequence.load(std::memory_order_acquire);
+			if (!(before & 1)) {
+				memcpy(copy, m_pTable->entries, sizeof(copy));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_pTable->sequence.load(std::memory_order_relaxed) == before) break;
+			}
+			m_stats.snapshotRetries++;
+			YieldProcessor();
+		}
+
+		size_t count = 0;
+		for (const Entry& entry : copy) {
+			if (entry.ownerPid) out[count++] = entry;
+		}
+		return count;
+	}
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	static constexpr const wchar_t* MAPPING_NAME = L"Local\\ARCC-Schedule";
+	static constexpr const wchar_t* MUTEX_NAME = L"Local\\ARCC-Coordinator";
+	static constexpr const wchar_t* FIRE_EVENT_PREFIX = L"Local\\ARCC-Fire-";
+	static constexpr ULONG_PTR REQUEST_MAGIC = 0x41524343;     // "ARCC"
+	static constexpr UINT REQUEST_TIMEOUT_MS = 1000;
+	static constexpr uint32_t REQUEST_PUBLISH = 1;
+	static constexpr uint32_t REQUEST_WITHDRAW = 2;
+	static constexpr uint32_t REQUEST_WITHDRAW_ALL = 3;
+
+	// Zero-filled by the system when the mapping is first created
+	struct Table {
+		std::atomic<uint32_t> sequence;     // Odd while the coordinator writes
+		uint32_t reserved;
+		uint64_t coordinatorWindow;
+		Entry entries[MAX_ENTRIES];
+	};
+
+	struct Request {
+		uint32_t type;
+		uint64_t job;
+		int64_t deadline;
+	};
+
+	Mode m_mode = Mode::Standalone;
+	HANDLE m_hMapping = nullptr;
+	Table* m_pTable = nullptr;
+	HANDLE m_hMutex = nullptr;
+	HANDLE m_hFireEvent = nullptr;
+	HWND m_hWindow = nullptr;
+	EventLoop* m_pLoop = nullptr;
+	FireHandler m_onFire;
+	ChangeHandler m_onChange;
+	std::unordered_map<DWORD, HANDLE> m_owners;     // Coordinator: process handles of members with jobs
+	Stats m_stats;
+
+	void BeginWrite() {
+		uint32_t sequence = m_pTable->sequence.load(std::memory_order_relaxed);
+		m_pTable->sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void EndWrite() {
+		uint32_t sequence = m_pTable->sequence.load(std::memory_order_relaxed);
+		m_pTable->sequence.store(sequence + 1, std::memory_order_release);
+		m_stats.writes++;
+	}
+
+	// Replaces the owner's entry for the job, or takes a free slot
+	bool Write(DWORD pid, uint64_t job, int64_t deadline) {
+		Entry* pSlot = nullptr;
+		for (Entry& entry : m_pTable->entries) {
+			if (entry.ownerPid == pid && entry.job == job) {
+				pSlot = &entry;
+				break;
+			}
+			if (!pSlot && !entry.ownerPid) pSlot = &entry;
+		}
+		if (!pSlot) return false;
+
+		BeginWrite();
+		pSlot->ownerPid = pid;
+		pSlot->due = 0;
+		pSlot->job = job;
+		pSlot->deadline = deadline;
+		EndWrite();
+		return true;
+	}
+
+	void Remove(DWORD pid, uint64_t job) {
+		for (Entry& entry : m_pTable->entries) {
+			if (entry.ownerPid == pid && entry.job == job) {
+				BeginWrite();
+				entry = Entry();
+				EndWrite();
+				return;
+			}
+		}
+	}
+
+	void RemoveOwner(DWORD pid) {
+		BeginWrite();
+		for (Entry& entry : m_pTable->entries) {
+			if (entry.ownerPid == pid) entry = Entry();
+		}
+		EndWrite();
+
+		auto it = m_owners.find(pid);
+		if (it != m_owners.end()) {
+			m_pLoop->Remove(it->second);
+			CloseHandle(it->second);
+			m_owners.erase(it);
+		}
+	}
+
+	void OnOwnerExited(DWORD pid) {
+		RemoveOwner(pid);
+		m_onChange();
+	}
+
+	// Entries of a process that exits without withdrawing are dropped when it does
+	bool WatchOwner(DWORD pid) {
+		if (pid == GetCurrentProcessId() || m_owners.count(pid)) return true;
+
+		HANDLE hProcess = OpenProcess(SYNCHRONIZE, FALSE, pid);
+		if (!hProcess) return false;
+		if (!m_pLoop->Add(hProcess, [this, pid]() { OnOwnerExited(pid); })) {
+			CloseHandle(hProcess);
+			return false;
+		}
+		m_owners[pid] = hProcess;
+		return true;
+	}
+
+	void Signal(DWORD pid) {
+		m_stats.signals++;
+		if (pid == GetCurrentProcessId()) {
+			SetEvent(m_hFireEvent);
+			return;
+		}
+
+		wchar_t eventName[64];
+		swprintf_s(eventName, L"%ls%lu", FIRE_EVENT_PREFIX, pid);
+		HANDLE hEvent = OpenEventW(EVENT_MODIFY_STATE, FALSE, eventName);
+		if (hEvent) {
+			SetEvent(hEvent);
+			CloseHandle(hEvent);
+		}
+	}
+
+	bool Send(const Request& request) {
+		HWND hCoordinator = reinterpret_cast<HWND>(static_cast<uintptr_t>(m_pTable->coordinatorWindow));
+		COPYDATASTRUCT data = { REQUEST_MAGIC, sizeof(request), const_cast<Request*>(&request) };
+		DWORD_PTR result = 0;
+		if (hCoordinator && SendMessageTimeoutW(hCoordinator, WM_COPYDATA, reinterpret_cast<WPARAM>(m_hWindow),
+			reinterpret_cast<LPARAM>(&data), SMTO_ABORTIFHUNG | SMTO_BLOCK, REQUEST_TIMEOUT_MS, &result) && result) {
+			return true;
+		}
+
+		// Hung, gone between its exit and our takeover, or the table is full
+		m_stats.requestFailures++;
+		return false;
+	}
+
+	void WithdrawAll() {
+		Send(Request{ REQUEST_WITHDRAW_ALL, 0, 0 });
+	}
+
+	void BecomeCoordinator() {
+		m_mode = Mode::Coordinator;
+
+		// Adopt what the previous coordinator left: drop the entries of processes that are gone
+		// and watch the rest. Jobs it had already signalled stay signalled.
+		Entry entries[MAX_ENTRIES];
+		size_t count = Snapshot(entries);
+		for (size_t i = 0; i < count; i++) {
+			DWORD pid = entries[i].ownerPid;
+			if (!WatchOwner(pid)) {
+				RemoveOwner(pid);
+			}
+		}
+
+		BeginWrite();
+		m_pTable->coordinatorWindow = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(m_hWindow));
+		EndWrite();
+	}
+
+	// Our wait on the mutex completed, so we own it now
+	void OnCoordinatorGone() {
+		m_pLoop->Remove(m_hMutex);
+		BecomeCoordinator();
+		m_onChange();
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of the latest value from one writer thread to one reader thread. Three slots:
+// the writer fills its own, the reader draws from its own, and Publish/Acquire swap through the
+// middle one. Neither side ever waits, and the reader always gets the newest complete value
+// (intermediate ones are dropped).
+//
+// T is copied into place by the writer, keep it a plain struct so publishing doesn't allocate.
+template<class T>
+class SnapshotBuffer {
+public:
+	SnapshotBuffer() = default;
+	SnapshotBuffer(const SnapshotBuffer&) = delete;
+	SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+	// Writer: slot to fill before Publish
+	T& WriteSlot() { return m_slots[m_writeIndex]; }
+
+	// Writer: make the filled slot the newest value
+	void Publish() {
+		uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_writeIndex | FRESH), std::memory_order_acq_rel);
+		m_writeIndex = previous & INDEX_MASK;
+	}
+
+	// Reader: take the newest value if there is one. Returns false if nothing was published since
+	// the last call, ReadSlot() then still holds the previous value.
+	bool Acquire() {
+		if (!(m_middle.load(std::memory_order_acquire) & FRESH)) return false;
+		uint8_t previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & INDEX_MASK;
+		return true;
+	}
+
+	// Reader: value taken by the last Acquire
+	const T& ReadSlot() const { return m_slots[m_readIndex]; }
+
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t FRESH = 0x4;
+
+	T m_slots[3];
+	std::atomic<uint8_t> m_middle{ 1 };
+	uint8_t m_writeIndex = 0;   // Writer thread only
+	uint8_t m_readIndex = 2;    // Reader thread only
+};
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <cwctype>
+#include <string>
+#include "Schedule.h"
+
+// Finds the reset time in a CLI's JSON status output without building a document: bytes go
+// through a small state machine that may be fed in any number of pieces, so a file can be read
+// a chunk at a time, stopping as soon as the value is found, and an append-only log (one JSON
+// object per line) only ever has its new bytes parsed. No allocation, no platform dependency.
+//
+// The value is taken from a key that reads "resets_at", "reset_at" or "reset_time" once case,
+// '_' and '-' are ignored, at any depth. Accepted values:
+//   1760800000 / 1760800000000      Unix seconds, or milliseconds
+//   "2026-10-18T15:00:00Z"          ISO 8601, with Z or an offset, or local time without one
+//   "15:00"                         next local time of day
+// A value only counts once its token has ended, so a half-written file yields nothing.
+class StatusJsonScanner {
+public:
+	void Reset() {
+		m_state = State::Between;
+		m_tokenLength = 0;
+		m_keyLength = 0;
+		m_keyMatches = false;
+		m_afterColon = false;
+		m_tokenIsKey = false;
+	}
+
+	// True if a reset time completed in this piece, ResetTime() is then the last one
+	bool Feed(const char* data, size_t length, const Clock& clock) {
+		bool found = false;
+		for (size_t i = 0; i < length; i++) {
+			char c = data[i];
+			switch (m_state) {
+			case State::String:
+				if (c == '\\') {
+					m_state = State::Escape;
+				}
+				else if (c == '"') {
+					m_state = State::Between;
+					found |= EndToken(true, clock);
+				}
+				else {
+					Append(c);
+				}
+				break;
+			case State::Escape:
+				// Reset values and key names never need escapes, keep the character as is
+				Append(c);
+				m_state = State::String;
+				break;
+			case State::Bare:
+				if (IsBare(c)) {
+					Append(c);
+					break;
+				}
+				m_state = State::Between;
+				found |= EndToken(false, clock);
+				Structural(c);
+				break;
+			case State::Between:
+			default:
+				if (c == '"') {
+					StartToken(State::String);
+				}
+				else if (IsBare(c)) {
+					StartToken(State::Bare);
+					Append(c);
+				}
+				else {
+					Structural(c);
+				}
+				break;
+			}
+		}
+		m_bytes += length;
+		return found;
+	}
+
+	Clock::time_point ResetTime() const { return m_resetTime; }
+	uint64_t ValueCount() const { return m_valueCount; }
+	uint64_t Bytes() const { return m_bytes; }
+
+	// Calendar conversion, public for the bench and other callers with a date in hand
+	static bool ParseValue(const char* text, size_t length, bool quoted, const Clock& clock, Clock::time_point& time) {
+		const char* p = text;
+		const char* end = text + length;
+
+		int64_t number = 0;
+		if (ParseDigits(p, end, number) && p == end) {
+			// Seconds run out of 11 digits in the year 5138, milliseconds need 12 from 1973 on
+			if (number >= MILLIS_THRESHOLD) {
+				time = Clock::time_point(std::chrono::duration_cast<Clock::time_point::duration>(std::chrono::milliseconds(number)));
+			}
+			else {
+				time = Clock::time_point(std::chrono::duration_cast<Clock::time_point::duration>(std::chrono::seconds(number)));
+			}
+			return true;
+		}
+		if (!quoted) return false;
+
+		// HH:MM, the next time the local clock shows it
+		p = text;
+		int hour, minute;
+		if (length == 5 && ParseTwo(p, hour) && *p++ == ':' && ParseTwo(p, minute) && hour < 24 && minute < 60) {
+			Clock::time_point now = clock.Now();
+			tm local{};
+			clock.ToLocal(now, local);
+			local.tm_hour = hour;
+			local.tm_min = minute;
+			local.tm_sec = 0;
+			time = clock.FromLocal(local);
+			if (time <= now) {
+				local.tm_mday += 1;
+				time = clock.FromLocal(local);
+			}
+			return true;
+		}
+
+		// YYYY-MM-DDTHH:MM[:SS[.fraction]][Z|+HH:MM|-HH:MM]
+		p = text;
+		int64_t year;
+		int month, day, second = 0;
+		const char* yearEnd = p + 4;
+		if (length < 16 || !ParseDigits(p, yearEnd, year) || p != yearEnd || *p++ != '-' ||
+			!ParseTwo(p, month) || *p++ != '-' || !ParseTwo(p, day)) {
+			return false;
+		}
+		if (*p != 'T' && *p != 't' && *p != ' ') return false;
+		p++;
+		if (!ParseTwo(p, hour) || *p++ != ':' || !ParseTwo(p, minute)) return false;
+		if (p < end && *p == ':') {
+			p++;
+			if (end - p < 2 || !ParseTwo(p, second)) return false;
+		}
+		if (p < end && *p == '.') {
+			p++;
+			while (p < end && *p >= '0' && *p <= '9') p++;
+		}
+		if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+		if (p == end) {
+			tm local{};
+			local.tm_year = static_cast<int>(year) - 1900;
+			local.tm_mon = month - 1;
+			local.tm_mday = day;
+			local.tm_hour = hour;
+			local.tm_min = minute;
+			local.tm_sec = second;
+			time = clock.FromLocal(local);
+			return true;
+		}
+
+		int64_t offsetMinutes = 0;
+		if (*p == 'Z' || *p == 'z') {
+			p++;
+		}
+		else if (*p == '+' || *p == '-') {
+			int sign = *p++ == '-' ? -1 : 1;
+			int offsetHour, offsetMinute = 0;
+			if (end - p < 2 || !ParseTwo(p, offsetHour)) return false;
+			if (p < end && *p == ':') p++;
+			if (p < end && (end - p < 2 || !ParseTwo(p, offsetMinute))) return false;
+			offsetMinutes = sign * (offsetHour * 60 + offsetMinute);
+		}
+		if (p != end) return false;
+
+		int64_t seconds = DaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offsetMinutes * 60;
+		time = Clock::time_point(std::chrono::duration_cast<Clock::time_point::duration>(std::chrono::seconds(seconds)));
+		return true;
+	}
+
+private:
+	static constexpr size_t MAX_TOKEN = 48;         // Longest ISO 8601 form with a fraction fits
+	static constexpr size_t MAX_KEY = 16;
+	static constexpr int64_t MILLIS_THRESHOLD = 100000000000LL;
+
+	enum class State : uint8_t {
+		Between,
+		String,
+		Escape,
+		Bare
+	};
+
+	State m_state = State::Between;
+	char m_token[MAX_TOKEN];
+	size_t m_tokenLength = 0;
+	bool m_tokenTruncated = false;
+	bool m_tokenIsKey = false;
+
+	// Normalized name of the last key, and whether its value is the one we want
+	char m_key[MAX_KEY];
+	size_t m_keyLength = 0;
+	bool m_keyMatches = false;
+	bool m_afterColon = false;
+
+	Clock::time_point m_resetTime;
+	uint64_t m_valueCount = 0;
+	uint64_t m_bytes = 0;
+
+	static bool IsBare(char c) {
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '+' || c == '.';
+	}
+
+	void StartToken(State state) {
+		m_state = state;
+		m_tokenLength = 0;
+		m_tokenTruncated = false;
+		m_tokenIsKey = !m_afterColon;
+	}
+
+	void Append(char c) {
+		if (m_tokenLength < MAX_TOKEN) {
+			m_token[m_tokenLength++] = c;
+		}
+		else {
+			m_tokenTruncated = true;
+		}
+	}
+
+	void Structural(char c) {
+		if (c == ':') {
+			m_afterColon = true;
+		}
+		else if (c == ',' || c == '{' || c == '[' || c == '}' || c == ']') {
+			m_afterColon = false;
+			m_keyMatches = false;
+		}
+	}
+
+	// A string before ':' names a key, a token after one is its value
+	bool EndToken(bool quoted, const Clock& clock) {
+		if (m_tokenIsKey) {
+			if (!quoted) return false;
+			NormalizeKey();
+			return false;
+		}
+
+		bool wanted = m_keyMatches && !m_tokenTruncated;
+		m_afterColon = false;
+		m_keyMatches = false;
+		if (!wanted) return false;
+
+		Clock::time_point time;
+		if (!ParseValue(m_token, m_tokenLength, quoted, clock, time)) return false;
+		m_resetTime = time;
+		m_valueCount++;
+		return true;
+	}
+
+	void NormalizeKey() {
+		m_keyLength = 0;
+		bool fits = true;
+		for (size_t i = 0; i < m_tokenLength; i++) {
+			char c = m_token[i];
+			if (c == '_' || c == '-') continue;
+			if (m_keyLength == MAX_KEY) {
+				fits = false;
+				break;
+			}
+			m_key[m_keyLength++] = static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+		}
+		m_keyMatches = fits && !m_tokenTruncated && (IsKey("resetsat") || IsKey("resetat") || IsKey("resettime"));
+	}
+
+	bool IsKey(const char* name) const {
+		return m_keyLength == strlen(name) && memcmp(m_key, name, m_keyLength) == 0;
+	}
+
+	static bool ParseDigits(const char*& p, const char* end, int64_t& value) {
+		const char* start = p;
+		value = 0;
+		while (p < end && *p >= '0' && *p <= '9' && p - start < 18) value = value * 10 + (*p++ - '0');
+		return p > start;
+	}
+
+	static bool ParseTwo(const char*& p, int& value) {
+		if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') return false;
+		value = (p[0] - '0') * 10 + (p[1] - '0');
+		p += 2;
+		return true;
+	}
+
+	// Days since 1970-01-01 in the proleptic Gregorian calendar, no time zone involved
+	static int64_t DaysFromCivil(int64_t year, int month, int day) {
+		year -= month <= 2;
+		int64_t era = (year >= 0 ? year : year - 399) / 400;
+		int64_t yearOfEra = year - era * 400;
+		int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+		int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+		return era * 146097 + dayOfEra - 719468;
+	}
+};
+
+// One watched status file's reads, apart from how the file is opened and watched (ResetProvider.h:
+// ReadDirectoryChangesW on Windows, inotify elsewhere). Each change is read through
+// StatusJsonScanner as Begin, Feed for each chunk until it says stop, then End:
+//   - a document (usage.json) is read from the start until the value turns up
+//   - a log (.jsonl, .ndjson) is only read past where the last read ended, the last value wins,
+//     and it starts over if the file was replaced or truncated
+// End reports a reset time only when it differs from the last one it reported.
+class StatusFileReader {
+public:
+	struct Stats {
+		uint64_t reloads = 0;           // Reads of the file
+		uint64_t failedReloads = 0;     // Of those, file missing or locked
+		uint64_t bytesParsed = 0;
+		uint64_t values = 0;            // Reads that found a reset value
+		uint64_t changes = 0;           // Of those, a different one than before
+	};
+
+	explicit StatusFileReader(bool log) : m_bLog(log) {}
+
+	// By extension, in any case
+	static bool IsLog(const std::wstring& path) {
+		return EndsWith(path, L".jsonl") || EndsWith(path, L".ndjson");
+	}
+
+	bool IsLog() const { return m_bLog; }
+
+	// A read of the file identified by volume and file (volume serial and file index, or device
+	// and inode) and now size bytes long. Returns the offset to read from.
+	uint64_t Begin(uint64_t volume, uint64_t file, uint64_t size) {
+		m_stats.reloads++;
+		m_bFound = false;
+		// A log carries on where it was if it is the same file and hasn't shrunk
+		bool resume = m_bLog && m_bOpened && volume == m_volume && file == m_file && size >= m_offset;
+		if (!resume) {
+			m_scanner.Reset();
+			m_offset = 0;
+			m_volume = volume;
+			m_file = file;
+			m_bOpened = true;
+		}
+		return m_offset;
+	}
+
+	// The file couldn't be opened or examined, it is read again on the next change
+	void Failed() {
+		m_stats.reloads++;
+		m_stats.failedReloads++;
+	}
+
+	// The next chunk from where Begin said. False once the rest of the file needn't be read.
+	bool Feed(const char* data, size_t length, const Clock& clock) {
+		m_offset += length;
+		m_stats.bytesParsed += length;
+		if (m_scanner.Feed(data, length, clock)) {
+			m_bFound = true;
+			m_stats.values++;
+			if (!m_bLog) return false;
+		}
+		return true;
+	}
+
+	// The read is over. True with the reset time if it found one other than the last reported.
+	bool End(Clock::time_point& resetTime) {
+		if (!m_bFound) return false;
+		Clock::time_point found = m_scanner.ResetTime();
+		if (m_bHaveReset && found == m_lastReset) return false;
+		m_bHaveReset = true;
+		m_lastReset = found;
+		m_stats.changes++;
+		resetTime = found;
+		return true;
+	}
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	bool m_bLog;
+	StatusJsonScanner m_scanner;
+	bool m_bFound = false;
+
+	// Log: the file read so far, and how far
+	bool m_bOpened = false;
+	uint64_t m_volume = 0;
+	uint64_t m_file = 0;
+	uint64_t m_offset = 0;
+
+	bool m_bHaveReset = false;
+	Clock::time_point m_lastReset;
+	Stats m_stats;
+
+	static bool EndsWith(const std::wstring& text, const wchar_t* suffix) {
+		size_t length = wcslen(suffix);
+		if (text.size() < length) return false;
+		const wchar_t* tail = text.c_str() + text.size() - length;
+		for (size_t i = 0; i < length; i++) {
+			if (towlower(static_cast<wint_t>(tail[i])) != static_cast<wint_t>(suffix[i])) return false;
+		}
+		return true;
+	}
+};
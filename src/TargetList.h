@@ -0,0 +1,337 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <functional>
+#include "TargetSearch.h"
+
+// Keyboard alternative to clicking the target: a search box over a list of candidate windows.
+// Created hidden once and reused, so opening it is just a show. The list box is virtual
+// (LBS_NODATA, owner drawn) and reads rows straight from the TargetSearch results, so a keystroke
+// costs one incremental query plus a repaint, never repopulating thousands of rows.
+//
+// Up/Down/PgUp/PgDn move the selection while typing, Enter or double-click picks, Esc or
+// switching away closes.
+class TargetList {
+public:
+	using PickHandler = std::function<void(HWND)>;
+
+	TargetList() = default;
+	TargetList(const TargetList&) = delete;
+	TargetList& operator=(const TargetList&) = delete;
+
+	~TargetList() {
+		Destroy();
+	}
+
+	// Owned by hOwner so it is destroyed along with it
+	bool Create(HINSTANCE hInstance, HWND hOwner, TargetSearch* pSearch) {
+		m_hOwner = hOwner;
+		m_pSearch = pSearch;
+
+		m_hBgBrush = CreateSolidBrush(BG_COLOR);
+		m_hSelectedBrush = CreateSolidBrush(SELECTED_COLOR);
+
+		WNDCLASSEXW wc = {};
+		wc.cbSize = sizeof(wc);
+		wc.lpfnWndProc = WndProc;
+		wc.hInstance = hInstance;
+		wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
+		wc.hbrBackground = m_hBgBrush;
+		wc.lpszClassName = CLASS_NAME;
+		RegisterClassExW(&wc);
+
+		m_hWnd = CreateWindowExW(WS_EX_TOOLWINDOW, CLASS_NAME, L"", WS_POPUP | WS_BORDER,
+			0, 0, 0, 0, hOwner, nullptr, hInstance, this);
+		if (!m_hWnd) return false;
+
+		m_hEdit = CreateWindowExW(0, L"EDIT", L"", WS_CHILD | WS_VISIBLE | ES_AUTOHSCROLL,
+			0, 0, 0, 0, m_hWnd, nullptr, hInstance, nullptr);
+		m_hList = CreateWindowExW(0, L"LISTBOX", L"",
+			WS_CHILD | WS_VISIBLE | WS_VSCROLL | LBS_NODATA | LBS_OWNERDRAWFIXED | LBS_NOTIFY | LBS_NOINTEGRALHEIGHT,
+			0, 0, 0, 0, m_hWnd, nullptr, hInstance, nullptr);
+		if (!m_hEdit || !m_hList) {
+			Destroy();
+			return false;
+		}
+
+		// Subclass the search box for list navigation keys
+		SetWindowLongPtrW(m_hEdit, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+		m_editProc = reinterpret_cast<WNDPROC>(SetWindowLongPtrW(m_hEdit, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(EditProc)));
+		return true;
+	}
+
+	void Destroy() {
+		if (m_hWnd) {
+			DestroyWindow(m_hWnd);
+			m_hWnd = nullptr;
+		}
+		DeleteGdiObject(m_hFont);
+		DeleteGdiObject(m_hBgBrush);
+		DeleteGdiObject(m_hSelectedBrush);
+	}
+
+	void SetPickHandler(PickHandler handler) {
+		m_onPick = std::move(handler);
+	}
+
+	// Show over the owner with an empty search, listing every candidate
+	void Open() {
+		if (!m_hWnd) return;
+
+		UINT dpi = GetDpiForWindow(m_hOwner);
+		UpdateFont(dpi);
+
+		RECT owner;
+		GetWindowRect(m_hOwner, &owner);
+		int width = MulDiv(LIST_WIDTH, dpi, 96);
+		int height = MulDiv(LIST_HEIGHT, dpi, 96);
+		int x = owner.left + ((owner.right - owner.left) - width) / 2;
+		int y = owner.top + MulDiv(OWNER_OFFSET, dpi, 96);
+		SetWindowPos(m_hWnd, HWND_TOP, x, y, width, height, SWP_SHOWWINDOW);
+		Layout(dpi);
+
+		SetWindowTextW(m_hEdit, L"");
+		Search(false);
+		SetForegroundWindow(m_hWnd);
+		SetFocus(m_hEdit);
+	}
+
+	void Close() {
+		if (m_hWnd && IsWindowVisible(m_hWnd)) {
+			ShowWindow(m_hWnd, SW_HIDE);
+		}
+	}
+
+	bool IsOpen() const {
+		return m_hWnd && IsWindowVisible(m_hWnd);
+	}
+
+	// Re-run the search after the candidate windows changed, keeping the selected window selected
+	void Refresh() {
+		Search(true);
+	}
+
+private:
+	static constexpr const wchar_t* CLASS_NAME = L"ARCCTargetList";
+	static constexpr const wchar_t* FONT_NAME = L"Segoe UI";
+	static constexpr COLORREF BG_COLOR = RGB(0x19, 0x19, 0x22);        // App background
+	static constexpr COLORREF SELECTED_COLOR = RGB(0x3D, 0x3D, 0x4A);  // Button hover
+	static constexpr COLORREF TEXT_COLOR = RGB(0xDD, 0xDD, 0xDD);
+	static constexpr COLORREF DETAIL_COLOR = RGB(0x99, 0x99, 0xA4);
+
+	// In DIPs
+	static constexpr int LIST_WIDTH = 480;
+	static constexpr int LIST_HEIGHT = 360;
+	static constexpr int OWNER_OFFSET = 40;
+	static constexpr int FONT_SIZE = 15;
+	static constexpr int PADDING = 8;
+	static constexpr int EDIT_HEIGHT = 24;
+	static constexpr int ROW_HEIGHT = 28;
+
+	static constexpr UINT TEXT_FORMAT = DT_SINGLELINE | DT_NOPREFIX | DT_VCENTER | DT_END_ELLIPSIS;
+
+	HWND m_hWnd = nullptr;
+	HWND m_hOwner = nullptr;
+	HWND m_hEdit = nullptr;
+	HWND m_hList = nullptr;
+	WNDPROC m_editProc = nullptr;
+	TargetSearch* m_pSearch = nullptr;
+	HWND m_hSelected = nullptr;
+	PickHandler m_onPick;
+	std::wstring m_query;
+
+	HFONT m_hFont = nullptr;
+	UINT m_fontDpi = 0;
+	HBRUSH m_hBgBrush = nullptr;
+	HBRUSH m_hSelectedBrush = nullptr;
+
+	template<class T>
+	static void DeleteGdiObject(T& object) {
+		if (object) {
+			DeleteObject(object);
+			object = nullptr;
+		}
+	}
+
+	void UpdateFont(UINT dpi) {
+		if (dpi == m_fontDpi) return;
+
+		DeleteGdiObject(m_hFont);
+		m_hFont = CreateFontW(-MulDiv(FONT_SIZE, dpi, 96), 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+			DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, DEFAULT_PITCH, FONT_NAME);
+		m_fontDpi = dpi;
+
+		SendMessageW(m_hEdit, WM_SETFONT, reinterpret_cast<WPARAM>(m_hFont), FALSE);
+		SendMessageW(m_hList, LB_SETITEMHEIGHT, 0, MulDiv(ROW_HEIGHT, dpi, 96));
+	}
+
+	void Layout(UINT dpi) {
+		RECT client;
+		GetClientRect(m_hWnd, &client);
+		int padding = MulDiv(PADDING, dpi, 96);
+		int editHeight = MulDiv(EDIT_HEIGHT, dpi, 96);
+
+		SetWindowPos(m_hEdit, nullptr, padding, padding,
+			client.right - 2 * padding, editHeight, SWP_NOZORDER | SWP_NOACTIVATE);
+		SetWindowPos(m_hList, nullptr, 0, 2 * padding + editHeight,
+			client.right, client.bottom - (2 * padding + editHeight), SWP_NOZORDER | SWP_NOACTIVATE);
+	}
+
+	// Query from the search box. keepSelection keeps the selected window selected if it still
+	// matches, otherwise (typing) the best match is selected.
+	void Search(bool keepSelection) {
+		if (!m_hWnd || !m_pSearch) return;
+
+		int length = GetWindowTextLengthW(m_hEdit);
+		m_query.resize(static_cast<size_t>(length));
+		if (length > 0) {
+			GetWindowTextW(m_hEdit, &m_query[0], length + 1);
+		}
+		m_pSearch->SetQuery(m_query);
+
+		size_t count = m_pSearch->ResultCount();
+		WPARAM selection = count > 0 ? 0 : static_cast<WPARAM>(-1);
+		if (keepSelection && m_hSelected) {
+			for (size_t i = 0; i < count; i++) {
+				if (m_pSearch->Result(i).hWnd == m_hSelected) {
+					selection = i;
+					break;
+				}
+			}
+		}
+
+		SendMessageW(m_hList, LB_SETCOUNT, count, 0);
+		SendMessageW(m_hList, LB_SETCURSEL, selection, 0);
+		InvalidateRect(m_hList, nullptr, TRUE);
+		OnSelectionChanged();
+	}
+
+	// Remembered by window, the result indexes don't survive a change to the candidates
+	void OnSelectionChanged() {
+		LRESULT selected = SendMessageW(m_hList, LB_GETCURSEL, 0, 0);
+		m_hSelected = selected >= 0 && static_cast<size_t>(selected) < m_pSearch->ResultCount() ?
+			m_pSearch->Result(static_cast<size_t>(selected)).hWnd : nullptr;
+	}
+
+	void Pick() {
+		HWND hWnd = m_hSelected;
+		if (!hWnd) return;
+
+		Close();
+		if (m_onPick) {
+			m_onPick(hWnd);
+		}
+	}
+
+	static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+		if (message == WM_NCCREATE) {
+			const CREATESTRUCTW* pCreate = reinterpret_cast<const CREATESTRUCTW*>(lParam);
+			SetWindowLongPtrW(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pCreate->lpCreateParams));
+		}
+
+		TargetList* pList = reinterpret_cast<TargetList*>(GetWindowLongPtrW(hWnd, GWLP_USERDATA));
+		if (pList) {
+			switch (message) {
+			case WM_COMMAND:
+				if (reinterpret_cast<HWND>(lParam) == pList->m_hEdit && HIWORD(wParam) == EN_CHANGE) {
+					pList->Search(false);
+					return 0;
+				}
+				if (reinterpret_cast<HWND>(lParam) == pList->m_hList) {
+					if (HIWORD(wParam) == LBN_DBLCLK) {
+						pList->Pick();
+					}
+					else if (HIWORD(wParam) == LBN_SELCHANGE) {
+						pList->OnSelectionChanged();
+
+						// Keep typing going to the search box after a click in the list
+						SetFocus(pList->m_hEdit);
+					}
+					return 0;
+				}
+				break;
+			case WM_DRAWITEM:
+				pList->OnDrawItem(*reinterpret_cast<const DRAWITEMSTRUCT*>(lParam));
+				return TRUE;
+			case WM_CTLCOLOREDIT:
+			case WM_CTLCOLORLISTBOX:
+				SetTextColor(reinterpret_cast<HDC>(wParam), TEXT_COLOR);
+				SetBkColor(reinterpret_cast<HDC>(wParam), BG_COLOR);
+				return reinterpret_cast<LRESULT>(pList->m_hBgBrush);
+			case WM_ACTIVATE:
+				// Clicking anywhere else dismisses the list
+				if (LOWORD(wParam) == WA_INACTIVE) {
+					pList->Close();
+				}
+				break;
+			case WM_NCDESTROY:
+				// Destroyed with the owner window
+				pList->m_hWnd = nullptr;
+				pList->m_hEdit = nullptr;
+				pList->m_hList = nullptr;
+				break;
+			}
+		}
+		return DefWindowProcW(hWnd, message, wParam, lParam);
+	}
+
+	static LRESULT CALLBACK EditProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+		TargetList* pList = reinterpret_cast<TargetList*>(GetWindowLongPtrW(hWnd, GWLP_USERDATA));
+
+		switch (message) {
+		case WM_KEYDOWN:
+			switch (wParam) {
+			case VK_UP:
+			case VK_DOWN:
+			case VK_PRIOR:
+			case VK_NEXT:
+				SendMessageW(pList->m_hList, WM_KEYDOWN, wParam, lParam);
+				return 0;
+			case VK_RETURN:
+				pList->Pick();
+				return 0;
+			case VK_ESCAPE:
+				pList->Close();
+				return 0;
+			}
+			break;
+		case WM_CHAR:
+			// Already handled on key down, the edit control would just beep
+			if (wParam == L'\r' || wParam == 0x1B) return 0;
+			break;
+		}
+		return CallWindowProcW(pList->m_editProc, hWnd, message, wParam, lParam);
+	}
+
+	// One row: process name, then the title dimmed, both cut with an ellipsis to fit
+	void OnDrawItem(const DRAWITEMSTRUCT& item) {
+		if (item.itemID == static_cast<UINT>(-1) || item.itemID >= m_pSearch->ResultCount()) return;
+		const TargetSearch::Item& result = m_pSearch->Result(item.itemID);
+
+		HDC hdc = item.hDC;
+		FillRect(hdc, &item.rcItem, (item.itemState & ODS_SELECTED) ? m_hSelectedBrush : m_hBgBrush);
+
+		HGDIOBJ hOldFont = SelectObject(hdc, m_hFont);
+		SetBkMode(hdc, TRANSPARENT);
+
+		int padding = MulDiv(PADDING, m_fontDpi, 96);
+		RECT text = { item.rcItem.left + padding, item.rcItem.top, item.rcItem.right - padding, item.rcItem.bottom };
+
+		RECT name = text;
+		DrawTextW(hdc, result.processName.c_str(), static_cast<int>(result.processName.size()), &name, TEXT_FORMAT | DT_CALCRECT);
+		name.top = text.top;
+		name.bottom = text.bottom;
+		if (name.right > text.right) name.right = text.right;
+		SetTextColor(hdc, TEXT_COLOR);
+		DrawTextW(hdc, result.processName.c_str(), static_cast<int>(result.processName.size()), &name, TEXT_FORMAT);
+
+		text.left = name.right + padding;
+		if (text.left < text.right && !result.title.empty()) {
+			SetTextColor(hdc, DETAIL_COLOR);
+			DrawTextW(hdc, result.title.c_str(), static_cast<int>(result.title.size()), &text, TEXT_FORMAT);
+		}
+
+		SelectObject(hdc, hOldFont);
+	}
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "Platform.h"
+
+// Fuzzy (in-order subsequence) search over candidate windows by "process title". Items are kept
+// current from WindowIndex changes, each with a lowercased key and a character mask built once.
+//
+// Queries are incremental: for every query prefix the candidates that still match are kept along
+// with where their greedy match ended, so typing one more character only resumes those matches
+// and backspace just drops the last level. Only a change to the items themselves forces a rescan.
+class TargetSearch {
+public:
+	using WindowHandle = Platform::WindowHandle;
+
+	struct Item {
+		WindowHandle hWnd = nullptr;
+		std::wstring processName;
+		std::wstring title;
+		std::wstring key;           // Lowercased "process title"
+		uint64_t charMask = 0;      // CharBit of every character in key
+	};
+
+	// Cost of answering queries
+	struct Stats {
+		uint64_t queryCount = 0;
+		uint64_t queryTicks = 0;        // Platform::Ticks spent in SetQuery
+		uint64_t maxQueryTicks = 0;     // Slowest single query
+		uint64_t ticksPerSecond = 1;
+	};
+
+	TargetSearch() {
+		m_stats.ticksPerSecond = Platform::TicksPerSecond();
+	}
+
+	TargetSearch(const TargetSearch&) = delete;
+	TargetSearch& operator=(const TargetSearch&) = delete;
+
+	// Add the window, or refresh it if it is already known
+	void Update(WindowHandle hWnd, const std::wstring& processName, const std::wstring& title) {
+		auto it = m_slots.find(hWnd);
+		if (it == m_slots.end()) {
+			it = m_slots.emplace(hWnd, m_items.size()).first;
+			m_items.emplace_back();
+		}
+
+		Item& item = m_items[it->second];
+		item.hWnd = hWnd;
+		item.processName = processName;
+		item.title = title;
+		item.key = processName;
+		item.key += L' ';
+		item.key += title;
+		Platform::ToLower(&item.key[0], item.key.size());
+		item.charMask = 0;
+		for (wchar_t c : item.key) {
+			item.charMask |= CharBit(c);
+		}
+
+		Invalidate();
+	}
+
+	void Remove(WindowHandle hWnd) {
+		auto it = m_slots.find(hWnd);
+		if (it == m_slots.end()) return;
+
+		// Swap-remove so items stay dense
+		size_t slot = it->second;
+		m_slots.erase(it);
+		if (slot != m_items.size() - 1) {
+			m_items[slot] = std::move(m_items.back());
+			m_slots[m_items[slot].hWnd] = slot;
+		}
+		m_items.pop_back();
+
+		Invalidate();
+	}
+
+	void Clear() {
+		m_items.clear();
+		m_slots.clear();
+		Invalidate();
+	}
+
+	// Narrow (or widen) the results to match query, reusing whatever the previous query shares
+	void SetQuery(const std::wstring& query) {
+		uint64_t start = Platform::Ticks();
+
+		std::wstring lowered = query;
+		if (!lowered.empty()) {
+			Platform::ToLower(&lowered[0], lowered.size());
+		}
+
+		// Levels for the shared prefix stay valid, level 0 is every item
+		size_t shared = 0;
+		while (shared < lowered.size() && shared < m_query.size() && lowered[shared] == m_query[shared]) {
+			shared++;
+		}
+		if (m_levels.empty()) {
+			shared = 0;
+			m_levels.emplace_back();
+			for (size_t i = 0; i < m_items.size(); i++) {
+				m_levels[0].push_back({ static_cast<uint32_t>(i), 0 });
+			}
+		}
+		m_levels.resize(shared + 1);
+
+		for (size_t i = shared; i < lowered.size(); i++) {
+			wchar_t c = lowered[i];
+			uint64_t bit = CharBit(c);
+			const std::vector<Candidate>& previous = m_levels[i];
+			std::vector<Candidate> next;
+			for (const Candidate& candidate : previous) {
+				const Item& item = m_items[candidate.item];
+				if (!(item.charMask & bit)) continue;
+
+				size_t pos = item.key.find(c, candidate.end);
+				if (pos != std::wstring::npos) {
+					next.push_back({ candidate.item, static_cast<uint32_t>(pos + 1) });
+				}
+			}
+			m_levels.push_back(std::move(next));
+		}
+		m_query.swap(lowered);
+
+		Rank();
+
+		uint64_t ticks = Platform::Ticks() - start;
+		m_stats.queryCount++;
+		m_stats.queryTicks += ticks;
+		if (ticks > m_stats.maxQueryTicks) {
+			m_stats.maxQueryTicks = ticks;
+		}
+	}
+
+	// Matches for the last SetQuery, best first
+	size_t ResultCount() const { return m_results.size(); }
+	const Item& Result(size_t index) const { return m_items[m_results[index]]; }
+
+	size_t Size() const { return m_items.size(); }
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	// Greedy match state after a query prefix: the item and the key position just past the match
+	struct Candidate {
+		uint32_t item;
+		uint32_t end;
+	};
+
+	std::vector<Item> m_items;
+	std::unordered_map<WindowHandle, size_t> m_slots;   // Window to index in m_items
+	std::wstring m_query;                       // Lowercased
+	std::vector<std::vector<Candidate>> m_levels;
+	std::vector<uint32_t> m_results;
+	std::vector<int> m_scores;                  // Per item, only valid for items in m_results
+	Stats m_stats;
+
+	// Character mask bit, collisions only cost an extra find
+	static uint64_t CharBit(wchar_t c) {
+		return uint64_t(1) << (c & 63);
+	}
+
+	// Items changed, the next query starts over from level 0
+	void Invalidate() {
+		m_levels.clear();
+		m_results.clear();
+	}
+
+	static bool IsWordStart(const std::wstring& key, size_t pos) {
+		if (pos == 0) return true;
+		wchar_t before = key[pos - 1];
+		return before == L' ' || before == L'-' || before == L'_' || before == L'.' || before == L'\\' || before == L'/';
+	}
+
+	// Greedy match again with position bonuses: runs of characters, word starts, and hits in the
+	// process name (a query is usually aimed at the app), shorter keys break ties
+	int Score(const Item& item) const {
+		int score = 0;
+		size_t pos = 0;
+		size_t last = std::wstring::npos;
+		for (wchar_t c : m_query) {
+			pos = item.key.find(c, pos);
+			if (pos == std::wstring::npos) break;
+			score += 1;
+			if (last != std::wstring::npos && pos == last + 1) score += 4;
+			if (IsWordStart(item.key, pos)) score += 6;
+			if (pos < item.processName.size()) score += 2;
+			last = pos;
+			pos++;
+		}
+		return score * 1024 - static_cast<int>(item.key.size() < 1024 ? item.key.size() : 1023);
+	}
+
+	void Rank() {
+		const std::vector<Candidate>& matches = m_levels.back();
+		m_results.clear();
+		m_results.reserve(matches.size());
+		for (const Candidate& candidate : matches) {
+			m_results.push_back(candidate.item);
+		}
+
+		// An empty query lists everything by process name
+		if (m_query.empty()) {
+			std::sort(m_results.begin(), m_results.end(), [this](uint32_t a, uint32_t b) {
+				return m_items[a].key < m_items[b].key;
+			});
+			return;
+		}
+
+		m_scores.resize(m_items.size());
+		for (uint32_t index : m_results) {
+			m_scores[index] = Score(m_items[index]);
+		}
+		std::sort(m_results.begin(), m_results.end(), [this](uint32_t a, uint32_t b) {
+			return m_scores[a] > m_scores[b];
+		});
+	}
+};
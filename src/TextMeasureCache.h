@@ -0,0 +1,99 @@
+#pragma once
+
+#include <windows.h>
+#include <dwrite.h>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+// DirectWrite metrics keyed by (text, format, layout width). Layout asks for the same few strings
+// over and over, and a live resize keeps revisiting widths it has just measured, so each distinct
+// measurement creates one IDWriteTextLayout instead of one per layout pass.
+//
+// Text is keyed by pointer and must outlive the cache (the UI only measures string constants).
+// Clear() whenever the text formats are recreated.
+class TextMeasureCache {
+public:
+	struct Size {
+		float width = 0.0f;
+		float height = 0.0f;
+	};
+
+	struct Stats {
+		ULONGLONG hits = 0;
+		ULONGLONG misses = 0;
+	};
+
+	void SetFactory(IDWriteFactory* pFactory) {
+		m_pFactory = pFactory;
+		Clear();
+	}
+
+	void Clear() {
+		m_entries.clear();
+	}
+
+	// Returns false if the text could not be laid out
+	bool Measure(const wchar_t* text, IDWriteTextFormat* pFormat, float maxWidth, Size& size) {
+		Key key = { text, pFormat, maxWidth };
+		auto it = m_entries.find(key);
+		if (it != m_entries.end()) {
+			m_stats.hits++;
+			size = it->second;
+			return true;
+		}
+
+		m_stats.misses++;
+		if (!m_pFactory || !pFormat) return false;
+
+		IDWriteTextLayout* pTextLayout = nullptr;
+		HRESULT hr = m_pFactory->CreateTextLayout(text, static_cast<UINT32>(wcslen(text)), pFormat,
+			maxWidth, MAX_LAYOUT_HEIGHT, &pTextLayout);
+		if (FAILED(hr) || !pTextLayout) return false;
+
+		DWRITE_TEXT_METRICS textMetrics;
+		pTextLayout->GetMetrics(&textMetrics);
+		pTextLayout->Release();
+
+		size.width = textMetrics.width;
+		size.height = textMetrics.height;
+
+		// Dragging across a wide range of widths shouldn't grow this forever
+		if (m_entries.size() >= MAX_ENTRIES) {
+			m_entries.clear();
+		}
+		m_entries.emplace(key, size);
+		return true;
+	}
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	static constexpr float MAX_LAYOUT_HEIGHT = 1000.0f;
+	static constexpr size_t MAX_ENTRIES = 512;
+
+	struct Key {
+		const wchar_t* text;
+		IDWriteTextFormat* pFormat;
+		float maxWidth;
+
+		bool operator==(const Key& other) const {
+			return text == other.text && pFormat == other.pFormat && maxWidth == other.maxWidth;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			uint32_t widthBits;
+			memcpy(&widthBits, &key.maxWidth, sizeof(widthBits));
+			size_t hash = reinterpret_cast<size_t>(key.text);
+			hash = hash * 31 + reinterpret_cast<size_t>(key.pFormat);
+			hash = hash * 31 + widthBits;
+			return hash;
+		}
+	};
+
+	IDWriteFactory* m_pFactory = nullptr;
+	std::unordered_map<Key, Size, KeyHash> m_entries;
+	Stats m_stats;
+};
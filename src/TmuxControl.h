@@ -0,0 +1,471 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include "EventLoop.h"
+#include "Keystrokes.h"
+
+// One persistent tmux control-mode client (tmux -C) for typing into specific panes and following
+// their output. Every pane is reached through the same connection: a send is a couple of
+// command lines written to the client's stdin, never a new process.
+//
+// Both ends of the client are overlapped named pipes. Its stdout is serviced from the event loop;
+// writes to its stdin wait at most WRITE_TIMEOUT_MS, so a client that stops reading costs the UI
+// thread that long once and is then dropped rather than hanging it. Control-mode output is
+// line based: command replies are wrapped in %begin/%end (or %error), and pane output arrives as
+// "%output %<pane> <data>" with control characters and backslashes escaped as \ooo octal.
+class TmuxControl {
+public:
+	// Decoded output of one %output line
+	using OutputHandler = std::function<void(const char* data, size_t length)>;
+
+	struct Stats {
+		ULONGLONG connectCount = 0;
+		ULONGLONG commandCount = 0;     // Command lines written
+		ULONGLONG commandErrors = 0;    // %error replies
+		ULONGLONG outputLines = 0;      // %output notifications, any pane
+		ULONGLONG outputBytes = 0;      // Decoded
+		ULONGLONG echoCount = 0;        // Sends followed by output from the same pane
+		ULONGLONG echoTicks = 0;        // QPC ticks from send to that first output
+		ULONGLONG maxEchoTicks = 0;
+		ULONGLONG pasteCount = 0;
+		ULONGLONG pasteChunks = 0;      // set-buffer writes, a paste takes one or more
+		ULONGLONG pasteBackoffs = 0;    // Writes tmux took longer than the budget to accept
+		ULONGLONG writeTimeouts = 0;    // Writes not accepted within WRITE_TIMEOUT_MS, each dropped the client
+		ULONGLONG ticksPerSecond = 1;
+	};
+
+	TmuxControl() {
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		m_stats.ticksPerSecond = static_cast<ULONGLONG>(freq.QuadPart);
+	}
+
+	~TmuxControl() {
+		Disconnect();
+	}
+
+	TmuxControl(const TmuxControl&) = delete;
+	TmuxControl& operator=(const TmuxControl&) = delete;
+
+	// Start the client, e.g. L"wsl.exe -e tmux -C attach-session". Does nothing if already connected.
+	bool Connect(const std::wstring& commandLine, EventLoop& loop) {
+		if (IsConnected()) return true;
+		Disconnect();
+
+		// Overlapped named pipes for the client's stdout and stdin, anonymous pipes can't be waited on
+		unsigned long serial = NextPipeSerial();
+		wchar_t outputName[64];
+		wchar_t inputName[64];
+		swprintf_s(outputName, L"\\\\.\\pipe\\arcc-tmux-%lu-%lu", GetCurrentProcessId(), serial);
+		swprintf_s(inputName, L"\\\\.\\pipe\\arcc-tmux-in-%lu-%lu", GetCurrentProcessId(), serial);
+		m_hOutput = CreateNamedPipeW(outputName, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+			PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 0, BUFFER_SIZE, 0, nullptr);
+		if (m_hOutput == INVALID_HANDLE_VALUE) {
+			m_hOutput = nullptr;
+			return false;
+		}
+		m_hInput = CreateNamedPipeW(inputName, PIPE_ACCESS_OUTBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+			PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, BUFFER_SIZE, 0, 0, nullptr);
+		if (m_hInput == INVALID_HANDLE_VALUE) {
+			m_hInput = nullptr;
+			Disconnect();
+			return false;
+		}
+		m_hWriteEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (!m_hWriteEvent) {
+			Disconnect();
+			return false;
+		}
+
+		// The client's ends are ordinary synchronous handles
+		SECURITY_ATTRIBUTES inherit = { sizeof(inherit), nullptr, TRUE };
+		HANDLE hChildOutput = CreateFileW(outputName, GENERIC_WRITE, 0, &inherit, OPEN_EXISTING, 0, nullptr);
+		HANDLE hChildInput = CreateFileW(inputName, GENERIC_READ, 0, &inherit, OPEN_EXISTING, 0, nullptr);
+		if (hChildOutput == INVALID_HANDLE_VALUE || hChildInput == INVALID_HANDLE_VALUE) {
+			if (hChildOutput != INVALID_HANDLE_VALUE) CloseHandle(hChildOutput);
+			if (hChildInput != INVALID_HANDLE_VALUE) CloseHandle(hChildInput);
+			Disconnect();
+			return false;
+		}
+
+		STARTUPINFOW startup = {};
+		startup.cb = sizeof(startup);
+		startup.dwFlags = STARTF_USESTDHANDLES;
+		startup.hStdInput = hChildInput;
+		startup.hStdOutput = hChildOutput;
+		startup.hStdError = hChildOutput;
+
+		PROCESS_INFORMATION process = {};
+		std::wstring mutableCommand = commandLine;
+		BOOL started = CreateProcessW(nullptr, &mutableCommand[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+			nullptr, nullptr, &startup, &process);
+		CloseHandle(hChildInput);
+		CloseHandle(hChildOutput);
+		if (!started) {
+			Disconnect();
+			return false;
+		}
+		CloseHandle(process.hThread);
+		m_hProcess = process.hProcess;
+
+		m_hReadEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		if (!m_hReadEvent || !loop.Add(m_hReadEvent, [this]() { OnRead(); })) {
+			Disconnect();
+			return false;
+		}
+		m_pLoop = &loop;
+		if (!loop.Add(m_hProcess, [this]() { Disconnect(); })) {
+			Disconnect();
+			return false;
+		}
+
+		m_stats.connectCount++;
+		Read();
+		return IsConnected();
+	}
+
+	void Disconnect() {
+		if (m_pLoop) {
+			if (m_hReadEvent) m_pLoop->Remove(m_hReadEvent);
+			if (m_hProcess) m_pLoop->Remove(m_hProcess);
+			m_pLoop = nullptr;
+		}
+		if (m_hOutput) {
+			// The pending read still owns m_overlapped until it completes
+			if (CancelIoEx(m_hOutput, &m_overlapped)) {
+				DWORD bytes;
+				GetOverlappedResult(m_hOutput, &m_overlapped, &bytes, TRUE);
+			}
+			CloseHandle(m_hOutput);
+			m_hOutput = nullptr;
+		}
+		// Closing stdin makes the client detach and exit. Write never leaves a write pending.
+		CloseHandleAndClear(m_hInput);
+		CloseHandleAndClear(m_hWriteEvent);
+		CloseHandleAndClear(m_hReadEvent);
+		CloseHandleAndClear(m_hProcess);
+		m_line.clear();
+		m_lastSend.clear();
+	}
+
+	bool IsConnected() const { return m_hProcess != nullptr && m_hOutput != nullptr; }
+
+	// Type text into the pane (e.g. "%3") literally, then press Enter. Newlines in the text become
+	// Enter presses too.
+	bool SendKeys(const std::string& pane, const std::wstring& text, bool pressEnter) {
+		if (!IsConnected()) return false;
+
+		m_command.clear();
+		size_t start = 0;
+		for (;;) {
+			size_t end = text.find(L'\n', start);
+			size_t length = (end == std::wstring::npos ? text.size() : end) - start;
+			if (length > 0 && text[start + length - 1] == L'\r') length--;
+			if (length > 0) {
+				AppendCommand("send-keys -t ", pane);
+				m_command += " -l ";
+				AppendQuoted(text.c_str() + start, length);
+				m_command += '\n';
+			}
+			if (end == std::wstring::npos) break;
+			AppendCommand("send-keys -t ", pane);
+			m_command += " Enter\n";
+			start = end + 1;
+		}
+		if (pressEnter) {
+			AppendCommand("send-keys -t ", pane);
+			m_command += " Enter\n";
+		}
+
+		if (!Write(m_command)) return false;
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		m_lastSend[pane] = static_cast<ULONGLONG>(now.QuadPart);
+		return true;
+	}
+
+	// Bulk text: loaded into a tmux buffer in chunks, then pasted into the pane in one go with
+	// bracketed paste (-p) if the program there asked for it, so its line breaks don't submit
+	// anything early. A write that waits means tmux is behind on reading and the chunks shrink.
+	bool Paste(const std::string& pane, const std::wstring& text, bool pressEnter) {
+		if (!IsConnected()) return false;
+
+		// One buffer per pane, deleted by the paste (-d)
+		std::string buffer = "arcc";
+		buffer.append(pane, 1, std::string::npos);
+
+		Keystrokes::ChunkSizer sizer(PASTE_INITIAL_CHUNK, PASTE_MIN_CHUNK, PASTE_MAX_CHUNK);
+		size_t start = 0;
+		do {
+			size_t length = text.size() - start;
+			if (length > sizer.Size()) {
+				length = sizer.Size();
+				// Keep a surrogate pair in one chunk, UTF-8 can't encode half of one
+				if (text[start + length - 1] >= 0xD800 && text[start + length - 1] <= 0xDBFF) length--;
+			}
+
+			m_command.clear();
+			m_command += start == 0 ? "set-buffer -b " : "set-buffer -a -b ";
+			m_command += buffer;
+			m_command += " -- ";
+			AppendEscaped(text.c_str() + start, length);
+			m_command += '\n';
+			m_stats.commandCount++;
+
+			LARGE_INTEGER before, after;
+			QueryPerformanceCounter(&before);
+			if (!Write(m_command)) return false;
+			QueryPerformanceCounter(&after);
+
+			uint64_t micros = static_cast<uint64_t>(after.QuadPart - before.QuadPart) * 1000000 / m_stats.ticksPerSecond;
+			sizer.Completed(length, length, micros, PASTE_BUDGET_MICROS);
+			m_stats.pasteChunks++;
+			start += length;
+		} while (start < text.size());
+		m_stats.pasteBackoffs += sizer.Backoffs();
+
+		m_command.clear();
+		AppendCommand("paste-buffer -p -d -b ", buffer);
+		m_command += " -t ";
+		m_command += pane;
+		m_command += '\n';
+		if (pressEnter) {
+			AppendCommand("send-keys -t ", pane);
+			m_command += " Enter\n";
+		}
+		if (!Write(m_command)) return false;
+		m_stats.pasteCount++;
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		m_lastSend[pane] = static_cast<ULONGLONG>(now.QuadPart);
+		return true;
+	}
+
+	// Output from one pane, for detection and verification. One handler per pane.
+	void Subscribe(const std::string& pane, OutputHandler handler) {
+		m_subscribers[pane] = std::move(handler);
+	}
+
+	void Unsubscribe(const std::string& pane) {
+		m_subscribers.erase(pane);
+	}
+
+	Stats GetStats() const { return m_stats; }
+
+private:
+	static constexpr DWORD BUFFER_SIZE = 64 * 1024;
+	static constexpr const char* OUTPUT_PREFIX = "%output ";
+	static constexpr const char* ERROR_PREFIX = "%error";
+	static constexpr size_t PASTE_INITIAL_CHUNK = 1024;     // UTF-16 units
+	static constexpr size_t PASTE_MIN_CHUNK = 128;
+	static constexpr size_t PASTE_MAX_CHUNK = 16384;
+	static constexpr uint64_t PASTE_BUDGET_MICROS = 10000;
+	static constexpr DWORD WRITE_TIMEOUT_MS = 500;          // Longer than any healthy client takes to drain a chunk
+
+	HANDLE m_hProcess = nullptr;
+	HANDLE m_hInput = nullptr;      // Client stdin, overlapped writes waited on with a timeout
+	HANDLE m_hOutput = nullptr;     // Client stdout, overlapped reads
+	HANDLE m_hReadEvent = nullptr;
+	HANDLE m_hWriteEvent = nullptr; // Not on the event loop, Write waits on it
+	OVERLAPPED m_overlapped = {};
+	OVERLAPPED m_writeOverlapped = {};
+	EventLoop* m_pLoop = nullptr;
+
+	char m_readBuffer[BUFFER_SIZE];
+	std::string m_line;             // Partial line carried between reads
+	std::string m_decoded;          // Reused for %output data
+	std::string m_command;          // Reused for outgoing commands
+	std::unordered_map<std::string, OutputHandler> m_subscribers;
+	std::unordered_map<std::string, ULONGLONG> m_lastSend;  // Pane to QPC of a send not yet echoed
+	Stats m_stats;
+
+	// Each connection gets a fresh pipe name
+	static unsigned long NextPipeSerial() {
+		static unsigned long serial = 0;
+		return ++serial;
+	}
+
+	static void CloseHandleAndClear(HANDLE& handle) {
+		if (handle) {
+			CloseHandle(handle);
+			handle = nullptr;
+		}
+	}
+
+	void AppendCommand(const char* command, const std::string& pane) {
+		m_command += command;
+		m_command += pane;
+		m_stats.commandCount++;
+	}
+
+	// Single-quoted tmux argument in UTF-8, a quote inside becomes '\''
+	void AppendQuoted(const wchar_t* text, size_t length) {
+		int bytes = WideCharToMultiByte(CP_UTF8, 0, text, static_cast<int>(length), nullptr, 0, nullptr, nullptr);
+		std::string utf8(static_cast<size_t>(bytes), '\0');
+		WideCharToMultiByte(CP_UTF8, 0, text, static_cast<int>(length), &utf8[0], bytes, nullptr, nullptr);
+
+		m_command += '\'';
+		for (char c : utf8) {
+			if (c == '\'') {
+				m_command += "'\\''";
+			}
+			else {
+				m_command += c;
+			}
+		}
+		m_command += '\'';
+	}
+
+	// Double-quoted tmux argument in UTF-8, which unlike single quotes can carry line breaks and
+	// control characters as escapes. $ is escaped too, tmux expands variables in double quotes.
+	void AppendEscaped(const wchar_t* text, size_t length) {
+		int bytes = WideCharToMultiByte(CP_UTF8, 0, text, static_cast<int>(length), nullptr, 0, nullptr, nullptr);
+		std::string utf8(static_cast<size_t>(bytes), '\0');
+		WideCharToMultiByte(CP_UTF8, 0, text, static_cast<int>(length), &utf8[0], bytes, nullptr, nullptr);
+
+		m_command += '"';
+		for (char c : utf8) {
+			unsigned char byte = static_cast<unsigned char>(c);
+			if (c == '\r') continue;
+			if (c == '\n') {
+				m_command += "\\n";
+			}
+			else if (c == '"' || c == '\\' || c == '$') {
+				m_command += '\\';
+				m_command += c;
+			}
+			else if (byte < 0x20 || byte == 0x7F) {
+				char octal[5];
+				sprintf_s(octal, "\\%03o", byte);
+				m_command += octal;
+			}
+			else {
+				m_command += c;
+			}
+		}
+		m_command += '"';
+	}
+
+	// Returns once the pipe has taken all of data, or false after WRITE_TIMEOUT_MS with the client
+	// dropped. The next send connects a fresh one.
+	bool Write(const std::string& data) {
+		memset(&m_writeOverlapped, 0, sizeof(m_writeOverlapped));
+		m_writeOverlapped.hEvent = m_hWriteEvent;
+		ResetEvent(m_hWriteEvent);
+
+		DWORD written = 0;
+		bool ok = WriteFile(m_hInput, data.data(), static_cast<DWORD>(data.size()), nullptr, &m_writeOverlapped) != FALSE;
+		if (!ok && GetLastError() == ERROR_IO_PENDING) {
+			if (WaitForSingleObject(m_hWriteEvent, WRITE_TIMEOUT_MS) != WAIT_OBJECT_0) {
+				// The write owns m_writeOverlapped and data until the cancel completes
+				CancelIoEx(m_hInput, &m_writeOverlapped);
+				m_stats.writeTimeouts++;
+			}
+			ok = true;
+		}
+		ok = ok && GetOverlappedResult(m_hInput, &m_writeOverlapped, &written, TRUE) && written == data.size();
+		if (!ok) {
+			Disconnect();
+			return false;
+		}
+		return true;
+	}
+
+	void Read() {
+		memset(&m_overlapped, 0, sizeof(m_overlapped));
+		m_overlapped.hEvent = m_hReadEvent;
+		if (!ReadFile(m_hOutput, m_readBuffer, BUFFER_SIZE, nullptr, &m_overlapped) && GetLastError() != ERROR_IO_PENDING) {
+			Disconnect();
+		}
+	}
+
+	void OnRead() {
+		DWORD bytes = 0;
+		BOOL ok = GetOverlappedResult(m_hOutput, &m_overlapped, &bytes, FALSE);
+		ResetEvent(m_hReadEvent);
+		if (!ok || bytes == 0) {
+			Disconnect();
+			return;
+		}
+
+		// Whole lines only, the rest waits for the next read
+		const char* p = m_readBuffer;
+		const char* end = m_readBuffer + bytes;
+		while (p < end) {
+			const char* newline = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+			if (!newline) {
+				m_line.append(p, end);
+				break;
+			}
+			if (m_line.empty()) {
+				HandleLine(p, static_cast<size_t>(newline - p));
+			}
+			else {
+				m_line.append(p, newline);
+				HandleLine(m_line.data(), m_line.size());
+				m_line.clear();
+			}
+			p = newline + 1;
+		}
+
+		Read();
+	}
+
+	void HandleLine(const char* line, size_t length) {
+		if (length > 0 && line[length - 1] == '\r') length--;
+
+		size_t prefixLength = strlen(OUTPUT_PREFIX);
+		if (length > prefixLength && memcmp(line, OUTPUT_PREFIX, prefixLength) == 0) {
+			const char* pane = line + prefixLength;
+			const char* lineEnd = line + length;
+			const char* space = static_cast<const char*>(memchr(pane, ' ', static_cast<size_t>(lineEnd - pane)));
+			if (!space) return;
+			HandleOutput(std::string(pane, space), space + 1, lineEnd);
+			return;
+		}
+
+		size_t errorLength = strlen(ERROR_PREFIX);
+		if (length >= errorLength && memcmp(line, ERROR_PREFIX, errorLength) == 0) {
+			m_stats.commandErrors++;
+		}
+	}
+
+	void HandleOutput(const std::string& pane, const char* data, const char* end) {
+		m_decoded.clear();
+		while (data < end) {
+			if (*data == '\\' && end - data >= 4) {
+				m_decoded += static_cast<char>(((data[1] - '0') << 6) | ((data[2] - '0') << 3) | (data[3] - '0'));
+				data += 4;
+			}
+			else {
+				m_decoded += *data++;
+			}
+		}
+		m_stats.outputLines++;
+		m_stats.outputBytes += m_decoded.size();
+
+		auto sent = m_lastSend.find(pane);
+		if (sent != m_lastSend.end()) {
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			ULONGLONG ticks = static_cast<ULONGLONG>(now.QuadPart) - sent->second;
+			m_stats.echoCount++;
+			m_stats.echoTicks += ticks;
+			if (ticks > m_stats.maxEchoTicks) m_stats.maxEchoTicks = ticks;
+			m_lastSend.erase(sent);
+		}
+
+		auto subscriber = m_subscribers.find(pane);
+		if (subscriber != m_subscribers.end()) {
+			subscriber->second(m_decoded.data(), m_decoded.size());
+		}
+	}
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Timeline of where the app spends its time, for looking into late resumes and stuttering
+// paints. Scoped spans go into a fixed ring per thread (oldest overwritten) that only its own
+// thread writes, so recording takes no locks. Export writes Chrome trace event JSON, which
+// chrome://tracing and Perfetto open.
+//
+// Off by default. A disabled span costs one relaxed load and a branch; a thread's ring is only
+// allocated by its first span after tracing is turned on.
+namespace Trace {
+	constexpr size_t RING_SIZE = 16384;     // Spans kept per thread, power of two
+
+	struct Event {
+		const char* name;
+		uint32_t arg;       // Shown as args.value, e.g. the window message
+		int64_t start;      // QPC ticks
+		int64_t end;
+	};
+
+	class Ring {
+	public:
+		Ring(DWORD threadId, const char* threadName) : m_threadId(threadId), m_threadName(threadName) {}
+
+		Ring(const Ring&) = delete;
+		Ring& operator=(const Ring&) = delete;
+
+		// Owner thread only
+		void Write(const char* name, uint32_t arg, int64_t start, int64_t end) {
+			uint64_t index = m_written.load(std::memory_order_relaxed);
+			Event& event = m_events[index & (RING_SIZE - 1)];
+			event.name = name;
+			event.arg = arg;
+			event.start = start;
+			event.end = end;
+			m_written.store(index + 1, std::memory_order_release);
+		}
+
+		// Appends the spans still in the ring, oldest first. The owner may keep writing meanwhile;
+		// anything it could have overwritten during the copy is dropped rather than reported torn.
+		void Snapshot(std::vector<Event>& out) const {
+			uint64_t written = m_written.load(std::memory_order_acquire);
+			uint64_t first = written > RING_SIZE ? written - RING_SIZE : 0;
+			size_t base = out.size();
+			for (uint64_t i = first; i < written; i++) {
+				out.push_back(m_events[i & (RING_SIZE - 1)]);
+			}
+
+			uint64_t after = m_written.load(std::memory_order_acquire);
+			uint64_t safe = after > RING_SIZE ? after - RING_SIZE : 0;
+			if (safe > first) {
+				uint64_t torn = safe - first < written - first ? safe - first : written - first;
+				out.erase(out.begin() + base, out.begin() + base + static_cast<size_t>(torn));
+			}
+		}
+
+		DWORD ThreadId() const { return m_threadId; }
+		const char* ThreadName() const { return m_threadName; }
+
+	private:
+		DWORD m_threadId;
+		const char* m_threadName;
+		std::atomic<uint64_t> m_written{ 0 };
+		Event m_events[RING_SIZE];
+	};
+
+	// Every ring ever created; rings live until exit so a finished thread's spans still export
+	struct Registry {
+		SRWLOCK lock = SRWLOCK_INIT;
+		std::vector<std::unique_ptr<Ring>> rings;
+		std::atomic<bool> enabled{ false };
+		int64_t origin = 0;                 // QPC when tracing was first enabled, time zero in the export
+		int64_t ticksPerSecond = 1;
+	};
+
+	inline Registry& GetRegistry() {
+		static Registry registry;
+		return registry;
+	}
+
+	inline bool IsEnabled() {
+		return GetRegistry().enabled.load(std::memory_order_relaxed);
+	}
+
+	inline void Enable(bool enable) {
+		Registry& registry = GetRegistry();
+		if (enable && registry.origin == 0) {
+			LARGE_INTEGER now, freq;
+			QueryPerformanceCounter(&now);
+			QueryPerformanceFrequency(&freq);
+			registry.origin = now.QuadPart;
+			registry.ticksPerSecond = freq.QuadPart;
+		}
+		registry.enabled.store(enable, std::memory_order_relaxed);
+	}
+
+	// Label for the calling thread in the export, must outlive the trace (string literal)
+	inline const char*& ThreadName() {
+		static thread_local const char* name = nullptr;
+		return name;
+	}
+
+	inline Ring& ThisRing() {
+		static thread_local Ring* pRing = nullptr;
+		if (!pRing) {
+			Registry& registry = GetRegistry();
+			std::unique_ptr<Ring> ring(new Ring(GetCurrentThreadId(), ThreadName()));
+			pRing = ring.get();
+			AcquireSRWLockExclusive(&registry.lock);
+			registry.rings.push_back(std::move(ring));
+			ReleaseSRWLockExclusive(&registry.lock);
+		}
+		return *pRing;
+	}
+
+	// Records the enclosing scope as one span
+	class Span {
+	public:
+		explicit Span(const char* name, uint32_t arg = 0) {
+			if (IsEnabled()) {
+				m_name = name;
+				m_arg = arg;
+				QueryPerformanceCounter(&m_start);
+			}
+		}
+
+		~Span() {
+			if (m_name) {
+				LARGE_INTEGER end;
+				QueryPerformanceCounter(&end);
+				ThisRing().Write(m_name, m_arg, m_start.QuadPart, end.QuadPart);
+			}
+		}
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		const char* m_name = nullptr;
+		uint32_t m_arg = 0;
+		LARGE_INTEGER m_start;
+	};
+
+	// Chrome trace event JSON ("X" complete events in microseconds plus thread names)
+	inline bool WriteChromeJson(const std::wstring& path) {
+		Registry& registry = GetRegistry();
+		FILE* pFile = nullptr;
+		if (_wfopen_s(&pFile, path.c_str(), L"wb") != 0 || !pFile) return false;
+
+		DWORD processId = GetCurrentProcessId();
+		double microsPerTick = 1e6 / static_cast<double>(registry.ticksPerSecond);
+		std::vector<Event> events;
+		bool first = true;
+
+		fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", pFile);
+		AcquireSRWLockShared(&registry.lock);
+		for (const auto& ring : registry.rings) {
+			if (ring->ThreadName()) {
+				fprintf(pFile, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+					first ? "" : ",", processId, ring->ThreadId(), ring->ThreadName());
+				first = false;
+			}
+
+			events.clear();
+			ring->Snapshot(events);
+			for (const Event& event : events) {
+				fprintf(pFile, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"value\":%u}}",
+					first ? "" : ",", event.name, processId, ring->ThreadId(),
+					static_cast<double>(event.start - registry.origin) * microsPerTick,
+					static_cast<double>(event.end - event.start) * microsPerTick, event.arg);
+				first = false;
+			}
+		}
+		ReleaseSRWLockShared(&registry.lock);
+		fputs("\n]}\n", pFile);
+
+		return fclose(pFile) == 0;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "RenderThread.h"
+
+// What waiting in the tray does to the window. The app implements it with the notification area
+// icon, ShowWindow and its Direct2D and DirectWrite resources; tests implement it with a fake.
+class TrayHost {
+public:
+	virtual ~TrayHost() = default;
+
+	// False if the notification area is unavailable
+	virtual bool AddTrayIcon() = 0;
+	virtual void RemoveTrayIcon() = 0;
+
+	virtual void HideWindow() = 0;
+	virtual void MinimizeWindow() = 0;
+	virtual void RestoreWindow(int showCommand) = 0;
+
+	// Everything the UI thread holds for drawing, after the render thread released its own
+	virtual void ReleaseDrawing() = 0;
+	// And back, before the render thread draws again
+	virtual void PrepareDrawing() = 0;
+};
+
+// Tray-only waiting: the window is hidden behind a notification area icon, with the render thread
+// and everything drawing holds released until it is restored. Keeps the order these happen in,
+// which is what a restored window depends on to draw again.
+class Tray {
+public:
+	Tray(TrayHost& host, RenderThread& renderThread) : m_host(host), m_renderThread(renderThread) {}
+
+	bool InTray() const {
+		return m_bInTray;
+	}
+
+	// Minimizes instead if the tray isn't available, e.g. in replay, or the icon can't be added
+	void Enter(bool available) {
+		if (m_bInTray) return;
+		if (!available || !m_host.AddTrayIcon()) {
+			m_host.MinimizeWindow();
+			return;
+		}
+
+		m_bInTray = true;
+		m_host.HideWindow();
+
+		// The render thread releases its device resources as it exits
+		m_renderThread.Stop();
+		m_host.ReleaseDrawing();
+	}
+
+	// False if the render thread didn't start again, the caller draws frames itself then
+	bool Leave(int showCommand) {
+		if (!m_bInTray) return true;
+		m_bInTray = false;
+		m_host.RemoveTrayIcon();
+
+		// Ready before the window shows, its first paint draws a frame
+		m_host.PrepareDrawing();
+		bool started = m_renderThread.Start();
+		m_host.RestoreWindow(showCommand);
+		return started;
+	}
+
+	// The window is going, it is not restored
+	void Close() {
+		m_renderThread.Stop();
+		if (!m_bInTray) return;
+		m_host.RemoveTrayIcon();
+		m_bInTray = false;
+	}
+
+private:
+	TrayHost& m_host;
+	RenderThread& m_renderThread;
+	bool m_bInTray = false;
+};
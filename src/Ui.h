@@ -0,0 +1,443 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cwchar>
+#include <ctime>
+#include "Schedule.h"
+
+// Everything about the main window that doesn't need Win32 or Direct2D: app state, layout,
+// hit testing, labels, and what the content area draws where. The window supplies a
+// TextMeasurer and a Canvas backed by DirectWrite and Direct2D; Headless.h has recording ones,
+// so layout and drawing can be exercised and profiled without a window or a GPU.
+//
+// All coordinates are DIPs. The title bar belongs to the window and is not drawn here.
+namespace Ui {
+	enum class AppState {
+		Idle,       // No target selected
+		Ready,      // Target selected, ready to start
+		Waiting     // Timer is running
+	};
+
+	struct Rect {
+		float left;
+		float top;
+		float right;
+		float bottom;
+
+		bool Contains(float x, float y) const {
+			return x >= left && x <= right && y >= top && y <= bottom;
+		}
+	};
+
+	enum class TextStyle {
+		Paragraph,      // Wrapped, leading aligned
+		Button,         // Centered
+		Bold,           // Centered
+		BoldLeft,       // Leading aligned, vertically centered
+		Icon            // Segoe MDL2 glyph, centered
+	};
+
+	enum class Color {
+		Background,
+		Text,
+		Button,
+		ButtonHover,
+		Green,
+		GreenHover,
+		Red,
+		RedHover,
+		Amber
+	};
+
+	class TextMeasurer {
+	public:
+		virtual ~TextMeasurer() = default;
+
+		// Size of the text laid out at maxWidth, false if it couldn't be measured
+		virtual bool Measure(const wchar_t* text, TextStyle style, float maxWidth, float& width, float& height) = 0;
+	};
+
+	class Canvas {
+	public:
+		virtual ~Canvas() = default;
+
+		virtual void FillRect(const Rect& rect, Color color, float opacity = 1.0f) = 0;
+		virtual void DrawRect(const Rect& rect, Color color, float strokeWidth) = 0;
+		virtual void DrawText(const wchar_t* text, TextStyle style, const Rect& rect, Color color) = 0;
+	};
+
+	// Layout constants
+	constexpr float TITLEBAR_HEIGHT = 40.0f;
+	constexpr float WINDOW_MARGIN = 25.0f;
+	constexpr float ELEMENT_SPACING = 16.0f;
+	constexpr float LINE_SPACING = 1.5f;
+
+	// Button dimensions
+	constexpr float TARGET_BUTTON_HEIGHT = 54.0f;
+	constexpr float START_BUTTON_HEIGHT = 46.0f;
+	constexpr float HOUR_BUTTON_MIN_WIDTH = 64.0f;
+	constexpr float HOUR_BUTTON_HEIGHT = 32.0f;
+	constexpr float HOUR_BUTTON_SPACING = 10.0f;
+	constexpr float BUTTON_TEXT_PADDING = 8.0f;
+	constexpr float BUTTON_TEXT_PADDING_V = 4.0f;
+	constexpr float BORDER_WIDTH = 1.0f;
+
+	// Font sizes
+	constexpr float MAIN_FONT_SIZE = 16.0f;
+	constexpr float TITLE_FONT_SIZE = 15.0f;
+
+	constexpr int HOUR_COUNT = 5;
+	constexpr size_t HOUR_LABEL_SIZE = 8;
+	constexpr size_t COUNTDOWN_TEXT_SIZE = 32;
+	constexpr size_t TARGET_NAME_SIZE = 260;
+	constexpr size_t TARGET_DETAIL_SIZE = 256;
+
+	// Measured height of a paragraph that couldn't be measured
+	constexpr float FALLBACK_TEXT_HEIGHT = 20.0f;
+
+	constexpr const wchar_t* INSTRUCTION_TEXT = L"Resume message will be sent to the application identified below. Click the target button and then click on the target application, or press ESC to cancel. Press TAB to search for the target by name instead.";
+	constexpr const wchar_t* TAB_INFO_TEXT = L"The resume message will be sent to the application. If your application has a tabbed interface then make sure the correct tab is active.";
+	constexpr const wchar_t* START_INFO_TEXT = L"Click start button below to activate the resumer. When the limit reset time occurs the resume message will be sent to the selected application. If you close the target application before the timer expires the timer will be stopped.";
+	constexpr const wchar_t* ICON_PLAY = L"\uE768";
+	constexpr const wchar_t* BTN_TARGET_CAPTURE = L"Click on target window, TAB to search or ESC to cancel";
+	constexpr const wchar_t* BTN_TARGET_SELECT = L"Click to select target window";
+	constexpr const wchar_t* BTN_TARGET_LOST = L"Target application closed, click to select a new target";
+	constexpr const wchar_t* BTN_START_CLICK = L" Click to start";
+
+	// Start button icon and label, centered together
+	struct StartButtonMeasurements {
+		float iconWidth;
+		float textWidth;
+		float totalWidth;
+		float startX;
+	};
+
+	// All the layout
+	struct Layout {
+		// Content positioning
+		float clientWidth = 0;
+		float contentTop = 0;
+		float textWidth = 0;
+		float spacing = 0;
+
+		// Text blocks with positions and heights
+		struct TextBlock {
+			Rect rect;
+			float height;
+		};
+
+		TextBlock instructionText{};
+		TextBlock tabInfoText{};
+		TextBlock startInfoText{};
+
+		// Button rectangles
+		Rect targetButtonRect{};
+		Rect startButtonRect{};
+		Rect hourButtonRects[HOUR_COUNT]{};
+
+		// Start button detailed measurements
+		StartButtonMeasurements startButtonMeasurements{};
+
+		// Total calculated height
+		float totalContentHeight = 0;
+
+		// Validity flag
+		bool isValid = false;
+	};
+
+	// What a content-area point is over
+	enum class Hit {
+		None,
+		TargetButton,
+		StartButton,
+		HourButton
+	};
+
+	// Everything the content area draws, copied from live state so it can be drawn on another thread
+	struct Frame {
+		AppState appState = AppState::Idle;
+		bool hasTarget = false;
+		bool capturing = false;
+		bool targetLost = false;
+		bool timerActive = false;
+		int selectedHourOffset = 0;
+		float mouseX = -1.0f;       // Outside the window when negative
+		float mouseY = -1.0f;
+		Layout layout;
+		wchar_t targetLabelName[TARGET_NAME_SIZE] = {};
+		wchar_t targetLabelDetail[TARGET_DETAIL_SIZE] = {};
+		wchar_t countdownText[COUNTDOWN_TEXT_SIZE] = {};
+		wchar_t hourLabels[HOUR_COUNT][HOUR_LABEL_SIZE] = {};
+	};
+
+	inline AppState GetAppState(bool hasTarget, bool timerActive) {
+		if (timerActive) {
+			return AppState::Waiting;
+		}
+		else if (hasTarget) {
+			return AppState::Ready;
+		}
+		else {
+			return AppState::Idle;
+		}
+	}
+
+	inline float MeasureHeight(TextMeasurer& measurer, const wchar_t* text, TextStyle style, float width) {
+		float measuredWidth, height;
+		if (!measurer.Measure(text, style, width, measuredWidth, height)) return FALLBACK_TEXT_HEIGHT;
+		return height;
+	}
+
+	inline StartButtonMeasurements MeasureStartButton(TextMeasurer& measurer, const Rect& textRect) {
+		StartButtonMeasurements measurements = {};
+
+		float height;
+		if (!measurer.Measure(ICON_PLAY, TextStyle::Icon, 1000.0f, measurements.iconWidth, height)) {
+			measurements.iconWidth = 0.0f;
+		}
+		if (!measurer.Measure(BTN_START_CLICK, TextStyle::Bold, 1000.0f, measurements.textWidth, height)) {
+			measurements.textWidth = 0.0f;
+		}
+
+		measurements.totalWidth = measurements.iconWidth + measurements.textWidth;
+		float buttonWidth = textRect.right - textRect.left;
+		measurements.startX = textRect.left + (buttonWidth - measurements.totalWidth) / 2.0f;
+
+		return measurements;
+	}
+
+	// Lays the content out for a client width. Only the width drives layout, so this returns
+	// false without touching the measurer when it is already laid out at that width.
+	inline bool ComputeLayout(float clientWidth, TextMeasurer& measurer, Layout& layout) {
+		if (layout.isValid && layout.clientWidth == clientWidth) return false;
+
+		// Reset validity
+		layout.isValid = false;
+
+		// Setup basic layout parameters
+		layout.clientWidth = clientWidth;
+		layout.contentTop = WINDOW_MARGIN + TITLEBAR_HEIGHT;
+		layout.textWidth = clientWidth - (2 * WINDOW_MARGIN);
+		layout.spacing = ELEMENT_SPACING;
+
+		float currentY = layout.contentTop;
+		float margin = WINDOW_MARGIN;
+		float textWidth = layout.textWidth;
+		float spacing = layout.spacing;
+
+		// Instruction text block
+		layout.instructionText.height = MeasureHeight(measurer, INSTRUCTION_TEXT, TextStyle::Paragraph, textWidth);
+		layout.instructionText.rect = Rect{ margin, currentY, margin + textWidth, currentY + layout.instructionText.height };
+		currentY += layout.instructionText.height + spacing;
+
+		// Target button
+		layout.targetButtonRect = Rect{ margin, currentY, margin + textWidth, currentY + TARGET_BUTTON_HEIGHT };
+		currentY += TARGET_BUTTON_HEIGHT + spacing;
+
+		// Tab info text block
+		layout.tabInfoText.height = MeasureHeight(measurer, TAB_INFO_TEXT, TextStyle::Paragraph, textWidth);
+		layout.tabInfoText.rect = Rect{ margin, currentY, margin + textWidth, currentY + layout.tabInfoText.height };
+		currentY += layout.tabInfoText.height + spacing;
+
+		// Hour buttons, sharing the content width
+		float hourButtonWidth = (textWidth - (HOUR_COUNT - 1) * HOUR_BUTTON_SPACING) / HOUR_COUNT;
+		for (int i = 0; i < HOUR_COUNT; i++) {
+			float buttonX = margin + i * (hourButtonWidth + HOUR_BUTTON_SPACING);
+			layout.hourButtonRects[i] = Rect{ buttonX, currentY, buttonX + hourButtonWidth, currentY + HOUR_BUTTON_HEIGHT };
+		}
+		currentY += HOUR_BUTTON_HEIGHT + spacing;
+
+		// Start info text block
+		layout.startInfoText.height = MeasureHeight(measurer, START_INFO_TEXT, TextStyle::Paragraph, textWidth);
+		layout.startInfoText.rect = Rect{ margin, currentY, margin + textWidth, currentY + layout.startInfoText.height };
+		currentY += layout.startInfoText.height + spacing;
+
+		// Start button and its detailed measurements
+		layout.startButtonRect = Rect{ margin, currentY, margin + textWidth, currentY + START_BUTTON_HEIGHT };
+		layout.startButtonMeasurements = MeasureStartButton(measurer, layout.startButtonRect);
+
+		currentY += START_BUTTON_HEIGHT + WINDOW_MARGIN; // Bottom margin
+
+		layout.totalContentHeight = currentY;
+		layout.isValid = true;
+		return true;
+	}
+
+	// Layout must be valid. hour is set for HourButton.
+	inline Hit HitTest(const Layout& layout, float x, float y, int& hour) {
+		if (layout.targetButtonRect.Contains(x, y)) return Hit::TargetButton;
+		if (layout.startButtonRect.Contains(x, y)) return Hit::StartButton;
+		for (int i = 0; i < HOUR_COUNT; i++) {
+			if (layout.hourButtonRects[i].Contains(x, y)) {
+				hour = i;
+				return Hit::HourButton;
+			}
+		}
+		return Hit::None;
+	}
+
+	// When timer is running we show the countdown on the start button
+	template<size_t N>
+	void FormatCountdown(const Clock& clock, Clock::time_point target, wchar_t (&text)[N]) {
+		text[0] = L'\0';
+		auto remaining = std::chrono::duration_cast<std::chrono::seconds>(target - clock.Now());
+
+		if (remaining.count() > 0) {
+			int hours = static_cast<int>(remaining.count() / 3600);
+			int minutes = static_cast<int>((remaining.count() % 3600) / 60);
+			int seconds = static_cast<int>(remaining.count() % 60);
+
+			swprintf(text, N, L"Resuming in %02d:%02d:%02d", hours, minutes, seconds);
+		}
+	}
+
+	// Hours buttons text, formatted in place
+	inline void FormatHourLabels(const Clock& clock, wchar_t (&labels)[HOUR_COUNT][HOUR_LABEL_SIZE]) {
+		// Get the start of the next hour
+		auto nextHour = Schedule::NextHourStart(clock);
+
+		// Generate hour times starting from next hour
+		for (int i = 0; i < HOUR_COUNT; i++) {
+			auto futureTime = nextHour + std::chrono::hours(i);
+			struct tm future_tm;
+			clock.ToLocal(futureTime, future_tm);
+
+			// Format as 12-hour with am/pm
+			int hour12 = future_tm.tm_hour % 12;
+			if (hour12 == 0) hour12 = 12; // Handle 12am/12pm
+
+			swprintf(labels[i], HOUR_LABEL_SIZE, L"%d%ls", hour12, future_tm.tm_hour >= 12 ? L"pm" : L"am");
+		}
+	}
+
+	inline bool IsHovered(const Frame& frame, const Rect& rect) {
+		if (frame.mouseX < 0 || frame.mouseY < 0) return false;
+		return rect.Contains(frame.mouseX, frame.mouseY);
+	}
+
+	// Button text for either start or target, a selected target is drawn from its prebuilt label
+	inline const wchar_t* GetButtonText(const Frame& frame, bool isTargetButton, bool isStartButton) {
+		if (isTargetButton) {
+			if (frame.capturing) {
+				return BTN_TARGET_CAPTURE;
+			}
+			else if (frame.targetLost) {
+				return BTN_TARGET_LOST;
+			}
+			else {
+				return BTN_TARGET_SELECT;
+			}
+		}
+		else if (isStartButton) {
+			if (frame.timerActive) {
+				return frame.countdownText;
+			}
+			else {
+				return BTN_START_CLICK;
+			}
+		}
+		return L"";
+	}
+
+	// Draws either start or target button
+	inline void DrawButton(const Frame& frame, Canvas& canvas, const Rect& rect, bool isTargetButton, bool isStartButton) {
+		bool isHovered = IsHovered(frame, rect);
+
+		// Choose button colors
+		Color buttonColor = Color::Button;
+		Color textColor = Color::Text;
+
+		// While picking, the button prompts for the new target even though the current one is kept
+		bool showTarget = frame.hasTarget && !frame.capturing;
+		if (isTargetButton) {
+			if (showTarget) {
+				buttonColor = Color::Background;
+				textColor = Color::Green;
+			}
+			else {
+				buttonColor = isHovered ? Color::ButtonHover : Color::Background;
+				textColor = Color::Amber;
+			}
+		}
+		else if (isStartButton) {
+			switch (frame.appState) {
+			case AppState::Waiting:
+				buttonColor = isHovered ? Color::RedHover : Color::Red;
+				textColor = Color::Background;
+				break;
+			case AppState::Ready:
+				buttonColor = isHovered ? Color::GreenHover : Color::Green;
+				textColor = Color::Background;
+				break;
+			case AppState::Idle:
+			default:
+				buttonColor = Color::Background;
+				textColor = Color::Button;
+				break;
+			}
+		}
+
+		canvas.FillRect(rect, buttonColor);
+
+		// Border for target button
+		if (isTargetButton) {
+			canvas.DrawRect(rect, showTarget ? Color::Green : Color::Amber, BORDER_WIDTH);
+		}
+
+		Rect textRect{
+			rect.left + BUTTON_TEXT_PADDING, rect.top + BUTTON_TEXT_PADDING_V,
+			rect.right - BUTTON_TEXT_PADDING, rect.bottom - BUTTON_TEXT_PADDING_V };
+
+		if (isTargetButton && showTarget && frame.targetLabelName[0]) {
+			// Process name over the window title
+			float lineHeight = (textRect.bottom - textRect.top) / 2.0f;
+			Rect firstLineRect{ textRect.left, textRect.top, textRect.right, textRect.top + lineHeight };
+			Rect secondLineRect{ textRect.left, textRect.top + lineHeight, textRect.right, textRect.bottom };
+
+			canvas.DrawText(frame.targetLabelName, TextStyle::Bold, firstLineRect, textColor);
+			canvas.DrawText(frame.targetLabelDetail, TextStyle::Button, secondLineRect, textColor);
+		}
+		else if (isStartButton && !frame.timerActive) {
+			// Start button with icon + text
+			const StartButtonMeasurements& measurements = frame.layout.startButtonMeasurements;
+
+			Rect iconRect{ measurements.startX, textRect.top, measurements.startX + measurements.iconWidth, textRect.bottom };
+			canvas.DrawText(ICON_PLAY, TextStyle::Icon, iconRect, textColor);
+
+			// Text right after icon
+			Rect mainTextRect{ measurements.startX + measurements.iconWidth, textRect.top, textRect.right, textRect.bottom };
+			canvas.DrawText(BTN_START_CLICK, TextStyle::BoldLeft, mainTextRect, textColor);
+		}
+		else {
+			canvas.DrawText(GetButtonText(frame, isTargetButton, isStartButton),
+				isStartButton ? TextStyle::Bold : TextStyle::Button, textRect, textColor);
+		}
+	}
+
+	// Draw all the things below the title bar
+	inline void DrawContent(const Frame& frame, Canvas& canvas) {
+		const Layout& layout = frame.layout;
+
+		canvas.DrawText(INSTRUCTION_TEXT, TextStyle::Paragraph, layout.instructionText.rect, Color::Text);
+		DrawButton(frame, canvas, layout.targetButtonRect, true, false);
+		canvas.DrawText(TAB_INFO_TEXT, TextStyle::Paragraph, layout.tabInfoText.rect, Color::Text);
+
+		for (int i = 0; i < HOUR_COUNT; i++) {
+			const Rect& buttonRect = layout.hourButtonRects[i];
+			bool selected = i == frame.selectedHourOffset;
+
+			canvas.FillRect(buttonRect, selected ? Color::Green : Color::Button);
+
+			// Green hover tint, only if not already selected
+			if (!selected && IsHovered(frame, buttonRect)) {
+				canvas.FillRect(buttonRect, Color::Green, 0.3f);
+			}
+
+			canvas.DrawText(frame.hourLabels[i], TextStyle::Button, buttonRect, selected ? Color::Background : Color::Text);
+		}
+
+		canvas.DrawText(START_INFO_TEXT, TextStyle::Paragraph, layout.startInfoText.rect, Color::Text);
+		DrawButton(frame, canvas, layout.startButtonRect, false, true);
+	}
+}
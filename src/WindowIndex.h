@@ -0,0 +1,296 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <unordered_map>
+#include <functional>
+
+// Live index of candidate top-level windows. Populated once at start and then kept current
+// from WinEvent notifications (create/destroy/show/hide/name change), never by polling.
+class WindowIndex {
+public:
+	struct ProcessInfo {
+		std::wstring name;      // Executable name without extension
+		int windowCount = 0;    // Entries referencing this process
+	};
+
+	struct Entry {
+		DWORD processId = 0;
+		const ProcessInfo* process = nullptr;
+		std::wstring title;
+	};
+
+	enum class Change {
+		Added,
+		Hidden,
+		Destroyed,
+		TitleChanged
+	};
+
+	// Cost of keeping the index current
+	struct Stats {
+		ULONGLONG eventCount = 0;       // WinEvents applied to the index
+		ULONGLONG eventTicks = 0;       // QPC ticks spent applying them
+		ULONGLONG maxEventTicks = 0;    // Slowest single event
+		ULONGLONG ticksPerSecond = 1;
+		size_t windowCount = 0;
+		size_t processCount = 0;
+		size_t approxBytes = 0;         // Entries, strings and hash nodes
+	};
+
+	using Listener = std::function<void(HWND, Change)>;
+
+	WindowIndex() {
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		m_stats.ticksPerSecond = static_cast<ULONGLONG>(freq.QuadPart);
+	}
+
+	~WindowIndex() {
+		Stop();
+	}
+
+	WindowIndex(const WindowIndex&) = delete;
+	WindowIndex& operator=(const WindowIndex&) = delete;
+
+	// Hooks are out-of-context so events arrive on the calling thread's message loop
+	bool Start() {
+		if (m_hLifetimeHook) return true;
+
+		s_pInstance = this;
+
+		// Two ranges so we don't subscribe to the very chatty location/state events in between
+		m_hLifetimeHook = SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_HIDE, nullptr,
+			WinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+		m_hNameHook = SetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, nullptr,
+			WinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+
+		if (!m_hLifetimeHook || !m_hNameHook) {
+			Stop();
+			return false;
+		}
+
+		// One-time seed, everything after this is incremental
+		EnumWindows(EnumWindowsProc, reinterpret_cast<LPARAM>(this));
+		return true;
+	}
+
+	void Stop() {
+		if (m_hLifetimeHook) {
+			UnhookWinEvent(m_hLifetimeHook);
+			m_hLifetimeHook = nullptr;
+		}
+		if (m_hNameHook) {
+			UnhookWinEvent(m_hNameHook);
+			m_hNameHook = nullptr;
+		}
+		m_entries.clear();
+		m_processes.clear();
+		if (s_pInstance == this) {
+			s_pInstance = nullptr;
+		}
+	}
+
+	void SetListener(Listener listener) {
+		m_listener = std::move(listener);
+	}
+
+	const Entry* Find(HWND hWnd) const {
+		auto it = m_entries.find(hWnd);
+		return it != m_entries.end() ? &it->second : nullptr;
+	}
+
+	template<class Fn>
+	void ForEach(Fn fn) const {
+		for (const auto& item : m_entries) {
+			fn(item.first, item.second);
+		}
+	}
+
+	size_t Size() const { return m_entries.size(); }
+
+	// Name for a process that may not own an indexed window (e.g. owned popups)
+	std::wstring LookupProcessName(DWORD processId) {
+		auto it = m_processes.find(processId);
+		if (it != m_processes.end()) {
+			return it->second.name;
+		}
+		return QueryProcessName(processId);
+	}
+
+	Stats GetStats() const {
+		Stats stats = m_stats;
+		stats.windowCount = m_entries.size();
+		stats.processCount = m_processes.size();
+
+		// Hash nodes carry the key/value pair plus a next pointer and cached hash
+		constexpr size_t nodeOverhead = 2 * sizeof(void*);
+		size_t bytes = m_entries.bucket_count() * sizeof(void*) + m_processes.bucket_count() * sizeof(void*);
+		for (const auto& item : m_entries) {
+			bytes += sizeof(item) + nodeOverhead + item.second.title.capacity() * sizeof(wchar_t);
+		}
+		for (const auto& item : m_processes) {
+			bytes += sizeof(item) + nodeOverhead + item.second.name.capacity() * sizeof(wchar_t);
+		}
+		stats.approxBytes = bytes;
+		return stats;
+	}
+
+private:
+	HWINEVENTHOOK m_hLifetimeHook = nullptr;
+	HWINEVENTHOOK m_hNameHook = nullptr;
+	std::unordered_map<HWND, Entry> m_entries;
+	std::unordered_map<DWORD, ProcessInfo> m_processes;
+	Listener m_listener;
+	Stats m_stats;
+
+	static constexpr int TITLE_BUFFER_SIZE = 256;
+
+	// WinEvent callbacks carry no user context
+	static WindowIndex* s_pInstance;
+
+	static void CALLBACK WinEventProc(HWINEVENTHOOK, DWORD event, HWND hWnd, LONG idObject, LONG idChild, DWORD, DWORD) {
+		if (!s_pInstance || !hWnd || idObject != OBJID_WINDOW || idChild != CHILDID_SELF) return;
+		s_pInstance->OnWinEvent(event, hWnd);
+	}
+
+	static BOOL CALLBACK EnumWindowsProc(HWND hWnd, LPARAM lParam) {
+		WindowIndex* pIndex = reinterpret_cast<WindowIndex*>(lParam);
+		if (pIndex->IsCandidate(hWnd)) {
+			pIndex->Add(hWnd, false);
+		}
+		return TRUE;
+	}
+
+	void OnWinEvent(DWORD event, HWND hWnd) {
+		LARGE_INTEGER start;
+		QueryPerformanceCounter(&start);
+
+		switch (event) {
+		case EVENT_OBJECT_CREATE:
+		case EVENT_OBJECT_SHOW:
+			if (m_entries.find(hWnd) == m_entries.end() && IsCandidate(hWnd)) {
+				Add(hWnd, true);
+			}
+			break;
+		case EVENT_OBJECT_DESTROY:
+			Remove(hWnd, Change::Destroyed);
+			break;
+		case EVENT_OBJECT_HIDE:
+			Remove(hWnd, Change::Hidden);
+			break;
+		case EVENT_OBJECT_NAMECHANGE:
+			UpdateTitle(hWnd);
+			break;
+		}
+
+		LARGE_INTEGER end;
+		QueryPerformanceCounter(&end);
+		ULONGLONG ticks = static_cast<ULONGLONG>(end.QuadPart - start.QuadPart);
+		m_stats.eventCount++;
+		m_stats.eventTicks += ticks;
+		if (ticks > m_stats.maxEventTicks) {
+			m_stats.maxEventTicks = ticks;
+		}
+	}
+
+	// Visible, unowned top-level windows that a user could sensibly target
+	static bool IsCandidate(HWND hWnd) {
+		if (GetAncestor(hWnd, GA_ROOT) != hWnd) return false;
+		if (!IsWindowVisible(hWnd)) return false;
+		if (GetWindow(hWnd, GW_OWNER) != nullptr) return false;
+		if (GetWindowLongW(hWnd, GWL_EXSTYLE) & WS_EX_TOOLWINDOW) return false;
+		return true;
+	}
+
+	void Add(HWND hWnd, bool notify) {
+		DWORD processId = 0;
+		GetWindowThreadProcessId(hWnd, &processId);
+		if (processId == 0 || processId == GetCurrentProcessId()) return;
+
+		ProcessInfo& process = AcquireProcess(processId);
+
+		Entry& entry = m_entries[hWnd];
+		entry.processId = processId;
+		entry.process = &process;
+		entry.title = ReadTitle(hWnd);
+
+		if (notify && m_listener) {
+			m_listener(hWnd, Change::Added);
+		}
+	}
+
+	void Remove(HWND hWnd, Change change) {
+		auto it = m_entries.find(hWnd);
+		if (it == m_entries.end()) return;
+
+		ReleaseProcess(it->second.processId);
+		m_entries.erase(it);
+
+		if (m_listener) {
+			m_listener(hWnd, change);
+		}
+	}
+
+	void UpdateTitle(HWND hWnd) {
+		auto it = m_entries.find(hWnd);
+		if (it == m_entries.end()) return;
+
+		std::wstring title = ReadTitle(hWnd);
+		if (title == it->second.title) return;
+		it->second.title.swap(title);
+
+		if (m_listener) {
+			m_listener(hWnd, Change::TitleChanged);
+		}
+	}
+
+	ProcessInfo& AcquireProcess(DWORD processId) {
+		auto it = m_processes.find(processId);
+		if (it == m_processes.end()) {
+			it = m_processes.emplace(processId, ProcessInfo{ QueryProcessName(processId), 0 }).first;
+		}
+		it->second.windowCount++;
+		return it->second;
+	}
+
+	void ReleaseProcess(DWORD processId) {
+		auto it = m_processes.find(processId);
+		if (it != m_processes.end() && --it->second.windowCount <= 0) {
+			m_processes.erase(it);
+		}
+	}
+
+	// InternalGetWindowText doesn't send WM_GETTEXT, so a hung window can't stall the event handler
+	static std::wstring ReadTitle(HWND hWnd) {
+		wchar_t buffer[TITLE_BUFFER_SIZE];
+		int length = InternalGetWindowText(hWnd, buffer, TITLE_BUFFER_SIZE);
+		return std::wstring(buffer, length > 0 ? length : 0);
+	}
+
+	static std::wstring QueryProcessName(DWORD processId) {
+		std::wstring name;
+		HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+		if (!hProcess) return name;
+
+		wchar_t path[MAX_PATH];
+		DWORD length = MAX_PATH;
+		if (QueryFullProcessImageNameW(hProcess, 0, path, &length)) {
+			name.assign(path, length);
+
+			// Strip directory and .exe extension
+			size_t slash = name.find_last_of(L"\\/");
+			if (slash != std::wstring::npos) {
+				name.erase(0, slash + 1);
+			}
+			size_t dot = name.rfind(L'.');
+			if (dot != std::wstring::npos && _wcsicmp(name.c_str() + dot, L".exe") == 0) {
+				name.erase(dot);
+			}
+		}
+		CloseHandle(hProcess);
+		return name;
+	}
+};
+
+__declspec(selectany) WindowIndex* WindowIndex::s_pInstance = nullptr;
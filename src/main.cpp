@@ -1,36 +1,198 @@
 #include <windows.h>
-#include <tlhelp32.h>
 #include <windowsx.h>
 #include <string>
-#include <sstream>
-#include <iomanip>
 #include <chrono>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <d2d1.h>
 #include <dwrite.h>
 #include <dwmapi.h>
+#include <psapi.h>
 #include "resource.h"
+#include "WindowIndex.h"
+#include "EventLoop.h"
+#include "SharedSchedule.h"
+#include "Schedule.h"
+#include "MessageTrace.h"
+#include "AllocationCounter.h"
+#include "AllocationHooks.h"
+#include "TextMeasureCache.h"
+#include "SnapshotBuffer.h"
+#include "RenderThread.h"
+#include "Tray.h"
+#include "PickerOverlay.h"
+#include "TargetSearch.h"
+#include "TargetList.h"
+#include "ProfileStore.h"
+#include "ControlPipe.h"
+#include "ControlCommands.h"
+#include "TmuxControl.h"
+#include "PatternScanner.h"
+#include "Metrics.h"
+#include "MetricsFile.h"
+#include "TraceRing.h"
+#include "Ui.h"
+#include "Keystrokes.h"
+#include "BulkInput.h"
+#include "ResetProvider.h"
 
 #pragma comment(lib, "d2d1.lib")
 #pragma comment(lib, "dwrite.lib")
 #pragma comment(lib, "dwmapi.lib")
+#pragma comment(lib, "psapi.lib")
 
-class ARCCApp {
+class ARCCApp : private ControlTarget, private TrayHost {
 private:
-	enum class AppState {
-		Idle,       // No target selected
-		Ready,      // Target selected, ready to start
-		Waiting     // Timer is running
+	using AppState = Ui::AppState;
+
+	// How a resume message went out
+	enum class Delivery {
+		None,       // Target gone (or replaying)
+		Keystrokes,
+		Clipboard,  // Multi-line or long payload pasted into a window
+		Tmux
 	};
 	HWND m_hTargetWindow;
 	HHOOK m_hInputHook;
 	bool m_bCapturing;
 	bool m_bTimerActive;
 	std::chrono::system_clock::time_point m_targetTime;
-	std::string m_targetWindowTitle;
-	std::string m_targetProcessName;
+
+	// All scheduling decisions read time through the clock so they can run on virtual time
+	SystemClock m_systemClock;
+	const Clock* m_pClock;
+	Scheduler m_scheduler;
+	Scheduler::JobId m_resumeJob = Scheduler::INVALID_JOB;
+
+	// Message trace recording (--record) and replay profiling (--replay)
+	MessageTrace::Writer m_traceWriter;
+	const char* m_replayPath = nullptr;
+	bool m_bReplaying = false;
+
+	// Operational metrics, exported in Prometheus text format to the --metrics file
+	Metrics m_metrics;
+	MetricsFile m_metricsFile;
+	std::wstring m_metricsPath;
+	Metrics::Histogram* m_pResumeLateness = nullptr;
+	Metrics::Histogram* m_pKeystrokeDeliveryTime = nullptr;
+	Metrics::Histogram* m_pClipboardDeliveryTime = nullptr;
+	Metrics::Counter* m_pDeliveredBytes = nullptr;
+	Metrics::Gauge* m_pDeliveryBytesPerSecond = nullptr;
+	Metrics::Histogram* m_pTmuxDeliveryTime = nullptr;
+	Metrics::Histogram* m_pTmuxFirstOutput = nullptr;
+	Metrics::Histogram* m_pTmuxWorking = nullptr;
+	Metrics::Counter* m_pDeliveries = nullptr;
+	Metrics::Counter* m_pDeliveryFailures = nullptr;
+	Metrics::Counter* m_pTimersStarted = nullptr;
+	Metrics::Counter* m_pLoopWakeups = nullptr;
+	Metrics::Gauge* m_pArmedJobs = nullptr;
+	Metrics::Counter* m_pFramesRendered = nullptr;
+	Metrics::Counter* m_pFramesSkipped = nullptr;
+	Metrics::Gauge* m_pRendersPerHour = nullptr;
+	Metrics::Gauge* m_pWorkingSet = nullptr;
+	Metrics::Gauge* m_pTrayOnly = nullptr;
+	Metrics::Counter* m_pResetUpdates = nullptr;
+	Metrics::Histogram* m_pResetRearmTime = nullptr;
+	Metrics::Counter* m_pStatusBytesParsed = nullptr;
+	uint64_t m_lastExportRendered = 0;
+	ULONGLONG m_lastExportTick = 0;
+
+	// QPC ticks the last delivery spent moving the payload itself, after focusing the target
+	LONGLONG m_payloadTicks = 0;
+	InputBatch m_inputBatch;
+
+	// Stages after a resume went to a tmux pane, timed from when it was fired (QPC)
+	LONGLONG m_resumeFiredTicks = 0;
+	bool m_bAwaitingFirstOutput = false;
+	bool m_bAwaitingWorking = false;
+
+	std::wstring m_targetWindowTitle;
+	std::wstring m_targetProcessName;
+
+	// Target button label, rebuilt only when the target or its title changes
+	std::wstring m_targetLabelName;
+	std::wstring m_targetLabelDetail;
+
 	int m_selectedHourOffset = 0;
 
+	// Candidate windows kept current from system events
+	WindowIndex m_windowIndex;
+
+	// Capture highlights the window under the cursor. The hook only records where the cursor went,
+	// the window there is resolved on TIMER_PICKER at most once per display refresh.
+	PickerOverlay m_pickerOverlay;
+	POINT m_pickerCursor = {};
+	bool m_bPickerCursorMoved = false;
+	HWND m_hPickerWindow = nullptr;
+
+	// Keyboard picking (TAB): searchable list over the indexed windows
+	TargetSearch m_targetSearch;
+	TargetList m_targetList;
+
+	// Per-application settings remembered across launches, applied when that application is
+	// picked and saved when a timer is started for it
+	ProfileStore m_profiles;
+	std::wstring m_resumeMessage = RESUME_MESSAGE;
+
+	// Message loop plus kernel handle waits, and the target's process handle registered with it
+	EventLoop m_eventLoop;
+	HANDLE m_hTargetProcess = nullptr;
+
+	// Scripting endpoints, serviced from the event loop (declared after it so they are torn down
+	// first): the session's name, served by the coordinator, and this instance's own by process ID
+	ControlPipe m_controlPipe;
+	ControlPipe m_instancePipe;
+
+	// Schedule shared by every instance in the session. The coordinator holds the deadline, wake
+	// timer and keep-awake for all of them; a member whose job it took (m_bSharedDeadline) holds none.
+	SharedSchedule m_sharedSchedule;
+	bool m_bSharedDeadline = false;
+
+	// tmux control-mode client, started when a pane is bound. With a pane bound the resume message
+	// goes to that pane rather than to whatever tab or pane of the target is active.
+	TmuxControl m_tmux;
+	int64_t m_tmuxPane = -1;
+
+	// Bound pane's output is scanned for the limit message, its reset time, and signs that the
+	// session is working again. Those arm or cancel the timer on their own (m_bAutoArmed).
+	PatternScanner m_outputScanner;
+	PatternScanner::Stream m_paneStream;
+	int m_patternLimit = -1;
+	int m_patternResetAt = -1;
+	int m_patternResets = -1;
+	int m_patternWorking = -1;
+	bool m_bAutoArmed = false;
+	bool m_bCapturingReset = false;
+	uint64_t m_resetTextOffset = 0;     // Stream offset the reset time starts at
+	static constexpr size_t RESET_TEXT_SIZE = 12;   // "12:30 pm" and some slack
+	char m_resetText[RESET_TEXT_SIZE] = {};
+	size_t m_resetTextLength = 0;
+	bool m_bTargetLost = false;
+
+	// Status files the CLI keeps (--watch, or "watch" on the pipe). A reset time in one arms the
+	// timer like one in the pane's output; m_watchPaths are the ones from the command line.
+	std::vector<std::wstring> m_watchPaths;
+	std::vector<std::unique_ptr<ResetProvider>> m_resetProviders;
+	uint64_t m_stoppedStatusBytes = 0;  // Parsed by providers since stopped, keeps the counter rising
+
+	// Power saving mode lets the machine sleep and wakes it shortly before the deadline. The lead
+	// is set with --wake-lead or "lead" on the pipe.
+	bool m_bPowerSaving = false;
+	int m_wakeLeadSeconds = WAKE_LEAD_SECONDS;
+	HANDLE m_hWakeTimer = nullptr;
+
+	// Fires at the resume deadline through the event loop, the countdown display is all the
+	// one second timer is still for
+	HANDLE m_hDeadlineTimer = nullptr;
+	bool m_bKeepingAwake = false;
+
+	// Tray-only waiting: the window is hidden behind a notification area icon, with the render
+	// thread, Direct2D target and text formats released until it is restored
+	Tray m_tray{ *this, m_renderThread };
+	UINT m_taskbarCreatedMessage = 0;   // Explorer restarted, the icon has to be added again
+	wchar_t m_trayTip[64] = {};
+
 	// Theme colors
 	static const D2D1_COLOR_F BG_COLOR;
 	static const D2D1_COLOR_F TEXT_COLOR;
@@ -43,33 +205,25 @@ private:
 	static const D2D1_COLOR_F START_BUTTON_TEXT_COLOR;
 	static const D2D1_COLOR_F TARGET_BUTTON_COLOR;
 	static const D2D1_COLOR_F TITLEBAR_COLOR;
-	static constexpr float TITLEBAR_HEIGHT = 40.0f;
-	static constexpr float LINE_SPACING = 1.5f;
 
-	// Layout constants
-	static constexpr float WINDOW_MARGIN = 25.0f;
-	static constexpr float ELEMENT_SPACING = 16.0f;
+	// Window size, the content layout is in Ui.h
 	static constexpr float WINDOW_WIDTH = 500.0f;
-	static constexpr float CONTENT_WIDTH = 450.0f;
-
-	// Button dimensions
-	static constexpr float TARGET_BUTTON_HEIGHT = 54.0f;
-	static constexpr float START_BUTTON_HEIGHT = 46.0f;
-	static constexpr float HOUR_BUTTON_WIDTH = 80.0f;
-	static constexpr float HOUR_BUTTON_HEIGHT = 32.0f;
-	static constexpr float HOUR_BUTTON_SPACING = 10.0f;
 
-	// Font sizes
-	static constexpr float MAIN_FONT_SIZE = 16.0f;
-	static constexpr float TITLE_FONT_SIZE = 15.0f;
+	// Width can be dragged between these, height always follows the content
+	static constexpr float MIN_WINDOW_WIDTH = 2 * Ui::WINDOW_MARGIN + Ui::HOUR_COUNT * Ui::HOUR_BUTTON_MIN_WIDTH + (Ui::HOUR_COUNT - 1) * Ui::HOUR_BUTTON_SPACING;
+	static constexpr float MAX_WINDOW_WIDTH = 1000.0f;
 
 	// UI constants
-	static constexpr float BUTTON_TEXT_PADDING = 8.0f;
-	static constexpr float BUTTON_TEXT_PADDING_V = 4.0f;
-	static constexpr float BORDER_WIDTH = 1.0f;
 	static constexpr int DPI_REFERENCE = 96;
-	static constexpr int HOUR_COUNT = 5;
 	static constexpr int TITLE_CHAR_LIMIT = 35;
+	static constexpr int APP_ICON_SIZE = 24;
+	static constexpr int WAKE_LEAD_SECONDS = 120;
+	static constexpr int MIN_WAKE_LEAD_SECONDS = 10;    // Resuming from sleep takes a few seconds
+	static constexpr int MAX_WAKE_LEAD_SECONDS = 3600;  // Below the shortest hour button wait
+	static constexpr DWORD PICKER_DEFAULT_REFRESH_RATE = 60;   // Hz, when the display doesn't say
+	static constexpr DWORD OCCLUDED_RECHECK_MS = 1000;  // Covered windows get no paint when uncovered
+	static constexpr UINT WM_TRAY_ICON = WM_APP + 1;
+	static constexpr UINT TRAY_ICON_ID = 1;
 
 	// String constants
 	static constexpr const wchar_t* FONT_SEGOE_UI = L"Segoe UI";
@@ -78,33 +232,52 @@ private:
 	static constexpr const char* APP_WINDOW_TITLE = "ARCC";
 	static constexpr const wchar_t* APP_TITLE_MAIN = L"ARCC";
 	static constexpr const wchar_t* APP_TITLE_SUB = L"Auto Resume CC";
-	static constexpr const wchar_t* INSTRUCTION_TEXT = L"Resume message will be sent to the application identified below. Click the target button and then click on the target application, or press ESC to cancel.";
-	static constexpr const wchar_t* TAB_INFO_TEXT = L"The resume message will be sent to the application. If your application has a tabbed interface then make sure the correct tab is active.";
-	static constexpr const wchar_t* START_INFO_TEXT = L"Click start button below to activate the resumer. When the limit reset time occurs the resume message will be sent to the selected application. If you close the target application before the timer expires the timer will be stopped.";
 	static constexpr const wchar_t* ICON_MINIMIZE = L"\uE949";
 	static constexpr const wchar_t* ICON_CLOSE = L"\uE8BB";
-	static constexpr const wchar_t* ICON_PLAY = L"\uE768";
 	static constexpr const wchar_t* ICON_HELP = L"\uE946";
+	static constexpr const wchar_t* ICON_POWER_SAVING = L"\uE708";
+	static constexpr const wchar_t* TRAY_TIP_FORMAT = L"ARCC - resumes at %02d:%02d";
+	static constexpr const wchar_t* MSG_TASKBAR_CREATED = L"TaskbarCreated";
 	static constexpr const char* HELP_URL = "https://github.com/fjzeit/arcc";
-	static constexpr const char* RESUME_MESSAGE = "RESUME";
-	static constexpr const char* FILE_EXT_EXE = ".exe";
-	static constexpr const char* PROCESS_EXPLORER = "explorer";
-	static constexpr const char* PROCESS_ARCC = "arcc";
+	static constexpr const wchar_t* RESUME_MESSAGE = L"RESUME";
+	static constexpr const wchar_t* PROCESS_EXPLORER = L"explorer";
+	static constexpr const wchar_t* PROCESS_ARCC = L"arcc";
+	static constexpr const char* ARG_RECORD = "--record";
+	static constexpr const char* ARG_REPLAY = "--replay";
+	static constexpr const char* ARG_METRICS = "--metrics";
+	static constexpr const char* ARG_WATCH = "--watch";
+	static constexpr const char* ARG_WAKE_LEAD = "--wake-lead";
+	static constexpr UINT METRICS_INTERVAL_MS = 15000;
+	static constexpr const char* REPLAY_REPORT_EXT = ".report.txt";
+	static constexpr const wchar_t* PROFILE_DIR = L"ARCC";
+	static constexpr const wchar_t* PROFILE_FILE = L"profiles.bin";
+	static constexpr const wchar_t* TRACE_FILE = L"trace.json";
+	static constexpr const wchar_t* CONTROL_PIPE_NAME = L"\\\\.\\pipe\\arcc";
+	static constexpr const wchar_t* CONTROL_PIPE_PID_FORMAT = L"\\\\.\\pipe\\arcc-%lu";
+	static constexpr size_t MAX_PAYLOAD = 0xFFFF - 1;  // What a profile keeps
+	static constexpr DWORD PASTE_SETTLE_MS = 250;      // Terminals read the clipboard after the Ctrl+V
+	static constexpr const wchar_t* TMUX_COMMAND = L"wsl.exe -e tmux -C attach-session";
+	static constexpr const char* PATTERN_LIMIT = "limit reached";
+	static constexpr const char* PATTERN_RESET_AT = "reset at ";
+	static constexpr const char* PATTERN_RESETS = "resets ";
+	static constexpr const char* PATTERN_WORKING = "esc to interrupt";
 
 	// Button text constants
-	static constexpr const wchar_t* BTN_TARGET_CAPTURE = L"Click on target window or ESC to cancel";
-	static constexpr const wchar_t* BTN_TARGET_SELECT = L"Click to select target window";
-	static constexpr const wchar_t* BTN_START_CLICK = L" Click to start";
 	static constexpr const wchar_t* BTN_START_SELECT = L"Select target window";
 	static constexpr const wchar_t* TITLE_NO_TITLE = L"[No Title]";
 	static constexpr const wchar_t* TITLE_ELLIPSIS = L"...";
+	static constexpr wchar_t ZERO_WIDTH_JOINER = 0x200D;
 
 	// Error messages
 	static constexpr const char* ERR_HOOK_FAILED = "Failed to install mouse hook";
+	static constexpr const char* ERR_TRACE_FAILED = "Failed to open message trace";
 	static constexpr const char* ERR_NO_TARGET = "Please select a target window first";
-	static constexpr const char* ERR_TARGET_GONE = "Target window is no longer available";
 	static constexpr const char* ERR_TITLE = "Error";
-	static constexpr const char* WARN_TITLE = "Warning";
+	static constexpr const char* WARN_PAINT_ALLOCATED = "ARCC: steady-state paint allocated\n";
+	static constexpr const char* WARN_NO_RENDER_THREAD = "ARCC: render thread did not start, drawing on the UI thread\n";
+
+	// Replay exit code when a counting build saw a steady-state paint allocate
+	static constexpr int EXIT_PAINT_ALLOCATED = 3;
 
 	// Direct2D resources
 	ID2D1Factory* m_pD2DFactory;
@@ -123,6 +296,9 @@ private:
 	ID2D1SolidColorBrush* m_pTitleBarBrush = nullptr;
 	ID2D1SolidColorBrush* m_pWhiteBrush = nullptr;
 
+	// Title bar icon, converted once per render target
+	ID2D1Bitmap* m_pAppIconBitmap = nullptr;
+
 	// DirectWrite resources
 	IDWriteFactory* m_pDWriteFactory = nullptr;
 	IDWriteTextFormat* m_pTextFormat = nullptr;
@@ -132,6 +308,13 @@ private:
 	IDWriteTextFormat* m_pIconTextFormat = nullptr;
 	IDWriteTextFormat* m_pBoldIconTextFormat = nullptr;
 	IDWriteTextFormat* m_pBoldLeftTextFormat = nullptr;
+	float m_titleMainWidth = 0.0f;
+
+	// Paragraph and label metrics, so reflowing at a width seen before doesn't touch DirectWrite
+	TextMeasureCache m_textMeasureCache;
+
+	// Allocation counting builds only: steady-state paints that allocated, on either thread
+	std::atomic<uint64_t> m_paintAllocationFrames{ 0 };
 
 	// Custom window members
 	HWND m_hMainWindow;
@@ -148,6 +331,7 @@ private:
 	// Title bar button hover tracking
 	enum class TitleBarHover {
 		None,
+		PowerSaving,
 		Help,
 		Minimize,
 		Close
@@ -175,7 +359,7 @@ private:
 		if (textFormat) {
 			textFormat->SetTextAlignment(textAlign);
 			textFormat->SetParagraphAlignment(paraAlign);
-			textFormat->SetLineSpacing(DWRITE_LINE_SPACING_METHOD_DEFAULT, LINE_SPACING, 0.8f);
+			textFormat->SetLineSpacing(DWRITE_LINE_SPACING_METHOD_DEFAULT, Ui::LINE_SPACING, 0.8f);
 		}
 	}
 
@@ -202,17 +386,181 @@ private:
 	// Timer management helper function
 	void StopTimer() {
 		if (m_bTimerActive) {
-			KillTimer(m_hMainWindow, TIMER_COUNTDOWN);
 			KillTimer(m_hMainWindow, TIMER_STATUS_UPDATE);
 			m_bTimerActive = false;
 
-			// Allow system sleep again
+			if (m_bSharedDeadline) {
+				m_sharedSchedule.Withdraw(m_resumeJob);
+				m_bSharedDeadline = false;
+			}
+			m_scheduler.Cancel(m_resumeJob);
+			m_resumeJob = Scheduler::INVALID_JOB;
+			m_pArmedJobs->Set(static_cast<int64_t>(m_scheduler.Size()));
+
+			// A coordinator keeps waking for the other instances, otherwise this allows sleep again
+			ArmDeadline();
+			UpdatePowerState();
+		}
+		m_bAutoArmed = false;
+	}
+
+	// Prevent system sleep and display off
+	void KeepAwake() {
+		if (!m_bKeepingAwake) {
+			SetThreadExecutionState(ES_CONTINUOUS | ES_SYSTEM_REQUIRED | ES_DISPLAY_REQUIRED);
+			m_bKeepingAwake = true;
+		}
+	}
+
+	void ReleaseKeepAwake() {
+		if (m_bKeepingAwake) {
 			SetThreadExecutionState(ES_CONTINUOUS);
+			m_bKeepingAwake = false;
+		}
+	}
+
+	// Either keep the machine awake now, or let it sleep and arm a wake timer for the final stretch
+	// A lead at least as long as the wait leaves nothing to sleep through, the machine stays awake
+	void ArmPowerState(Clock::time_point deadline) {
+		auto wakeTime = deadline - std::chrono::seconds(m_wakeLeadSeconds);
+		if (!m_bPowerSaving || !m_hWakeTimer || m_pClock->Now() >= wakeTime) {
+			KeepAwake();
+			return;
+		}
+
+		ReleaseKeepAwake();
+
+		// Last argument asks the system to resume from sleep when the timer fires
+		LARGE_INTEGER dueTime = ToDueTime(wakeTime);
+		if (!SetWaitableTimer(m_hWakeTimer, &dueTime, 0, nullptr, nullptr, TRUE)) {
+			KeepAwake();
+		}
+	}
+
+	static int ClampWakeLead(int64_t seconds) {
+		if (seconds < MIN_WAKE_LEAD_SECONDS) return MIN_WAKE_LEAD_SECONDS;
+		return seconds > MAX_WAKE_LEAD_SECONDS ? MAX_WAKE_LEAD_SECONDS : static_cast<int>(seconds);
+	}
+
+	// Positive due time is absolute UTC in 100ns units since 1601. Absolute timers follow
+	// system clock changes, so the deadline stays right if the clock is adjusted while waiting.
+	static LARGE_INTEGER ToDueTime(Clock::time_point time) {
+		constexpr LONGLONG FILETIME_UNIX_EPOCH = 116444736000000000LL;
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10000000>>>(
+			time.time_since_epoch()).count() + FILETIME_UNIX_EPOCH;
+		return dueTime;
+	}
+
+	// Keep-awake and wake timer follow the deadline this process wakes for, without one it may sleep
+	void UpdatePowerState() {
+		Clock::time_point deadline;
+		if (!GetWakeDeadline(deadline)) {
+			if (m_hWakeTimer) {
+				CancelWaitableTimer(m_hWakeTimer);
+			}
+			ReleaseKeepAwake();
+			return;
+		}
+		ArmPowerState(deadline);
+	}
+
+	// The earliest deadline this process has to wake for: its own job unless the coordinator took
+	// it, and as coordinator every instance's
+	bool GetWakeDeadline(Clock::time_point& deadline) const {
+		bool found = false;
+		if (!m_bSharedDeadline && !m_scheduler.Empty()) {
+			deadline = m_scheduler.NextDeadline();
+			found = true;
+		}
+
+		int64_t shared;
+		if (m_sharedSchedule.NextDeadline(shared)) {
+			Clock::time_point sharedDeadline = FromUnixMillis(shared);
+			if (!found || sharedDeadline < deadline) deadline = sharedDeadline;
+			found = true;
+		}
+		return found;
+	}
+
+	// Wake exactly at the earliest deadline. Without the waitable timer (or in replay, where time
+	// is virtual) fall back to checking once a second.
+	void ArmDeadline() {
+		KillTimer(m_hMainWindow, TIMER_COUNTDOWN);
+		Clock::time_point deadline;
+		if (!GetWakeDeadline(deadline)) {
+			if (m_hDeadlineTimer) {
+				CancelWaitableTimer(m_hDeadlineTimer);
+			}
+			return;
+		}
+
+		LARGE_INTEGER dueTime = ToDueTime(deadline);
+		if (m_bReplaying || !m_hDeadlineTimer || !SetWaitableTimer(m_hDeadlineTimer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+			SetTimer(m_hMainWindow, TIMER_COUNTDOWN, 1000, nullptr);
+		}
+	}
+
+	// Deadline timer fired: the coordinator wakes the owners of due jobs (itself included, through
+	// its fire event), a job the coordinator doesn't hold is checked here
+	void OnDeadline() {
+		m_sharedSchedule.DispatchDue(ToUnixMillis(m_pClock->Now()));
+		if (!m_bSharedDeadline) {
+			CheckCountdown();
+		}
+		ArmDeadline();
+		UpdatePowerState();
+	}
+
+	// The coordinator says a job of ours is due. If our clock doesn't agree yet, hand it back so
+	// it is signalled again.
+	void OnSharedFire() {
+		if (!CheckCountdown() && m_bTimerActive) {
+			PublishDeadline();
+		}
+	}
+
+	// Took over coordination, or an instance went away: its control pipe name is free now and the
+	// earliest deadline may have moved
+	void OnSharedScheduleChanged() {
+		if (m_bTimerActive && !m_bSharedDeadline) {
+			PublishDeadline();
 		}
+		StartControlPipe();
+		ArmDeadline();
+		UpdatePowerState();
+	}
+
+	// Hand the deadline to the coordinator, or keep our own timers if there is none
+	void PublishDeadline() {
+		m_bSharedDeadline = m_sharedSchedule.Publish(m_resumeJob, ToUnixMillis(m_targetTime));
+		ArmDeadline();
+		UpdatePowerState();
+	}
+
+	// Wake timer fired, stay awake until the resume is sent
+	void OnWakeTimer() {
+		Clock::time_point deadline;
+		if (GetWakeDeadline(deadline)) {
+			KeepAwake();
+		}
+	}
+
+	// After resuming from sleep the deadline may have passed or the clock may have moved
+	void OnPowerResume() {
+		OnDeadline();
+		UpdateUI();
+	}
+
+	// Applies to every instance's deadline while this one coordinates
+	void TogglePowerSaving() {
+		m_bPowerSaving = !m_bPowerSaving;
+		UpdatePowerState();
 	}
 
 	// Title bar layout
 	struct TitleBarButtonPositions {
+		float powerButtonX;
 		float helpButtonX;
 		float minimizeButtonX;
 		float closeButtonX;
@@ -221,55 +569,39 @@ private:
 		float buttonHeight;
 	};
 
-	// Start button layout
-	struct StartButtonMeasurements {
-		float iconWidth;
-		float textWidth;
-		float totalWidth;
-		float startX;
+	// Cost of reflowing the content, mostly interesting during a live resize
+	struct LayoutStats {
+		ULONGLONG reflowCount = 0;      // Layout passes that had to do work
+		ULONGLONG reflowTicks = 0;      // QPC ticks spent in them
+		ULONGLONG maxReflowTicks = 0;
 	};
 
-	// All the layout
-	struct LayoutData {
-		// Content positioning
-		float contentTop = 0;
-		float textWidth = 0;
-		float spacing = 0;
-
-		// Text blocks with positions and heights
-		struct TextBlock {
-			D2D1_RECT_F rect;
-			float height;
-		};
-
-		TextBlock instructionText{};
-		TextBlock tabInfoText{};
-		TextBlock startInfoText{};
-
-		// Button rectangles
-		D2D1_RECT_F targetButtonRect{};
-		D2D1_RECT_F startButtonRect{};
-		D2D1_RECT_F hourButtonRects[HOUR_COUNT]{};
-
-		// Start button detailed measurements
-		StartButtonMeasurements startButtonMeasurements{};
-
-		// Total calculated height
-		float totalContentHeight = 0;
-
-		// Validity flag
-		bool isValid;
-
-		LayoutData() : isValid(false) {}
+	TitleBarButtonPositions m_titleBarButtonPositions{};
+	Ui::Layout m_layoutData;
+	LayoutStats m_layoutStats;
+
+	// Everything a frame draws, copied from the UI thread so the render thread never reads live
+	// state. Fixed buffers keep publishing allocation-free.
+	struct FrameState {
+		Ui::Frame content;
+		bool powerSaving = false;
+		TitleBarHover titleBarHover = TitleBarHover::None;
+		TitleBarButtonPositions titleBarButtons{};
+		UINT32 pixelWidth = 0;
+		UINT32 pixelHeight = 0;
+		float dpiX = 96.0f;
+		float dpiY = 96.0f;
 	};
 
-	TitleBarButtonPositions m_titleBarButtonPositions{};
-	LayoutData m_layoutData = {};
+	// Rendering runs on its own thread from published frames, so a slow present never holds up
+	// input, hooks or deadline checks on the UI thread
+	SnapshotBuffer<FrameState> m_frames;
+	RenderThread m_renderThread;
 
 	TitleBarButtonPositions CalculateTitleBarButtonPositions(HWND hWnd) {
 		TitleBarButtonPositions pos = {};
-		pos.buttonWidth = TITLEBAR_HEIGHT;
-		pos.buttonHeight = TITLEBAR_HEIGHT;
+		pos.buttonWidth = Ui::TITLEBAR_HEIGHT;
+		pos.buttonHeight = Ui::TITLEBAR_HEIGHT;
 		pos.buttonY = 0.0f;
 
 		RECT clientRect;
@@ -279,6 +611,7 @@ private:
 		pos.closeButtonX = windowWidth - pos.buttonWidth;
 		pos.minimizeButtonX = pos.closeButtonX - pos.buttonWidth;
 		pos.helpButtonX = pos.minimizeButtonX - pos.buttonWidth;
+		pos.powerButtonX = pos.helpButtonX - pos.buttonWidth;
 
 		return pos;
 	}
@@ -287,58 +620,103 @@ private:
 		m_titleBarButtonPositions = CalculateTitleBarButtonPositions(hWnd);
 	}
 
-	StartButtonMeasurements CalculateStartButtonMeasurements(const D2D1_RECT_F& textRect) {
-		StartButtonMeasurements measurements = {};
-
-		std::wstring iconText = ICON_PLAY;
-		std::wstring mainText = BTN_START_CLICK;
+	// DirectWrite backend for the layout's text measurement, formats picked by style
+	class DirectWriteMeasurer : public Ui::TextMeasurer {
+	public:
+		explicit DirectWriteMeasurer(ARCCApp& app) : m_app(app) {}
+
+		bool Measure(const wchar_t* text, Ui::TextStyle style, float maxWidth, float& width, float& height) override {
+			TextMeasureCache::Size size;
+			if (!m_app.m_textMeasureCache.Measure(text, m_app.GetTextFormat(style), maxWidth, size)) return false;
+			width = size.width;
+			height = size.height;
+			return true;
+		}
 
-		IDWriteTextLayout* pIconLayout = nullptr;
-		IDWriteTextLayout* pTextLayout = nullptr;
+	private:
+		ARCCApp& m_app;
+	};
 
-		if (m_pDWriteFactory && m_pIconTextFormat) {
-			HRESULT hr = m_pDWriteFactory->CreateTextLayout(
-				iconText.c_str(), static_cast<UINT32>(iconText.length()),
-				m_pIconTextFormat, 1000.0f, textRect.bottom - textRect.top, &pIconLayout);
-			if (SUCCEEDED(hr) && pIconLayout) {
-				DWRITE_TEXT_METRICS iconMetrics;
-				pIconLayout->GetMetrics(&iconMetrics);
-				measurements.iconWidth = iconMetrics.width;
-				pIconLayout->Release();
+	// Direct2D backend for the content drawing, render thread only
+	class Direct2DCanvas : public Ui::Canvas {
+	public:
+		explicit Direct2DCanvas(ARCCApp& app) : m_app(app) {}
+
+		void FillRect(const Ui::Rect& rect, Ui::Color color, float opacity) override {
+			ID2D1SolidColorBrush* pBrush = m_app.GetBrush(color);
+			D2D1_RECT_F d2dRect = ToD2D(rect);
+			if (opacity != 1.0f) {
+				pBrush->SetOpacity(opacity);
+				m_app.m_pRenderTarget->FillRectangle(&d2dRect, pBrush);
+				pBrush->SetOpacity(1.0f);
+				return;
 			}
+			m_app.m_pRenderTarget->FillRectangle(&d2dRect, pBrush);
 		}
 
-		if (m_pDWriteFactory && m_pBoldTextFormat) {
-			HRESULT hr = m_pDWriteFactory->CreateTextLayout(
-				mainText.c_str(), static_cast<UINT32>(mainText.length()),
-				m_pBoldTextFormat, 1000.0f, textRect.bottom - textRect.top, &pTextLayout);
-			if (SUCCEEDED(hr) && pTextLayout) {
-				DWRITE_TEXT_METRICS textMetrics;
-				pTextLayout->GetMetrics(&textMetrics);
-				measurements.textWidth = textMetrics.width;
-				pTextLayout->Release();
-			}
+		void DrawRect(const Ui::Rect& rect, Ui::Color color, float strokeWidth) override {
+			D2D1_RECT_F d2dRect = ToD2D(rect);
+			m_app.m_pRenderTarget->DrawRectangle(&d2dRect, m_app.GetBrush(color), strokeWidth);
 		}
 
-		measurements.totalWidth = measurements.iconWidth + measurements.textWidth;
-		float buttonWidth = textRect.right - textRect.left;
-		measurements.startX = textRect.left + (buttonWidth - measurements.totalWidth) / 2.0f;
+		void DrawText(const wchar_t* text, Ui::TextStyle style, const Ui::Rect& rect, Ui::Color color) override {
+			IDWriteTextFormat* pFormat = m_app.GetTextFormat(style);
+			if (!pFormat) return;
+			D2D1_RECT_F d2dRect = ToD2D(rect);
+			m_app.m_pRenderTarget->DrawText(text, static_cast<UINT32>(wcslen(text)), pFormat, &d2dRect, m_app.GetBrush(color));
+		}
+
+	private:
+		ARCCApp& m_app;
+
+		static D2D1_RECT_F ToD2D(const Ui::Rect& rect) {
+			return D2D1::RectF(rect.left, rect.top, rect.right, rect.bottom);
+		}
+	};
 
-		return measurements;
+	DirectWriteMeasurer m_textMeasurer{ *this };
+	Direct2DCanvas m_canvas{ *this };
+
+	IDWriteTextFormat* GetTextFormat(Ui::TextStyle style) const {
+		switch (style) {
+		case Ui::TextStyle::Button: return m_pButtonTextFormat;
+		case Ui::TextStyle::Bold: return m_pBoldTextFormat;
+		case Ui::TextStyle::BoldLeft: return m_pBoldLeftTextFormat;
+		case Ui::TextStyle::Icon: return m_pIconTextFormat;
+		case Ui::TextStyle::Paragraph:
+		default: return m_pTextFormat;
+		}
 	}
 
+	ID2D1SolidColorBrush* GetBrush(Ui::Color color) const {
+		switch (color) {
+		case Ui::Color::Background: return m_pBgBrush;
+		case Ui::Color::Button: return m_pButtonBrush;
+		case Ui::Color::ButtonHover: return m_pButtonHoverBrush;
+		case Ui::Color::Green: return m_pGreenBrush;
+		case Ui::Color::GreenHover: return m_pGreenHoverBrush;
+		case Ui::Color::Red: return m_pRedBrush;
+		case Ui::Color::RedHover: return m_pRedHoverBrush;
+		case Ui::Color::Amber: return m_pAmberBrush;
+		case Ui::Color::Text:
+		default: return m_pTextBrush;
+		}
+	}
 
 	void CreateTextFormats() {
 		if (!m_pDWriteFactory) return;
 
+		// Cached metrics refer to the formats being replaced
+		m_textMeasureCache.SetFactory(m_pDWriteFactory);
+
 		// Create text formats
-		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_NORMAL, MAIN_FONT_SIZE, &m_pTextFormat);
-		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_NORMAL, TITLE_FONT_SIZE, &m_pTitleTextFormat);
-		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_NORMAL, MAIN_FONT_SIZE, &m_pButtonTextFormat);
-		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_BOLD, MAIN_FONT_SIZE, &m_pBoldTextFormat);
-		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_BOLD, MAIN_FONT_SIZE, &m_pBoldLeftTextFormat);
-		CreateSingleTextFormat(FONT_SEGOE_MDL2, DWRITE_FONT_WEIGHT_NORMAL, MAIN_FONT_SIZE, &m_pIconTextFormat);
-		CreateSingleTextFormat(FONT_SEGOE_MDL2, DWRITE_FONT_WEIGHT_BOLD, MAIN_FONT_SIZE, &m_pBoldIconTextFormat);
+		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_NORMAL, Ui::MAIN_FONT_SIZE, &m_pTextFormat);
+		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_NORMAL, Ui::TITLE_FONT_SIZE, &m_pTitleTextFormat);
+		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_NORMAL, Ui::MAIN_FONT_SIZE, &m_pButtonTextFormat);
+		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_BOLD, Ui::MAIN_FONT_SIZE, &m_pBoldTextFormat);
+		CreateSingleTextFormat(FONT_SEGOE_UI, DWRITE_FONT_WEIGHT_BOLD, Ui::MAIN_FONT_SIZE, &m_pBoldLeftTextFormat);
+		CreateSingleTextFormat(FONT_SEGOE_MDL2, DWRITE_FONT_WEIGHT_NORMAL, Ui::MAIN_FONT_SIZE, &m_pIconTextFormat);
+		CreateSingleTextFormat(FONT_SEGOE_MDL2, DWRITE_FONT_WEIGHT_BOLD, Ui::MAIN_FONT_SIZE, &m_pBoldIconTextFormat);
 
 		// Configure text formats
 		ConfigureTextFormat(m_pTextFormat, DWRITE_TEXT_ALIGNMENT_LEADING, DWRITE_PARAGRAPH_ALIGNMENT_NEAR);
@@ -348,30 +726,38 @@ private:
 		ConfigureTextFormat(m_pTitleTextFormat, DWRITE_TEXT_ALIGNMENT_LEADING, DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
 		ConfigureTextFormat(m_pIconTextFormat, DWRITE_TEXT_ALIGNMENT_CENTER, DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
 		ConfigureTextFormat(m_pBoldIconTextFormat, DWRITE_TEXT_ALIGNMENT_CENTER, DWRITE_PARAGRAPH_ALIGNMENT_CENTER);
+
+		// Main title width positions the subtitle, it only depends on the format
+		IDWriteTextLayout* pMainLayout = nullptr;
+		if (m_pTitleTextFormat && SUCCEEDED(m_pDWriteFactory->CreateTextLayout(
+			APP_TITLE_MAIN, static_cast<UINT32>(wcslen(APP_TITLE_MAIN)),
+			m_pTitleTextFormat, 1000.0f, Ui::TITLEBAR_HEIGHT, &pMainLayout)) && pMainLayout) {
+			DWRITE_TEXT_METRICS mainMetrics;
+			pMainLayout->GetMetrics(&mainMetrics);
+			m_titleMainWidth = mainMetrics.width;
+			pMainLayout->Release();
+		}
+	}
+
+	void ReleaseTextFormats() {
+		SafeRelease(&m_pTextFormat);
+		SafeRelease(&m_pTitleTextFormat);
+		SafeRelease(&m_pButtonTextFormat);
+		SafeRelease(&m_pBoldTextFormat);
+		SafeRelease(&m_pBoldLeftTextFormat);
+		SafeRelease(&m_pIconTextFormat);
+		SafeRelease(&m_pBoldIconTextFormat);
 	}
 
-	HRESULT CreateDeviceResources(HWND hWnd, float dpiX = 0, float dpiY = 0) {
+	// Render thread only
+	HRESULT CreateDeviceResources(const FrameState& frame) {
 		if (m_pRenderTarget) return S_OK; // Already created
 
 		if (!m_pD2DFactory) return E_FAIL;
 
-		RECT rc;
-		GetClientRect(hWnd, &rc);
-
-		D2D1_SIZE_U size = D2D1::SizeU(
-			rc.right - rc.left,
-			rc.bottom - rc.top
-		);
-
-		// During startup will yield 0 dpi values, so default to what we already know
-		if (dpiX == 0 || dpiY == 0) {
-			dpiX = m_currentDpiX;
-			dpiY = m_currentDpiY;
-		}
-
-		// Store DPI values as our trusted source
-		m_currentDpiX = dpiX;
-		m_currentDpiY = dpiY;
+		D2D1_SIZE_U size = D2D1::SizeU(frame.pixelWidth, frame.pixelHeight);
+		float dpiX = frame.dpiX;
+		float dpiY = frame.dpiY;
 
 		// Create render target
 		HRESULT hr = m_pD2DFactory->CreateHwndRenderTarget(
@@ -383,7 +769,7 @@ private:
 				D2D1_RENDER_TARGET_USAGE_NONE,
 				D2D1_FEATURE_LEVEL_DEFAULT
 			),
-			D2D1::HwndRenderTargetProperties(hWnd, size),
+			D2D1::HwndRenderTargetProperties(m_hMainWindow, size),
 			&m_pRenderTarget
 		);
 
@@ -427,9 +813,58 @@ private:
 		hr = m_pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(1.0f, 1.0f, 1.0f), &m_pWhiteBrush);
 		if (FAILED(hr)) return hr;
 
+		// Icon is optional, the title bar just goes without it
+		CreateAppIconBitmap();
+
 		return S_OK;
 	}
 
+	// Render the app icon over the title bar colour once and keep it as a bitmap
+	void CreateAppIconBitmap() {
+		HICON hIcon = LoadIcon(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDI_MAIN_ICON));
+		if (!hIcon) return;
+
+		// Create a compatible DC for the icon
+		HDC hdcScreen = GetDC(nullptr);
+		HDC hdcMem = CreateCompatibleDC(hdcScreen);
+		HBITMAP hBitmap = CreateCompatibleBitmap(hdcScreen, APP_ICON_SIZE, APP_ICON_SIZE);
+		HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
+
+		// Fill background
+		RECT iconRect = { 0, 0, APP_ICON_SIZE, APP_ICON_SIZE };
+		HBRUSH hBrush = CreateSolidBrush(RGB(0x2A, 0x2A, 0x2A));
+		FillRect(hdcMem, &iconRect, hBrush);
+		DeleteObject(hBrush);
+
+		// Draw icon
+		DrawIconEx(hdcMem, 0, 0, hIcon, APP_ICON_SIZE, APP_ICON_SIZE, 0, nullptr, DI_NORMAL);
+
+		// Get bitmap bits
+		BITMAPINFO bmi = {};
+		bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		bmi.bmiHeader.biWidth = APP_ICON_SIZE;
+		bmi.bmiHeader.biHeight = -APP_ICON_SIZE;
+		bmi.bmiHeader.biPlanes = 1;
+		bmi.bmiHeader.biBitCount = 32;
+		bmi.bmiHeader.biCompression = BI_RGB;
+
+		// Convert to Direct2D bitmap
+		BYTE bits[APP_ICON_SIZE * APP_ICON_SIZE * 4];
+		if (GetDIBits(hdcMem, hBitmap, 0, APP_ICON_SIZE, bits, &bmi, DIB_RGB_COLORS)) {
+			D2D1_BITMAP_PROPERTIES bitmapProps = D2D1::BitmapProperties(
+				D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE));
+			m_pRenderTarget->CreateBitmap(D2D1::SizeU(APP_ICON_SIZE, APP_ICON_SIZE), bits, APP_ICON_SIZE * 4,
+				&bitmapProps, &m_pAppIconBitmap);
+		}
+
+		// Cleanup
+		SelectObject(hdcMem, hOldBitmap);
+		DeleteObject(hBitmap);
+		DeleteDC(hdcMem);
+		ReleaseDC(nullptr, hdcScreen);
+		DestroyIcon(hIcon);
+	}
+
 	void DiscardDeviceResources() {
 		// Release consolidated brushes
 		SafeRelease(&m_pBgBrush);
@@ -443,6 +878,7 @@ private:
 		SafeRelease(&m_pAmberBrush);
 		SafeRelease(&m_pTitleBarBrush);
 		SafeRelease(&m_pWhiteBrush);
+		SafeRelease(&m_pAppIconBitmap);
 		SafeRelease(&m_pRenderTarget);
 	}
 
@@ -461,8 +897,7 @@ private:
 
 	// Calculate position of ui elements
 	void CalculateLayout(float overrideClientWidthDIP = 0.0f) {
-		// Reset validity
-		m_layoutData.isValid = false;
+		Trace::Span span("CalculateLayout");
 
 		// Calculate content width - either use override or convert from pixels to DIP
 		float clientWidthDIP;
@@ -475,386 +910,45 @@ private:
 			clientWidthDIP = PixelToDIP_X(clientRect.right - clientRect.left);
 		}
 
-		// Setup basic layout parameters
-		m_layoutData.contentTop = WINDOW_MARGIN + TITLEBAR_HEIGHT;
-		m_layoutData.textWidth = clientWidthDIP - (2 * WINDOW_MARGIN);
-		m_layoutData.spacing = ELEMENT_SPACING;
-
-		float currentY = m_layoutData.contentTop;
-		float margin = WINDOW_MARGIN;
-		float textWidth = m_layoutData.textWidth;
-		float spacing = m_layoutData.spacing;
-
-		// Calculate instruction text block
-		m_layoutData.instructionText.height = CalculateDirectWriteTextHeight(INSTRUCTION_TEXT, textWidth, m_pTextFormat);
-		m_layoutData.instructionText.rect = D2D1::RectF(margin, currentY, margin + textWidth, currentY + m_layoutData.instructionText.height);
-		currentY += m_layoutData.instructionText.height + spacing;
+		LARGE_INTEGER start;
+		QueryPerformanceCounter(&start);
 
-		// Calculate target button
-		m_layoutData.targetButtonRect = D2D1::RectF(margin, currentY, margin + textWidth, currentY + TARGET_BUTTON_HEIGHT);
-		currentY += TARGET_BUTTON_HEIGHT + spacing;
+		// Only the width drives layout, so moves and height-only size changes are free
+		if (!Ui::ComputeLayout(clientWidthDIP, m_textMeasurer, m_layoutData)) return;
 
-		// Calculate tab info text block
-		m_layoutData.tabInfoText.height = CalculateDirectWriteTextHeight(TAB_INFO_TEXT, textWidth, m_pTextFormat);
-		m_layoutData.tabInfoText.rect = D2D1::RectF(margin, currentY, margin + textWidth, currentY + m_layoutData.tabInfoText.height);
-		currentY += m_layoutData.tabInfoText.height + spacing;
-
-		// Calculate hour buttons
-		for (int i = 0; i < HOUR_COUNT; i++) {
-			float buttonX = margin + i * (HOUR_BUTTON_WIDTH + HOUR_BUTTON_SPACING);
-			m_layoutData.hourButtonRects[i] = D2D1::RectF(buttonX, currentY, buttonX + HOUR_BUTTON_WIDTH, currentY + HOUR_BUTTON_HEIGHT);
+		LARGE_INTEGER end;
+		QueryPerformanceCounter(&end);
+		ULONGLONG ticks = static_cast<ULONGLONG>(end.QuadPart - start.QuadPart);
+		m_layoutStats.reflowCount++;
+		m_layoutStats.reflowTicks += ticks;
+		if (ticks > m_layoutStats.maxReflowTicks) {
+			m_layoutStats.maxReflowTicks = ticks;
 		}
-		currentY += HOUR_BUTTON_HEIGHT + spacing;
-
-		// Calculate start info text block
-		m_layoutData.startInfoText.height = CalculateDirectWriteTextHeight(START_INFO_TEXT, textWidth, m_pTextFormat);
-		m_layoutData.startInfoText.rect = D2D1::RectF(margin, currentY, margin + textWidth, currentY + m_layoutData.startInfoText.height);
-		currentY += m_layoutData.startInfoText.height + spacing;
-
-		// Calculate start button
-		m_layoutData.startButtonRect = D2D1::RectF(margin, currentY, margin + textWidth, currentY + START_BUTTON_HEIGHT);
-
-		// Calculate start button detailed measurements
-		m_layoutData.startButtonMeasurements = CalculateStartButtonMeasurements(m_layoutData.startButtonRect);
-
-		currentY += START_BUTTON_HEIGHT + WINDOW_MARGIN; // Bottom margin
+	}
 
-		// Store total height
-		m_layoutData.totalContentHeight = currentY;
+	// Window height for the content laid out at a client width, used to snap the height while sizing
+	int GetWindowHeightForClientWidth(int clientWidth) {
+		int contentHeight = GetCalculatedContentHeight(PixelToDIP_X(clientWidth));
+		RECT windowRect = { 0, 0, clientWidth, DIPToPixel_Y(contentHeight) };
+		AdjustWindowRectEx(&windowRect, WS_POPUP | WS_THICKFRAME, FALSE, WS_EX_APPWINDOW);
+		return windowRect.bottom - windowRect.top;
+	}
 
-		// Mark as valid
-		m_layoutData.isValid = true;
+	// Horizontal frame size, window width minus client width
+	static int GetFrameWidth() {
+		RECT frameRect = { 0, 0, 0, 0 };
+		AdjustWindowRectEx(&frameRect, WS_POPUP | WS_THICKFRAME, FALSE, WS_EX_APPWINDOW);
+		return frameRect.right - frameRect.left;
 	}
 
 	// Window height is set to fit the UI elements
 	int GetCalculatedContentHeight(float overrideClientWidthDIP = 0.0f) {
-		if (!m_layoutData.isValid || overrideClientWidthDIP > 0.0f) {
-			CalculateLayout(overrideClientWidthDIP);
-		}
+		CalculateLayout(overrideClientWidthDIP);
 		return static_cast<int>(m_layoutData.totalContentHeight);
 	}
 
-	// Draw all the things
-	void DrawMainContent() {
-		if (!m_pRenderTarget || !m_pTextFormat) return;
-
-		// Ensure layout is calculated
-		if (!m_layoutData.isValid) {
-			CalculateLayout();
-		}
-
-		// Draw instruction text
-		m_pRenderTarget->DrawText(INSTRUCTION_TEXT, static_cast<UINT32>(wcslen(INSTRUCTION_TEXT)),
-			m_pTextFormat, &m_layoutData.instructionText.rect, m_pTextBrush);
-
-		// Draw target button
-		DrawButton(m_layoutData.targetButtonRect, true, false);
-
-		// Draw tab info text
-		m_pRenderTarget->DrawText(TAB_INFO_TEXT, static_cast<UINT32>(wcslen(TAB_INFO_TEXT)),
-			m_pTextFormat, &m_layoutData.tabInfoText.rect, m_pTextBrush);
-
-		// Draw hour buttons
-		std::vector<std::wstring> hourTimes = GetNext5HourTimes();
-		for (int i = 0; i < HOUR_COUNT; i++) {
-			const D2D1_RECT_F& buttonRect = m_layoutData.hourButtonRects[i];
-
-			// Check if mouse is hovering over this button
-			bool isHovered = false;
-			if (m_mousePos.x >= 0 && m_mousePos.y >= 0) {
-				// Convert mouse coordinates to DIP using stored values
-				float dipX = PixelToDIP_X(m_mousePos.x);
-				float dipY = PixelToDIP_Y(m_mousePos.y);
-
-				isHovered = (dipX >= buttonRect.left && dipX <= buttonRect.right &&
-					dipY >= buttonRect.top && dipY <= buttonRect.bottom);
-			}
-
-			// Use different colors for selected vs unselected
-			ID2D1SolidColorBrush* buttonBrush = (i == m_selectedHourOffset) ? m_pGreenBrush : m_pButtonBrush;
-			ID2D1SolidColorBrush* textBrush = (i == m_selectedHourOffset) ? m_pBgBrush : m_pTextBrush;
-
-			m_pRenderTarget->FillRectangle(&buttonRect, buttonBrush);
-
-			// Add green hover effect with opacity (only if not already selected)
-			if (isHovered && i != m_selectedHourOffset) {
-				m_pGreenBrush->SetOpacity(0.3f);
-				m_pRenderTarget->FillRectangle(&buttonRect, m_pGreenBrush);
-				m_pGreenBrush->SetOpacity(1.0f); // Reset opacity
-			}
-
-			// Draw hour text centered in button
-			m_pRenderTarget->DrawText(hourTimes[i].c_str(), static_cast<UINT32>(hourTimes[i].length()),
-				m_pButtonTextFormat, &buttonRect, textBrush);
-		}
-
-		// Draw start info text
-		m_pRenderTarget->DrawText(START_INFO_TEXT, static_cast<UINT32>(wcslen(START_INFO_TEXT)),
-			m_pTextFormat, &m_layoutData.startInfoText.rect, m_pTextBrush);
-
-		// Draw start/stop button
-		DrawButton(m_layoutData.startButtonRect, false, true); // isTargetButton = false, isStartButton = true
-	}
-
-	// Calculates the height of text if rendered at the provided width
-	float CalculateDirectWriteTextHeight(const wchar_t* text, float width, IDWriteTextFormat* textFormat) {
-		if (!m_pDWriteFactory || !textFormat) return 20.0f;
-
-		IDWriteTextLayout* pTextLayout = nullptr;
-		HRESULT hr = m_pDWriteFactory->CreateTextLayout(
-			text, static_cast<UINT32>(wcslen(text)), textFormat,
-			width, 1000.0f, &pTextLayout);
-
-		if (FAILED(hr) || !pTextLayout) return 20.0f;
-
-		DWRITE_TEXT_METRICS textMetrics;
-		pTextLayout->GetMetrics(&textMetrics);
-
-		float height = textMetrics.height;
-
-		pTextLayout->Release();
-		return height;
-	}
-
-	// Draws either start or target button could refactor this as it's bit long-winded
-	void DrawButton(const D2D1_RECT_F& rect, bool isTargetButton, bool isStartButton) {
-		if (!m_pRenderTarget) return;
-
-		AppState currentState = GetCurrentAppState();
-
-		// Check if mouse is hovering over this button
-		bool isHovered = false;
-		if (m_mousePos.x >= 0 && m_mousePos.y >= 0) {
-			float dipX = PixelToDIP_X(m_mousePos.x);
-			float dipY = PixelToDIP_Y(m_mousePos.y);
-
-			isHovered = (dipX >= rect.left && dipX <= rect.right &&
-				dipY >= rect.top && dipY <= rect.bottom);
-		}
-
-		// Choose button colors
-		ID2D1SolidColorBrush* pButtonBrush = m_pButtonBrush;
-		ID2D1SolidColorBrush* pTextBrush = m_pTextBrush;
-
-		if (isTargetButton) {
-			if (m_hTargetWindow) {
-				pButtonBrush = m_pBgBrush;
-				pTextBrush = m_pGreenBrush;
-			}
-			else {
-				pButtonBrush = isHovered ? m_pButtonHoverBrush : m_pBgBrush;
-				pTextBrush = m_pAmberBrush;
-			}
-		}
-		else if (isStartButton) {
-			switch (currentState) {
-			case AppState::Waiting:
-				pButtonBrush = isHovered ? m_pRedHoverBrush : m_pRedBrush;
-				pTextBrush = m_pBgBrush;
-				break;
-			case AppState::Ready:
-				pButtonBrush = isHovered ? m_pGreenHoverBrush : m_pGreenBrush;
-				pTextBrush = m_pBgBrush;
-				break;
-			case AppState::Idle:
-			default:
-				pButtonBrush = m_pBgBrush;
-				pTextBrush = m_pButtonBrush;
-				break;
-			}
-		}
-
-		// Draw button background
-		m_pRenderTarget->FillRectangle(&rect, pButtonBrush);
-
-		// Draw border for target button
-		if (isTargetButton) {
-			if (m_hTargetWindow) {
-				m_pRenderTarget->DrawRectangle(&rect, m_pGreenBrush, BORDER_WIDTH);
-			}
-			else {
-				m_pRenderTarget->DrawRectangle(&rect, m_pAmberBrush, BORDER_WIDTH);
-			}
-		}
-
-		// Draw button text
-		D2D1_RECT_F textRect = D2D1::RectF(
-			rect.left + BUTTON_TEXT_PADDING, rect.top + BUTTON_TEXT_PADDING_V,
-			rect.right - BUTTON_TEXT_PADDING, rect.bottom - BUTTON_TEXT_PADDING_V);
-
-		std::wstring buttonText = GetButtonText(isTargetButton, isStartButton);
-
-		if (isTargetButton && m_hTargetWindow && buttonText.find(L'\n') != std::wstring::npos) {
-			// Draw multiline text
-			size_t newlinePos = buttonText.find(L'\n');
-			std::wstring firstLine = buttonText.substr(0, newlinePos);
-			std::wstring secondLine = buttonText.substr(newlinePos + 1);
-
-			float lineHeight = (textRect.bottom - textRect.top) / 2.0f;
-			D2D1_RECT_F firstLineRect = D2D1::RectF(textRect.left, textRect.top,
-				textRect.right, textRect.top + lineHeight);
-			D2D1_RECT_F secondLineRect = D2D1::RectF(textRect.left, textRect.top + lineHeight,
-				textRect.right, textRect.bottom);
-
-			if (m_pBoldTextFormat) {
-				m_pRenderTarget->DrawText(firstLine.c_str(), static_cast<UINT32>(firstLine.length()),
-					m_pBoldTextFormat, &firstLineRect, pTextBrush);
-			}
-			if (m_pButtonTextFormat) {
-				m_pRenderTarget->DrawText(secondLine.c_str(), static_cast<UINT32>(secondLine.length()),
-					m_pButtonTextFormat, &secondLineRect, pTextBrush);
-			}
-		}
-		else {
-			if (isStartButton && !m_bTimerActive) {
-				// Start button with icon + text
-				const StartButtonMeasurements& measurements = m_layoutData.startButtonMeasurements;
-
-				// Draw icon
-				D2D1_RECT_F iconRect = D2D1::RectF(
-					measurements.startX, textRect.top,
-					measurements.startX + measurements.iconWidth, textRect.bottom);
-				if (m_pIconTextFormat) {
-					m_pRenderTarget->DrawText(ICON_PLAY, 1, m_pIconTextFormat, &iconRect, pTextBrush);
-				}
-
-				// Draw text right after icon
-				D2D1_RECT_F mainTextRect = D2D1::RectF(
-					measurements.startX + measurements.iconWidth, textRect.top,
-					textRect.right, textRect.bottom);
-				if (m_pBoldLeftTextFormat) {
-					m_pRenderTarget->DrawText(BTN_START_CLICK, static_cast<UINT32>(wcslen(BTN_START_CLICK)),
-						m_pBoldLeftTextFormat, &mainTextRect, pTextBrush);
-				}
-			}
-			else {
-				IDWriteTextFormat* textFormat = isStartButton ? m_pBoldTextFormat : m_pButtonTextFormat;
-
-				if (textFormat) {
-					m_pRenderTarget->DrawText(buttonText.c_str(), static_cast<UINT32>(buttonText.length()),
-						textFormat, &textRect, pTextBrush);
-				}
-			}
-		}
-	}
-
-	// Get button text for either start or target - could be refactored as it's a bit involved
-	std::wstring GetButtonText(bool isTargetButton, bool isStartButton) {
-		if (isTargetButton) {
-			if (m_hTargetWindow && !m_targetProcessName.empty()) {
-				std::wstringstream wss;
-				// Convert process name to wide string
-				std::wstring processNameW;
-				size_t len = MultiByteToWideChar(CP_UTF8, 0, m_targetProcessName.c_str(), -1, nullptr, 0);
-				if (len > 0) {
-					processNameW.resize(len - 1);
-					MultiByteToWideChar(CP_UTF8, 0, m_targetProcessName.c_str(), -1, &processNameW[0], static_cast<int>(len));
-				}
-
-				std::wstring titleW;
-				if (!m_targetWindowTitle.empty()) {
-					size_t titleLen = MultiByteToWideChar(CP_UTF8, 0, m_targetWindowTitle.c_str(), -1, nullptr, 0);
-					if (titleLen > 0) {
-						titleW.resize(titleLen - 1);
-						MultiByteToWideChar(CP_UTF8, 0, m_targetWindowTitle.c_str(), -1, &titleW[0], static_cast<int>(titleLen));
-
-						// Limit title to specified character limit with ellipsis
-						if (titleW.length() > TITLE_CHAR_LIMIT) {
-							titleW = titleW.substr(0, TITLE_CHAR_LIMIT) + TITLE_ELLIPSIS;
-						}
-					}
-				}
-				else {
-					titleW = TITLE_NO_TITLE;
-				}
-
-				wss << processNameW << L"\n\"" << titleW << L"\" (0x" << std::hex << std::uppercase
-					<< reinterpret_cast<uintptr_t>(m_hTargetWindow) << L")";
-				return wss.str();
-			}
-			else if (m_bCapturing) {
-				return BTN_TARGET_CAPTURE;
-			}
-			else {
-				return BTN_TARGET_SELECT;
-			}
-		}
-		else if (isStartButton) {
-			if (m_bTimerActive) {
-				return GetCountdownText();
-			}
-			else {
-				return BTN_START_CLICK;
-			}
-		}
-		return L"";
-	}
-
-	// When timer is running we show the countdown on the start button
-	std::wstring GetCountdownText() const {
-		if (!m_bTimerActive) return L"";
-
-		auto now = std::chrono::system_clock::now();
-		auto remaining = std::chrono::duration_cast<std::chrono::seconds>(m_targetTime - now);
-
-		if (remaining.count() > 0) {
-			int hours = static_cast<int>(remaining.count() / 3600);
-			int minutes = static_cast<int>((remaining.count() % 3600) / 60);
-			int seconds = static_cast<int>(remaining.count() % 60);
-
-			std::wstringstream wss;
-			wss << L"Resuming in " << std::setfill(L'0') << std::setw(2) << hours
-				<< L":" << std::setw(2) << minutes << L":" << std::setw(2) << seconds;
-			return wss.str();
-		}
-		return L"";
-	}
-
-	// Hours buttons text construction
-	std::vector<std::wstring> GetNext5HourTimes() {
-		std::vector<std::wstring> times;
-		auto now = std::chrono::system_clock::now();
-
-		// Get the start of the next hour
-		auto time_t = std::chrono::system_clock::to_time_t(now);
-		struct tm local_tm;
-		localtime_s(&local_tm, &time_t);
-
-		// Set to start of next hour
-		local_tm.tm_min = 0;
-		local_tm.tm_sec = 0;
-		local_tm.tm_hour += 1;
-
-		auto nextHour = std::chrono::system_clock::from_time_t(mktime(&local_tm));
-
-		// Generate hour times starting from next hour
-		for (int i = 0; i < HOUR_COUNT; i++) {
-			auto futureTime = nextHour + std::chrono::hours(i);
-			auto future_time_t = std::chrono::system_clock::to_time_t(futureTime);
-			struct tm future_tm;
-			localtime_s(&future_tm, &future_time_t);
-
-			// Format as 12-hour with am/pm
-			std::wstringstream wss;
-			int hour12 = future_tm.tm_hour % 12;
-			if (hour12 == 0) hour12 = 12; // Handle 12am/12pm
-
-			wss << hour12;
-			if (future_tm.tm_hour >= 12) {
-				wss << L"pm";
-			}
-			else {
-				wss << L"am";
-			}
-
-			times.push_back(wss.str());
-		}
-
-		return times;
-	}
-
 public:
-	ARCCApp() : m_hTargetWindow(nullptr), m_hInputHook(nullptr), m_bCapturing(false), m_bTimerActive(false),
+	explicit ARCCApp(const Clock* pClock = nullptr) : m_hTargetWindow(nullptr), m_hInputHook(nullptr), m_bCapturing(false), m_bTimerActive(false),
 		m_selectedHourOffset(0), m_hMainWindow(nullptr), m_bDragging(false), m_bMouseTracking(false),
 		m_hBackgroundBrush(nullptr), m_bWindowActive(true), m_currentDpiX(96.0f), m_currentDpiY(96.0f),
 		m_titleBarHover(TitleBarHover::None), m_pD2DFactory(nullptr), m_pRenderTarget(nullptr),
@@ -866,10 +960,17 @@ public:
 		m_pBoldLeftTextFormat(nullptr)
 	{
 		s_pInstance = this;
+		m_pClock = pClock ? pClock : &m_systemClock;
 		m_mousePos.x = m_mousePos.y = -1;
+		RegisterMetrics();
+
+		// Device resources are created, used and released on the render thread only
+		m_renderThread.SetCallbacks([]() { Trace::ThreadName() = "Render"; },
+			[this]() { return RenderPublishedFrame() != S_FALSE; },
+			[this]() { DiscardDeviceResources(); }, OCCLUDED_RECHECK_MS);
 
 		// Initialize Direct2D
-		HRESULT hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &m_pD2DFactory);
+		HRESULT hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_MULTI_THREADED, &m_pD2DFactory);
 		if (FAILED(hr)) return;
 
 		// Initialize DirectWrite
@@ -881,11 +982,24 @@ public:
 	}
 
 	~ARCCApp() {
+		m_renderThread.Stop();
+
 		// Remove message hook if it's active
 		if (m_hInputHook) {
 			UnhookWindowsHookEx(m_hInputHook);
 		}
 
+		UnwatchTargetProcess();
+
+		if (m_hWakeTimer) {
+			m_eventLoop.Remove(m_hWakeTimer);
+			CloseHandle(m_hWakeTimer);
+		}
+		if (m_hDeadlineTimer) {
+			m_eventLoop.Remove(m_hDeadlineTimer);
+			CloseHandle(m_hDeadlineTimer);
+		}
+
 		// Cleanup window background brush
 		if (m_hBackgroundBrush) {
 			DeleteObject(m_hBackgroundBrush);
@@ -903,16 +1017,12 @@ public:
 		SafeRelease(&m_pAmberBrush);
 		SafeRelease(&m_pTitleBarBrush);
 		SafeRelease(&m_pWhiteBrush);
+		SafeRelease(&m_pAppIconBitmap);
 		SafeRelease(&m_pRenderTarget);
 		SafeRelease(&m_pD2DFactory);
 
 		// Cleanup DirectWrite resources
-		SafeRelease(&m_pTextFormat);
-		SafeRelease(&m_pTitleTextFormat);
-		SafeRelease(&m_pButtonTextFormat);
-		SafeRelease(&m_pBoldTextFormat);
-		SafeRelease(&m_pIconTextFormat);
-		SafeRelease(&m_pBoldIconTextFormat);
+		ReleaseTextFormats();
 		SafeRelease(&m_pDWriteFactory);
 
 	}
@@ -920,7 +1030,45 @@ public:
 	// Need to access app class instance from wnd procs
 	static ARCCApp* GetInstance() { return s_pInstance; }
 
+	// --record <file> captures window messages, --replay <file> profiles the handlers against a capture,
+	// --metrics <file> exports metrics, --watch <file> (any number) takes reset times from a status file,
+	// --wake-lead <seconds> sets how long before the deadline power saving mode wakes the machine
+	void ParseCommandLine(int argc, char** argv) {
+		for (int i = 1; i + 1 < argc; i++) {
+			if (strcmp(argv[i], ARG_RECORD) == 0) {
+				if (!m_traceWriter.Open(argv[++i])) {
+					MessageBoxA(nullptr, ERR_TRACE_FAILED, ERR_TITLE, MB_OK | MB_ICONERROR);
+				}
+			}
+			else if (strcmp(argv[i], ARG_REPLAY) == 0) {
+				m_replayPath = argv[++i];
+			}
+			else if (strcmp(argv[i], ARG_METRICS) == 0) {
+				const char* path = argv[++i];
+				int length = MultiByteToWideChar(CP_ACP, 0, path, -1, nullptr, 0);
+				if (length > 1) {
+					m_metricsPath.resize(static_cast<size_t>(length - 1));
+					MultiByteToWideChar(CP_ACP, 0, path, -1, &m_metricsPath[0], length);
+				}
+			}
+			else if (strcmp(argv[i], ARG_WAKE_LEAD) == 0) {
+				m_wakeLeadSeconds = ClampWakeLead(atoll(argv[++i]));
+			}
+			else if (strcmp(argv[i], ARG_WATCH) == 0) {
+				const char* path = argv[++i];
+				int length = MultiByteToWideChar(CP_ACP, 0, path, -1, nullptr, 0);
+				if (length > 1) {
+					std::wstring watchPath(static_cast<size_t>(length - 1), L'\0');
+					MultiByteToWideChar(CP_ACP, 0, path, -1, &watchPath[0], length);
+					m_watchPaths.push_back(std::move(watchPath));
+				}
+			}
+		}
+	}
+
 	int Run(HINSTANCE hInstance) {
+		Trace::ThreadName() = "UI";
+
 		// Register custom window class
 		WNDCLASSEXA wcex = {};
 		wcex.cbSize = sizeof(WNDCLASSEXA);
@@ -980,11 +1128,23 @@ public:
 			return 1;
 		}
 
-		// Now calculate proper content height using real client width
-		int contentHeight = GetCalculatedContentHeight();
-		int properClientHeight = DIPToPixel_Y(contentHeight);
+		// Capture still works without it, just without the highlight
+		m_pickerOverlay.Create(hInstance, m_hMainWindow);
 
-		// Resize window to proper height
+		if (m_targetList.Create(hInstance, m_hMainWindow, &m_targetSearch)) {
+			m_targetList.SetPickHandler([this](HWND hWnd) { OnTargetListPick(hWnd); });
+		}
+
+		// Replay measures rendering inline on this thread, otherwise frames are drawn on their own
+		if (!m_replayPath && !m_renderThread.Start()) {
+			OutputDebugStringA(WARN_NO_RENDER_THREAD);
+		}
+
+		// Now calculate proper content height using real client width
+		int contentHeight = GetCalculatedContentHeight();
+		int properClientHeight = DIPToPixel_Y(contentHeight);
+
+		// Resize window to proper height
 		RECT properWindowRect = { 0, 0, clientWidth, properClientHeight };
 		AdjustWindowRectEx(&properWindowRect, WS_POPUP | WS_THICKFRAME, FALSE, WS_EX_APPWINDOW);
 
@@ -1004,14 +1164,12 @@ public:
 		ShowWindow(m_hMainWindow, SW_SHOW);
 		UpdateWindow(m_hMainWindow);
 
-		// Message loop
-		MSG msg;
-		while (GetMessage(&msg, nullptr, 0, 0)) {
-			TranslateMessage(&msg);
-			DispatchMessage(&msg);
+		if (m_replayPath) {
+			return RunReplay();
 		}
 
-		return static_cast<int>(msg.wParam);
+		// Message loop
+		return m_eventLoop.Run();
 	}
 
 private:
@@ -1024,6 +1182,14 @@ private:
 	}
 
 	LRESULT HandleWindowMessage(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+		Trace::Span span("HandleWindowMessage", message);
+		m_traceWriter.RecordWindowMessage(message, wParam, lParam);
+
+		if (message == m_taskbarCreatedMessage && m_tray.InTray()) {
+			UpdateTrayIcon(NIM_ADD);
+			return 0;
+		}
+
 		switch (message) {
 		case WM_CREATE:
 			OnInitialize();
@@ -1035,22 +1201,21 @@ private:
 			OnPaint(hWnd);
 			return 0;
 		case WM_KEYDOWN:
-			// User presses ESC when we are capturing other app window
+			// User presses ESC when we are capturing other app window, the current target stays
 			if (wParam == VK_ESCAPE && m_bCapturing) {
-				m_hTargetWindow = nullptr;
-				m_targetWindowTitle.clear();
-				m_targetProcessName.clear();
 				StopWindowCapture();
 				UpdateUI();
 			}
+			// TAB picks the target from a list instead, with or without capture running
+			else if (wParam == VK_TAB) {
+				OpenTargetList();
+			}
 			return 0;
 		case WM_KILLFOCUS:
 			// Might change this later. But we cancel capture when we lose focus. Would be nice if we 
 			// allowed user to click on explorer/taskbar to navigate to a window. But good enough for now.
+			// Like ESC, the current target and its timer are kept.
 			if (m_bCapturing) {
-				m_hTargetWindow = nullptr;
-				m_targetWindowTitle.clear();
-				m_targetProcessName.clear();
 				StopWindowCapture();
 				UpdateUI();
 			}
@@ -1094,10 +1259,10 @@ private:
 					// Update title bar button hover state
 					TitleBarHover newHover = TitleBarHover::None;
 
-					// Convert mouse Y to DIP for comparison with TITLEBAR_HEIGHT
+					// Convert mouse Y to DIP for comparison with Ui::TITLEBAR_HEIGHT
 					float dipY_check = PixelToDIP_Y(y);
 
-					if (dipY_check <= TITLEBAR_HEIGHT) {
+					if (dipY_check <= Ui::TITLEBAR_HEIGHT) {
 						// Convert mouse coordinates to DIP using stored DPI values
 						float dipX = PixelToDIP_X(x);
 						float dipY = PixelToDIP_Y(y);
@@ -1121,6 +1286,11 @@ private:
 							newHover = TitleBarHover::Help;
 							overButton = true;
 						}
+						else if (dipX >= pos.powerButtonX && dipX <= pos.powerButtonX + pos.buttonWidth &&
+							dipY >= pos.buttonY && dipY <= pos.buttonY + pos.buttonHeight) {
+							newHover = TitleBarHover::PowerSaving;
+							overButton = true;
+						}
 					}
 					else {
 						// Check main content buttons using stored DPI values
@@ -1132,26 +1302,8 @@ private:
 							CalculateLayout();
 						}
 
-						// Check target button
-						if (dipX >= m_layoutData.targetButtonRect.left && dipX <= m_layoutData.targetButtonRect.right &&
-							dipY >= m_layoutData.targetButtonRect.top && dipY <= m_layoutData.targetButtonRect.bottom) {
-							overButton = true;
-						}
-						// Check start button
-						else if (dipX >= m_layoutData.startButtonRect.left && dipX <= m_layoutData.startButtonRect.right &&
-							dipY >= m_layoutData.startButtonRect.top && dipY <= m_layoutData.startButtonRect.bottom) {
-							overButton = true;
-						}
-						// Check hour buttons
-						else {
-							for (int i = 0; i < HOUR_COUNT; i++) {
-								if (dipX >= m_layoutData.hourButtonRects[i].left && dipX <= m_layoutData.hourButtonRects[i].right &&
-									dipY >= m_layoutData.hourButtonRects[i].top && dipY <= m_layoutData.hourButtonRects[i].bottom) {
-									overButton = true;
-									break;
-								}
-							}
-						}
+						int hour;
+						overButton = Ui::HitTest(m_layoutData, dipX, dipY, hour) != Ui::Hit::None;
 					}
 
 					// Set appropriate cursor
@@ -1168,7 +1320,7 @@ private:
 						// Invalidate only the title bar area for efficiency
 						RECT clientRect;
 						GetClientRect(hWnd, &clientRect);
-						RECT titleBarRect = { 0, 0, clientRect.right, static_cast<LONG>(TITLEBAR_HEIGHT) };
+						RECT titleBarRect = { 0, 0, clientRect.right, static_cast<LONG>(Ui::TITLEBAR_HEIGHT) };
 						InvalidateRect(hWnd, &titleBarRect, FALSE);
 					}
 
@@ -1186,15 +1338,50 @@ private:
 			InvalidateRect(hWnd, nullptr, FALSE);
 			return 0;
 		case WM_SIZE:
-			if (m_pRenderTarget) {
-				RECT rc;
-				GetClientRect(hWnd, &rc);
-				D2D1_SIZE_U size = D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top);
-				m_pRenderTarget->Resize(size);
-				m_layoutData.isValid = false;
-				UpdateTitleBarButtonPositions(hWnd);
+			// Minimized has no client area to lay out, restoring sends the real size
+			if (wParam == SIZE_MINIMIZED) return 0;
+
+			// The render thread resizes its target from the next frame
+			CalculateLayout();
+			UpdateTitleBarButtonPositions(hWnd);
+			InvalidateRect(hWnd, nullptr, FALSE);
+			return 0;
+		case WM_SIZING:
+		{
+			// Width is free within limits, height always snaps to fit the reflowed content. The
+			// limits apply before the height is worked out, so it fits the width the window gets.
+			RECT* pRect = (RECT*)lParam;
+			int frameWidth = GetFrameWidth();
+			int clientWidth = (pRect->right - pRect->left) - frameWidth;
+			int minClientWidth = DIPToPixel_X(MIN_WINDOW_WIDTH);
+			int maxClientWidth = DIPToPixel_X(MAX_WINDOW_WIDTH);
+			if (clientWidth < minClientWidth || clientWidth > maxClientWidth) {
+				clientWidth = clientWidth < minClientWidth ? minClientWidth : maxClientWidth;
+				if (wParam == WMSZ_LEFT || wParam == WMSZ_TOPLEFT || wParam == WMSZ_BOTTOMLEFT) {
+					pRect->left = pRect->right - clientWidth - frameWidth;
+				}
+				else {
+					pRect->right = pRect->left + clientWidth + frameWidth;
+				}
+			}
+			int windowHeight = GetWindowHeightForClientWidth(clientWidth);
+
+			if (wParam == WMSZ_TOP || wParam == WMSZ_TOPLEFT || wParam == WMSZ_TOPRIGHT) {
+				pRect->top = pRect->bottom - windowHeight;
+			}
+			else {
+				pRect->bottom = pRect->top + windowHeight;
 			}
+			return TRUE;
+		}
+		case WM_GETMINMAXINFO:
+		{
+			MINMAXINFO* pInfo = (MINMAXINFO*)lParam;
+			int frameWidth = GetFrameWidth();
+			pInfo->ptMinTrackSize.x = DIPToPixel_X(MIN_WINDOW_WIDTH) + frameWidth;
+			pInfo->ptMaxTrackSize.x = DIPToPixel_X(MAX_WINDOW_WIDTH) + frameWidth;
 			return 0;
+		}
 		case WM_NCACTIVATE:
 		{
 			bool wasActive = m_bWindowActive;
@@ -1228,40 +1415,29 @@ private:
 			// Use the suggested window rect from Windows for position
 			RECT* pSuggestedRect = (RECT*)lParam;
 
-			// Calculate our intended width with new DPI
-			int ourClientWidth = DIPToPixel_X(WINDOW_WIDTH);
-			int tempClientHeight = DIPToPixel_Y(400);
-
-			RECT tempWindowRect = { 0, 0, ourClientWidth, tempClientHeight };
-			AdjustWindowRectEx(&tempWindowRect, WS_POPUP | WS_THICKFRAME, FALSE, WS_EX_APPWINDOW);
-
-			SetWindowPos(hWnd, nullptr,
-				pSuggestedRect->left, pSuggestedRect->top,
-				tempWindowRect.right - tempWindowRect.left,
-				tempWindowRect.bottom - tempWindowRect.top,
-				SWP_NOZORDER | SWP_NOACTIVATE);
+			// Keep the width the user sized the window to: measured in DIPs at the old DPI, sized in
+			// pixels at the new one
+			RECT currentClientRect;
+			GetClientRect(hWnd, &currentClientRect);
+			float clientWidthDIP = PixelToDIP_X(currentClientRect.right - currentClientRect.left);
 
-			// First recreate text formats and render target with new DPI
-			CreateTextFormats();
+			// Text formats are in DIPs and don't change, the render thread applies the new DPI to
+			// its target from the next frame
 			ApplyModernWindowStyling();
-			DiscardDeviceResources();
-			CreateDeviceResources(hWnd, (float)newDpiX, (float)newDpiY);
-
-			// Calculate content height with the new DPI-scaled fonts using intended client width
-			int contentHeight = GetCalculatedContentHeight(WINDOW_WIDTH);
-			int properClientHeight = DIPToPixel_Y(contentHeight);
+			m_currentDpiX = static_cast<float>(newDpiX);
+			m_currentDpiY = static_cast<float>(newDpiY);
 
-			RECT properWindowRect = { 0, 0,
-				pSuggestedRect->right - pSuggestedRect->left,
-				properClientHeight };
-			AdjustWindowRectEx(&properWindowRect, WS_POPUP | WS_THICKFRAME, FALSE, WS_EX_APPWINDOW);
+			// Height follows the content reflowed at that width
+			m_layoutData.isValid = false;
+			int contentHeight = GetCalculatedContentHeight(clientWidthDIP);
 
-			int properWindowHeight = properWindowRect.bottom - properWindowRect.top;
+			RECT windowRect = { 0, 0, DIPToPixel_X(clientWidthDIP), DIPToPixel_Y(contentHeight) };
+			AdjustWindowRectEx(&windowRect, WS_POPUP | WS_THICKFRAME, FALSE, WS_EX_APPWINDOW);
 
-			// Final resize to correct height
 			SetWindowPos(hWnd, nullptr,
 				pSuggestedRect->left, pSuggestedRect->top,
-				pSuggestedRect->right - pSuggestedRect->left, properWindowHeight,
+				windowRect.right - windowRect.left,
+				windowRect.bottom - windowRect.top,
 				SWP_NOZORDER | SWP_NOACTIVATE | SWP_FRAMECHANGED);
 
 			// Invalidate cached measurements and recalculate with new window size
@@ -1282,7 +1458,30 @@ private:
 			}
 		}
 		return DefWindowProc(hWnd, message, wParam, lParam);
+		case WM_COPYDATA:
+		{
+			// Only a coordinator takes requests (never in replay, where lParam is long gone)
+			if (!m_sharedSchedule.IsCoordinator()) break;
+			bool handled = m_sharedSchedule.OnCopyData(reinterpret_cast<HWND>(wParam), *reinterpret_cast<const COPYDATASTRUCT*>(lParam));
+			if (handled) {
+				ArmDeadline();
+				UpdatePowerState();
+			}
+			return handled ? TRUE : FALSE;
+		}
+		case WM_POWERBROADCAST:
+			if (wParam == PBT_APMRESUMEAUTOMATIC || wParam == PBT_APMRESUMESUSPEND) {
+				OnPowerResume();
+			}
+			return TRUE;
+		case WM_TRAY_ICON:
+			if (lParam == WM_LBUTTONUP || lParam == WM_RBUTTONUP) {
+				LeaveTray(SW_SHOW);
+			}
+			return 0;
 		case WM_DESTROY:
+			m_tray.Close();
+
 			// Ensure sleep prevention is disabled on exit
 			StopTimer();
 			PostQuitMessage(0);
@@ -1291,29 +1490,473 @@ private:
 		return DefWindowProc(hWnd, message, wParam, lParam);
 	}
 
+	// One instance per session serves the shared name, another one retries when it takes over
+	// coordination. Every instance serves its own name too, so a tool can arm or fire any of them.
+	void StartControlPipe() {
+		ControlProtocol::Handler handler = [this](const ControlProtocol::Command& command, std::string& reply) {
+			ControlCommands::Handle(command, *this, reply);
+		};
+		m_controlPipe.Start(CONTROL_PIPE_NAME, m_eventLoop, handler);
+
+		wchar_t name[64];
+		swprintf_s(name, CONTROL_PIPE_PID_FORMAT, static_cast<unsigned long>(GetCurrentProcessId()));
+		m_instancePipe.Start(name, m_eventLoop, handler);
+	}
+
 	void OnInitialize() {
+		// Synchronization timer so it resets once the event loop has seen it fire
+		m_hWakeTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		if (m_hWakeTimer && !m_eventLoop.Add(m_hWakeTimer, [this]() { OnWakeTimer(); })) {
+			CloseHandle(m_hWakeTimer);
+			m_hWakeTimer = nullptr;
+		}
+		m_hDeadlineTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+		if (m_hDeadlineTimer && !m_eventLoop.Add(m_hDeadlineTimer, [this]() { OnDeadline(); })) {
+			CloseHandle(m_hDeadlineTimer);
+			m_hDeadlineTimer = nullptr;
+		}
+
+		m_taskbarCreatedMessage = RegisterWindowMessageW(MSG_TASKBAR_CREATED);
+
+		m_windowIndex.SetListener([this](HWND hWnd, WindowIndex::Change change) {
+			OnWindowIndexChange(hWnd, change);
+		});
+		m_profiles.Open(GetProfilePath());
+
+		m_patternLimit = m_outputScanner.Add(PATTERN_LIMIT);
+		m_patternResetAt = m_outputScanner.Add(PATTERN_RESET_AT);
+		m_patternResets = m_outputScanner.Add(PATTERN_RESETS);
+		m_patternWorking = m_outputScanner.Add(PATTERN_WORKING);
+
+		// Replay must not take commands from outside, nor share its virtual deadlines, nor arm from
+		// files that changed since the capture
+		if (!m_replayPath) {
+			StartControlPipe();
+			m_sharedSchedule.Open(m_eventLoop, m_hMainWindow, [this]() { OnSharedFire(); }, [this]() { OnSharedScheduleChanged(); });
+			for (const std::wstring& path : m_watchPaths) {
+				WatchStatusFile(path);
+			}
+		}
+
+		// Replay must not overwrite a live export either
+		if (!m_metricsPath.empty() && !m_replayPath) {
+			ExportMetrics();
+			SetTimer(m_hMainWindow, TIMER_METRICS, METRICS_INTERVAL_MS, nullptr);
+		}
+
+		m_windowIndex.Start();
+		m_windowIndex.ForEach([this](HWND hWnd, const WindowIndex::Entry& entry) {
+			UpdateSearchCandidate(hWnd, entry);
+		});
 		UpdateUI();
 	}
 
-	AppState GetCurrentAppState() const {
-		if (m_bTimerActive) {
-			return AppState::Waiting;
+	// Keep the target's title live as the application renames itself (e.g. terminal tab changes)
+	void OnWindowIndexChange(HWND hWnd, WindowIndex::Change change) {
+		// The target list's search follows the index, one item at a time
+		const WindowIndex::Entry* pChanged = m_windowIndex.Find(hWnd);
+		if (pChanged) {
+			UpdateSearchCandidate(hWnd, *pChanged);
+		}
+		else {
+			m_targetSearch.Remove(hWnd);
+		}
+		if (m_targetList.IsOpen()) {
+			m_targetList.Refresh();
 		}
-		else if (m_hTargetWindow != nullptr) {
-			return AppState::Ready;
+
+		if (hWnd != m_hTargetWindow) return;
+
+		if (change == WindowIndex::Change::Destroyed) {
+			OnTargetGone();
+			return;
+		}
+		if (change != WindowIndex::Change::TitleChanged) return;
+
+		const WindowIndex::Entry* pEntry = m_windowIndex.Find(hWnd);
+		if (pEntry) {
+			m_targetWindowTitle = pEntry->title;
+			BuildTargetLabel();
+			UpdateUI();
+		}
+	}
+
+	// Same exclusions as clicking, explorer and our own app can't be targets
+	void UpdateSearchCandidate(HWND hWnd, const WindowIndex::Entry& entry) {
+		const std::wstring& processName = entry.process->name;
+		if (processName == PROCESS_EXPLORER || processName == PROCESS_ARCC) return;
+		m_targetSearch.Update(hWnd, processName, entry.title);
+	}
+
+	void OpenTargetList() {
+		if (m_bCapturing) {
+			StopWindowCapture();
+			UpdateUI();
+		}
+
+		// Replay must not pop up interactive windows
+		if (m_bReplaying) return;
+		m_targetList.Open();
+	}
+
+	// The list can be a moment stale, so check the window again before taking it
+	void OnTargetListPick(HWND hWnd) {
+		std::wstring processName;
+		std::wstring title;
+		if (!IsWindow(hWnd) || !GetPickableWindowInfo(hWnd, processName, title)) return;
+
+		PickTarget(hWnd, processName, title);
+		UpdateUI();
+	}
+
+	// A new target replaces the current one, and its timer with it. Picking the current target
+	// again only refreshes its title, a running timer carries on.
+	void PickTarget(HWND hWnd, std::wstring& processName, std::wstring& title) {
+		m_bTargetLost = false;
+		if (hWnd == m_hTargetWindow) {
+			m_targetWindowTitle.swap(title);
+			BuildTargetLabel();
+			return;
+		}
+
+		ClearTarget();
+		m_targetProcessName.swap(processName);
+		m_targetWindowTitle.swap(title);
+		SetTarget(hWnd);
+	}
+
+	// Target metadata is already set, take the window and start watching it
+	void SetTarget(HWND hWnd) {
+		m_hTargetWindow = hWnd;
+		BuildTargetLabel();
+		WatchTargetProcess(hWnd);
+		ApplyProfile();
+	}
+
+	// %LOCALAPPDATA%\ARCC\profiles.bin, empty (no profiles) if there's nowhere to keep it
+	static std::wstring GetProfilePath() {
+		return GetDataPath(PROFILE_FILE);
+	}
+
+	// File in %LOCALAPPDATA%\ARCC, empty if there is no such folder
+	static std::wstring GetDataPath(const wchar_t* file) {
+		wchar_t base[MAX_PATH];
+		DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", base, MAX_PATH);
+		if (length == 0 || length >= MAX_PATH) return std::wstring();
+
+		std::wstring path = base;
+		path += L'\\';
+		path += PROFILE_DIR;
+		CreateDirectoryW(path.c_str(), nullptr);
+		path += L'\\';
+		path += file;
+		return path;
+	}
+
+	// Bring back the payload and hour last used with the target's application
+	void ApplyProfile() {
+		m_resumeMessage = RESUME_MESSAGE;
+
+		ProfileStore::ProfileView profile;
+		if (!m_profiles.Find(m_targetProcessName, profile)) return;
+
+		if (profile.payloadLength > 0) {
+			m_resumeMessage.assign(profile.payload, profile.payloadLength);
+		}
+		if (profile.hourOffset >= 0 && profile.hourOffset < Ui::HOUR_COUNT) {
+			m_selectedHourOffset = profile.hourOffset;
+		}
+	}
+
+	void SaveProfile() {
+		if (m_bReplaying || m_targetProcessName.empty()) return;
+
+		ProfileStore::Profile profile;
+		profile.processName = m_targetProcessName;
+		profile.title = m_targetWindowTitle;
+		profile.payload = m_resumeMessage;
+		profile.hourOffset = m_selectedHourOffset;
+		profile.lastUsed = ToUnixSeconds(m_pClock->Now());
+		m_profiles.Save(profile);
+	}
+
+	// Two-line target button label: process name, then the quoted (truncated) title and handle
+	void BuildTargetLabel() {
+		m_targetLabelName.clear();
+		m_targetLabelDetail.clear();
+		if (!m_hTargetWindow || m_targetProcessName.empty()) return;
+
+		m_targetLabelName = m_targetProcessName;
+
+		m_targetLabelDetail = L"\"";
+		if (m_targetWindowTitle.empty()) {
+			m_targetLabelDetail += TITLE_NO_TITLE;
 		}
 		else {
-			return AppState::Idle;
+			// Limit title to specified character limit with ellipsis, never splitting a character
+			size_t end = 0;
+			int graphemes = 0;
+			while (end < m_targetWindowTitle.length() && graphemes < TITLE_CHAR_LIMIT) {
+				end = NextGrapheme(m_targetWindowTitle, end);
+				graphemes++;
+			}
+			m_targetLabelDetail.append(m_targetWindowTitle, 0, end);
+			if (end < m_targetWindowTitle.length()) {
+				m_targetLabelDetail += TITLE_ELLIPSIS;
+			}
 		}
+
+		wchar_t handle[32];
+		swprintf_s(handle, L"\" (0x%llX)", static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(m_hTargetWindow)));
+		m_targetLabelDetail += handle;
 	}
 
-	// Paint all the things
+	// End of the user-perceived character starting at pos: a code point (surrogate pairs included)
+	// plus any combining marks, variation selectors, emoji modifiers and zero-width-joined sequences
+	static size_t NextGrapheme(const std::wstring& text, size_t pos) {
+		auto codePointEnd = [&text](size_t i) {
+			if (IS_HIGH_SURROGATE(text[i]) && i + 1 < text.length() && IS_LOW_SURROGATE(text[i + 1])) {
+				return i + 2;
+			}
+			return i + 1;
+		};
+
+		pos = codePointEnd(pos);
+		while (pos < text.length()) {
+			wchar_t ch = text[pos];
+			if (ch == ZERO_WIDTH_JOINER && pos + 1 < text.length()) {
+				pos = codePointEnd(pos + 1);
+				continue;
+			}
+
+			WORD type = 0;
+			bool extends = (ch >= 0xFE00 && ch <= 0xFE0F) ||
+				(GetStringTypeW(CT_CTYPE3, &ch, 1, &type) && (type & C3_NONSPACING));
+
+			// Skin tone modifiers U+1F3FB..U+1F3FF
+			if (!extends && ch == 0xD83C && pos + 1 < text.length() && text[pos + 1] >= 0xDFFB && text[pos + 1] <= 0xDFFF) {
+				extends = true;
+			}
+			if (!extends) break;
+			pos = codePointEnd(pos);
+		}
+		return pos;
+	}
+
+	AppState GetCurrentAppState() const {
+		return Ui::GetAppState(m_hTargetWindow != nullptr, m_bTimerActive);
+	}
+
+	// Painting just hands the current state to the renderer
 	void OnPaint(HWND hWnd) {
+		Trace::Span span("OnPaint");
+
+		// Once layout exists publishing a frame should not touch the heap
+		bool steadyState = m_layoutData.isValid && m_titleBarButtonPositions.buttonWidth != 0;
+		AllocationCounter::Scope allocations;
+
 		PAINTSTRUCT ps;
-		HDC hdc = BeginPaint(hWnd, &ps);
+		BeginPaint(hWnd, &ps);
+		EndPaint(hWnd, &ps);
+
+		if (!m_bReplaying && IsIconic(hWnd)) {
+			m_pFramesSkipped->Add();
+			return;
+		}
+		PublishFrame();
+
+		if (AllocationCounter::ENABLED && steadyState && allocations.Allocations() > 0) {
+			m_paintAllocationFrames++;
+			OutputDebugStringA(WARN_PAINT_ALLOCATED);
+		}
+	}
+
+	// Snapshot everything the frame draws and wake the render thread
+	void PublishFrame() {
+		Trace::Span span("PublishFrame");
+		CalculateLayout();
+		if (m_titleBarButtonPositions.buttonWidth == 0) {
+			UpdateTitleBarButtonPositions(m_hMainWindow);
+		}
+
+		RECT clientRect;
+		GetClientRect(m_hMainWindow, &clientRect);
+
+		FrameState& frame = m_frames.WriteSlot();
+		Ui::Frame& content = frame.content;
+		content.appState = GetCurrentAppState();
+		content.hasTarget = m_hTargetWindow != nullptr;
+		content.capturing = m_bCapturing;
+		content.targetLost = m_bTargetLost;
+		content.timerActive = m_bTimerActive;
+		content.selectedHourOffset = m_selectedHourOffset;
+		content.mouseX = m_mousePos.x < 0 ? -1.0f : PixelToDIP_X(m_mousePos.x);
+		content.mouseY = m_mousePos.y < 0 ? -1.0f : PixelToDIP_Y(m_mousePos.y);
+		content.layout = m_layoutData;
+		wcsncpy_s(content.targetLabelName, m_targetLabelName.c_str(), _TRUNCATE);
+		wcsncpy_s(content.targetLabelDetail, m_targetLabelDetail.c_str(), _TRUNCATE);
+		content.countdownText[0] = L'\0';
+		if (m_bTimerActive) {
+			Ui::FormatCountdown(*m_pClock, m_targetTime, content.countdownText);
+		}
+		Ui::FormatHourLabels(*m_pClock, content.hourLabels);
+		frame.powerSaving = m_bPowerSaving;
+		frame.titleBarHover = m_titleBarHover;
+		frame.titleBarButtons = m_titleBarButtonPositions;
+		frame.pixelWidth = static_cast<UINT32>(clientRect.right - clientRect.left);
+		frame.pixelHeight = static_cast<UINT32>(clientRect.bottom - clientRect.top);
+		frame.dpiX = m_currentDpiX;
+		frame.dpiY = m_currentDpiY;
+		m_frames.Publish();
+
+		if (!m_renderThread.Signal()) {
+			// No render thread (replay, or it failed to start), draw here
+			RenderPublishedFrame();
+		}
+	}
+
+	// Minimize while waiting: there is nothing to watch until the deadline, so the window goes to
+	// the notification area and everything drawing holds is released. Replay has no tray.
+	void EnterTray() {
+		m_tray.Enter(!m_bReplaying);
+		m_pTrayOnly->Set(m_tray.InTray() ? 1 : 0);
+	}
+
+	void LeaveTray(int showCommand) {
+		if (!m_tray.InTray()) return;
+		// Without a render thread UpdateUI draws frames itself, as in replay
+		if (!m_tray.Leave(showCommand)) {
+			OutputDebugStringA(WARN_NO_RENDER_THREAD);
+		}
+		m_pTrayOnly->Set(0);
+	}
+
+	bool AddTrayIcon() override {
+		return UpdateTrayIcon(NIM_ADD);
+	}
+
+	void RemoveTrayIcon() override {
+		UpdateTrayIcon(NIM_DELETE);
+		m_trayTip[0] = L'\0';
+	}
+
+	void HideWindow() override {
+		ShowWindow(m_hMainWindow, SW_HIDE);
+	}
+
+	void MinimizeWindow() override {
+		ShowWindow(m_hMainWindow, SW_MINIMIZE);
+	}
+
+	void RestoreWindow(int showCommand) override {
+		ShowWindow(m_hMainWindow, showCommand);
+		if (showCommand == SW_SHOW) {
+			SetForegroundWindow(m_hMainWindow);
+		}
+	}
+
+	// Without a render thread there were device resources here too
+	void ReleaseDrawing() override {
+		DiscardDeviceResources();
+		ReleaseTextFormats();
+		m_textMeasureCache.Clear();
+		m_layoutData.isValid = false;
+
+		// Hand back the pages drawing touched, what stays is the idle working set
+		SetProcessWorkingSetSize(GetCurrentProcess(), static_cast<SIZE_T>(-1), static_cast<SIZE_T>(-1));
+	}
+
+	// Device resources follow with the first frame
+	void PrepareDrawing() override {
+		CreateTextFormats();
+		CalculateLayout();
+	}
+
+	bool UpdateTrayIcon(DWORD action) {
+		NOTIFYICONDATAW data = {};
+		data.cbSize = sizeof(data);
+		data.hWnd = m_hMainWindow;
+		data.uID = TRAY_ICON_ID;
+		if (action != NIM_DELETE) {
+			data.uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP;
+			data.uCallbackMessage = WM_TRAY_ICON;
+			data.hIcon = LoadIcon(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDI_MAIN_ICON));
+			FormatTrayTip(data.szTip);
+			wcsncpy_s(m_trayTip, data.szTip, _TRUNCATE);
+		}
+		return Shell_NotifyIconW(action, &data) != FALSE;
+	}
+
+	// Countdown display without a window: the tip names the deadline, so it only changes with it
+	void FormatTrayTip(wchar_t (&tip)[128]) const {
+		tm local;
+		m_pClock->ToLocal(m_targetTime, local);
+		swprintf_s(tip, TRAY_TIP_FORMAT, local.tm_hour, local.tm_min);
+	}
+
+	void UpdateTrayTip() {
+		wchar_t tip[128];
+		FormatTrayTip(tip);
+		if (wcsncmp(tip, m_trayTip, _countof(m_trayTip)) != 0) {
+			UpdateTrayIcon(NIM_MODIFY);
+		}
+	}
+
+	// Draws the newest frame, any published while the previous one was drawing are skipped.
+	// S_FALSE if the window is covered and nothing was drawn.
+	HRESULT RenderPublishedFrame() {
+		Trace::Span span("RenderPublishedFrame");
+		m_frames.Acquire();
+		const FrameState& frame = m_frames.ReadSlot();
+
+		// Once device resources exist a frame should not touch the heap
+		bool steadyState = m_pRenderTarget != nullptr;
+		AllocationCounter::Scope allocations;
+
+		HRESULT hr = RenderFrame(frame);
 
-		HRESULT hr = CreateDeviceResources(hWnd);
+		if (hr == S_FALSE) {
+			m_pFramesSkipped->Add();
+		}
+		else if (hr == D2DERR_RECREATE_TARGET) {
+			DiscardDeviceResources();
+
+			// Draw the same frame again on fresh resources
+			m_renderThread.Signal();
+		}
+		else if (AllocationCounter::ENABLED && steadyState && allocations.Allocations() > 0) {
+			m_paintAllocationFrames++;
+			OutputDebugStringA(WARN_PAINT_ALLOCATED);
+		}
+		return hr;
+	}
+
+	// Paint all the things
+	HRESULT RenderFrame(const FrameState& frame) {
+		HRESULT hr;
+		{
+			Trace::Span span("CreateDeviceResources");
+			hr = CreateDeviceResources(frame);
+		}
 		if (SUCCEEDED(hr)) {
+			// Follow window size and DPI changes
+			D2D1_SIZE_U pixelSize = m_pRenderTarget->GetPixelSize();
+			if (pixelSize.width != frame.pixelWidth || pixelSize.height != frame.pixelHeight) {
+				m_pRenderTarget->Resize(D2D1::SizeU(frame.pixelWidth, frame.pixelHeight));
+			}
+			float dpiX, dpiY;
+			m_pRenderTarget->GetDpi(&dpiX, &dpiY);
+			if (dpiX != frame.dpiX || dpiY != frame.dpiY) {
+				m_pRenderTarget->SetDpi(frame.dpiX, frame.dpiY);
+			}
+
+			// Covered or off-screen, nothing drawn would be seen
+			if (m_pRenderTarget->CheckWindowState() & D2D1_WINDOW_STATE_OCCLUDED) {
+				return S_FALSE;
+			}
+			m_pFramesRendered->Add();
+
+			Trace::Span drawSpan("Draw");
 			m_pRenderTarget->BeginDraw();
 
 			// Clear background
@@ -1321,72 +1964,22 @@ private:
 
 			// Draw custom title bar
 			D2D1_SIZE_F renderTargetSize = m_pRenderTarget->GetSize();
-			D2D1_RECT_F titleBarRect = D2D1::RectF(0, 0, renderTargetSize.width, TITLEBAR_HEIGHT);
+			D2D1_RECT_F titleBarRect = D2D1::RectF(0, 0, renderTargetSize.width, Ui::TITLEBAR_HEIGHT);
 			m_pRenderTarget->FillRectangle(&titleBarRect, m_pTitleBarBrush);
 
 			// Draw application icon
-			HICON hIcon = LoadIcon(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDI_MAIN_ICON));
-			if (hIcon) {
-				// Calculate icon size and position
-				constexpr int iconSize = 24;
-				constexpr float iconX = 8.0f;
-				constexpr float iconY = (TITLEBAR_HEIGHT - iconSize) / 2;
-
-				// Create a compatible DC for the icon
-				HDC hdcScreen = GetDC(nullptr);
-				HDC hdcMem = CreateCompatibleDC(hdcScreen);
-				HBITMAP hBitmap = CreateCompatibleBitmap(hdcScreen, iconSize, iconSize);
-				HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
-
-				// Fill background
-				RECT iconRect = { 0, 0, iconSize, iconSize };
-				HBRUSH hBrush = CreateSolidBrush(RGB(0x2A, 0x2A, 0x2A));
-				FillRect(hdcMem, &iconRect, hBrush);
-				DeleteObject(hBrush);
-
-				// Draw icon
-				DrawIconEx(hdcMem, 0, 0, hIcon, iconSize, iconSize, 0, nullptr, DI_NORMAL);
-
-				// Convert to Direct2D bitmap
-				ID2D1Bitmap* pBitmap = nullptr;
-				D2D1_SIZE_U bitmapSize = D2D1::SizeU(iconSize, iconSize);
-				D2D1_BITMAP_PROPERTIES bitmapProps = D2D1::BitmapProperties(
-					D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE));
-
-				// Get bitmap bits
-				BITMAPINFO bmi = {};
-				bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-				bmi.bmiHeader.biWidth = iconSize;
-				bmi.bmiHeader.biHeight = -iconSize;
-				bmi.bmiHeader.biPlanes = 1;
-				bmi.bmiHeader.biBitCount = 32;
-				bmi.bmiHeader.biCompression = BI_RGB;
-
-				void* pBits = malloc(static_cast<size_t>(iconSize * iconSize * 4));
-				if (pBits && GetDIBits(hdcMem, hBitmap, 0, iconSize, pBits, &bmi, DIB_RGB_COLORS)) {
-					HRESULT hr = m_pRenderTarget->CreateBitmap(bitmapSize, pBits, iconSize * 4, &bitmapProps, &pBitmap);
-					if (SUCCEEDED(hr) && pBitmap) {
-						D2D1_RECT_F destRect = D2D1::RectF(iconX, iconY, iconX + iconSize, iconY + iconSize);
-						m_pRenderTarget->DrawBitmap(pBitmap, &destRect);
-						pBitmap->Release();
-					}
-				}
-				free(pBits);
-
-				// Cleanup
-				SelectObject(hdcMem, hOldBitmap);
-				DeleteObject(hBitmap);
-				DeleteDC(hdcMem);
-				ReleaseDC(nullptr, hdcScreen);
-				DestroyIcon(hIcon);
+			constexpr float iconX = 8.0f;
+			constexpr float iconY = (Ui::TITLEBAR_HEIGHT - APP_ICON_SIZE) / 2;
+			if (m_pAppIconBitmap) {
+				D2D1_RECT_F destRect = D2D1::RectF(iconX, iconY, iconX + APP_ICON_SIZE, iconY + APP_ICON_SIZE);
+				m_pRenderTarget->DrawBitmap(m_pAppIconBitmap, &destRect);
 			}
 
 			// Draw title text using DirectWrite
 			if (m_pTitleTextFormat && m_pTextBrush) {
-				int iconSize = 24;
-				float textStartX = 8.0f + static_cast<float>(iconSize) + 8.0f;
+				float textStartX = iconX + static_cast<float>(APP_ICON_SIZE) + 8.0f;
 				// Draw main title
-				D2D1_RECT_F mainTitleRect = D2D1::RectF(textStartX, 0, 340, TITLEBAR_HEIGHT);
+				D2D1_RECT_F mainTitleRect = D2D1::RectF(textStartX, 0, 340, Ui::TITLEBAR_HEIGHT);
 				m_pRenderTarget->DrawText(
 					APP_TITLE_MAIN,
 					static_cast<UINT32>(wcslen(APP_TITLE_MAIN)),
@@ -1395,40 +1988,45 @@ private:
 					m_pTextBrush
 				);
 
-				// Calculate width of main title to position subtitle
-				IDWriteTextLayout* pMainLayout = nullptr;
-				HRESULT hr = m_pDWriteFactory->CreateTextLayout(
-					APP_TITLE_MAIN, static_cast<UINT32>(wcslen(APP_TITLE_MAIN)),
-					m_pTitleTextFormat, 1000.0f, TITLEBAR_HEIGHT, &pMainLayout);
-
-				if (SUCCEEDED(hr) && pMainLayout) {
-					DWRITE_TEXT_METRICS mainMetrics;
-					pMainLayout->GetMetrics(&mainMetrics);
-
-					// Draw subtitle with opacity and gap
-					float subtitleStartX = textStartX + mainMetrics.width + 12; // 12px gap
-					D2D1_RECT_F subtitleRect = D2D1::RectF(subtitleStartX, 0, 340, TITLEBAR_HEIGHT);
-
-					// Set opacity for subtitle
-					m_pTextBrush->SetOpacity(0.6f);
-					m_pRenderTarget->DrawText(
-						APP_TITLE_SUB,
-						static_cast<UINT32>(wcslen(APP_TITLE_SUB)),
-						m_pTitleTextFormat,
-						&subtitleRect,
-						m_pTextBrush
-					);
-					m_pTextBrush->SetOpacity(1.0f);
-
-					pMainLayout->Release();
-				}
+				// Draw subtitle with opacity and gap
+				float subtitleStartX = textStartX + m_titleMainWidth + 12; // 12px gap
+				D2D1_RECT_F subtitleRect = D2D1::RectF(subtitleStartX, 0, 340, Ui::TITLEBAR_HEIGHT);
+
+				// Set opacity for subtitle
+				m_pTextBrush->SetOpacity(0.6f);
+				m_pRenderTarget->DrawText(
+					APP_TITLE_SUB,
+					static_cast<UINT32>(wcslen(APP_TITLE_SUB)),
+					m_pTitleTextFormat,
+					&subtitleRect,
+					m_pTextBrush
+				);
+				m_pTextBrush->SetOpacity(1.0f);
 			}
 
-			// Ensure positions are calculated and draw title bar buttons
-			if (m_titleBarButtonPositions.buttonWidth == 0) {
-				UpdateTitleBarButtonPositions(hWnd);
+			// Draw title bar buttons
+			const TitleBarButtonPositions& pos = frame.titleBarButtons;
+
+			// Draw power saving toggle, green when the machine is allowed to sleep while waiting
+			D2D1_RECT_F powerButtonRect = D2D1::RectF(
+				pos.powerButtonX, pos.buttonY,
+				pos.powerButtonX + pos.buttonWidth, pos.buttonY + pos.buttonHeight);
+			m_pRenderTarget->FillRectangle(&powerButtonRect, m_pTitleBarBrush);
+
+			// Draw hover effect with opacity
+			if (frame.titleBarHover == TitleBarHover::PowerSaving) {
+				m_pWhiteBrush->SetOpacity(0.15f);
+				m_pRenderTarget->FillRectangle(&powerButtonRect, m_pWhiteBrush);
+				m_pWhiteBrush->SetOpacity(1.0f);
+			}
+
+			// Draw power saving icon
+			if (m_pIconTextFormat) {
+				m_pRenderTarget->DrawText(
+					ICON_POWER_SAVING, 1, m_pIconTextFormat,
+					&powerButtonRect, frame.powerSaving ? m_pGreenBrush : m_pTextBrush
+				);
 			}
-			const TitleBarButtonPositions& pos = m_titleBarButtonPositions;
 
 			// Draw help button
 			D2D1_RECT_F helpButtonRect = D2D1::RectF(
@@ -1437,7 +2035,7 @@ private:
 			m_pRenderTarget->FillRectangle(&helpButtonRect, m_pTitleBarBrush);
 
 			// Draw hover effect with opacity
-			if (m_titleBarHover == TitleBarHover::Help) {
+			if (frame.titleBarHover == TitleBarHover::Help) {
 				m_pWhiteBrush->SetOpacity(0.15f);
 				m_pRenderTarget->FillRectangle(&helpButtonRect, m_pWhiteBrush);
 				m_pWhiteBrush->SetOpacity(1.0f);
@@ -1458,7 +2056,7 @@ private:
 			m_pRenderTarget->FillRectangle(&minimizeButtonRect, m_pTitleBarBrush);
 
 			// Draw hover effect with opacity
-			if (m_titleBarHover == TitleBarHover::Minimize) {
+			if (frame.titleBarHover == TitleBarHover::Minimize) {
 				m_pWhiteBrush->SetOpacity(0.15f);
 				m_pRenderTarget->FillRectangle(&minimizeButtonRect, m_pWhiteBrush);
 				m_pWhiteBrush->SetOpacity(1.0f);
@@ -1479,7 +2077,7 @@ private:
 			m_pRenderTarget->FillRectangle(&closeButtonRect, m_pTitleBarBrush);
 
 			// Draw hover effect with opacity
-			if (m_titleBarHover == TitleBarHover::Close) {
+			if (frame.titleBarHover == TitleBarHover::Close) {
 				m_pRedBrush->SetOpacity(0.8f);
 				m_pRenderTarget->FillRectangle(&closeButtonRect, m_pRedBrush);
 				m_pRedBrush->SetOpacity(1.0f);
@@ -1494,23 +2092,19 @@ private:
 			}
 
 			// Draw main UI content
-			DrawMainContent();
+			Ui::DrawContent(frame.content, m_canvas);
 
+			Trace::Span span("EndDraw");
 			hr = m_pRenderTarget->EndDraw();
-
-			if (hr == D2DERR_RECREATE_TARGET) {
-				DiscardDeviceResources();
-			}
 		}
-
-		EndPaint(hWnd, &ps);
+		return hr;
 	}
 
 	void OnMouseLeftClick(HWND hWnd, int x, int y) {
 		float dipY_check = PixelToDIP_Y(y);
 
 		// Deal with a title bar click
-		if (dipY_check <= TITLEBAR_HEIGHT) {
+		if (dipY_check <= Ui::TITLEBAR_HEIGHT) {
 			float dipX = PixelToDIP_X(x);
 			float dipY = PixelToDIP_Y(y);
 
@@ -1523,11 +2117,23 @@ private:
 			}
 			else if (dipX >= pos.minimizeButtonX && dipX <= pos.minimizeButtonX + pos.buttonWidth &&
 				dipY >= pos.buttonY && dipY <= pos.buttonY + pos.buttonHeight) {
-				ShowWindow(hWnd, SW_MINIMIZE);
+				if (m_bTimerActive) {
+					EnterTray();
+				}
+				else {
+					ShowWindow(hWnd, SW_MINIMIZE);
+				}
 			}
 			else if (dipX >= pos.helpButtonX && dipX <= pos.helpButtonX + pos.buttonWidth &&
 				dipY >= pos.buttonY && dipY <= pos.buttonY + pos.buttonHeight) {
-				ShellExecuteA(nullptr, "open", HELP_URL, nullptr, nullptr, SW_SHOWNORMAL);
+				if (!m_bReplaying) {
+					ShellExecuteA(nullptr, "open", HELP_URL, nullptr, nullptr, SW_SHOWNORMAL);
+				}
+			}
+			else if (dipX >= pos.powerButtonX && dipX <= pos.powerButtonX + pos.buttonWidth &&
+				dipY >= pos.buttonY && dipY <= pos.buttonY + pos.buttonHeight) {
+				TogglePowerSaving();
+				InvalidateRect(hWnd, nullptr, FALSE);
 			}
 			else {
 				// Start dragging
@@ -1561,29 +2167,22 @@ private:
 			CalculateLayout();
 		}
 
-		if (dipX >= m_layoutData.targetButtonRect.left && dipX <= m_layoutData.targetButtonRect.right &&
-			dipY >= m_layoutData.targetButtonRect.top && dipY <= m_layoutData.targetButtonRect.bottom) {
+		int hour = 0;
+		switch (Ui::HitTest(m_layoutData, dipX, dipY, hour)) {
+		case Ui::Hit::TargetButton:
 			StartWindowCapture();
-			return;
-		}
-
-		if (dipX >= m_layoutData.startButtonRect.left && dipX <= m_layoutData.startButtonRect.right &&
-			dipY >= m_layoutData.startButtonRect.top && dipY <= m_layoutData.startButtonRect.bottom) {
-			AppState currentState = GetCurrentAppState();
-			if (currentState != AppState::Idle) {
+			break;
+		case Ui::Hit::StartButton:
+			if (GetCurrentAppState() != AppState::Idle) {
 				ToggleTimer();
 			}
-			return;
-		}
-
-		// Hour button hit tests
-		for (int i = 0; i < HOUR_COUNT; i++) {
-			if (dipX >= m_layoutData.hourButtonRects[i].left && dipX <= m_layoutData.hourButtonRects[i].right &&
-				dipY >= m_layoutData.hourButtonRects[i].top && dipY <= m_layoutData.hourButtonRects[i].bottom) {
-				m_selectedHourOffset = i;
-				InvalidateRect(hWnd, nullptr, FALSE);
-				return;
-			}
+			break;
+		case Ui::Hit::HourButton:
+			m_selectedHourOffset = hour;
+			InvalidateRect(hWnd, nullptr, FALSE);
+			break;
+		case Ui::Hit::None:
+			break;
 		}
 	}
 
@@ -1596,30 +2195,125 @@ private:
 	void OnTimer(HWND hWnd, WPARAM timerID) {
 		switch (timerID) {
 		case TIMER_COUNTDOWN:
-			CheckCountdown();
+			OnDeadline();
 			break;
 		case TIMER_STATUS_UPDATE:
+			// Replay has no deadline timer, the recorded ticks move the virtual clock instead
+			if (m_bReplaying) {
+				CheckCountdown();
+			}
 			UpdateUI();
 			break;
+		case TIMER_PICKER:
+			UpdatePicker();
+			break;
+		case TIMER_METRICS:
+			ExportMetrics();
+			break;
 		}
 	}
 
+	// The current target and its timer stay until another window is actually picked, so an
+	// abandoned re-selection (ESC, focus lost) changes nothing
 	void StartWindowCapture() {
-		// Clear any existing target to start fresh
-		m_hTargetWindow = nullptr;
-		m_targetWindowTitle.clear();
-		m_targetProcessName.clear();
-
 		m_bCapturing = true;
 
 		UpdateUI();
 
+		// Replay shows the capture state but must not grab the live mouse
+		if (m_bReplaying) return;
+
 		m_hInputHook = SetWindowsHookEx(WH_MOUSE_LL, InputHookProc, GetModuleHandle(nullptr), 0);
 		if (!m_hInputHook) {
 			MessageBoxA(m_hMainWindow, ERR_HOOK_FAILED, ERR_TITLE, MB_OK | MB_ICONERROR);
 			m_bCapturing = false;
 			UpdateUI();
+			return;
+		}
+
+		GetCursorPos(&m_pickerCursor);
+		m_bPickerCursorMoved = true;
+		m_hPickerWindow = nullptr;
+		SetTimer(m_hMainWindow, TIMER_PICKER, GetPickerInterval(), nullptr);
+	}
+
+	// One display refresh, resolving faster than the overlay can be shown is wasted work. SetTimer
+	// raises anything shorter than USER_TIMER_MINIMUM (10ms) to that.
+	static UINT GetPickerInterval() {
+		DEVMODEW mode = {};
+		mode.dmSize = sizeof(mode);
+		DWORD refreshRate = PICKER_DEFAULT_REFRESH_RATE;
+		if (EnumDisplaySettingsW(nullptr, ENUM_CURRENT_SETTINGS, &mode) && mode.dmDisplayFrequency > 1) {
+			refreshRate = mode.dmDisplayFrequency;
+		}
+		return 1000 / refreshRate;
+	}
+
+	// Top-level window under pt, child windows (e.g. terminal input sites) have no useful title
+	static HWND GetPickableWindow(POINT pt) {
+		HWND hWnd = WindowFromPoint(pt);
+		if (hWnd) {
+			hWnd = GetAncestor(hWnd, GA_ROOT);
+		}
+		return hWnd;
+	}
+
+	// Process name and title for a pick candidate, from the window index where it has them. Returns
+	// false for windows that can't be targets.
+	bool GetPickableWindowInfo(HWND hWnd, std::wstring& processName, std::wstring& title) {
+		const WindowIndex::Entry* pEntry = m_windowIndex.Find(hWnd);
+
+		// Get process name
+		if (pEntry) {
+			processName = pEntry->process->name;
+		}
+		else {
+			DWORD processId;
+			GetWindowThreadProcessId(hWnd, &processId);
+			processName = m_windowIndex.LookupProcessName(processId);
+		}
+
+		// Skip explorer and our own app
+		if (processName == PROCESS_EXPLORER || processName == PROCESS_ARCC) {
+			return false;
+		}
+
+		// Get window title
+		if (pEntry) {
+			title = pEntry->title;
+		}
+		else {
+			wchar_t titleW[256];
+			GetWindowTextW(hWnd, titleW, sizeof(titleW) / sizeof(wchar_t));
+			title = titleW;
+		}
+		return true;
+	}
+
+	// Move the highlight to whatever the cursor is over now. Only a new window under the cursor
+	// costs a lookup, otherwise this just follows the highlighted window if it moved.
+	void UpdatePicker() {
+		if (!m_hInputHook) return;
+
+		if (m_bPickerCursorMoved) {
+			m_bPickerCursorMoved = false;
+			HWND hWnd = GetPickableWindow(m_pickerCursor);
+			if (hWnd != m_hPickerWindow) {
+				m_hPickerWindow = hWnd;
+
+				std::wstring processName;
+				std::wstring title;
+				if (hWnd && GetPickableWindowInfo(hWnd, processName, title)) {
+					m_pickerOverlay.Show(hWnd, processName, title);
+				}
+				else {
+					m_pickerOverlay.Hide();
+				}
+				return;
+			}
 		}
+
+		m_pickerOverlay.Track();
 	}
 
 	static LRESULT CALLBACK InputHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
@@ -1632,56 +2326,30 @@ private:
 
 	// Mouse tracking during app window selection
 	LRESULT HandleInputHook(int nCode, WPARAM wParam, LPARAM lParam) {
+		Trace::Span span("HandleInputHook", static_cast<uint32_t>(wParam));
+
+		// Mice can report at 1000Hz and the hook stalls all input while it runs, so just note the
+		// position and leave resolving the window to the picker timer
+		if (nCode >= 0 && wParam == WM_MOUSEMOVE) {
+			const MSLLHOOKSTRUCT* pMouse = reinterpret_cast<const MSLLHOOKSTRUCT*>(lParam);
+			m_pickerCursor = pMouse->pt;
+			m_bPickerCursorMoved = true;
+		}
+
 		if (nCode >= 0 && wParam == WM_LBUTTONDOWN) {
 			POINT pt;
 			GetCursorPos(&pt);
-			HWND hWnd = WindowFromPoint(pt);
+			HWND hWnd = GetPickableWindow(pt);
 
 			if (hWnd) {
-				// Get process name
-				DWORD processId;
-				GetWindowThreadProcessId(hWnd, &processId);
-				HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-				if (hSnapshot != INVALID_HANDLE_VALUE) {
-					PROCESSENTRY32 pe{};
-					pe.dwSize = sizeof(PROCESSENTRY32);
-					if (Process32First(hSnapshot, &pe)) {
-						do {
-							if (pe.th32ProcessID == processId) {
-								m_targetProcessName = pe.szExeFile;
-								// Remove .exe extension
-								size_t pos = m_targetProcessName.find(FILE_EXT_EXE);
-								if (pos != std::string::npos) {
-									m_targetProcessName = m_targetProcessName.substr(0, pos);
-								}
-								break;
-							}
-						} while (Process32Next(hSnapshot, &pe));
-					}
-					CloseHandle(hSnapshot);
-				}
-
-				// Skip explorer and our own app - this isn't working atm as we cancel tracking on losing focus
-				if (m_targetProcessName == PROCESS_EXPLORER || m_targetProcessName == PROCESS_ARCC) {
+				// Skip explorer and our own app - the latter isn't working atm as we cancel tracking on losing focus
+				std::wstring processName;
+				std::wstring title;
+				if (!GetPickableWindowInfo(hWnd, processName, title)) {
 					return CallNextHookEx(m_hInputHook, nCode, wParam, lParam);
 				}
 
-				// Get window title
-				wchar_t titleW[256];
-				GetWindowTextW(hWnd, titleW, sizeof(titleW) / sizeof(wchar_t));
-
-				// Convert to UTF-8
-				int utf8Length = WideCharToMultiByte(CP_UTF8, 0, titleW, -1, nullptr, 0, nullptr, nullptr);
-				if (utf8Length > 0) {
-					std::string utf8Title(utf8Length - 1, '\0');
-					WideCharToMultiByte(CP_UTF8, 0, titleW, -1, &utf8Title[0], utf8Length, nullptr, nullptr);
-					m_targetWindowTitle = utf8Title;
-				}
-				else {
-					m_targetWindowTitle.clear();
-				}
-
-				m_hTargetWindow = hWnd;
+				PickTarget(hWnd, processName, title);
 				StopWindowCapture();
 				UpdateUI();
 			}
@@ -1690,11 +2358,59 @@ private:
 		return CallNextHookEx(m_hInputHook, nCode, wParam, lParam);
 	}
 
+	// A timer without a target has nothing to resume, so clearing the target also stops it
+	void ClearTarget() {
+		UnwatchTargetProcess();
+		StopTimer();
+		m_hTargetWindow = nullptr;
+		m_targetWindowTitle.clear();
+		m_targetProcessName.clear();
+		m_resumeMessage = RESUME_MESSAGE;
+		BindTmuxPane(-1);
+		BuildTargetLabel();
+	}
+
+	// Register the target's process handle with the event loop so exit is seen immediately
+	void WatchTargetProcess(HWND hWnd) {
+		UnwatchTargetProcess();
+
+		DWORD processId = 0;
+		GetWindowThreadProcessId(hWnd, &processId);
+		m_hTargetProcess = OpenProcess(SYNCHRONIZE, FALSE, processId);
+		if (m_hTargetProcess && !m_eventLoop.Add(m_hTargetProcess, [this]() { OnTargetGone(); })) {
+			CloseHandle(m_hTargetProcess);
+			m_hTargetProcess = nullptr;
+		}
+	}
+
+	void UnwatchTargetProcess() {
+		if (m_hTargetProcess) {
+			m_eventLoop.Remove(m_hTargetProcess);
+			CloseHandle(m_hTargetProcess);
+			m_hTargetProcess = nullptr;
+		}
+	}
+
+	// Target process exited or its window was destroyed
+	void OnTargetGone() {
+		bool wasWaiting = m_bTimerActive;
+		ClearTarget();
+		m_bTargetLost = true;
+		if (wasWaiting) {
+			m_selectedHourOffset = 0;
+			FlashWindow(m_hMainWindow, TRUE);
+		}
+		UpdateUI();
+	}
+
 	void StopWindowCapture() {
 		if (m_hInputHook) {
 			UnhookWindowsHookEx(m_hInputHook);
 			m_hInputHook = nullptr;
+			KillTimer(m_hMainWindow, TIMER_PICKER);
 		}
+		m_pickerOverlay.Hide();
+		m_hPickerWindow = nullptr;
 		m_bCapturing = false;
 	}
 
@@ -1708,91 +2424,678 @@ private:
 				return;
 			}
 
-			// Calculate target time based on selected hour offset
-			auto now = std::chrono::system_clock::now();
-			auto time_t = std::chrono::system_clock::to_time_t(now);
-			struct tm local_tm;
-			localtime_s(&local_tm, &time_t);
+			// Calculate target time based on selected hour offset, a moment after the limit resets
+			StartTimer(Schedule::HourTarget(*m_pClock, m_selectedHourOffset));
+		}
+
+		UpdateUI();
+	}
 
-			// Add 1 to get the start of the next hour, then add the selected offset
-			int targetHour = local_tm.tm_hour + 1 + m_selectedHourOffset;
+	// Needs a target, the caller updates the UI
+	void StartTimer(Clock::time_point deadline) {
+		m_resumeJob = m_scheduler.Arm(deadline, reinterpret_cast<uintptr_t>(m_hTargetWindow));
+		OnResumeJobArmed();
+	}
 
-			// Handle day rollover
-			int dayOffset = 0;
-			if (targetHour >= 24) {
-				dayOffset = targetHour / 24;
-				targetHour = targetHour % 24;
-			}
+	// Resumes at every occurrence of the rule until stopped
+	void StartRecurringTimer(const Recurrence& recurrence) {
+		m_resumeJob = m_scheduler.ArmRecurring(recurrence, *m_pClock, reinterpret_cast<uintptr_t>(m_hTargetWindow));
+		OnResumeJobArmed();
+	}
 
-			// Set target time with the calculated hour
-			local_tm.tm_hour = targetHour;
-			local_tm.tm_min = 0;
-			local_tm.tm_sec = 10;	// want to resume a moment after limit reset
+	void OnResumeJobArmed() {
+		m_targetTime = m_scheduler.Find(m_resumeJob)->deadline;
+		m_pTimersStarted->Add();
+		m_pArmedJobs->Set(static_cast<int64_t>(m_scheduler.Size()));
 
-			auto target = std::chrono::system_clock::from_time_t(mktime(&local_tm));
-			if (dayOffset > 0) {
-				target += std::chrono::hours(24 * dayOffset);
-			}
+		// Deadline timer, plus the countdown display
+		SetTimer(m_hMainWindow, TIMER_STATUS_UPDATE, 1000, nullptr);
+		m_bTimerActive = true;
 
-			m_targetTime = target;
+		// Prevent system sleep while timer is active, or only for the final stretch in power saving
+		// mode. Another instance may be coordinating, then it does both for us.
+		PublishDeadline();
 
-			// Start timers
-			SetTimer(m_hMainWindow, TIMER_COUNTDOWN, 1000, nullptr);
-			SetTimer(m_hMainWindow, TIMER_STATUS_UPDATE, 1000, nullptr);
-			m_bTimerActive = true;
+		SaveProfile();
+	}
 
-			// Prevent system sleep while timer is active
-			SetThreadExecutionState(ES_CONTINUOUS | ES_SYSTEM_REQUIRED | ES_DISPLAY_REQUIRED);
+	// True if a resume fired
+	bool CheckCountdown() {
+		Trace::Span span("CheckCountdown");
+
+		// see if it's time to send resume
+		Clock::time_point now = m_pClock->Now();
+		size_t fired = m_scheduler.RunDue(*m_pClock, [](const Scheduler::Job&) {});
+		if (fired == 0) return false;
+
+		m_pResumeLateness->Record(static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::microseconds>(now - m_targetTime).count()));
+
+		// A recurring job is already re-armed, so the timer just carries on to the next occurrence
+		const Scheduler::Job* pNext = m_scheduler.Find(m_resumeJob);
+		if (pNext) {
+			m_targetTime = pNext->deadline;
+			DeliverResume();
+			PublishDeadline();
+			UpdateUI();
+			return true;
 		}
 
+		FireResume();
+		return true;
+	}
+
+	// Deadline reached (or fired early from the control pipe)
+	void FireResume() {
+		DeliverResume();
+		StopTimer();
+		m_selectedHourOffset = 0;
 		UpdateUI();
 	}
 
-	void CheckCountdown() {
-		auto now = std::chrono::system_clock::now();
-		// see if it's time to send resume
-		if (now >= m_targetTime) {
-			SendResumeMessage();
+	// Send the resume message and record how it went
+	void DeliverResume() {
+		LARGE_INTEGER start, end, freq;
+		QueryPerformanceCounter(&start);
+		Delivery delivery = SendResumeMessage();
+		QueryPerformanceCounter(&end);
+		QueryPerformanceFrequency(&freq);
+
+		uint64_t ticks = static_cast<uint64_t>(end.QuadPart - start.QuadPart);
+		if (delivery != Delivery::None) {
+			// Throughput of the payload alone, focusing the target isn't part of it
+			uint64_t bytes = static_cast<uint64_t>(WideCharToMultiByte(CP_UTF8, 0, m_resumeMessage.c_str(),
+				static_cast<int>(m_resumeMessage.size()), nullptr, 0, nullptr, nullptr));
+			m_pDeliveredBytes->Add(bytes);
+			if (m_payloadTicks > 0) {
+				m_pDeliveryBytesPerSecond->Set(static_cast<int64_t>(bytes * static_cast<uint64_t>(freq.QuadPart) / static_cast<uint64_t>(m_payloadTicks)));
+			}
+		}
+		switch (delivery) {
+		case Delivery::None:
+			m_pDeliveryFailures->Add();
+			break;
+		case Delivery::Keystrokes:
+			m_pDeliveries->Add();
+			m_pKeystrokeDeliveryTime->RecordTicks(ticks, static_cast<uint64_t>(freq.QuadPart));
+			break;
+		case Delivery::Clipboard:
+			m_pDeliveries->Add();
+			m_pClipboardDeliveryTime->RecordTicks(ticks, static_cast<uint64_t>(freq.QuadPart));
+			break;
+		case Delivery::Tmux:
+			// The pane's output tells when the keys arrived and when the session got going
+			m_pDeliveries->Add();
+			m_pTmuxDeliveryTime->RecordTicks(ticks, static_cast<uint64_t>(freq.QuadPart));
+			m_resumeFiredTicks = start.QuadPart;
+			m_bAwaitingFirstOutput = true;
+			m_bAwaitingWorking = true;
+			break;
+		}
+	}
+
+	// ControlTarget: control pipe commands, with the same effect as the matching clicks
+	const Clock& GetClock() const override {
+		return *m_pClock;
+	}
+
+	bool HasTarget() const override {
+		return m_hTargetWindow != nullptr;
+	}
+
+	std::string TargetName() const override {
+		return ToUtf8(m_targetProcessName);
+	}
+
+	bool TimerActive() const override {
+		return m_bTimerActive;
+	}
+
+	uint64_t ArmedJob() const override {
+		return m_resumeJob;
+	}
+
+	Clock::time_point Deadline() const override {
+		return m_targetTime;
+	}
+
+	void ArmHour(int hourOffset, Clock::time_point deadline) override {
+		m_selectedHourOffset = hourOffset;
+		Arm(deadline);
+	}
+
+	void Arm(Clock::time_point deadline) override {
+		StopTimer();
+		StartTimer(deadline);
+		UpdateUI();
+	}
+
+	void ArmRecurring(const Recurrence& recurrence) override {
+		StopTimer();
+		StartRecurringTimer(recurrence);
+		UpdateUI();
+	}
+
+	void Cancel() override {
+		StopTimer();
+		UpdateUI();
+	}
+
+	void Fire() override {
+		FireResume();
+	}
+
+	size_t SharedJobs(SharedJob* jobs, size_t capacity) override {
+		SharedSchedule::Entry entries[SharedSchedule::MAX_ENTRIES];
+		size_t count = m_sharedSchedule.Snapshot(entries);
+		if (count > capacity) count = capacity;
+		for (size_t i = 0; i < count; i++) {
+			jobs[i].ownerPid = entries[i].ownerPid;
+			jobs[i].job = entries[i].job;
+			jobs[i].deadline = entries[i].deadline / 1000;
+		}
+		return count;
+	}
+
+	bool SetPayload(bool reset, const std::string& path, size_t& length) override {
+		if (reset) {
+			m_resumeMessage = RESUME_MESSAGE;
+		}
+		else if (!ReadPayload(path, m_resumeMessage)) {
+			return false;
+		}
+		SaveProfile();
+		length = m_resumeMessage.size();
+		return true;
+	}
+
+	int64_t SetWakeLead(int64_t seconds) override {
+		m_wakeLeadSeconds = ClampWakeLead(seconds);
+		UpdatePowerState();
+		return m_wakeLeadSeconds;
+	}
+
+	bool Watch(const std::string& path) override {
+		return WatchStatusFile(FromUtf8(path));
+	}
+
+	void StopWatching() override {
+		for (const auto& provider : m_resetProviders) {
+			m_stoppedStatusBytes += provider->BytesParsed();
+		}
+		m_resetProviders.clear();
+	}
+
+	size_t WatchCount() const override {
+		return m_resetProviders.size();
+	}
+
+	bool BindPane(int64_t pane) override {
+		if (pane >= 0 && !m_tmux.Connect(TMUX_COMMAND, m_eventLoop)) return false;
+		BindTmuxPane(pane);
+		return true;
+	}
+
+	std::string PaneId() const override {
+		return m_tmuxPane >= 0 ? GetTmuxPaneId() : std::string();
+	}
+
+	void EnableTrace(bool enable) override {
+		Trace::Enable(enable);
+	}
+
+	bool DumpTrace(std::string& path) override {
+		std::wstring file = GetDataPath(TRACE_FILE);
+		if (file.empty() || !Trace::WriteChromeJson(file)) return false;
+		path = ToUtf8(file);
+		return true;
+	}
+
+	void RegisterMetrics() {
+		m_pResumeLateness = &m_metrics.AddHistogram("arcc_resume_lateness_seconds", "How long after its deadline a resume fired");
+		m_pKeystrokeDeliveryTime = &m_metrics.AddHistogram("arcc_keystroke_delivery_seconds", "Time taken to type the resume message into the target window");
+		m_pClipboardDeliveryTime = &m_metrics.AddHistogram("arcc_clipboard_delivery_seconds", "Time taken to paste a multi-line or long resume message into the target window");
+		m_pTmuxDeliveryTime = &m_metrics.AddHistogram("arcc_tmux_delivery_seconds", "Time taken to send the resume message to the tmux pane");
+		m_pTmuxFirstOutput = &m_metrics.AddHistogram("arcc_tmux_first_output_seconds", "From firing a resume to the pane's first output");
+		m_pTmuxWorking = &m_metrics.AddHistogram("arcc_tmux_working_seconds", "From firing a resume to the pane showing the session working");
+		m_pDeliveries = &m_metrics.AddCounter("arcc_deliveries_total", "Resume messages delivered");
+		m_pDeliveryFailures = &m_metrics.AddCounter("arcc_delivery_failures_total", "Resumes due with the target gone");
+		m_pDeliveredBytes = &m_metrics.AddCounter("arcc_delivered_bytes_total", "Resume message bytes (UTF-8) delivered");
+		m_pDeliveryBytesPerSecond = &m_metrics.AddGauge("arcc_delivery_bytes_per_second", "Payload throughput of the last delivery, from after the target was focused");
+		m_pTimersStarted = &m_metrics.AddCounter("arcc_timers_started_total", "Timers started from the UI, control pipe or pane output");
+		m_pLoopWakeups = &m_metrics.AddCounter("arcc_event_loop_wakeups_total", "Times the event loop woke up");
+		m_pArmedJobs = &m_metrics.AddGauge("arcc_armed_jobs", "Resume jobs waiting for their deadline");
+		m_pFramesRendered = &m_metrics.AddCounter("arcc_frames_rendered_total", "Frames drawn");
+		m_pFramesSkipped = &m_metrics.AddCounter("arcc_frames_skipped_total", "Frames not drawn because the window was minimized, in the tray or covered");
+		m_pRendersPerHour = &m_metrics.AddGauge("arcc_renders_per_hour", "Frames drawn per hour over the last export interval");
+		m_pWorkingSet = &m_metrics.AddGauge("arcc_working_set_bytes", "Process working set at the last export");
+		m_pTrayOnly = &m_metrics.AddGauge("arcc_tray_only", "1 while waiting in the tray with rendering released");
+		m_pResetUpdates = &m_metrics.AddCounter("arcc_reset_updates_total", "New reset times read from watched status files");
+		m_pResetRearmTime = &m_metrics.AddHistogram("arcc_reset_rearm_seconds", "From a status file change being noticed to the timer re-armed for it");
+		m_pStatusBytesParsed = &m_metrics.AddCounter("arcc_status_bytes_parsed_total", "Bytes of watched status files parsed");
+	}
+
+	void ExportMetrics() {
+		m_pLoopWakeups->Set(m_eventLoop.GetStats().wakeCount);
+
+		// Render rate since the previous export, so tray and covered stretches show up as such
+		ULONGLONG now = GetTickCount64();
+		uint64_t rendered = m_pFramesRendered->Value();
+		if (m_lastExportTick != 0 && now > m_lastExportTick) {
+			m_pRendersPerHour->Set(static_cast<int64_t>((rendered - m_lastExportRendered) * 3600000 / (now - m_lastExportTick)));
+		}
+		m_lastExportTick = now;
+		m_lastExportRendered = rendered;
+
+		uint64_t statusBytes = m_stoppedStatusBytes;
+		for (const auto& provider : m_resetProviders) {
+			statusBytes += provider->BytesParsed();
+		}
+		m_pStatusBytesParsed->Set(statusBytes);
+
+		PROCESS_MEMORY_COUNTERS memory = {};
+		memory.cb = sizeof(memory);
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory))) {
+			m_pWorkingSet->Set(static_cast<int64_t>(memory.WorkingSetSize));
+		}
+
+		m_metricsFile.Write(m_metrics, m_metricsPath);
+	}
+
+	static int64_t ToUnixSeconds(Clock::time_point time) {
+		return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+	}
+
+	// UTF-8 text file (a BOM is skipped), at most MAX_PAYLOAD characters and not empty
+	static bool ReadPayload(const std::string& utf8Path, std::wstring& payload) {
+		std::wstring path = FromUtf8(utf8Path);
+		if (path.empty()) return false;
+
+		HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) return false;
+
+		// UTF-8 takes at least one byte per UTF-16 unit, four for the longest
+		LARGE_INTEGER size;
+		std::string bytes;
+		DWORD read = 0;
+		bool ok = GetFileSizeEx(hFile, &size) && size.QuadPart > 0 && size.QuadPart <= static_cast<LONGLONG>(MAX_PAYLOAD * 4);
+		if (ok) {
+			bytes.resize(static_cast<size_t>(size.QuadPart));
+			ok = ReadFile(hFile, &bytes[0], static_cast<DWORD>(bytes.size()), &read, nullptr) && read == bytes.size();
+		}
+		CloseHandle(hFile);
+		if (!ok) return false;
+
+		size_t offset = bytes.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+		int length = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, bytes.data() + offset, static_cast<int>(bytes.size() - offset), nullptr, 0);
+		if (length <= 0 || static_cast<size_t>(length) > MAX_PAYLOAD) return false;
+		payload.resize(static_cast<size_t>(length));
+		MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, bytes.data() + offset, static_cast<int>(bytes.size() - offset), &payload[0], length);
+		return true;
+	}
+
+	static int64_t ToUnixMillis(Clock::time_point time) {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+	}
+
+	static Clock::time_point FromUnixMillis(int64_t millis) {
+		return Clock::time_point(std::chrono::duration_cast<Clock::time_point::duration>(std::chrono::milliseconds(millis)));
+	}
+
+	static std::string ToUtf8(const std::wstring& text) {
+		if (text.empty()) return std::string();
+		int length = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+		std::string utf8(static_cast<size_t>(length), '\0');
+		WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), &utf8[0], length, nullptr, nullptr);
+		return utf8;
+	}
+
+	// Empty if the text isn't valid UTF-8
+	static std::wstring FromUtf8(const std::string& utf8) {
+		if (utf8.empty()) return std::wstring();
+		int length = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, utf8.c_str(), static_cast<int>(utf8.size()), nullptr, 0);
+		if (length <= 0) return std::wstring();
+		std::wstring text(static_cast<size_t>(length), L'\0');
+		MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, utf8.c_str(), static_cast<int>(utf8.size()), &text[0], length);
+		return text;
+	}
+
+	std::string GetTmuxPaneId() const {
+		return "%" + std::to_string(m_tmuxPane);
+	}
+
+	// Deliver to and watch this pane, -1 to unbind
+	void BindTmuxPane(int64_t pane) {
+		if (m_tmuxPane >= 0) {
+			m_tmux.Unsubscribe(GetTmuxPaneId());
+		}
+		m_tmuxPane = pane;
+		m_paneStream = PatternScanner::Stream();
+		m_bCapturingReset = false;
+		m_bAwaitingFirstOutput = false;
+		m_bAwaitingWorking = false;
+		if (m_tmuxPane >= 0) {
+			m_tmux.Subscribe(GetTmuxPaneId(), [this](const char* data, size_t length) {
+				OnPaneOutput(data, length);
+			});
+		}
+	}
+
+	void OnPaneOutput(const char* data, size_t length) {
+		if (m_bAwaitingFirstOutput) {
+			m_bAwaitingFirstOutput = false;
+			RecordSinceResume(*m_pTmuxFirstOutput);
+		}
+
+		bool limit = false;
+		bool working = false;
+		uint64_t chunkOffset = m_paneStream.offset;
+		m_outputScanner.Scan(m_paneStream, data, length, [&](uint32_t pattern, uint64_t offset) {
+			int index = static_cast<int>(pattern);
+			if (index == m_patternLimit) {
+				limit = true;
+			}
+			else if (index == m_patternWorking) {
+				working = true;
+			}
+			else if (index == m_patternResetAt || index == m_patternResets) {
+				m_bCapturingReset = true;
+				m_resetTextOffset = offset + (index == m_patternResetAt ? strlen(PATTERN_RESET_AT) : strlen(PATTERN_RESETS));
+				m_resetTextLength = 0;
+			}
+		});
+
+		if (working && m_bAwaitingWorking) {
+			m_bAwaitingWorking = false;
+			RecordSinceResume(*m_pTmuxWorking);
+		}
+		if (working && m_bAutoArmed) {
+			// Resumed some other way, the armed resume would only interrupt
 			StopTimer();
-			m_selectedHourOffset = 0;
 			UpdateUI();
 		}
+		if (limit && !m_bTimerActive && m_hTargetWindow) {
+			// No reset time yet, limits reset on the hour
+			StartTimer(Schedule::HourTarget(*m_pClock, 0));
+			m_bAutoArmed = true;
+			UpdateUI();
+		}
+		if (m_bCapturingReset) {
+			CaptureResetText(data, length, chunkOffset);
+		}
+	}
+
+	// Collect the text after "resets", which may arrive over several chunks, until it ends
+	void CaptureResetText(const char* data, size_t length, uint64_t chunkOffset) {
+		uint64_t chunkEnd = chunkOffset + length;
+		uint64_t from = m_resetTextOffset + m_resetTextLength;
+		if (from < chunkOffset || from >= chunkEnd) return;
+
+		for (size_t i = static_cast<size_t>(from - chunkOffset); i < length; i++) {
+			char c = data[i];
+			bool ended = c == '\n' || c == '\r' || c == '\x1b' || c == '(' || c == ',' || c == '.';
+			if (!ended) {
+				m_resetText[m_resetTextLength++] = c;
+			}
+			if (ended || m_resetTextLength == RESET_TEXT_SIZE - 1) {
+				m_resetText[m_resetTextLength] = '\0';
+				m_bCapturingReset = false;
+				OnResetText();
+				return;
+			}
+		}
+	}
+
+	// Adding a file already watched just keeps the one watch
+	bool WatchStatusFile(const std::wstring& path) {
+		if (path.empty()) return false;
+		for (const auto& provider : m_resetProviders) {
+			if (CompareStringOrdinal(provider->Source().c_str(), -1, path.c_str(), -1, TRUE) == CSTR_EQUAL) return true;
+		}
+
+		std::unique_ptr<ResetProvider> provider(new StatusFileProvider(path));
+		if (!provider->Start(m_eventLoop, *m_pClock, [this](Clock::time_point resetTime, uint64_t changeTicks) {
+			OnProviderReset(resetTime, changeTicks);
+		})) {
+			return false;
+		}
+		m_resetProviders.push_back(std::move(provider));
+		return true;
+	}
+
+	// Same rules as a reset time in the pane's output: never overrides a timer set by hand
+	void OnProviderReset(Clock::time_point resetTime, uint64_t changeTicks) {
+		m_pResetUpdates->Add();
+		if (!m_hTargetWindow) return;
+
+		Clock::time_point deadline;
+		if (!Schedule::RearmForReset(resetTime, m_pClock->Now(), m_bTimerActive, m_bAutoArmed, m_targetTime, deadline)) return;
+		StopTimer();
+		StartTimer(deadline);
+		m_bAutoArmed = true;
+		UpdateUI();
+
+		m_pResetRearmTime->RecordTicks(Platform::Ticks() - changeTicks, Platform::TicksPerSecond());
+	}
+
+	void OnResetText() {
+		int hour, minute;
+		if (!ParseResetTime(m_resetText, hour, minute) || !m_hTargetWindow) return;
+		if (m_bTimerActive && !m_bAutoArmed) return;
+
+		Clock::time_point deadline = Schedule::TimeOfDayTarget(*m_pClock, hour, minute);
+		if (m_bTimerActive && deadline == m_targetTime) return;
+		StopTimer();
+		StartTimer(deadline);
+		m_bAutoArmed = true;
+		UpdateUI();
+	}
+
+	// "3pm", "3 pm", "15:00", "3:30am"
+	static bool ParseResetTime(const char* text, int& hour, int& minute) {
+		const char* p = text;
+		while (*p == ' ') p++;
+		if (*p < '0' || *p > '9') return false;
+
+		hour = 0;
+		while (*p >= '0' && *p <= '9' && hour < 100) hour = hour * 10 + (*p++ - '0');
+		minute = 0;
+		if (*p == ':') {
+			p++;
+			if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') return false;
+			minute = (p[0] - '0') * 10 + (p[1] - '0');
+			p += 2;
+		}
+		while (*p == ' ') p++;
+
+		char meridiem = static_cast<char>(*p | 0x20);
+		if ((meridiem == 'a' || meridiem == 'p') && (p[1] | 0x20) == 'm') {
+			if (hour < 1 || hour > 12) return false;
+			hour = hour % 12 + (meridiem == 'p' ? 12 : 0);
+		}
+		return hour < 24 && minute < 60;
+	}
+
+	void RecordSinceResume(Metrics::Histogram& histogram) const {
+		LARGE_INTEGER now, freq;
+		QueryPerformanceCounter(&now);
+		QueryPerformanceFrequency(&freq);
+		histogram.RecordTicks(static_cast<uint64_t>(now.QuadPart - m_resumeFiredTicks), static_cast<uint64_t>(freq.QuadPart));
 	}
 
 	// Send the resume message
-	void SendResumeMessage() const {
-		if (!m_hTargetWindow || !IsWindow(m_hTargetWindow)) {
-			MessageBoxA(m_hMainWindow, ERR_TARGET_GONE, WARN_TITLE, MB_OK | MB_ICONWARNING);
-			return;
+	Delivery SendResumeMessage() {
+		Trace::Span span("SendResumeMessage");
+		m_payloadTicks = 0;
+
+		// Exits are normally caught as they happen, this covers a window destroyed while hidden
+		if (m_bReplaying || !m_hTargetWindow || !IsWindow(m_hTargetWindow)) {
+			return Delivery::None;
+		}
+
+		// Prompts with line breaks or of some length are pasted, short ones typed
+		bool bulk = Keystrokes::IsBulk(m_resumeMessage.c_str(), m_resumeMessage.size());
+		LARGE_INTEGER start, end;
+
+		// Straight into the bound pane, reconnecting if tmux went away while waiting. If tmux
+		// can't be reached, typing into the window is still better than not resuming at all.
+		if (m_tmuxPane >= 0) {
+			std::string pane = GetTmuxPaneId();
+			QueryPerformanceCounter(&start);
+			auto send = [&]() {
+				return bulk ? m_tmux.Paste(pane, m_resumeMessage, true) : m_tmux.SendKeys(pane, m_resumeMessage, true);
+			};
+			if (send() || (m_tmux.Connect(TMUX_COMMAND, m_eventLoop) && send())) {
+				QueryPerformanceCounter(&end);
+				m_payloadTicks = end.QuadPart - start.QuadPart;
+				return Delivery::Tmux;
+			}
 		}
 
 		// Bring target window to foreground
 		SetForegroundWindow(m_hTargetWindow);
 		Sleep(500);
 
-		// Send "RESUME" text
-		for (int i = 0; RESUME_MESSAGE[i]; i++) {
-			SHORT vk = VkKeyScanA(RESUME_MESSAGE[i]);
-			BYTE key = LOBYTE(vk);
-			BYTE shift = HIBYTE(vk);
+		// Type the resume text, "RESUME" unless the target's profile says otherwise, then Enter.
+		// One SendInput batch (or a few, paced by the target) so nothing typed meanwhile lands
+		// in the middle of it.
+		// Input blocked part way (a higher integrity target, the secure desktop) is no delivery.
+		QueryPerformanceCounter(&start);
+		m_inputBatch.Clear();
+		SavedClipboard savedClipboard;
+		if (bulk) {
+			SaveClipboardText(m_hMainWindow, savedClipboard);
+		}
+		if (bulk && SetClipboardText(m_hMainWindow, m_resumeMessage.c_str(), m_resumeMessage.size(), savedClipboard)) {
+			// The user's clipboard comes back once the paste and its Enter are in
+			Keystrokes::PlanPaste(m_inputBatch);
+			bool pasted = m_inputBatch.Send(m_hTargetWindow);
+			if (pasted) {
+				Sleep(PASTE_SETTLE_MS);
+				m_inputBatch.Clear();
+				m_inputBatch.Key(Keystrokes::KEY_RETURN, false);
+				m_inputBatch.Key(Keystrokes::KEY_RETURN, true);
+				pasted = m_inputBatch.Send(m_hTargetWindow);
+			}
+			QueryPerformanceCounter(&end);
+			RestoreClipboardText(m_hMainWindow, savedClipboard);
+			if (!pasted) return Delivery::None;
+			m_payloadTicks = end.QuadPart - start.QuadPart;
+			return Delivery::Clipboard;
+		}
 
-			if (shift & 1) keybd_event(VK_SHIFT, 0, 0, 0);
-			keybd_event(key, 0, 0, 0);
-			keybd_event(key, 0, KEYEVENTF_KEYUP, 0);
-			if (shift & 1) keybd_event(VK_SHIFT, 0, KEYEVENTF_KEYUP, 0);
+		// Typed instead of pasted if the clipboard couldn't be had. Line breaks as Shift+Return so
+		// none submits the prompt before the rest of it is in.
+		Keystrokes::PlanUnicode(m_resumeMessage.c_str(), m_resumeMessage.size(), true, m_inputBatch,
+			Keystrokes::LineBreak::ShiftReturn);
+		if (!m_inputBatch.Send(m_hTargetWindow)) return Delivery::None;
+		QueryPerformanceCounter(&end);
+		m_payloadTicks = end.QuadPart - start.QuadPart;
+		return Delivery::Keystrokes;
+	}
+
+	// Drive recorded messages through the handlers as fast as possible and report their cost
+	// next to the trace file
+	int RunReplay() {
+		MessageTrace::Reader reader;
+		if (!reader.Open(m_replayPath)) {
+			MessageBoxA(m_hMainWindow, ERR_TRACE_FAILED, ERR_TITLE, MB_OK | MB_ICONERROR);
+			return 1;
 		}
 
-		// Send Enter
-		keybd_event(VK_RETURN, 0, 0, 0);
-		keybd_event(VK_RETURN, 0, KEYEVENTF_KEYUP, 0);
+		// Recorded time drives the clock so countdowns and hour labels match the session
+		using Ticks100ns = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
+		Clock::time_point startTime(std::chrono::duration_cast<Clock::time_point::duration>(Ticks100ns(reader.StartTime())));
+		VirtualClock replayClock(startTime);
+		m_pClock = &replayClock;
+		m_bReplaying = true;
+
+		MessageTrace::ReplayReport report;
+		MessageTrace::Record record;
+		HANDLE hThread = GetCurrentThread();
+		bool quit = false;
+
+		while (!quit && reader.Next(record)) {
+			replayClock.Set(startTime + std::chrono::microseconds(record.timeMicros));
+
+			RECT rect = { record.rect.left, record.rect.top, record.rect.right, record.rect.bottom };
+			LPARAM lParam = record.message == WM_DPICHANGED ? reinterpret_cast<LPARAM>(&rect) : static_cast<LPARAM>(record.lParam);
+			if (record.message == WM_PAINT) {
+				InvalidateRect(m_hMainWindow, nullptr, FALSE);
+			}
+
+			ULONG64 startCycles = 0, endCycles = 0;
+			LARGE_INTEGER start, end;
+			AllocationCounter::Scope allocations;
+			QueryThreadCycleTime(hThread, &startCycles);
+			QueryPerformanceCounter(&start);
+
+			HandleWindowMessage(m_hMainWindow, record.message, static_cast<WPARAM>(record.wParam), lParam);
+
+			QueryPerformanceCounter(&end);
+			QueryThreadCycleTime(hThread, &endCycles);
+			report.Add(record.message, static_cast<uint64_t>(end.QuadPart - start.QuadPart), endCycles - startCycles,
+				allocations.Allocations());
+
+			quit = DrainReplayQueue();
+		}
+
+		StopTimer();
+		m_bReplaying = false;
+		m_pClock = &m_systemClock;
+
+		std::string reportPath = std::string(m_replayPath) + REPLAY_REPORT_EXT;
+		report.Write(reportPath.c_str());
+
+		if (!quit) {
+			DestroyWindow(m_hMainWindow);
+		}
+		return m_paintAllocationFrames > 0 ? EXIT_PAINT_ALLOCATED : 0;
+	}
+
+	// Let window management messages raised by the handlers through, but drop live input, timers
+	// and paints so only the recorded messages are measured. Returns true on WM_QUIT.
+	bool DrainReplayQueue() {
+		MSG msg;
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+			if (msg.message == WM_QUIT) {
+				return true;
+			}
+			if (msg.message == WM_PAINT) {
+				ValidateRect(msg.hwnd, nullptr);
+				continue;
+			}
+			if (msg.message == WM_TIMER || msg.message == WM_MOUSELEAVE ||
+				(msg.message >= WM_MOUSEFIRST && msg.message <= WM_MOUSELAST) ||
+				(msg.message >= WM_KEYFIRST && msg.message <= WM_KEYLAST)) {
+				continue;
+			}
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
+		return false;
 	}
 
 	// Update all the things
-	void UpdateUI() const {
-		if (m_hMainWindow) {
-			InvalidateRect(m_hMainWindow, nullptr, FALSE);
-			UpdateWindow(m_hMainWindow);
+	// Nothing is drawn while minimized or in the tray, restoring repaints the window anyway
+	void UpdateUI() {
+		if (!m_hMainWindow) return;
+
+		if (m_tray.InTray()) {
+			if (m_bTimerActive) {
+				UpdateTrayTip();
+				return;
+			}
+			// Tray-only is for waiting, when that ends the window comes back minimized
+			LeaveTray(SW_SHOWMINNOACTIVE);
 		}
+		if (!m_bReplaying && (IsIconic(m_hMainWindow) || !IsWindowVisible(m_hMainWindow))) {
+			m_pFramesSkipped->Add();
+			return;
+		}
+
+		InvalidateRect(m_hMainWindow, nullptr, FALSE);
+		UpdateWindow(m_hMainWindow);
 	}
 };
 
@@ -1814,5 +3117,6 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 	SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
 
 	ARCCApp app;
+	app.ParseCommandLine(__argc, __argv);
 	return app.Run(hInstance);
 }
\ No newline at end of file
@@ -6,3 +6,5 @@
 // Timer IDs
 #define TIMER_COUNTDOWN         1
 #define TIMER_STATUS_UPDATE     2
+#define TIMER_PICKER            3
+#define TIMER_METRICS           4
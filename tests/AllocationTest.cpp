@@ -0,0 +1,99 @@
+// Painting a frame must not touch the heap once the first frame is up. Built with the counting
+// operator new (AllocationHooks.h), this draws a frame the way the app does, then checks that the
+// second one (countdown, hour labels, DrawContent) counts zero allocations. Also checks that the
+// counter sees plain and, from C++17, over-aligned allocations at all.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <memory>
+#include "AllocationCounter.h"
+#include "AllocationHooks.h"
+#include "Headless.h"
+#include "Schedule.h"
+#include "Ui.h"
+
+#ifndef ARCC_COUNT_ALLOCATIONS
+#error AllocationTest needs ARCC_COUNT_ALLOCATIONS
+#endif
+
+namespace {
+	int failures = 0;
+
+	void Expect(uint64_t allocations, uint64_t expected, const char* what) {
+		if (allocations == expected) return;
+		printf("FAIL %s: %llu allocations, expected %llu\n", what, static_cast<unsigned long long>(allocations),
+			static_cast<unsigned long long>(expected));
+		failures++;
+	}
+
+	// Everything PublishFrame and the renderer do for one frame
+	void DrawFrame(const Clock& clock, Clock::time_point deadline, Ui::Frame& frame, Headless::Canvas& canvas) {
+		frame.countdownText[0] = L'\0';
+		Ui::FormatCountdown(clock, deadline, frame.countdownText);
+		Ui::FormatHourLabels(clock, frame.hourLabels);
+		canvas.Clear();
+		Ui::DrawContent(frame, canvas);
+	}
+
+#ifdef __cpp_aligned_new
+	struct alignas(64) CacheLine {
+		char bytes[64];
+	};
+#endif
+}
+
+int main() {
+	{
+		AllocationCounter::Scope allocations;
+		std::unique_ptr<int> p(new int(1));
+		Expect(allocations.Allocations(), 1, "operator new");
+	}
+#ifdef __cpp_aligned_new
+	{
+		AllocationCounter::Scope allocations;
+		std::unique_ptr<CacheLine> p(new CacheLine());
+		Expect(allocations.Allocations(), 1, "aligned operator new");
+		if (reinterpret_cast<uintptr_t>(p.get()) % alignof(CacheLine) != 0) {
+			printf("FAIL aligned operator new: misaligned\n");
+			failures++;
+		}
+	}
+#endif
+
+	VirtualClock clock(std::chrono::system_clock::now());
+	Headless::TextMeasurer measurer;
+	Headless::Canvas canvas;
+	Ui::Frame frame;
+	Ui::ComputeLayout(500.0f, measurer, frame.layout);
+	frame.appState = Ui::AppState::Waiting;
+	frame.hasTarget = true;
+	frame.timerActive = true;
+	frame.mouseX = 100.0f;
+	frame.mouseY = 300.0f;
+	wcscpy(frame.targetLabelName, L"WindowsTerminal.exe");
+	wcscpy(frame.targetLabelDetail, L"\"claude\" (0x1A2B3C)");
+	Clock::time_point deadline = Schedule::HourTarget(clock, 2);
+
+	DrawFrame(clock, deadline, frame, canvas);
+
+	// A second later, as the status timer repaints
+	clock.Advance(std::chrono::seconds(1));
+	{
+		AllocationCounter::Scope allocations;
+		DrawFrame(clock, deadline, frame, canvas);
+		Expect(allocations.Allocations(), 0, "second frame");
+	}
+
+	// And again with the pointer off the window and a new hour in the labels
+	clock.Advance(std::chrono::hours(1));
+	frame.mouseX = frame.mouseY = -1.0f;
+	{
+		AllocationCounter::Scope allocations;
+		DrawFrame(clock, deadline, frame, canvas);
+		Expect(allocations.Allocations(), 0, "frame an hour later");
+	}
+
+	if (failures == 0) printf("ok\n");
+	return failures == 0 ? 0 : 1;
+}
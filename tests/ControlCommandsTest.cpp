@@ -0,0 +1,167 @@
+// Control commands against a fake target: which call each command makes, the reply it formats
+// and the errors it answers with before calling anything (no target, hour out of range, deadline
+// passed, bad rule, and the target refusing a payload, watch, pane or trace).
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "ControlCommands.h"
+
+namespace {
+	const Clock::time_point NOW = Clock::time_point(std::chrono::seconds(1790000000));
+
+	int failures = 0;
+
+	void Expect(bool condition, const char* what) {
+		if (condition) return;
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+
+	// Records the calls, arms jobs numbered from 1 and refuses what it is told to
+	class FakeTarget : public ControlTarget {
+	public:
+		explicit FakeTarget(const Clock& clock) : m_clock(clock) {}
+
+		bool hasTarget = false;
+		bool active = false;
+		uint64_t job = 0;
+		Clock::time_point deadline;
+		int hourOffset = -1;
+		std::string calls;
+		bool refuse = false;
+		size_t watches = 0;
+		int64_t pane = -1;
+
+		const Clock& GetClock() const override { return m_clock; }
+		bool HasTarget() const override { return hasTarget; }
+		std::string TargetName() const override { return "wt.exe"; }
+		bool TimerActive() const override { return active; }
+		uint64_t ArmedJob() const override { return job; }
+		Clock::time_point Deadline() const override { return deadline; }
+
+		void ArmHour(int offset, Clock::time_point time) override {
+			hourOffset = offset;
+			Arm(time);
+		}
+
+		void Arm(Clock::time_point time) override {
+			calls += "arm ";
+			active = true;
+			job++;
+			deadline = time;
+		}
+
+		void ArmRecurring(const Recurrence& recurrence) override {
+			calls += "repeat ";
+			active = true;
+			job++;
+			deadline = recurrence.Next(m_clock.Now(), m_clock);
+		}
+
+		void Cancel() override {
+			calls += "cancel ";
+			active = false;
+		}
+
+		void Fire() override { calls += "fire "; }
+
+		size_t SharedJobs(SharedJob* jobs, size_t capacity) override {
+			if (capacity < 2) return 0;
+			jobs[0] = { 100, 1, 1790003600 };
+			jobs[1] = { 200, 7, 1790007200 };
+			return 2;
+		}
+
+		bool SetPayload(bool reset, const std::string& path, size_t& length) override {
+			if (refuse) return false;
+			length = reset ? 6 : path.size();
+			return true;
+		}
+
+		int64_t SetWakeLead(int64_t seconds) override { return seconds < 10 ? 10 : seconds; }
+
+		bool Watch(const std::string&) override {
+			if (refuse) return false;
+			watches++;
+			return true;
+		}
+
+		void StopWatching() override { watches = 0; }
+		size_t WatchCount() const override { return watches; }
+
+		bool BindPane(int64_t id) override {
+			if (refuse) return false;
+			pane = id;
+			return true;
+		}
+
+		std::string PaneId() const override { return pane >= 0 ? "%" + std::to_string(pane) : std::string(); }
+
+		void EnableTrace(bool) override { calls += "trace "; }
+
+		bool DumpTrace(std::string& path) override {
+			if (refuse) return false;
+			path = "trace.json";
+			return true;
+		}
+
+	private:
+		const Clock& m_clock;
+	};
+
+	std::string Send(FakeTarget& target, const char* line) {
+		std::string reply;
+		ControlCommands::Handle(ControlProtocol::Parse(line, strlen(line)), target, reply);
+		return reply;
+	}
+
+	void TestTimer(const Clock& clock) {
+		FakeTarget target(clock);
+		Expect(Send(target, "arm 1") == "err no target" && Send(target, "fire") == "err no target" &&
+			Send(target, "repeat every 5h from 09:00") == "err no target" && target.calls.empty(), "a target is needed first");
+
+		target.hasTarget = true;
+		Expect(Send(target, "arm 5") == "err hour out of range", "hour out of range");
+		Expect(Send(target, "arm @1789999999") == "err deadline has passed", "deadline passed");
+		Expect(target.calls.empty(), "refused commands call nothing");
+
+		std::string expected = "ok 1 " + std::to_string(ControlCommands::ToUnixSeconds(Schedule::HourTarget(clock, 2)));
+		Expect(Send(target, "arm 2") == expected && target.hourOffset == 2, "arm <hour> selects the hour");
+		Expect(Send(target, "arm @1790100000") == "ok 2 1790100000" && target.hourOffset == 2, "arm @<unix> keeps it");
+		Expect(Send(target, "list") == "ok armed 2 1790100000 wt.exe", "list armed");
+
+		Expect(Send(target, "repeat every 5h from") == "err bad rule", "bad rule");
+		Expect(Send(target, "repeat every 5h from 09:00").compare(0, 5, "ok 3 ") == 0, "repeat");
+		Expect(Send(target, "cancel") == "ok" && Send(target, "list") == "ok idle wt.exe", "cancel");
+		Expect(Send(target, "fire") == "ok", "fire");
+		Expect(target.calls == "arm arm repeat cancel fire ", "one call per command");
+		Expect(Send(target, "jobs") == "ok 2 100:1@1790003600 200:7@1790007200", "jobs");
+	}
+
+	void TestSettings(const Clock& clock) {
+		FakeTarget target(clock);
+		target.hasTarget = true;
+		Expect(Send(target, "payload /tmp/prompt.txt") == "ok 15" && Send(target, "payload -") == "ok 6", "payload");
+		Expect(Send(target, "lead 3") == "ok 10", "lead replies as clamped");
+		Expect(Send(target, "watch /tmp/a.json") == "ok 1" && Send(target, "watch /tmp/b.json") == "ok 2" &&
+			Send(target, "watch -") == "ok 0", "watch counts files");
+		Expect(Send(target, "pane %3") == "ok %3" && Send(target, "pane -") == "ok", "pane");
+		Expect(Send(target, "trace on") == "ok" && Send(target, "trace dump") == "ok trace.json", "trace");
+
+		target.refuse = true;
+		Expect(Send(target, "payload /missing") == "err payload not read" && Send(target, "watch /missing/a.json") ==
+			"err directory not watched" && Send(target, "pane %3") == "err tmux unavailable" &&
+			Send(target, "trace dump") == "err trace not written", "refusals");
+		Expect(Send(target, "bogus") == "err unknown command", "unknown");
+	}
+}
+
+int main() {
+	VirtualClock clock{ NOW };
+	TestTimer(clock);
+	TestSettings(clock);
+
+	if (failures == 0) printf("ok\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// The control protocol apart from its transport: what each line parses to, and how a stream is
+// cut into commands (partial lines wait, CRLF is fine, empty lines are skipped, an overlong line
+// is refused). On Linux also a pipelined round trip through ControlSocket on the epoll loop, with
+// two clients at once.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#ifndef _WIN32
+#include <algorithm>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ControlSocket.h"
+#endif
+#include "ControlProtocol.h"
+
+namespace {
+	using Type = ControlProtocol::Command::Type;
+
+	int failures = 0;
+
+	void Expect(bool condition, const char* what) {
+		if (condition) return;
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+
+	ControlProtocol::Command Parse(const char* line) {
+		return ControlProtocol::Parse(line, strlen(line));
+	}
+
+	// Echoes the command type, so replies show what was parsed and in what order
+	void Echo(const ControlProtocol::Command& command, std::string& reply) {
+		reply = "ok " + std::to_string(static_cast<int>(command.type));
+	}
+
+	void TestParse() {
+		ControlProtocol::Command command = Parse("arm 3");
+		Expect(command.type == Type::Arm && !command.absolute && command.value == 3, "arm 3");
+		command = Parse("arm @1790000000");
+		Expect(command.type == Type::Arm && command.absolute && command.value == 1790000000, "arm @<unix>");
+		Expect(Parse("arm 3x").type == Type::Unknown && Parse("arm").type == Type::Unknown, "arm needs a number");
+
+		command = Parse("repeat every 5h from 03:00:10");
+		Expect(command.type == Type::Repeat && command.text == "every 5h from 03:00:10", "repeat keeps the rule");
+		command = Parse("payload -");
+		Expect(command.type == Type::Payload && command.value == ControlProtocol::PAYLOAD_RESET, "payload -");
+		command = Parse("watch /tmp/usage.json");
+		Expect(command.type == Type::Watch && command.value == ControlProtocol::WATCH_FILE && command.text == "/tmp/usage.json",
+			"watch <path>");
+		Expect(Parse("lead 90").value == 90 && Parse("lead -1").type == Type::Unknown, "lead takes seconds");
+		command = Parse("pane %12");
+		Expect(command.type == Type::Pane && command.value == 12 && Parse("pane -").value == -1, "pane");
+		Expect(Parse("pane 12").type == Type::Unknown, "pane needs %");
+		Expect(Parse("trace dump").value == ControlProtocol::TRACE_DUMP && Parse("trace maybe").type == Type::Unknown, "trace");
+
+		Expect(Parse("cancel").type == Type::Cancel && Parse("list").type == Type::List && Parse("jobs").type == Type::Jobs &&
+			Parse("fire").type == Type::Fire, "bare verbs");
+		Expect(Parse("list now").type == Type::Unknown && Parse("LIST").type == Type::Unknown && Parse("").type == Type::Unknown,
+			"bare verbs take nothing, in lower case");
+	}
+
+	void TestBatching() {
+		ControlProtocol protocol;
+		protocol.SetHandler(Echo);
+		std::string input = "list\r\n\ncancel\nfi";
+		std::string output;
+		Expect(protocol.HandleInput(input, output) == 2 && output == "ok 3\nok 2\n", "two commands, CR and empty line dropped");
+		Expect(input == "fi", "the partial line waits");
+		input += "re\n";
+		output.clear();
+		Expect(protocol.HandleInput(input, output) == 1 && output == "ok 8\n" && input.empty(), "and completes on the next read");
+
+		input.assign(2000, 'x');
+		output.clear();
+		Expect(protocol.HandleInput(input, output) == 0 && output == "err line too long\n" && input.empty(), "overlong line refused");
+
+		ControlProtocol::Stats stats = protocol.GetStats();
+		Expect(stats.commandCount == 3 && stats.batchCount == 2 && stats.maxBatchSize == 2, "batch stats");
+	}
+
+#ifndef _WIN32
+	int Connect(const char* path) {
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		strcpy(address.sun_path, path);
+		int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	// Runs the loop for a millisecond, long enough for the server to handle what is waiting
+	void Pump(EventLoop& loop) {
+		int timer = loop.AddTimer([&loop]() { loop.Quit(0); });
+		loop.SetTimer(timer, std::chrono::system_clock::now() + std::chrono::milliseconds(1));
+		loop.Run();
+		loop.Remove(timer);
+	}
+
+	// Runs the loop until the client has every reply line it is owed
+	std::string Receive(EventLoop& loop, int fd, size_t lines) {
+		std::string received;
+		char buffer[256];
+		while (static_cast<size_t>(std::count(received.begin(), received.end(), '\n')) < lines) {
+			ssize_t read = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+			if (read > 0) {
+				received.append(buffer, static_cast<size_t>(read));
+				continue;
+			}
+			if (read == 0) break;
+			Pump(loop);
+		}
+		return received;
+	}
+
+	void TestSocket() {
+		std::string path = "/tmp/ControlProtocolTest-" + std::to_string(getpid()) + ".sock";
+		EventLoop loop;
+		ControlSocket server;
+		Expect(server.Start(path.c_str(), loop, Echo), "socket served");
+		ControlSocket second;
+		Expect(!second.Start(path.c_str(), loop, Echo), "a served path isn't taken over");
+
+		int first = Connect(path.c_str());
+		int other = Connect(path.c_str());
+		Expect(first >= 0 && other >= 0, "two clients connect");
+		if (first < 0 || other < 0) return;
+
+		const char* pipelined = "list\njobs\ncancel\nbogus\n";
+		send(first, pipelined, strlen(pipelined), MSG_NOSIGNAL);
+		send(other, "fire\n", 5, MSG_NOSIGNAL);
+		Expect(Receive(loop, first, 4) == "ok 3\nok 4\nok 2\nok 11\n", "pipelined replies in order");
+		Expect(Receive(loop, other, 1) == "ok 8\n", "the other client is answered too");
+		Expect(server.ClientCount() == 2, "both clients held");
+
+		close(first);
+		Pump(loop);
+		Expect(server.ClientCount() == 1, "a client that hangs up is dropped");
+		close(other);
+		Pump(loop);
+		Expect(server.ClientCount() == 0, "and the other");
+		server.Stop();
+		Expect(access(path.c_str(), F_OK) != 0, "the socket file is removed on stop");
+
+		// The refused second server's probe counts as a connection too
+		ControlSocket::Stats stats = server.GetStats();
+		Expect(stats.connectionCount == 3 && stats.commandCount == 5, "socket stats");
+	}
+#endif
+}
+
+int main() {
+	TestParse();
+	TestBatching();
+#ifndef _WIN32
+	TestSocket();
+#endif
+
+	if (failures == 0) printf("ok\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// A target exiting cancels its job at once, without polling: a job is armed seconds ahead with a
+// loop timer at its deadline, the target (a forked sleeper) is killed shortly after, and the
+// process watch (a pidfd) must cancel the job and stop the loop long before the deadline, in one
+// wake for the kill and one for the exit. Also checks that a target gone before it is watched
+// still reports. Linux only; skipped (77) on kernels without pidfd_open.
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "EventLoop.h"
+#include "Schedule.h"
+
+namespace {
+	const auto JOB_DELAY = std::chrono::seconds(5);
+	const auto KILL_DELAY = std::chrono::milliseconds(50);
+	const int SKIP = 77;
+
+	int failures = 0;
+
+	void Expect(bool condition, const char* what) {
+		if (condition) return;
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+
+	pid_t StartSleeper() {
+		pid_t pid = fork();
+		if (pid == 0) {
+			for (;;) pause();
+		}
+		return pid;
+	}
+
+	void TestKilledMidWait(const Clock& clock) {
+		EventLoop loop;
+		Scheduler scheduler;
+		pid_t child = StartSleeper();
+		if (child < 0) {
+			Expect(false, "fork");
+			return;
+		}
+
+		Clock::time_point deadline = clock.Now() + JOB_DELAY;
+		Scheduler::JobId job = scheduler.Arm(deadline, static_cast<uintptr_t>(child));
+		bool fired = false;
+		bool exited = false;
+		Clock::time_point exitTime;
+
+		int deadlineTimer = loop.AddTimer([&]() {
+			scheduler.RunDue(clock, [&](const Scheduler::Job&) { fired = true; });
+			loop.Quit(1);
+		});
+		int killTimer = loop.AddTimer([&]() { kill(child, SIGKILL); });
+		int process = loop.AddProcess(child, [&]() {
+			exitTime = clock.Now();
+			exited = true;
+			waitpid(child, nullptr, 0);
+			scheduler.Cancel(job);
+			loop.CancelTimer(deadlineTimer);
+			loop.Quit(0);
+		});
+		Expect(deadlineTimer >= 0 && killTimer >= 0 && process >= 0, "timers and process watched");
+		if (process < 0) {
+			kill(child, SIGKILL);
+			waitpid(child, nullptr, 0);
+			return;
+		}
+		loop.SetTimer(deadlineTimer, deadline);
+		loop.SetTimer(killTimer, clock.Now() + KILL_DELAY);
+
+		int exitCode = loop.Run();
+		EventLoop::Stats stats = loop.GetStats();
+
+		Expect(exitCode == 0 && exited, "the exit stopped the loop");
+		Expect(!fired, "the job didn't fire");
+		Expect(scheduler.Find(job) == nullptr && scheduler.Empty(), "the exit cancelled the job");
+		Expect(exited && exitTime < deadline - JOB_DELAY / 2, "well before the deadline");
+		Expect(stats.wakeCount == 2, "one wake for the kill, one for the exit");
+		if (stats.wakeCount != 2) {
+			printf("  %llu wakes\n", static_cast<unsigned long long>(stats.wakeCount));
+		}
+	}
+
+	void TestGoneBeforeWatched() {
+		EventLoop loop;
+		pid_t child = fork();
+		if (child == 0) _exit(0);
+		if (child < 0) {
+			Expect(false, "fork");
+			return;
+		}
+		// Exited but not yet reaped, as a target can be by the time the watch is set up
+		siginfo_t info = {};
+		waitid(P_PID, static_cast<id_t>(child), &info, WEXITED | WNOWAIT);
+
+		bool exited = false;
+		int process = loop.AddProcess(child, [&]() {
+			exited = true;
+			loop.Quit(0);
+		});
+		Expect(process >= 0, "an exited child can be watched");
+		if (process >= 0) {
+			loop.Run();
+		}
+		Expect(exited, "an exited child reports at once");
+		waitpid(child, nullptr, 0);
+	}
+
+	bool HavePidfd() {
+		EventLoop loop;
+		return loop.AddProcess(getpid(), []() {}) >= 0;
+	}
+}
+
+int main() {
+	if (!HavePidfd()) {
+		printf("skip: no pidfd_open\n");
+		return SKIP;
+	}
+
+	SystemClock clock;
+	TestKilledMidWait(clock);
+	TestGoneBeforeWatched();
+
+	if (failures == 0) printf("ok\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+// Compiling recurrence rules and finding their next occurrence: which texts are rules, what they
+// compile to, and Next for cadences, day masks and the two daylight saving changes. Runs in US
+// Eastern (2026: forward on March 8, back on November 1) whatever the machine's zone.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "Schedule.h"
+
+namespace {
+	const char* const TZ = "EST5EDT,M3.2.0,M11.1.0";
+
+	int failures = 0;
+
+	void Expect(bool condition, const char* what) {
+		if (condition) return;
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+
+	void SetZone(const char* tz) {
+#ifdef _WIN32
+		_putenv_s("TZ", tz);
+		_tzset();
+#else
+		setenv("TZ", tz, 1);
+		tzset();
+#endif
+	}
+
+	Clock::time_point Local(const Clock& clock, int month, int day, int hour, int minute, int second = 0) {
+		tm local{};
+		local.tm_year = 2026 - 1900;
+		local.tm_mon = month - 1;
+		local.tm_mday = day;
+		local.tm_hour = hour;
+		local.tm_min = minute;
+		local.tm_sec = second;
+		return clock.FromLocal(local);
+	}
+
+	// Local wall time of an occurrence is day hour:minute:second
+	bool IsLocal(const Clock& clock, Clock::time_point time, int day, int hour, int minute, int second = 0) {
+		tm local{};
+		clock.ToLocal(time, local);
+		return local.tm_mday == day && local.tm_hour == hour && local.tm_min == minute && local.tm_sec == second;
+	}
+
+	void TestCompile(const Clock& clock) {
+		Recurrence rule;
+		Expect(Recurrence::Compile("every 5h from 03:00:10", clock, rule) && rule.kind == Recurrence::Kind::Interval &&
+			rule.period == std::chrono::hours(5) && IsLocal(clock, rule.anchor, 1, 3, 0, 10), "every 5h from 03:00:10");
+		Expect(Recurrence::Compile("every 5h30m from 23:00", clock, rule) && rule.period == std::chrono::minutes(330),
+			"every 5h30m");
+		Expect(Recurrence::Compile("EVERY 90m FROM 01:15", clock, rule) && rule.period == std::chrono::minutes(90),
+			"keywords in any case");
+
+		Expect(Recurrence::Compile("daily at 00:00", clock, rule) && rule.kind == Recurrence::Kind::Days && rule.dayMask == 0x7F,
+			"daily");
+		Expect(Recurrence::Compile("weekdays at 09:00:10", clock, rule) && rule.dayMask == 0x3E && rule.hour == 9 &&
+			rule.minute == 0 && rule.second == 10, "weekdays at 09:00:10");
+		Expect(Recurrence::Compile("weekends at 02:00", clock, rule) && rule.dayMask == 0x41, "weekends");
+		Expect(Recurrence::Compile("MON,wed,Fri at 21:30", clock, rule) && rule.dayMask == 0x2A, "day names");
+		// Friday to Monday, Monday to Wednesday
+		Expect(rule.nextDay[5] == 3 && rule.nextDay[1] == 2 && rule.nextDay[0] == 1, "days to the next day in the mask");
+		Expect(Recurrence::Compile("sun at 12:00", clock, rule) && rule.nextDay[0] == 7, "a single day is a week apart");
+
+		static const char* const NOT_RULES[] = { "", "every", "every 5h", "every 0h from 01:00", "every 5x from 01:00",
+			"every 5h from 1:00 pm", "daily", "daily at 24:00", "daily at 12:60", "daily at 12", "daily 12:00",
+			"at 09:00", "mon,xyz at 09:00", "mon, wed at 09:00", "weekdays at 09:00 please", "dailyat 09:00" };
+		for (const char* text : NOT_RULES) {
+			if (Recurrence::Compile(text, clock, rule)) {
+				printf("FAIL compiled \"%s\"\n", text);
+				failures++;
+			}
+		}
+	}
+
+	void TestInterval(const Clock& clock) {
+		Recurrence rule;
+		Recurrence::Compile("every 5h from 03:00", clock, rule);
+		Clock::time_point anchor = rule.anchor;
+		Expect(rule.Next(anchor - std::chrono::hours(1), clock) == anchor, "before the anchor it is the anchor");
+		Expect(rule.Next(anchor, clock) == anchor + std::chrono::hours(5), "strictly after");
+		Expect(rule.Next(anchor + std::chrono::hours(12), clock) == anchor + std::chrono::hours(15), "between occurrences");
+	}
+
+	void TestDays(VirtualClock& clock) {
+		Recurrence rule;
+		Recurrence::Compile("weekdays at 09:00", clock, rule);
+		// 2026-10-16 is a Friday
+		Expect(IsLocal(clock, rule.Next(Local(clock, 10, 16, 8, 0), clock), 16, 9, 0), "later the same weekday");
+		Expect(IsLocal(clock, rule.Next(Local(clock, 10, 16, 9, 0), clock), 19, 9, 0), "Friday at the time to Monday");
+		Expect(IsLocal(clock, rule.Next(Local(clock, 10, 17, 8, 0), clock), 19, 9, 0), "Saturday to Monday");
+
+		Recurrence::Compile("mon,wed,fri at 21:30", clock, rule);
+		Expect(IsLocal(clock, rule.Next(Local(clock, 10, 19, 22, 0), clock), 21, 21, 30), "Monday night to Wednesday");
+	}
+
+	void TestDaylightSaving(VirtualClock& clock) {
+		Recurrence rule;
+
+		// 02:30 doesn't exist on March 8, the occurrence moves past the gap rather than a day on
+		clock.Set(Local(clock, 3, 7, 12, 0));
+		Recurrence::Compile("daily at 02:30", clock, rule);
+		Clock::time_point gap = rule.Next(Local(clock, 3, 8, 1, 0), clock);
+		Expect(IsLocal(clock, gap, 8, 3, 30), "02:30 in the spring gap is 03:30");
+		Expect(IsLocal(clock, rule.Next(gap, clock), 9, 2, 30), "and 02:30 again the day after");
+
+		// 01:30 happens twice on November 1, the rule fires on the first only
+		clock.Set(Local(clock, 10, 31, 12, 0));
+		Recurrence::Compile("daily at 01:30", clock, rule);
+		Clock::time_point first = rule.Next(Local(clock, 11, 1, 0, 0), clock);
+		Expect(IsLocal(clock, first, 1, 1, 30), "01:30 on the day clocks go back");
+		Clock::time_point next = rule.Next(first, clock);
+		Expect(IsLocal(clock, next, 2, 1, 30) && next - first == std::chrono::hours(25), "not the repeated 01:30");
+
+		// A cadence counts elapsed time straight through both changes
+		clock.Set(Local(clock, 3, 7, 12, 0));
+		Recurrence::Compile("every 1h from 00:00", clock, rule);
+		Clock::time_point before = rule.Next(Local(clock, 3, 8, 1, 30), clock);
+		Expect(IsLocal(clock, before, 8, 3, 0) && rule.Next(before, clock) - before == std::chrono::hours(1),
+			"cadence across the spring gap");
+	}
+}
+
+int main() {
+	SetZone(TZ);
+	VirtualClock clock{ Clock::time_point() };
+	clock.Set(Local(clock, 10, 1, 12, 0));
+
+	TestCompile(clock);
+	TestInterval(clock);
+	TestDays(clock);
+	TestDaylightSaving(clock);
+
+	if (failures == 0) printf("ok\n");
+	return failures == 0 ? 0 : 1;
+}
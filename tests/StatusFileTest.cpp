@@ -0,0 +1,180 @@
+// Status files end to end, short of the timer: StatusFileReader deciding how much of a document
+// or log to read and when a reset time counts as new, Schedule::RearmForReset deciding whether it
+// moves the timer, and on Linux StatusFileProvider's inotify watch noticing a file replaced by
+// rename, rewritten in place and appended to, without polling.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "Schedule.h"
+#include "StatusJson.h"
+#ifndef _WIN32
+#include <cstdlib>
+#include <unistd.h>
+#include "EventLoop.h"
+#include "ResetProvider.h"
+#endif
+
+namespace {
+	const Clock::time_point RESET = Clock::time_point(std::chrono::seconds(1790000000));
+	const Clock::time_point LATER = RESET + std::chrono::hours(5);
+
+	int failures = 0;
+
+	void Expect(bool condition, const char* what) {
+		if (condition) return;
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+
+	// Everything from the offset Begin gives, a few bytes at a time so values span chunks
+	bool Read(StatusFileReader& reader, const std::string& file, uint64_t identity, const Clock& clock, Clock::time_point& reset,
+		size_t* parsed = nullptr) {
+		const size_t CHUNK = 5;
+		uint64_t before = reader.GetStats().bytesParsed;
+		for (size_t offset = static_cast<size_t>(reader.Begin(1, identity, file.size())); offset < file.size(); offset += CHUNK) {
+			size_t length = file.size() - offset < CHUNK ? file.size() - offset : CHUNK;
+			if (!reader.Feed(file.data() + offset, length, clock)) break;
+		}
+		if (parsed) *parsed = static_cast<size_t>(reader.GetStats().bytesParsed - before);
+		return reader.End(reset);
+	}
+
+	void TestDocument(const Clock& clock) {
+		Expect(!StatusFileReader::IsLog(L"/home/me/usage.json") && StatusFileReader::IsLog(L"C:\\logs\\Status.JSONL") &&
+			StatusFileReader::IsLog(L"status.ndjson"), "logs by extension");
+
+		StatusFileReader reader(false);
+		std::string document = "{\"limits\":{\"resets_at\":1790000000},\"padding\":\"" + std::string(200, 'x') + "\"}";
+		Clock::time_point reset;
+		size_t parsed = 0;
+		Expect(Read(reader, document, 1, clock, reset, &parsed) && reset == RESET, "document value");
+		Expect(parsed < 60, "a document is read only until the value");
+		Expect(!Read(reader, document, 1, clock, reset), "the same value again isn't reported");
+
+		std::string changed = "{\"limits\":{\"resets_at\":1790018000}}";
+		Expect(Read(reader, changed, 1, clock, reset) && reset == LATER, "a new value is");
+		Expect(!Read(reader, "{\"limits\":{\"resets_at\":17900", 1, clock, reset), "a half-written value is nothing");
+
+		reader.Failed();
+		StatusFileReader::Stats stats = reader.GetStats();
+		Expect(stats.reloads == 5 && stats.failedReloads == 1 && stats.values == 3 && stats.changes == 2, "document stats");
+	}
+
+	void TestLog(const Clock& clock) {
+		StatusFileReader reader(true);
+		std::string log = "{\"resets_at\":1790000000}\n";
+		Clock::time_point reset;
+		Expect(Read(reader, log, 7, clock, reset) && reset == RESET, "first log line");
+
+		std::string line = "{\"resets_at\":1790018000}\n";
+		size_t parsed = 0;
+		Expect(Read(reader, log + line, 7, clock, reset, &parsed) && reset == LATER, "an appended line, last value wins");
+		Expect(parsed == line.size(), "only the appended bytes are read");
+
+		Expect(reader.Begin(1, 7, line.size()) == 0, "a shorter file starts over");
+		reader.End(reset);
+		Expect(!Read(reader, log + line + line, 8, clock, reset, &parsed) && parsed == log.size() + 2 * line.size(),
+			"another file starts over, and its last value isn't new");
+	}
+
+	void TestRearm() {
+		Clock::time_point now = RESET - std::chrono::hours(1);
+		Clock::time_point deadline;
+		Expect(Schedule::RearmForReset(RESET, now, false, false, Clock::time_point(), deadline) &&
+			deadline == RESET + std::chrono::seconds(Schedule::RESUME_SECOND), "no timer: armed past the reset");
+		Expect(!Schedule::RearmForReset(RESET, now, true, false, LATER, deadline), "never over a timer set by hand");
+		Expect(Schedule::RearmForReset(RESET, now, true, true, LATER, deadline), "a timer armed this way moves");
+		Expect(!Schedule::RearmForReset(RESET, now, true, true, RESET + std::chrono::seconds(Schedule::RESUME_SECOND), deadline),
+			"not for the deadline already armed");
+		Expect(!Schedule::RearmForReset(RESET, RESET + std::chrono::minutes(1), false, false, Clock::time_point(), deadline),
+			"nor for a reset already past");
+	}
+
+#ifndef _WIN32
+	void WriteFile(const std::string& path, const std::string& text, const char* mode) {
+		FILE* file = fopen(path.c_str(), mode);
+		fwrite(text.data(), 1, text.size(), file);
+		fclose(file);
+	}
+
+	// Runs the loop until the provider has reported or 300 ms have passed
+	void Wait(EventLoop& loop, const int& reports, int expected) {
+		int timer = loop.AddTimer([&loop]() { loop.Quit(0); });
+		for (int i = 0; i < 30 && reports < expected; i++) {
+			loop.SetTimer(timer, std::chrono::system_clock::now() + std::chrono::milliseconds(10));
+			loop.Run();
+		}
+		loop.Remove(timer);
+	}
+
+	void TestProvider(const Clock& clock) {
+		char directory[] = "/tmp/StatusFileTest-XXXXXX";
+		if (!mkdtemp(directory)) {
+			Expect(false, "temporary directory");
+			return;
+		}
+		std::string path = std::string(directory) + "/usage.json";
+		std::string temporary = std::string(directory) + "/usage.json.tmp";
+		std::string logPath = std::string(directory) + "/status.jsonl";
+
+		EventLoop loop;
+		int reports = 0;
+		Clock::time_point reported;
+		auto handler = [&](Clock::time_point resetTime, uint64_t) {
+			reports++;
+			reported = resetTime;
+		};
+
+		StatusFileProvider provider(std::wstring(path.begin(), path.end()));
+		Expect(provider.Start(loop, clock, handler) && reports == 0, "watching a file not written yet");
+
+		// Replaced: written beside it, then renamed over it
+		WriteFile(temporary, "{\"resets_at\":1790000000}", "w");
+		rename(temporary.c_str(), path.c_str());
+		Wait(loop, reports, 1);
+		Expect(reports == 1 && reported == RESET, "a file renamed into place");
+
+		WriteFile(path, "{\"resets_at\":1790018000}", "w");
+		Wait(loop, reports, 2);
+		Expect(reports == 2 && reported == LATER, "a file rewritten in place");
+
+		WriteFile(std::string(directory) + "/other.json", "{\"resets_at\":1790000000}", "w");
+		Wait(loop, reports, 3);
+		Expect(reports == 2, "other files in the directory are ignored");
+
+		StatusFileProvider log(std::wstring(logPath.begin(), logPath.end()));
+		Expect(log.Start(loop, clock, handler), "watching a log");
+		WriteFile(logPath, "{\"resets_at\":1790000000}\n", "a");
+		Wait(loop, reports, 3);
+		WriteFile(logPath, "{\"resets_at\":1790018000}\n", "a");
+		Wait(loop, reports, 4);
+		Expect(reports == 4 && reported == LATER, "lines appended to a log");
+		StatusFileProvider::Stats stats = log.GetStats();
+		Expect(stats.reads.bytesParsed == 50, "each appended line read once");
+
+		provider.Stop();
+		log.Stop();
+		Expect(loop.Size() == 0, "stopped providers leave the loop");
+
+		unlink(path.c_str());
+		unlink(logPath.c_str());
+		unlink((std::string(directory) + "/other.json").c_str());
+		rmdir(directory);
+	}
+#endif
+}
+
+int main() {
+	VirtualClock clock{ RESET - std::chrono::hours(2) };
+	TestDocument(clock);
+	TestLog(clock);
+	TestRearm();
+#ifndef _WIN32
+	SystemClock systemClock;
+	TestProvider(systemClock);
+#endif
+
+	if (failures == 0) printf("ok\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// Tray-only waiting with a real RenderThread and a fake window: entering the tray stops the
+// thread and releases drawing, and leaving it starts the thread again so a signalled frame is
+// drawn, over several cycles (a restarted thread that still saw the last quit never drew again).
+// Also a covered frame being retried, and the tray being unavailable.
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include "RenderThread.h"
+#include "Tray.h"
+
+namespace {
+	const uint32_t RECHECK_MS = 10;
+	const int SHOW = 5;
+	const int CYCLES = 5;
+
+	int failures = 0;
+
+	void Expect(bool condition, const char* what) {
+		if (condition) return;
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+
+	// Records the calls in order, the way the app would make them on the window
+	class FakeHost : public TrayHost {
+	public:
+		std::string calls;
+		bool iconAvailable = true;
+
+		bool AddTrayIcon() override {
+			calls += "add ";
+			return iconAvailable;
+		}
+
+		void RemoveTrayIcon() override { calls += "remove "; }
+		void HideWindow() override { calls += "hide "; }
+		void MinimizeWindow() override { calls += "minimize "; }
+		void RestoreWindow(int showCommand) override { calls += showCommand == SHOW ? "restore " : "restore? "; }
+		void ReleaseDrawing() override { calls += "release "; }
+		void PrepareDrawing() override { calls += "prepare "; }
+	};
+
+	// What the render thread did, for the test thread to wait on
+	class Frames {
+	public:
+		int drawn = 0;
+		int exits = 0;
+		bool covered = false;
+
+		bool Draw() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			drawn++;
+			m_changed.notify_all();
+			return !covered;
+		}
+
+		void Exit() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			exits++;
+		}
+
+		// True once at least count frames were drawn, false after a second without
+		bool WaitFor(int count) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			return m_changed.wait_for(lock, std::chrono::seconds(1), [this, count]() { return drawn >= count; });
+		}
+
+		int Drawn() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return drawn;
+		}
+
+		void SetCovered(bool value) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			covered = value;
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_changed;
+	};
+
+	void TestCycles() {
+		FakeHost host;
+		Frames frames;
+		RenderThread renderThread;
+		renderThread.SetCallbacks(nullptr, [&frames]() { return frames.Draw(); }, [&frames]() { frames.Exit(); }, RECHECK_MS);
+		Tray tray(host, renderThread);
+
+		Expect(renderThread.Start() && renderThread.Signal() && frames.WaitFor(1), "a signal draws a frame");
+
+		for (int cycle = 0; cycle < CYCLES; cycle++) {
+			host.calls.clear();
+			tray.Enter(true);
+			Expect(tray.InTray() && !renderThread.Running(), "in the tray the thread is stopped");
+			Expect(host.calls == "add hide release ", "icon, hide, then release once the thread is gone");
+			Expect(frames.exits == cycle + 1, "the thread released its own resources as it exited");
+			Expect(!renderThread.Signal(), "no thread to signal in the tray");
+
+			int drawn = frames.Drawn();
+			host.calls.clear();
+			Expect(tray.Leave(SHOW) && !tray.InTray() && renderThread.Running(), "leaving starts the thread");
+			Expect(host.calls == "remove prepare restore ", "prepared before the window shows");
+			Expect(renderThread.Signal() && frames.WaitFor(drawn + 1), "and the restored window repaints");
+		}
+
+		RenderThread::Stats stats = renderThread.GetStats();
+		Expect(stats.starts == CYCLES + 1 && stats.frames == CYCLES + 1, "one start and one frame per cycle");
+
+		tray.Enter(true);
+		host.calls.clear();
+		tray.Close();
+		Expect(host.calls == "remove " && !tray.InTray() && !renderThread.Running(), "closing in the tray removes the icon");
+	}
+
+	void TestCovered() {
+		Frames frames;
+		RenderThread renderThread;
+		renderThread.SetCallbacks(nullptr, [&frames]() { return frames.Draw(); }, nullptr, RECHECK_MS);
+		frames.SetCovered(true);
+		Expect(renderThread.Start() && renderThread.Signal() && frames.WaitFor(3), "a covered frame is retried");
+		int retried = frames.Drawn();
+		frames.SetCovered(false);
+		Expect(frames.WaitFor(retried + 1), "until it is drawn");
+		renderThread.Stop();
+
+		int drawn = frames.Drawn();
+		RenderThread::Stats stats = renderThread.GetStats();
+		Expect(stats.rechecks > 0 && stats.frames == static_cast<uint64_t>(drawn) && stats.rechecks == stats.frames - 1,
+			"every frame after the signalled one a recheck");
+	}
+
+	void TestUnavailable() {
+		FakeHost host;
+		Frames frames;
+		RenderThread renderThread;
+		renderThread.SetCallbacks(nullptr, [&frames]() { return frames.Draw(); }, nullptr, RECHECK_MS);
+		Tray tray(host, renderThread);
+		renderThread.Start();
+
+		tray.Enter(false);
+		Expect(host.calls == "minimize " && !tray.InTray() && renderThread.Running(), "no tray, minimized instead");
+		host.iconAvailable = false;
+		host.calls.clear();
+		tray.Enter(true);
+		Expect(host.calls == "add minimize " && !tray.InTray() && renderThread.Running(), "no icon, minimized instead");
+		host.calls.clear();
+		Expect(tray.Leave(SHOW) && host.calls.empty(), "leaving when not in the tray does nothing");
+	}
+}
+
+int main() {
+	TestCycles();
+	TestCovered();
+	TestUnavailable();
+
+	if (failures == 0) printf("ok\n");
+	return failures == 0 ? 0 : 1;
+}